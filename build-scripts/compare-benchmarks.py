@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+Compare two Catch2 XML benchmark reports, as produced by running a benchmark runner
+with `--reporter xml --out <file>`, and report how the mean time of each benchmark
+moved between them.
+
+Exits with a non-zero status when at least one benchmark present in both reports
+got slower by more than the given threshold.
+"""
+
+import argparse
+import sys
+import xml.etree.ElementTree as ET
+
+
+def load_results(fname):
+    results = {}
+    root = ET.parse(fname).getroot()
+    for testcase in root.iter("TestCase"):
+        for benchmark in testcase.iter("BenchmarkResults"):
+            mean = benchmark.find("mean")
+            if mean is None:
+                continue
+            name = "{}/{}".format(testcase.get("name"), benchmark.get("name"))
+            results[name] = (float(mean.get("value")), float(mean.get("lowerBound")), float(mean.get("upperBound")))
+    return results
+
+
+def format_ns(value):
+    for unit, divisor in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if value >= divisor:
+            return "{:.2f} {}".format(value / divisor, unit)
+    return "{:.2f} ns".format(value)
+
+
+def main():
+    argp = argparse.ArgumentParser(description="Compare two Catch2 XML benchmark reports")
+    argp.add_argument("baseline", help="XML report of the reference run")
+    argp.add_argument("candidate", help="XML report of the run to check")
+    argp.add_argument(
+        "--threshold",
+        type=float,
+        default=10.0,
+        help="Percentage of slowdown of the mean above which a benchmark is reported as a regression (default: 10)",
+    )
+    arguments = argp.parse_args()
+
+    baseline = load_results(arguments.baseline)
+    candidate = load_results(arguments.candidate)
+
+    regressions = 0
+    width = max((len(name) for name in baseline.keys() | candidate.keys()), default=0)
+    for name in sorted(baseline.keys() | candidate.keys()):
+        if name not in candidate:
+            print("{:<{}}  {:>12}  {:>12}  removed".format(name, width, format_ns(baseline[name][0]), "-"))
+            continue
+        if name not in baseline:
+            print("{:<{}}  {:>12}  {:>12}  new".format(name, width, "-", format_ns(candidate[name][0])))
+            continue
+
+        before, before_low, before_high = baseline[name]
+        after, after_low, after_high = candidate[name]
+        change = (after - before) * 100.0 / before if before > 0 else 0.0
+        status = ""
+        # only flag changes that are not explained by the noise of both runs
+        if change > arguments.threshold and after_low > before_high:
+            status = "REGRESSION"
+            regressions += 1
+        elif change < -arguments.threshold and after_high < before_low:
+            status = "improvement"
+        print(
+            "{:<{}}  {:>12}  {:>12}  {:+7.1f}%  {}".format(
+                name, width, format_ns(before), format_ns(after), change, status
+            ).rstrip()
+        )
+
+    if regressions > 0:
+        print("{} benchmark(s) regressed by more than {}%".format(regressions, arguments.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
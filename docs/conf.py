@@ -232,6 +232,7 @@ latex_logo = "common/powerdns-logo-500px.png"
 # One entry per manual page. List of tuples
 # (source start file, name, description, authors, manual section).
 descriptions = {
+    "axfrbench": "Benchmark the ingestion of a large AXFR",
     "calidns": "A DNS recursor testing tool",
     "dnsbulktest": "A debugging tool for intermittent resolver failures",
     "dnsgram": "A debugging tool for intermittent resolver failures",
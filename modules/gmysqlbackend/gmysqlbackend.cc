@@ -94,6 +94,7 @@ public:
     declare(suffix, "ssl", "Send the SSL capability flag to the server", "no");
 
     declare(suffix, "dnssec", "Enable DNSSEC processing", "no");
+    declare(suffix, "bulk-insert-batch-size", "Number of records sent to the database at once when loading a zone, 0 to insert them one by one", "1000");
 
     string record_query = "SELECT content,ttl,prio,type,domain_id,disabled,name,auth FROM records WHERE";
 
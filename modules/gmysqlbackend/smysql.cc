@@ -569,6 +569,11 @@ std::unique_ptr<SSqlStatement> SMySQL::prepare(const string& query, int nparams)
   return std::make_unique<SMySQLStatement>(d_slog, query, s_dolog, nparams, &d_db);
 }
 
+std::unique_ptr<SSqlBulkInserter> SMySQL::bulkInserter(const string& table, const vector<string>& columns, size_t batchSize)
+{
+  return std::make_unique<SSqlMultiRowInserter>(this, table, columns, batchSize, false);
+}
+
 void SMySQL::execute(const string& query)
 {
   if (s_dolog) {
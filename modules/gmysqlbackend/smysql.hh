@@ -42,6 +42,7 @@ public:
   void setLog(bool state) override;
   std::unique_ptr<SSqlStatement> prepare(const string& query, int nparams) override;
   void execute(const string& query) override;
+  std::unique_ptr<SSqlBulkInserter> bulkInserter(const string& table, const vector<string>& columns, size_t batchSize) override;
 
   void startTransaction() override;
   void commit() override;
@@ -101,6 +101,7 @@ public:
     declare(suffix, "prepared-statements", "Use prepared statements instead of parameterized queries", "yes");
 
     declare(suffix, "dnssec", "Enable DNSSEC processing", "no");
+    declare(suffix, "bulk-insert-batch-size", "Number of records sent to the database at once when loading a zone, 0 to insert them one by one", "1000");
 
     string record_query = "SELECT content,ttl,prio,type,domain_id,disabled::int,name,auth::int FROM records WHERE";
 
@@ -31,6 +31,7 @@
 #include "pdns/dns.hh"
 #include "pdns/namespaces.hh"
 #include <algorithm>
+#include <boost/algorithm/string/join.hpp>
 
 class SPgSQLStatement : public SSqlStatement
 {
@@ -407,6 +408,119 @@ std::unique_ptr<SSqlStatement> SPgSQL::prepare(const string& query, int nparams)
   return std::make_unique<SPgSQLStatement>(d_slog, query, s_dolog, nparams, this, d_nstatements);
 }
 
+// Bulk insertion through COPY ... FROM STDIN, one COPY per batch of rows so
+// that the connection is usable for other queries between batches.
+class SPgSQLCopyInserter : public SSqlBulkInserter
+{
+public:
+  SPgSQLCopyInserter(SPgSQL* database, const string& table, const vector<string>& columns, size_t batchSize) :
+    d_parent(database), d_query("COPY " + table + " (" + boost::join(columns, ",") + ") FROM STDIN"), d_columns(columns.size()), d_batchSize(std::max(batchSize, static_cast<size_t>(1)))
+  {
+  }
+
+  void addRow(row_t&& row) override
+  {
+    if (row.size() != d_columns) {
+      throw SSqlException("Bulk insertion of a row with " + std::to_string(row.size()) + " fields instead of " + std::to_string(d_columns));
+    }
+    for (size_t idx = 0; idx < row.size(); ++idx) {
+      if (idx != 0) {
+        d_buffer.append(1, '\t');
+      }
+      if (row[idx]) {
+        appendEscaped(*row[idx]);
+      }
+      else {
+        d_buffer.append("\\N");
+      }
+    }
+    d_buffer.append(1, '\n');
+    if (++d_rows >= d_batchSize) {
+      flush();
+    }
+  }
+
+  void flush() override
+  {
+    if (d_rows == 0) {
+      return;
+    }
+    // the rows are gone whether the insertion succeeds or not
+    string buffer;
+    buffer.swap(d_buffer);
+    d_rows = 0;
+
+    PGresult* res = PQexec(d_parent->db(), d_query.c_str());
+    ExecStatusType status = PQresultStatus(res);
+    string errmsg(PQresultErrorMessage(res));
+    PQclear(res);
+    if (status != PGRES_COPY_IN) {
+      throw SSqlException("Fatal error during COPY: " + d_query + string(": ") + errmsg);
+    }
+
+    if (PQputCopyData(d_parent->db(), buffer.data(), static_cast<int>(buffer.size())) != 1) {
+      PQputCopyEnd(d_parent->db(), "unable to send data");
+    }
+    else {
+      PQputCopyEnd(d_parent->db(), nullptr);
+    }
+
+    status = PGRES_COMMAND_OK;
+    while ((res = PQgetResult(d_parent->db())) != nullptr) {
+      if (PQresultStatus(res) != PGRES_COMMAND_OK && status == PGRES_COMMAND_OK) {
+        status = PQresultStatus(res);
+        errmsg = PQresultErrorMessage(res);
+      }
+      PQclear(res);
+    }
+    if (status != PGRES_COMMAND_OK) {
+      throw SSqlException("Fatal error during COPY: " + d_query + string(": ") + errmsg);
+    }
+  }
+
+  void discard() override
+  {
+    d_buffer.clear();
+    d_rows = 0;
+  }
+
+private:
+  // text format escaping, see the COPY documentation
+  void appendEscaped(const string& value)
+  {
+    for (const char chr : value) {
+      switch (chr) {
+      case '\\':
+        d_buffer.append("\\\\");
+        break;
+      case '\t':
+        d_buffer.append("\\t");
+        break;
+      case '\n':
+        d_buffer.append("\\n");
+        break;
+      case '\r':
+        d_buffer.append("\\r");
+        break;
+      default:
+        d_buffer.append(1, chr);
+      }
+    }
+  }
+
+  SPgSQL* d_parent;
+  string d_query;
+  string d_buffer;
+  size_t d_columns;
+  size_t d_batchSize;
+  size_t d_rows{0};
+};
+
+unique_ptr<SSqlBulkInserter> SPgSQL::bulkInserter(const string& table, const vector<string>& columns, size_t batchSize)
+{
+  return std::make_unique<SPgSQLCopyInserter>(this, table, columns, batchSize);
+}
+
 void SPgSQL::startTransaction()
 {
   execute("begin");
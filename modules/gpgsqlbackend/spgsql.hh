@@ -37,6 +37,7 @@ public:
   void setLog(bool state) override;
   unique_ptr<SSqlStatement> prepare(const string& query, int nparams) override;
   void execute(const string& query) override;
+  unique_ptr<SSqlBulkInserter> bulkInserter(const string& table, const vector<string>& columns, size_t batchSize) override;
 
   void startTransaction() override;
   void rollback() override;
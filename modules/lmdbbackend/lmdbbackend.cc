@@ -752,6 +752,7 @@ LMDBBackend::LMDBBackend(const std::string& suffix)
 
   d_write_notification_update = mustDo("write-notification-update");
   d_split_domains_table = mustDo("split-domains-table");
+  d_staged_import = mustDo("staged-import");
 
   if (mustDo("lightning-stream")) {
     d_random_ids = true;
@@ -1427,14 +1428,21 @@ bool LMDBBackend::startTransaction(const ZoneName& domain, domainid_t domain_id)
     }
     real_id = info.id;
   }
-  if (d_rwtxn) {
+  if (d_rwtxn || d_staged) {
     throw DBException("Attempt to start a transaction while one was open already");
   }
-  d_rwtxn = getRecordsRWTransaction(real_id);
-  d_txnorder = false;
-
   d_transactiondomain = domain;
   d_transactiondomainid = real_id;
+  d_txnorder = false;
+
+  if (domain_id != UnknownDomainID && d_staged_import) {
+    // The zone contents are replaced as a whole: the shard write lock will
+    // only be taken once they are complete, in writeStagedImport().
+    d_staged = std::make_unique<StagedImport>();
+    return true;
+  }
+
+  d_rwtxn = getRecordsRWTransaction(real_id);
   if (domain_id != UnknownDomainID) {
     compoundOrdername order;
     string match = order(domain_id);
@@ -1447,6 +1455,9 @@ bool LMDBBackend::startTransaction(const ZoneName& domain, domainid_t domain_id)
 bool LMDBBackend::commitTransaction()
 {
   // cout<<"Commit transaction" <<endl;
+  if (d_staged) {
+    writeStagedImport();
+  }
   if (!d_rwtxn) {
     throw DBException("Attempt to commit a transaction while there isn't one open");
   }
@@ -1456,9 +1467,46 @@ bool LMDBBackend::commitTransaction()
   return true;
 }
 
+// Replace the zone contents with the staged ones, in a single write
+// transaction, which is left open. The keys are written in order, and when
+// they all sort after the last key of the shard, as is the case for zones
+// created last, appended with MDB_APPEND.
+void LMDBBackend::writeStagedImport()
+{
+  auto staged = std::move(d_staged);
+
+  d_rwtxn = getRecordsRWTransaction(d_transactiondomainid);
+  d_txnorder = false;
+  compoundOrdername order;
+  LMDBBackend::deleteDomainRecords(*d_rwtxn, order(d_transactiondomainid));
+
+  int flags = 0;
+  if (!staged->records.empty()) {
+    auto cursor = d_rwtxn->txn->getCursor(d_rwtxn->db->rdbi);
+    // not cursor.last(), which skips entries flagged as deleted
+    MDB_val key{};
+    MDB_val val{};
+    int ret = mdb_cursor_get(cursor, &key, &val, MDB_LAST);
+    if (ret == MDB_NOTFOUND || (ret == 0 && std::string_view(static_cast<const char*>(key.mv_data), key.mv_size) < staged->records.begin()->first)) {
+      flags = MDB_APPEND;
+    }
+  }
+
+  for (auto& [key, val] : staged->records) {
+    d_rwtxn->txn->put_header_in_place(d_rwtxn->db->rdbi, key, val, flags);
+  }
+  for (const auto& [key, val] : staged->comments) {
+    d_rwtxn->txn->put(d_rwtxn->db->cdbi, key, val);
+  }
+}
+
 bool LMDBBackend::abortTransaction()
 {
   // cout<<"Abort transaction"<<endl;
+  if (d_staged) {
+    d_staged.reset();
+    return true;
+  }
   if (!d_rwtxn) {
     throw DBException("Attempt to abort a transaction while there isn't one open");
   }
@@ -1532,6 +1580,42 @@ void LMDBBackend::writeNSEC3RecordPair(const std::shared_ptr<RecordsRWTransactio
   txn->txn->put_header_in_place(txn->db->rdbi, co(domain_id, qname, QType::NSEC3), ser);
 }
 
+// Same as above, within a staged import.
+void LMDBBackend::writeNSEC3RecordPair(StagedImport& staged, domainid_t domain_id, const DNSName& qname, const DNSName& ordername)
+{
+  if (ordername == qname) {
+    return;
+  }
+
+  compoundOrdername co; // NOLINT(readability-identifier-length)
+
+  auto& forward = staged.records[co(domain_id, qname, QType::NSEC3)];
+  if (!forward.empty()) {
+    LMDBResourceRecord lrr;
+    if (deserializeFromBuffer(std::string_view(forward).substr(LMDBLS::LS_MIN_HEADER_SIZE), lrr)) {
+      DNSName prevordername(lrr.content.c_str(), lrr.content.size(), 0, false);
+      if (prevordername == ordername) {
+        return;
+      }
+      staged.records.erase(co(domain_id, prevordername, QType::NSEC3));
+    }
+  }
+
+  LMDBResourceRecord lrr;
+  lrr.auth = false;
+
+  lrr.ttl = 0;
+  lrr.content = qname.toDNSStringLC();
+  std::string ser = MDBRWTransactionImpl::stringWithEmptyHeader();
+  serializeToBuffer(ser, lrr);
+  staged.records[co(domain_id, ordername, QType::NSEC3)] = std::move(ser);
+
+  lrr.ttl = 1;
+  lrr.content = ordername.toDNSString();
+  forward = MDBRWTransactionImpl::stringWithEmptyHeader();
+  serializeToBuffer(forward, lrr);
+}
+
 // Check if the only records found for this particular name are a single NSEC3
 // record. (in which case there is no actual data for that qname and that
 // record needs to be deleted)
@@ -1572,6 +1656,18 @@ bool LMDBBackend::feedRecord(const DNSResourceRecord& r, const DNSName& ordernam
   compoundOrdername co;
   string matchName = co(lrr.domain_id, lrr.qname, lrr.qtype.getCode());
 
+  if (d_staged) {
+    auto& rrs = d_staged->records[matchName];
+    if (rrs.empty()) {
+      rrs = MDBRWTransactionImpl::stringWithEmptyHeader();
+    }
+    serializeToBuffer(rrs, lrr);
+    if (lrr.hasOrderName) {
+      writeNSEC3RecordPair(*d_staged, lrr.domain_id, lrr.qname, ordername);
+    }
+    return true;
+  }
+
   string rrs = MDBRWTransactionImpl::stringWithEmptyHeader();
   MDBOutVal _rrs;
   if (!d_rwtxn->txn->get(d_rwtxn->db->rdbi, matchName, _rrs)) {
@@ -1591,6 +1687,10 @@ bool LMDBBackend::feedComment(const Comment& comment)
 {
   auto [key, val] = serializeComment(comment);
 
+  if (d_staged) {
+    d_staged->comments[key] = std::move(val);
+    return true;
+  }
   d_rwtxn->txn->put(d_rwtxn->db->cdbi, key, val);
 
   return true;
@@ -1608,6 +1708,10 @@ bool LMDBBackend::feedEnts(domainid_t domain_id, map<DNSName, bool>& nonterm)
 
     std::string ser = MDBRWTransactionImpl::stringWithEmptyHeader();
     serializeToBuffer(ser, lrr);
+    if (d_staged) {
+      d_staged->records[co(domain_id, lrr.qname, QType::ENT)] = std::move(ser);
+      continue;
+    }
     d_rwtxn->txn->put_header_in_place(d_rwtxn->db->rdbi, co(domain_id, lrr.qname, QType::ENT), ser);
   }
   return true;
@@ -1625,11 +1729,21 @@ bool LMDBBackend::feedEnts3(domainid_t domain_id, const DNSName& domain, map<DNS
     lrr.hasOrderName = lrr.auth && !narrow;
     std::string ser = MDBRWTransactionImpl::stringWithEmptyHeader();
     serializeToBuffer(ser, lrr);
-    d_rwtxn->txn->put_header_in_place(d_rwtxn->db->rdbi, co(domain_id, lrr.qname, QType::ENT), ser);
+    if (d_staged) {
+      d_staged->records[co(domain_id, lrr.qname, QType::ENT)] = std::move(ser);
+    }
+    else {
+      d_rwtxn->txn->put_header_in_place(d_rwtxn->db->rdbi, co(domain_id, lrr.qname, QType::ENT), ser);
+    }
 
     if (lrr.hasOrderName) {
       ordername = DNSName(toBase32Hex(hashQNameWithSalt(ns3prc, nt.first)));
-      writeNSEC3RecordPair(d_rwtxn, domain_id, lrr.qname, ordername);
+      if (d_staged) {
+        writeNSEC3RecordPair(*d_staged, domain_id, lrr.qname, ordername);
+      }
+      else {
+        writeNSEC3RecordPair(d_rwtxn, domain_id, lrr.qname, ordername);
+      }
     }
   }
   return true;
@@ -1639,6 +1753,9 @@ bool LMDBBackend::feedEnts3(domainid_t domain_id, const DNSName& domain, map<DNS
 // NOLINTNEXTLINE(readability-identifier-length)
 bool LMDBBackend::replaceRRSet(domainid_t domain_id, const DNSName& qname, const QType& qt, const vector<DNSResourceRecord>& rrset)
 {
+  if (d_staged) {
+    writeStagedImport();
+  }
   // Paranoia
   if (!d_rwtxn || domain_id != d_transactiondomainid) {
     throw DBException("replaceRRSet invoked without an active transaction on the domain");
@@ -1717,6 +1834,9 @@ bool LMDBBackend::replaceComments(const domainid_t domain_id, const DNSName& qna
 {
   // delete all existing comments for the RRset
   // this could be smarter and not del+replace unchanged comments
+  if (d_staged) {
+    writeStagedImport();
+  }
   auto cursor = d_rwtxn->txn->getCursor(d_rwtxn->db->cdbi);
   MDBOutVal key{};
   MDBOutVal val{};
@@ -1962,7 +2082,7 @@ std::shared_ptr<LMDBBackend::RecordsROTransaction> LMDBBackend::getRecordsROTran
 
 bool LMDBBackend::deleteDomain(const ZoneName& domain)
 {
-  if (!d_rwtxn) {
+  if (!d_rwtxn && !d_staged) {
     throw DBException(std::string(__PRETTY_FUNCTION__) + " called without a transaction");
   }
 
@@ -2152,6 +2272,9 @@ void LMDBBackend::lookupInternal(const QType& type, const DNSName& qdomain, doma
 
 void LMDBBackend::lookupStart(domainid_t domain_id, const std::string& match, bool dolog)
 {
+  if (d_staged && domain_id == d_transactiondomainid) {
+    writeStagedImport();
+  }
   d_rotxn = getRecordsROTransaction(domain_id, d_rwtxn);
   d_txnorder = true;
   if (d_lookupstate.comments) {
@@ -3218,6 +3341,9 @@ bool LMDBBackend::getBeforeAndAfterNames(domainid_t domainId, const ZoneName& zo
 bool LMDBBackend::updateDNSSECOrderNameAndAuth(domainid_t domain_id, const DNSName& qname, const DNSName& ordername, bool auth, const uint16_t qtype, bool isNsec3)
 {
   //  cout << __PRETTY_FUNCTION__<< ": "<< domain_id <<", '"<<qname <<"', '"<<ordername<<"', "<<auth<< ", " << qtype << endl;
+  if (d_staged) {
+    writeStagedImport();
+  }
   // Paranoia
   if (!d_rwtxn || domain_id != d_transactiondomainid) {
     throw DBException("updateDNSSECOrderNameAndAuth invoked without an active transaction on the domain");
@@ -3300,6 +3426,9 @@ bool LMDBBackend::updateDNSSECOrderNameAndAuth(domainid_t domain_id, const DNSNa
 bool LMDBBackend::updateEmptyNonTerminals(domainid_t domain_id, set<DNSName>& insert, set<DNSName>& erase, bool remove)
 {
   // cout << __PRETTY_FUNCTION__<< ": "<< domain_id << ", insert.size() "<<insert.size()<<", "<<erase.size()<<", " <<remove<<endl;
+  if (d_staged) {
+    writeStagedImport();
+  }
   // Paranoia
   if (!d_rwtxn || domain_id != d_transactiondomainid) {
     throw DBException("updateEmptyNonTerminals invoked without an active transaction on the domain");
@@ -3704,11 +3833,25 @@ void LMDBBackend::rectifyZoneHook(domainid_t domain_id, bool before) const
     return;
   }
 
+  compoundOrdername order;
+  if (d_staged) {
+    auto match = order(domain_id);
+    auto& records = d_staged->records;
+    for (auto iter = records.lower_bound(match); iter != records.end() && iter->first.compare(0, match.size(), match) == 0;) {
+      if (compoundOrdername::getQType(iter->first) == QType::NSEC3) {
+        iter = records.erase(iter);
+      }
+      else {
+        ++iter;
+      }
+    }
+    return;
+  }
+
   if (!d_rwtxn) {
     throw DBException("rectifyZoneHook invoked outside of a transaction");
   }
 
-  compoundOrdername order;
   LMDBBackend::deleteDomainRecords(*d_rwtxn, order(domain_id), QType::NSEC3);
 }
 
@@ -3772,6 +3915,7 @@ public:
     declare(suffix, "write-notification-update", "Update domain table upon notification", "yes");
     declare(suffix, "split-domains-table", "Use a split domain table to reduce I/O load after XFR notifications", "no");
     declare(suffix, "lightning-stream", "Run in Lightning Stream compatible mode", "no");
+    declare(suffix, "staged-import", "Stage the contents of zones being replaced as a whole in memory, and only write them upon commit", "no");
   }
   DNSBackend* make(const string& suffix = "") override
   {
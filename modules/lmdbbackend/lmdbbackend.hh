@@ -356,6 +356,16 @@ private:
   shared_ptr<RecordsROTransaction> d_rotxn; // for lookup and list
   shared_ptr<RecordsRWTransaction> d_rwtxn; // for feedrecord within begin/aborttransaction
   bool d_txnorder{false}; // whether d_rotxn is more recent than d_rwtxn
+
+  // Contents of a zone being replaced as a whole, kept out of any write
+  // transaction until commit (see staged-import)
+  struct StagedImport
+  {
+    std::map<std::string, std::string> records; // values with room for a LSheader
+    std::map<std::string, std::string> comments;
+  };
+  std::unique_ptr<StagedImport> d_staged; // set instead of d_rwtxn within begin/aborttransaction
+  void writeStagedImport();
   void openAllTheDatabases();
   std::shared_ptr<RecordsRWTransaction> getRecordsRWTransaction(domainid_t id);
   std::shared_ptr<RecordsROTransaction> getRecordsROTransaction(domainid_t id, const std::shared_ptr<LMDBBackend::RecordsRWTransaction>& rwtxn = nullptr);
@@ -387,6 +397,7 @@ private:
   static bool hasOrphanedNSEC3Record(MDBRWCursor& cursor, domainid_t domain_id, const DNSName& qname);
   static void deleteNSEC3RecordPair(const std::shared_ptr<RecordsRWTransaction>& txn, domainid_t domain_id, const DNSName& qname);
   void writeNSEC3RecordPair(const std::shared_ptr<RecordsRWTransaction>& txn, domainid_t domain_id, const DNSName& qname, const DNSName& ordername);
+  static void writeNSEC3RecordPair(StagedImport& staged, domainid_t domain_id, const DNSName& qname, const DNSName& ordername);
 
   std::pair<std::string, std::string> serializeComment(const Comment& c);
 
@@ -452,6 +463,7 @@ private:
   bool d_views;
   bool d_write_notification_update;
   bool d_split_domains_table;
+  bool d_staged_import;
   DTime d_dtime; // used only for logging
   uint64_t d_mapsize_main;
   uint64_t d_mapsize_shards;
@@ -21,17 +21,20 @@
  */
 
 #include "auth-caches.hh"
+#include "auth-denialcache.hh"
 #include "auth-querycache.hh"
 #include "auth-packetcache.hh"
 
 extern AuthPacketCache PC;
 extern AuthQueryCache QC;
+extern AuthDenialCache DC;
 
 /* empty all caches */
 uint64_t purgeAuthCaches()
 {
   uint64_t ret = 0;
-  /* Clean query cache before packet cache to avoid potential race condition */
+  /* Clean denial and query cache before packet cache to avoid potential race condition */
+  DC.purge(); // not counted, it holds ranges rather than answers
   ret += QC.purge();
   ret += PC.purge();
   return ret;
@@ -41,7 +44,8 @@ uint64_t purgeAuthCaches()
 uint64_t purgeAuthCaches(const std::string& match)
 {
   uint64_t ret = 0;
-  /* Clean query cache before packet cache to avoid potential race condition */
+  /* Clean denial and query cache before packet cache to avoid potential race condition */
+  DC.purge(match);
   ret += QC.purge(match);
   ret += PC.purge(match);
   return ret;
@@ -51,7 +55,8 @@ uint64_t purgeAuthCaches(const std::string& match)
 uint64_t purgeAuthCachesExact(const DNSName& qname)
 {
   uint64_t ret = 0;
-  /* Clean query cache before packet cache to avoid potential race condition */
+  /* Clean denial and query cache before packet cache to avoid potential race condition */
+  DC.purgeExact(qname);
   ret += QC.purgeExact(qname);
   ret += PC.purgeExact(qname);
   return ret;
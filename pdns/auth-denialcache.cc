@@ -0,0 +1,193 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include "auth-denialcache.hh"
+
+extern StatBag S;
+
+AuthDenialCache::AuthDenialCache(size_t mapsCount) :
+  d_maps(mapsCount)
+{
+  S.declare("denial-cache-hit", "Number of hits on the denial cache");
+  S.declare("denial-cache-miss", "Number of misses on the denial cache");
+  S.declare("denial-cache-size", "Number of NSEC ranges in the denial cache", StatType::gauge);
+
+  d_statnumhit = S.getPointer("denial-cache-hit");
+  d_statnummiss = S.getPointer("denial-cache-miss");
+  d_statnumentries = S.getPointer("denial-cache-size");
+}
+
+DNSName AuthDenialCache::getClosestEncloser(const DNSName& qname, const DNSName& before, const DNSName& after)
+{
+  // every ancestor of qname that exists is an ancestor of one of the names bordering its gap
+  auto viaBefore = qname.getCommonLabels(before);
+  auto viaAfter = qname.getCommonLabels(after);
+  return viaBefore.countLabels() >= viaAfter.countLabels() ? viaBefore : viaAfter;
+}
+
+bool AuthDenialCache::get(const ZoneName& zone, domainid_t zoneID, uint32_t serial, const DNSName& qname, bool wantNSEC, std::vector<DNSZoneRecord>& nsecs)
+{
+  if (!enabled()) {
+    return false;
+  }
+
+  time_t now = time(nullptr);
+  auto& mc = getMap(zone);
+  {
+    auto map = mc.d_map.try_read_lock();
+    if (!map.owns_lock()) {
+      S.inc("deferred-cache-lookup");
+      return false;
+    }
+
+    auto zit = map->find(zone);
+    if (zit == map->end() || zit->second.zoneID != zoneID || zit->second.serial != serial) {
+      (*d_statnummiss)++;
+      return false;
+    }
+
+    // the last link whose 'before' sorts below qname is the only candidate
+    const auto& ranges = zit->second.ranges;
+    auto iter = ranges.lower_bound(qname);
+    if (iter == ranges.begin()) {
+      (*d_statnummiss)++;
+      return false;
+    }
+    --iter;
+
+    const auto& before = iter->first;
+    const auto& range = iter->second;
+    bool wraps = !before.canonCompare(range.after);
+    if (range.ttd <= now || (!wraps && !qname.canonCompare(range.after)) || (wantNSEC && range.nsecs.empty()) || getClosestEncloser(qname, before, range.after) != range.closestEncloser) {
+      (*d_statnummiss)++;
+      return false;
+    }
+
+    if (wantNSEC) {
+      nsecs.insert(nsecs.end(), range.nsecs.begin(), range.nsecs.end());
+    }
+  }
+  (*d_statnumhit)++;
+  return true;
+}
+
+void AuthDenialCache::insert(const ZoneName& zone, domainid_t zoneID, uint32_t serial, const DNSName& before, const DNSName& after, const DNSName& closestEncloser, std::vector<DNSZoneRecord>&& nsecs)
+{
+  if (!enabled() || before.empty() || after.empty()) {
+    return;
+  }
+
+  time_t now = time(nullptr);
+  auto& mc = getMap(zone);
+  {
+    auto map = mc.d_map.try_write_lock();
+    if (!map.owns_lock()) {
+      S.inc("deferred-cache-inserts");
+      return;
+    }
+
+    auto& entry = (*map)[zone];
+    if (entry.zoneID != zoneID || entry.serial != serial) {
+      *d_statnumentries -= entry.ranges.size();
+      entry.ranges.clear();
+      entry.zoneID = zoneID;
+      entry.serial = serial;
+      entry.nextPrune = now + d_ttl;
+    }
+    else if (entry.nextPrune <= now) {
+      for (auto iter = entry.ranges.begin(); iter != entry.ranges.end();) {
+        if (iter->second.ttd <= now) {
+          iter = entry.ranges.erase(iter);
+          --(*d_statnumentries);
+        }
+        else {
+          ++iter;
+        }
+      }
+      entry.nextPrune = now + d_ttl;
+    }
+
+    auto [iter, inserted] = entry.ranges.try_emplace(before);
+    auto& range = iter->second;
+    if (inserted) {
+      ++(*d_statnumentries);
+    }
+    else if (nsecs.empty() && !range.nsecs.empty() && range.ttd > now) {
+      // do not let a denial learned without DO replace one that carries its proof
+      return;
+    }
+    range.after = after;
+    range.closestEncloser = closestEncloser;
+    range.nsecs = std::move(nsecs);
+    range.ttd = now + d_ttl;
+  }
+}
+
+template <typename P>
+uint64_t AuthDenialCache::purgeZones(P pred)
+{
+  uint64_t delcount = 0;
+
+  for (auto& shard : d_maps) {
+    auto map = shard.d_map.write_lock();
+    for (auto iter = map->begin(); iter != map->end();) {
+      if (pred(iter->first)) {
+        delcount += iter->second.ranges.size();
+        iter = map->erase(iter);
+      }
+      else {
+        ++iter;
+      }
+    }
+  }
+  *d_statnumentries -= delcount;
+
+  return delcount;
+}
+
+uint64_t AuthDenialCache::purge()
+{
+  return purgeZones([](const ZoneName&) { return true; });
+}
+
+/* a change anywhere in a zone reshapes its NSEC chain, so purges drop whole zones:
+   those below a $ terminated suffix, and the zones containing the named entry */
+uint64_t AuthDenialCache::purge(const std::string& match)
+{
+  if (boost::ends_with(match, "$")) {
+    std::string prefix(match);
+    prefix.resize(prefix.size() - 1);
+    DNSName dprefix(prefix);
+    return purgeZones([&dprefix](const ZoneName& zone) { return zone.isPartOf(dprefix) || dprefix.isPartOf(zone); });
+  }
+  return purgeExact(DNSName(match));
+}
+
+uint64_t AuthDenialCache::purgeExact(const DNSName& qname)
+{
+  return purgeZones([&qname](const ZoneName& zone) { return qname.isPartOf(zone); });
+}
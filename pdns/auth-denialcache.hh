@@ -0,0 +1,118 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/utility.hpp>
+
+#include "dnsname.hh"
+#include "dnspacket.hh"
+#include "lock.hh"
+#include "logging.hh"
+#include "statbag.hh"
+
+/* Caches denial-of-existence for NSEC-signed zones by name range instead of by
+   exact name. Each entry is one link of the zone's NSEC chain ('before' to
+   'after') together with the closest encloser of the name it was learned from
+   and the NSEC records that proved it. Any other name that falls strictly
+   inside the same link and derives the same closest encloser gets the exact
+   same NXDOMAIN answer, so a flood of random subdomains costs one backend
+   walk per link instead of one per query name. */
+class AuthDenialCache : public boost::noncopyable
+{
+public:
+  AuthDenialCache(size_t mapsCount = 1024);
+
+  /* Looks up a cached denial covering qname in the given zone version. When
+     wantNSEC is set, only entries that carry their NSEC records qualify,
+     and these are appended to nsecs. */
+  bool get(const ZoneName& zone, domainid_t zoneID, uint32_t serial, const DNSName& qname, bool wantNSEC, std::vector<DNSZoneRecord>& nsecs);
+
+  /* Records that nothing exists strictly between before and after (after
+     wraps around to the apex for the last link), with closestEncloser as
+     the closest encloser of the name the denial was computed for. */
+  void insert(const ZoneName& zone, domainid_t zoneID, uint32_t serial, const DNSName& before, const DNSName& after, const DNSName& closestEncloser, std::vector<DNSZoneRecord>&& nsecs);
+
+  static DNSName getClosestEncloser(const DNSName& qname, const DNSName& before, const DNSName& after);
+
+  uint64_t purge();
+  uint64_t purge(const std::string& match); // could be $ terminated. Is not a dnsname!
+  uint64_t purgeExact(const DNSName& qname); // drops the zone(s) containing qname
+
+  size_t size() { return *d_statnumentries; } //!< number of ranges in the cache
+
+  void setTTL(uint32_t ttl)
+  {
+    d_ttl = ttl;
+  }
+  bool enabled() const
+  {
+    return d_ttl > 0;
+  }
+
+private:
+  struct Range
+  {
+    DNSName after;
+    DNSName closestEncloser;
+    std::vector<DNSZoneRecord> nsecs;
+    time_t ttd{0};
+  };
+
+  struct Zone
+  {
+    std::map<DNSName, Range, CanonDNSNameCompare> ranges; // keyed by 'before'
+    time_t nextPrune{0};
+    uint32_t serial{0};
+    domainid_t zoneID{UnknownDomainID};
+  };
+
+  using zonemap_t = std::unordered_map<ZoneName, Zone>;
+
+  struct MapCombo
+  {
+    MapCombo() = default;
+    ~MapCombo() = default;
+    MapCombo(const MapCombo&) = delete;
+    MapCombo& operator=(const MapCombo&) = delete;
+
+    SharedLockGuarded<zonemap_t> d_map;
+  };
+
+  std::vector<MapCombo> d_maps;
+  MapCombo& getMap(const ZoneName& zone)
+  {
+    return d_maps[zone.hash() % d_maps.size()];
+  }
+
+  template <typename P>
+  uint64_t purgeZones(P pred);
+
+  AtomicCounter* d_statnumhit;
+  AtomicCounter* d_statnummiss;
+  AtomicCounter* d_statnumentries;
+
+  uint32_t d_ttl{0};
+};
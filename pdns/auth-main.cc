@@ -111,6 +111,7 @@ bool g_doLuaRecord;
 int g_luaRecordExecLimit;
 time_t g_luaHealthChecksInterval{5};
 time_t g_luaHealthChecksExpireDelay{3600};
+size_t g_luaHealthChecksMaxConcurrent{256};
 time_t g_luaConsistentHashesExpireDelay{86400};
 time_t g_luaConsistentHashesCleanupInterval{3600};
 #endif
@@ -127,6 +128,7 @@ ArgvMap theArg;
 StatBag S; //!< Statistics are gathered across PDNS via the StatBag class S
 AuthPacketCache PC; //!< This is the main PacketCache, shared across all threads
 AuthQueryCache QC;
+AuthDenialCache DC;
 AuthZoneCache g_zoneCache;
 std::vector<std::unique_ptr<RemoteLogger>> g_remote_loggers;
 
@@ -172,6 +174,7 @@ static void declareArguments()
   ::arg().setSwitch("write-pid", "Write a PID file") = "yes";
   ::arg().set("allow-dnsupdate-from", "A global setting to allow DNS updates from these IP ranges.") = "127.0.0.0/8,::1";
   ::arg().setSwitch("dnsupdate-require-tsig", "Require TSIG secured DNS updates. Default is no.") = "no";
+  ::arg().set("dnsupdate-group-commit", "Maximum number of queued DNS updates to the same zone to apply in a single transaction, 1 disables grouping") = "1";
   ::arg().set("proxy-protocol-from", "A Proxy Protocol header is only allowed from these subnets, and is mandatory then too.") = "";
   ::arg().set("proxy-protocol-maximum-size", "The maximum size of a proxy protocol payload, including the TLV values") = "512";
   ::arg().setSwitch("send-signed-notify", "Send TSIG secured NOTIFY if TSIG key is configured for a zone") = "yes";
@@ -267,6 +270,7 @@ static void declareArguments()
   ::arg().set("carbon-interval", "Number of seconds between carbon (graphite) updates") = "30";
 
   ::arg().set("cache-ttl", "Seconds to store packets in the PacketCache") = "20";
+  ::arg().set("denial-cache-ttl", "Seconds to store NSEC ranges proving non-existence in the DenialCache, 0 to disable") = "60";
   ::arg().set("negquery-cache-ttl", "Seconds to store negative query results in the QueryCache") = "60";
   ::arg().set("query-cache-ttl", "Seconds to store query results in the QueryCache") = "20";
   ::arg().set("zone-cache-refresh-interval", "Seconds to cache list of known zones") = "300";
@@ -330,6 +334,7 @@ static void declareArguments()
   ::arg().set("lua-records-exec-limit", "Lua records scripts execution limit (instructions count). Values <= 0 mean no limit") = "1000";
   ::arg().set("lua-health-checks-expire-delay", "Stops doing health checks after the record hasn't been used for that delay (in seconds)") = "3600";
   ::arg().set("lua-health-checks-interval", "Lua records health checks monitoring interval in seconds") = "5";
+  ::arg().set("lua-health-checks-max-concurrent", "Maximum number of Lua records health checks in progress at the same time") = "256";
   ::arg().set("lua-consistent-hashes-cleanup-interval", "Pre-computed hashes cleanup interval (in seconds)") = "3600";
   ::arg().set("lua-consistent-hashes-expire-delay", "Cleanup pre-computed hashes that haven't been used for the given delay (in seconds). See pickchashed() Lua function") = "86400";
 #endif
@@ -338,6 +343,7 @@ static void declareArguments()
   ::arg().set("lua-axfr-script", "Script to be used to edit incoming AXFRs") = "";
   ::arg().set("xfr-max-received-mbytes", "Maximum number of megabytes received from an incoming XFR") = "100";
   ::arg().set("axfr-fetch-timeout", "Maximum time in seconds for inbound AXFR to start or be idle after starting") = "10";
+  ::arg().set("axfr-spool-records", "Number of records of an inbound AXFR kept in memory before spooling them to a temporary file, 0 to keep all of them in memory") = "100000";
 
   ::arg().set("tcp-fast-open", "Enable TCP Fast Open support on the listening sockets, using the supplied numerical value as the queue size") = "0";
 
@@ -516,6 +522,14 @@ static void declareStats()
   S.declare("key-cache-size", "Number of entries in the key cache", DNSSECKeeper::dbdnssecCacheSizes, StatType::gauge);
   S.declare("signature-cache-size", "Number of entries in the signature cache", signatureCacheSize, StatType::gauge);
 
+#ifdef HAVE_LUA_RECORDS
+  S.declare("lua-health-checks", "Number of Lua records health checks performed", getLuaHealthChecksStat, StatType::counter);
+  S.declare("lua-health-checks-failed", "Number of Lua records health checks that failed", getLuaHealthChecksStat, StatType::counter);
+  S.declare("lua-health-checks-in-progress", "Number of Lua records health checks currently in progress", getLuaHealthChecksStat, StatType::gauge);
+  S.declare("lua-health-checks-queued", "Number of due Lua records health checks waiting for a free slot", getLuaHealthChecksStat, StatType::gauge);
+  S.declare("lua-health-checks-latency", "Average number of microseconds needed to perform a Lua records health check", getLuaHealthChecksStat, StatType::gauge);
+#endif
+
   S.declare("nxdomain-packets", "Number of times an NXDOMAIN packet was sent out");
   S.declare("noerror-packets", "Number of times a NOERROR packet was sent out");
   S.declare("servfail-packets", "Number of times a server-failed packet was sent out");
@@ -836,6 +850,7 @@ static void mainthread()
   g_luaConsistentHashesExpireDelay = ::arg().asNum("lua-consistent-hashes-expire-delay");
   g_luaConsistentHashesCleanupInterval = ::arg().asNum("lua-consistent-hashes-cleanup-interval");
   g_luaHealthChecksExpireDelay = ::arg().asNum("lua-health-checks-expire-delay");
+  g_luaHealthChecksMaxConcurrent = std::max(::arg().asNum("lua-health-checks-max-concurrent"), 1);
 #endif
 #ifdef ENABLE_GSS_TSIG
   g_doGssTSIG = ::arg().mustDo("enable-gss-tsig");
@@ -909,6 +924,7 @@ static void mainthread()
   PC.setMaxEntries(::arg().asNum("max-packet-cache-entries"));
   QC.setSLog(slog);
   QC.setMaxEntries(::arg().asNum("max-cache-entries"));
+  DC.setTTL(::arg().asNum("denial-cache-ttl"));
   DNSSECKeeper::setMaxEntries(::arg().asNum("max-cache-entries"));
 
   if (!PC.enabled() && ::arg().mustDo("log-dns-queries")) {
@@ -1726,6 +1742,9 @@ int main(int argc, char** argv)
     DynListener::registerFunc("CURRENT-CONFIG", &DLCurrentConfigHandler, "retrieve the current configuration", "[diff]");
     DynListener::registerFunc("FLUSH", &DLFlushHandler, "flush backend data");
     DynListener::registerFunc("LIST-ZONES", &DLListZones, "show list of zones", "[primary|secondary|native|consumer|producer]");
+#ifdef HAVE_LUA_RECORDS
+    DynListener::registerFunc("LUA-HEALTH-CHECKS", &DLLuaHealthChecksHandler, "show the status of the Lua records health checks");
+#endif /* HAVE_LUA_RECORDS */
     DynListener::registerFunc("NOTIFY", &DLNotifyHandler, "queue a notification", "<zone>");
     DynListener::registerFunc("NOTIFY-HOST", &DLNotifyHostHandler, "notify host for specific zone", "<zone> <host>");
     DynListener::registerFunc("PURGE", &DLPurgeHandler, "purge entries from packet cache", "[<record>]");
@@ -35,6 +35,7 @@
 #include "ueberbackend.hh"
 #include "packethandler.hh"
 #include "axfr-retriever.hh"
+#include "axfr-spool.hh"
 #include "logger.hh"
 #include "dns.hh"
 #include "arguments.hh"
@@ -683,10 +684,9 @@ static bool processRecordForZS(const DNSName& domain, bool& firstNSEC3, DNSResou
    5) It updates the Empty Non Terminals
 */
 
-static vector<DNSResourceRecord> doAxfr(const TSIGTriplet& tt, const ComboAddress& laddr, unique_ptr<AuthLua4>& pdl, XFRContext& ctx) // NOLINT(readability-identifier-length)
+static void doAxfr(const TSIGTriplet& tt, const ComboAddress& laddr, unique_ptr<AuthLua4>& pdl, XFRContext& ctx, AXFRSpool& rrs) // NOLINT(readability-identifier-length)
 {
   uint16_t axfr_timeout = ::arg().asNum("axfr-fetch-timeout");
-  vector<DNSResourceRecord> rrs;
   AXFRRetriever retriever(ctx.slog, ctx.remote, ctx.domain.zone, tt, (laddr.sin4.sin_family == 0) ? nullptr : &laddr, ((size_t)::arg().asNum("xfr-max-received-mbytes")) * 1024 * 1024, axfr_timeout);
   Resolver::res_t recs;
   bool first = true;
@@ -740,11 +740,10 @@ static vector<DNSResourceRecord> doAxfr(const TSIGTriplet& tt, const ComboAddres
           soa_received = true;
         }
 
-        rrs.push_back(rr);
+        rrs.add(std::move(rr));
       }
     }
   }
-  return rrs;
 }
 
 void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote, bool force) // NOLINT(readability-function-cognitive-complexity)
@@ -860,7 +859,8 @@ void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote,
     NSEC3PARAMRecordContent hadNs3pr;
     bool hadNarrow = false;
 
-    vector<DNSResourceRecord> rrs;
+    // Catalog zones need to be processed as a whole, and are small
+    AXFRSpool rrs(ctx.domain.kind == DomainInfo::Consumer ? 0 : ::arg().asNum("axfr-spool-records"));
     if (dk.isSecuredZone(domain, false)) {
       hadDnssecZone = true;
       hadPresigned = dk.isPresigned(domain, false);
@@ -889,7 +889,6 @@ void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote,
           }
           bool firstNSEC3{true};
           bool soa_received{false};
-          rrs.reserve(axfr.size());
           for (const auto& dr : axfr) { // NOLINT(readability-identifier-length)
             auto rr = DNSResourceRecord::fromWire(dr); // NOLINT(readability-identifier-length)
             rr.qname += domain.operator const DNSName&();
@@ -906,8 +905,10 @@ void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote,
               ctx.soa_serial = sd->d_st.serial;
               soa_received = true;
             }
-            rrs.emplace_back(std::move(rr));
+            rrs.add(std::move(rr));
           }
+          axfr.clear();
+          axfr.shrink_to_fit();
         }
         else {
           SLOG(g_log << Logger::Warning << ctx.logPrefix << "got " << ctx.numDeltas << " delta" << addS(ctx.numDeltas) << ", zone committed with serial " << ctx.soa_serial << endl,
@@ -921,13 +922,25 @@ void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote,
     if (rrs.empty()) {
       SLOG(g_log << Logger::Notice << ctx.logPrefix << "starting AXFR" << endl,
            ctx.slog->info(Logr::Notice, "AXFR: starting"));
-      rrs = doAxfr(tt, laddr, pdl, ctx);
+      doAxfr(tt, laddr, pdl, ctx, rrs);
       SLOG(g_log << Logger::Notice << ctx.logPrefix << "retrieval finished" << endl,
            ctx.slog->info(Logr::Notice, "AXFR: retrieval finished"));
     }
 
+    if (!rrs.spillError().empty()) {
+      SLOG(g_log << Logger::Warning << ctx.logPrefix << "could not spool records to disk, kept all of them in memory: " << rrs.spillError() << endl,
+           ctx.slog->info(Logr::Warning, "AXFR: could not spool records to disk, kept all of them in memory", "error", Logging::Loggable(rrs.spillError())));
+    }
+    else if (rrs.spilledBytes() > 0) {
+      SLOG(g_log << Logger::Info << ctx.logPrefix << "spooled " << rrs.spilledBytes() << " bytes of records to disk" << endl,
+           ctx.slog->info(Logr::Info, "AXFR: spooled records to disk", "bytes", Logging::Loggable(rrs.spilledBytes())));
+    }
+
     if (ctx.domain.kind == DomainInfo::Consumer) {
-      if (!catalogProcess(ctx, rrs)) {
+      vector<DNSResourceRecord> catalogRecords;
+      catalogRecords.reserve(rrs.size());
+      rrs.forEach([&catalogRecords](DNSResourceRecord& rr) { catalogRecords.push_back(rr); }); // NOLINT(readability-identifier-length)
+      if (!catalogProcess(ctx, catalogRecords)) {
         SLOG(g_log << Logger::Warning << ctx.logPrefix << "Catalog-Zone update failed, only import records" << endl,
              ctx.slog->info(Logr::Warning, "AXFR: Catalog-Zone update failed, only records will be imported"));
       }
@@ -964,14 +977,10 @@ void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote,
     }
 
     // Do not perform Lua records updates if not allowed to.
-    if (!::arg().mustDo("enable-lua-record-updates")) {
-      for (DNSResourceRecord& drr : rrs) {
-        if (drr.qtype.getCode() == QType::LUA) {
-          SLOG(g_log << Logger::Warning << ctx.logPrefix << "refused as it contains Lua record updates" << endl,
-               ctx.slog->info(Logr::Warning, "AXFR: refused as it contains Lua record updates"));
-          return;
-        }
-      }
+    if (!::arg().mustDo("enable-lua-record-updates") && rrs.containsType(QType::LUA)) {
+      SLOG(g_log << Logger::Warning << ctx.logPrefix << "refused as it contains Lua record updates" << endl,
+           ctx.slog->info(Logr::Warning, "AXFR: refused as it contains Lua record updates"));
+      return;
     }
     transaction = ctx.domain.backend->startTransaction(domain, ctx.domain.id);
     SLOG(g_log << Logger::Info << ctx.logPrefix << "storage transaction started" << endl,
@@ -1019,13 +1028,14 @@ void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote,
     set<DNSName> rrterm;
     map<DNSName, bool> nonterm;
 
-    for (DNSResourceRecord& rr : rrs) { // NOLINT(readability-identifier-length)
+    const bool directDNSKEY = ::arg().mustDo("direct-dnskey");
+    rrs.forEach([&](DNSResourceRecord& rr) { // NOLINT(readability-identifier-length)
       if (!ctx.isPresigned) {
         if (rr.qtype.getCode() == QType::RRSIG) {
-          continue;
+          return;
         }
-        if (ctx.isDnssecZone && rr.qtype.getCode() == QType::DNSKEY && !::arg().mustDo("direct-dnskey")) {
-          continue;
+        if (ctx.isDnssecZone && rr.qtype.getCode() == QType::DNSKEY && !directDNSKEY) {
+          return;
         }
       }
 
@@ -1106,7 +1116,7 @@ void CommunicatorClass::suck(const ZoneName& domain, const ComboAddress& remote,
       else {
         ctx.domain.backend->feedRecord(rr, DNSName());
       }
-    }
+    });
 
     // Insert empty non-terminals
     if (doent && !nonterm.empty()) {
@@ -154,58 +154,63 @@ void AuthZoneCache::replace(const vector<std::tuple<ZoneName, domainid_t>>& zone
   if (!d_refreshinterval)
     return;
 
-  size_t count = zone_indices.size();
-  vector<cmap_t> newMaps(d_maps.size());
-
-  // build new maps
-  for (const auto& [zone, id] : zone_indices) {
-    CacheValue val;
-    val.zoneId = id;
-    auto& mc = newMaps[getMapIndex(zone)];
-    auto iter = mc.find(zone);
-    if (iter != mc.end()) {
-      iter->second = val;
-    }
-    else {
-      mc.emplace(zone, val);
-    }
+  // Group the zone list by shard, so that each shard can be rebuilt and
+  // compared on its own. Only one shard worth of new data is alive at any
+  // time, and shards which did not change are never write-locked, so
+  // lookups only ever wait for the swap of the one shard they hash to.
+  vector<vector<size_t>> byShard(d_maps.size());
+  for (size_t idx = 0; idx < zone_indices.size(); idx++) {
+    byShard[getMapIndex(std::get<0>(zone_indices[idx]))].push_back(idx);
   }
 
-  {
+  size_t count = 0;
+  size_t changedShards = 0;
+  for (size_t mapIndex = 0; mapIndex < d_maps.size(); mapIndex++) {
+    cmap_t newMap;
+    newMap.reserve(byShard[mapIndex].size());
+    for (auto idx : byShard[mapIndex]) {
+      const auto& [zone, id] = zone_indices[idx];
+      newMap.insert_or_assign(zone, CacheValue{id});
+    }
+    vector<size_t>().swap(byShard[mapIndex]);
+
     // process zone updates done while data collection for replace() was already in progress.
+    // The pending lock is held until the shard has been swapped, so that a concurrent add()
+    // or remove() either shows up in the pending list or lands on top of the new shard.
     auto pending = d_pending.lock();
     assert(pending->d_replacePending); // make sure we never forget to call setReplacePending()
     for (const auto& [zone, id, insert] : pending->d_pendingUpdates) {
-      CacheValue val;
-      val.zoneId = id;
-      auto& mc = newMaps[getMapIndex(zone)];
-      auto iter = mc.find(zone);
-      if (iter != mc.end()) {
-        if (insert) {
-          iter->second = val;
-        }
-        else {
-          mc.erase(iter);
-          count--;
-        }
+      if (getMapIndex(zone) != mapIndex) {
+        continue;
       }
-      else if (insert) {
-        mc.emplace(zone, val);
-        count++;
+      if (insert) {
+        newMap.insert_or_assign(zone, CacheValue{id});
+      }
+      else {
+        newMap.erase(zone);
       }
     }
+    count += newMap.size();
 
-    for (size_t mapIndex = 0; mapIndex < d_maps.size(); mapIndex++) {
-      auto& mc = d_maps[mapIndex];
+    auto& mc = d_maps[mapIndex];
+    if (*mc.d_map.read_lock() == newMap) {
+      continue;
+    }
+    {
       auto map = mc.d_map.write_lock();
-      *map = std::move(newMaps[mapIndex]);
+      map->swap(newMap);
     }
+    changedShards++;
+  }
 
+  {
+    auto pending = d_pending.lock();
     pending->d_pendingUpdates.clear();
     pending->d_replacePending = false;
-
-    d_statnumentries->store(count);
   }
+
+  d_statnumentries->store(count);
+  d_lastChangedShards = changedShards;
 }
 
 void AuthZoneCache::replace(NetmaskTree<string> nettree)
@@ -216,6 +221,9 @@ void AuthZoneCache::replace(NetmaskTree<string> nettree)
 
 void AuthZoneCache::replace(ViewsMap viewsmap)
 {
+  if (*d_views.read_lock() == viewsmap) {
+    return;
+  }
   auto views = d_views.write_lock();
   views->swap(viewsmap);
 }
@@ -62,6 +62,7 @@ public:
   void setZoneVariant(DNSPacket& packet);
 
   size_t size() { return *d_statnumentries; } //!< number of entries in the cache
+  size_t lastChangedShards() const { return d_lastChangedShards; } //!< number of shards modified by the last replace()
 
   uint32_t getRefreshInterval() const
   {
@@ -90,6 +91,11 @@ private:
   struct CacheValue
   {
     domainid_t zoneId{UnknownDomainID};
+
+    bool operator==(const CacheValue& rhs) const
+    {
+      return zoneId == rhs.zoneId;
+    }
   };
 
   typedef std::unordered_map<ZoneName, CacheValue, std::hash<ZoneName>> cmap_t;
@@ -119,6 +125,7 @@ private:
   AtomicCounter* d_statnumentries;
 
   time_t d_refreshinterval{0};
+  std::atomic<size_t> d_lastChangedShards{0};
 
   struct PendingData
   {
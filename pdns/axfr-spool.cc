@@ -0,0 +1,163 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstdlib>
+#include <unistd.h>
+
+#include "axfr-spool.hh"
+#include "pdnsexception.hh"
+
+AXFRSpool::AXFRSpool(size_t maxInMemory) :
+  d_maxInMemory(maxInMemory)
+{
+  if (d_maxInMemory > 0) {
+    d_records.reserve(d_maxInMemory);
+  }
+}
+
+void AXFRSpool::add(DNSResourceRecord&& record)
+{
+  d_types.insert(record.qtype.getCode());
+  d_records.push_back(std::move(record));
+  ++d_count;
+  if (d_maxInMemory > 0 && d_records.size() >= d_maxInMemory) {
+    spill();
+  }
+}
+
+template <typename T>
+static void appendValue(std::string& buffer, const T& value)
+{
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(value)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+template <typename T>
+static bool readValue(FILE* filePtr, T& value)
+{
+  return fread(&value, sizeof(value), 1, filePtr) == 1;
+}
+
+static bool readString(FILE* filePtr, std::string& value, size_t length)
+{
+  value.resize(length);
+  return length == 0 || fread(value.data(), length, 1, filePtr) == 1;
+}
+
+void AXFRSpool::spill()
+{
+  if (!d_file) {
+    const char* tmpDir = getenv("TMPDIR"); // NOLINT(concurrency-mt-unsafe)
+    std::string path = std::string(tmpDir != nullptr ? tmpDir : "/tmp") + "/pdns-axfr-XXXXXX";
+    int fileDesc = mkstemp(path.data());
+    if (fileDesc < 0) {
+      d_spillError = "unable to create temporary file in '" + path + "': " + stringerror();
+      d_maxInMemory = 0;
+      return;
+    }
+    unlink(path.c_str());
+    d_file = pdns::UniqueFilePtr(fdopen(fileDesc, "w+"));
+    if (!d_file) {
+      d_spillError = "unable to open temporary file: " + stringerror();
+      close(fileDesc);
+      d_maxInMemory = 0;
+      return;
+    }
+  }
+
+  for (const auto& record : d_records) {
+    d_buffer.clear();
+    const auto qname = record.qname.toDNSString();
+    appendValue(d_buffer, static_cast<uint8_t>(qname.size()));
+    d_buffer.append(qname);
+    appendValue(d_buffer, static_cast<uint32_t>(record.content.size()));
+    d_buffer.append(record.content);
+    appendValue(d_buffer, static_cast<int64_t>(record.last_modified));
+    appendValue(d_buffer, record.ttl);
+    appendValue(d_buffer, record.signttl);
+    appendValue(d_buffer, record.domain_id);
+    appendValue(d_buffer, record.qtype.getCode());
+    appendValue(d_buffer, record.qclass);
+    appendValue(d_buffer, record.scopeMask);
+    appendValue(d_buffer, static_cast<uint8_t>(record.auth));
+    appendValue(d_buffer, static_cast<uint8_t>(record.disabled));
+    if (fwrite(d_buffer.data(), d_buffer.size(), 1, d_file.get()) != 1) {
+      throw PDNSException("Error writing the zone transfer to a temporary file: " + stringerror());
+    }
+    d_spilledBytes += d_buffer.size();
+  }
+  d_spilledCount += d_records.size();
+  d_records.clear();
+}
+
+bool AXFRSpool::readRecord(DNSResourceRecord& record)
+{
+  uint8_t qnameLength{0};
+  uint32_t contentLength{0};
+  int64_t lastModified{0};
+  uint16_t qtype{0};
+  uint8_t auth{0};
+  uint8_t disabled{0};
+
+  if (!readValue(d_file.get(), qnameLength) || !readString(d_file.get(), d_buffer, qnameLength)) {
+    return false;
+  }
+  record.qname = DNSName(d_buffer.data(), d_buffer.size(), 0, false);
+  if (!readValue(d_file.get(), contentLength) || !readString(d_file.get(), record.content, contentLength)) {
+    return false;
+  }
+  if (!readValue(d_file.get(), lastModified) || !readValue(d_file.get(), record.ttl) || !readValue(d_file.get(), record.signttl) || !readValue(d_file.get(), record.domain_id) || !readValue(d_file.get(), qtype) || !readValue(d_file.get(), record.qclass) || !readValue(d_file.get(), record.scopeMask) || !readValue(d_file.get(), auth) || !readValue(d_file.get(), disabled)) {
+    return false;
+  }
+  record.last_modified = static_cast<time_t>(lastModified);
+  record.qtype = qtype;
+  record.auth = auth != 0;
+  record.disabled = disabled != 0;
+  record.ordername.clear();
+  record.wildcardname.clear();
+  return true;
+}
+
+void AXFRSpool::forEach(const std::function<void(DNSResourceRecord&)>& func)
+{
+  if (d_file) {
+    if (fflush(d_file.get()) != 0 || fseeko(d_file.get(), 0, SEEK_SET) != 0) {
+      throw PDNSException("Error rewinding the temporary file holding the zone transfer: " + stringerror());
+    }
+    DNSResourceRecord record;
+    for (size_t idx = 0; idx < d_spilledCount; ++idx) {
+      if (!readRecord(record)) {
+        throw PDNSException("Error reading the zone transfer back from its temporary file");
+      }
+      func(record);
+    }
+    if (fseeko(d_file.get(), 0, SEEK_END) != 0) {
+      throw PDNSException("Error seeking in the temporary file holding the zone transfer: " + stringerror());
+    }
+  }
+
+  for (auto& record : d_records) {
+    func(record);
+  }
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+
+#include "dns.hh"
+#include "misc.hh"
+
+/* Holds the records of an incoming zone transfer until they can be committed.
+   Once more than maxInMemory records have been added, the records held in memory are
+   written to an unlinked temporary file, so the memory needed for a large zone stays
+   bounded. Records are handed back in the order they were added.
+   The ordername and wildcardname of the records are not preserved. */
+class AXFRSpool : public boost::noncopyable
+{
+public:
+  /* 0 means that all records are kept in memory */
+  explicit AXFRSpool(size_t maxInMemory);
+
+  void add(DNSResourceRecord&& record);
+  /* calls func on every record, in order. Whether changes made by func to a record
+     are seen by a later call is unspecified */
+  void forEach(const std::function<void(DNSResourceRecord&)>& func);
+
+  [[nodiscard]] size_t size() const
+  {
+    return d_count;
+  }
+  [[nodiscard]] bool empty() const
+  {
+    return d_count == 0;
+  }
+  [[nodiscard]] bool containsType(uint16_t qtype) const
+  {
+    return d_types.count(qtype) != 0;
+  }
+  /* number of bytes written to the temporary file */
+  [[nodiscard]] size_t spilledBytes() const
+  {
+    return d_spilledBytes;
+  }
+  /* set if the temporary file could not be created, in which case everything is kept in memory */
+  [[nodiscard]] const std::string& spillError() const
+  {
+    return d_spillError;
+  }
+
+private:
+  void spill();
+  bool readRecord(DNSResourceRecord& record);
+
+  std::vector<DNSResourceRecord> d_records;
+  std::set<uint16_t> d_types;
+  std::string d_buffer;
+  std::string d_spillError;
+  pdns::UniqueFilePtr d_file{nullptr};
+  size_t d_maxInMemory;
+  size_t d_count{0};
+  size_t d_spilledCount{0};
+  size_t d_spilledBytes{0};
+};
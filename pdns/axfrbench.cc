@@ -0,0 +1,252 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <csignal>
+#include <sys/resource.h>
+#include <thread>
+
+#include "arguments.hh"
+#include "axfr-retriever.hh"
+#include "axfr-spool.hh"
+#include "dnsrecords.hh"
+#include "dnswriter.hh"
+#include "ixfrutils.hh"
+#include "misc.hh"
+#include "sstuff.hh"
+#include "statbag.hh"
+
+StatBag S;
+
+bool g_slogStructured{false};
+
+ArgvMap &arg()
+{
+  static ArgvMap theArg;
+  return theArg;
+}
+
+static void usage() {
+  cerr<<"Syntax: axfrbench ixfrdist NUMBER-OF-RECORDS DIRECTORY"<<endl;
+  cerr<<"Syntax: axfrbench secondary NUMBER-OF-RECORDS [SPOOL-RECORDS]"<<endl;
+}
+
+static const ZoneName s_zone("axfrbench.example.");
+
+static std::shared_ptr<SOARecordContent> makeSOA()
+{
+  return std::make_shared<SOARecordContent>("ns1.axfrbench.example. hostmaster.axfrbench.example. 2024010101 3600 600 604800 3600");
+}
+
+static void sendMessage(Socket& sock, const vector<uint8_t>& packet)
+{
+  uint16_t len = htons(packet.size());
+  string buffer(reinterpret_cast<const char*>(&len), sizeof(len)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  buffer.append(packet.begin(), packet.end());
+  sock.writen(buffer);
+}
+
+/* Serves a synthetic zone of numRecords A and TXT records to the first client, over AXFR */
+static void serveAXFR(Socket* listener, size_t numRecords)
+try {
+  std::unique_ptr<Socket> sock(listener->accept());
+
+  uint16_t len{0};
+  sock->read(reinterpret_cast<char*>(&len), sizeof(len)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  string query;
+  query.resize(ntohs(len));
+  sock->read(query.data(), query.size());
+  MOADNSParser mdp(true, query);
+
+  const auto soa = makeSOA();
+  const DNSName apex(s_zone.operator const DNSName&());
+  vector<uint8_t> packet;
+  auto newPacket = [&](std::unique_ptr<DNSPacketWriter>& writer) {
+    packet.clear();
+    writer = std::make_unique<DNSPacketWriter>(packet, mdp.d_qname, mdp.d_qtype);
+    writer->getHeader()->id = mdp.d_header.id;
+    writer->getHeader()->qr = 1;
+    writer->getHeader()->aa = 1;
+  };
+
+  std::unique_ptr<DNSPacketWriter> writer;
+  newPacket(writer);
+  writer->startRecord(apex, QType::SOA, 3600);
+  soa->toPacket(*writer);
+
+  for (size_t idx = 0; idx < numRecords; ++idx) {
+    if (writer->size() > 16384) {
+      writer->commit();
+      sendMessage(*sock, packet);
+      newPacket(writer);
+    }
+    const DNSName name = DNSName("host" + std::to_string(idx)) + apex;
+    if (idx % 4 == 3) {
+      writer->startRecord(name, QType::TXT, 3600);
+      TXTRecordContent("\"synthetic record number " + std::to_string(idx) + "\"").toPacket(*writer);
+    }
+    else {
+      writer->startRecord(name, QType::A, 3600);
+      ARecordContent(ComboAddress(std::to_string(10 + ((idx >> 16) & 0xff)) + "." + std::to_string((idx >> 8) & 0xff) + "." + std::to_string(idx & 0xff) + ".1")).toPacket(*writer);
+    }
+  }
+
+  writer->startRecord(apex, QType::SOA, 3600);
+  soa->toPacket(*writer);
+  writer->commit();
+  sendMessage(*sock, packet);
+}
+catch (const std::exception& e) {
+  cerr<<"Error while serving the AXFR: "<<e.what()<<endl;
+}
+catch (const PDNSException& e) {
+  cerr<<"Error while serving the AXFR: "<<e.reason<<endl;
+}
+
+static const uint16_t s_timeout{60};
+
+/* what ixfrdist does: keep the zone in memory to serve it, and write it to disk */
+static size_t ingestLikeIxfrdist(const ComboAddress& primary, const std::string& directory)
+{
+  size_t received = 0;
+  const ComboAddress local("127.0.0.1");
+  const TSIGTriplet tsig;
+  AXFRRetriever axfr(nullptr, primary, s_zone, tsig, &local, 0, s_timeout);
+  records_t records;
+  ZoneFileWriter zoneFile(s_zone, directory);
+  Resolver::res_t nop;
+  vector<DNSRecord> chunk;
+  while (axfr.getChunk(nop, &chunk, s_timeout) != 0) {
+    for (auto& record : chunk) {
+      record.d_name.makeUsRelative(s_zone);
+      zoneFile.write(record);
+      records.insert(record);
+      ++received;
+    }
+  }
+  zoneFile.commit();
+  cout<<"Wrote "<<directory<<"/"<<zoneFile.getSerial()<<endl;
+  return received;
+}
+
+/* what a secondary does: hold the zone until it can be committed to the backend, then read it back */
+static size_t ingestLikeSecondary(const ComboAddress& primary, size_t spoolRecords)
+{
+  size_t received = 0;
+  const ComboAddress local("127.0.0.1");
+  const TSIGTriplet tsig;
+  AXFRRetriever axfr(nullptr, primary, s_zone, tsig, &local, 0, s_timeout);
+  AXFRSpool spool(spoolRecords);
+  Resolver::res_t chunk;
+  while (axfr.getChunk(chunk, nullptr, s_timeout) != 0) {
+    for (auto& record : chunk) {
+      spool.add(std::move(record));
+      ++received;
+    }
+  }
+  size_t fed = 0;
+  spool.forEach([&fed](DNSResourceRecord& /* record */) { ++fed; });
+  cout<<"Spooled "<<spool.spilledBytes()<<" bytes to disk, read back "<<fed<<" records"<<endl;
+  if (!spool.spillError().empty()) {
+    cout<<"Spooling failed: "<<spool.spillError()<<endl;
+  }
+  return received;
+}
+
+static uint64_t getMaxRSSKB()
+{
+  struct rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int main(int argc, char** argv) {
+  try {
+    for(int n=1 ; n < argc; ++n) {
+      if ((string) argv[n] == "--help") {
+        usage();
+        return EXIT_SUCCESS;
+      }
+
+      if ((string) argv[n] == "--version") {
+        cerr<<"axfrbench "<<VERSION<<endl;
+        return EXIT_SUCCESS;
+      }
+    }
+
+    reportAllTypes();
+    signal(SIGPIPE, SIG_IGN);
+    string mode;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (argc < 3 || (mode = argv[1], (mode != "ixfrdist" && mode != "secondary")) || (mode == "ixfrdist" && argc < 4)) {
+      usage();
+      return EXIT_FAILURE;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const size_t numRecords = pdns::checked_stoi<size_t>(argv[2]);
+
+    ComboAddress local("127.0.0.1", 0);
+    Socket listener(local.sin4.sin_family, SOCK_STREAM);
+    listener.setReuseAddr();
+    listener.bind(local);
+    listener.listen(1);
+    socklen_t addrlen = local.getSocklen();
+    if (getsockname(listener.getHandle(), reinterpret_cast<struct sockaddr*>(&local), &addrlen) < 0) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+      unixDie("getsockname");
+    }
+    std::thread server(serveAXFR, &listener, numRecords);
+
+    const uint64_t rssBefore = getMaxRSSKB();
+    DTime dt;
+    dt.set();
+    size_t received = 0;
+    try {
+      if (mode == "ixfrdist") {
+        received = ingestLikeIxfrdist(local, argv[3]); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      }
+      else {
+        received = ingestLikeSecondary(local, argc > 3 ? pdns::checked_stoi<size_t>(argv[3]) : 100000); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      }
+    }
+    catch (...) {
+      // wakes the server up if we did not even connect
+      shutdown(listener.getHandle(), SHUT_RDWR);
+      server.join();
+      throw;
+    }
+
+    auto usec = dt.udiff();
+    server.join();
+    cout<<"Received "<<received<<" records in "<<(usec / 1000000.0)<<" seconds, "<<(received * 1000000.0 / usec)<<" records/s"<<endl;
+    cout<<"Peak RSS grew by "<<(getMaxRSSKB() - rssBefore)<<" kB, to "<<getMaxRSSKB()<<" kB"<<endl;
+  }
+  catch (PDNSException& e) {
+    cerr<<"Fatal: "<<e.reason<<endl;
+    return EXIT_FAILURE;
+  }
+  catch (std::exception& e) {
+    cerr<<"Fatal: "<<e.what()<<endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -38,6 +38,15 @@
 
 #define ASSERT_ROW_COLUMNS(query, row, num) { if (row.size() != num) { throw PDNSException(std::string(query) + " returned wrong number of columns, expected "  #num  ", got " + std::to_string(row.size())); } }
 
+// Names are stored lowercase, with a trailing dot only for the root
+static string sqlName(const DNSName& name)
+{
+  if (name.empty()) {
+    return {};
+  }
+  return name.makeLowerCase().toStringRootDot();
+}
+
 GSQLBackend::GSQLBackend(const string &mode, const string &suffix)
 {
   setArgPrefix(mode+suffix);
@@ -98,6 +107,18 @@ GSQLBackend::GSQLBackend(const string &mode, const string &suffix)
   d_DeleteEmptyNonTerminalQuery = getArg("delete-empty-non-terminal-query");
   d_RemoveEmptyNonTerminalsFromZoneQuery = getArg("remove-empty-non-terminals-from-zone-query");
 
+  try {
+    d_bulkInsertBatchSize = getArgAsNum("bulk-insert-batch-size");
+  }
+  catch (const ArgException&) {
+    d_bulkInsertBatchSize = 0;
+  }
+  // Bulk insertion writes to the records table directly, bypassing the
+  // insertion queries, so it is only used with the stock ones.
+  if (d_InsertRecordQuery != ::arg().getDefault(getPrefix() + "-insert-record-query") || d_InsertEmptyNonTerminalOrderQuery != ::arg().getDefault(getPrefix() + "-insert-empty-non-terminal-order-query")) {
+    d_bulkInsertBatchSize = 0;
+  }
+
   d_ListCommentsQuery = getArg("list-comments-query");
   d_InsertCommentQuery = getArg("insert-comment-query");
   d_DeleteCommentRRsetQuery = getArg("delete-comment-rrset-query");
@@ -284,6 +305,7 @@ void GSQLBackend::allocateStatements()
 
 void GSQLBackend::freeStatements()
 {
+  d_bulkInserter.reset();
   d_NoIdQuery_stmt.reset();
   d_IdQuery_stmt.reset();
   d_ANYNoIdQuery_stmt.reset();
@@ -2212,6 +2234,15 @@ bool GSQLBackend::feedRecord(const DNSResourceRecord& r, const DNSName& ordernam
   }
 
   try {
+    if (auto* bulk = recordsBulkInserter(); bulk != nullptr) {
+      SSqlBulkInserter::field_t orderField;
+      if (!ordername.empty()) {
+        orderField = ordername.labelReverse().makeLowerCase().toString(" ", false);
+      }
+      bulk->addRow({content, std::to_string(r.ttl), std::to_string(prio), r.qtype.toString(), std::to_string(r.domain_id), r.disabled ? "1" : "0", sqlName(r.qname), orderField, (r.auth || !d_dnssecQueries) ? "1" : "0"});
+      return true;
+    }
+
     reconnectIfNeeded();
 
     // clang-format off
@@ -2247,8 +2278,14 @@ bool GSQLBackend::feedRecord(const DNSResourceRecord& r, const DNSName& ordernam
 
 bool GSQLBackend::feedEnts(domainid_t domain_id, map<DNSName,bool>& nonterm)
 {
+  auto* bulk = recordsBulkInserter();
   for(const auto& nt: nonterm) {
     try {
+      if (bulk != nullptr) {
+        bulk->addRow({std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::to_string(domain_id), "0", sqlName(nt.first), std::nullopt, (nt.second || !d_dnssecQueries) ? "1" : "0"});
+        continue;
+      }
+
       reconnectIfNeeded();
 
       // clang-format off
@@ -2275,8 +2312,18 @@ bool GSQLBackend::feedEnts3(domainid_t domain_id, const DNSName& /* domain */, m
 
   string ordername;
 
+  auto* bulk = recordsBulkInserter();
   for(const auto& nt: nonterm) {
     try {
+      if (bulk != nullptr) {
+        SSqlBulkInserter::field_t orderField;
+        if (!narrow && nt.second) {
+          orderField = toBase32Hex(hashQNameWithSalt(ns3prc, nt.first));
+        }
+        bulk->addRow({std::nullopt, std::nullopt, std::nullopt, std::nullopt, std::to_string(domain_id), "0", sqlName(nt.first), orderField, nt.second ? "1" : "0"});
+        continue;
+      }
+
       reconnectIfNeeded();
 
       // clang-format off
@@ -2310,6 +2357,35 @@ bool GSQLBackend::feedEnts3(domainid_t domain_id, const DNSName& /* domain */, m
   return true;
 }
 
+// Rows for the records table go through the bulk inserter, if any, while a
+// transaction is in progress.
+SSqlBulkInserter* GSQLBackend::recordsBulkInserter()
+{
+  if (d_bulkInsertBatchSize == 0 || !d_inTransaction) {
+    return nullptr;
+  }
+  if (!d_bulkInserter) {
+    d_bulkInserter = d_db->bulkInserter("records", {"content", "ttl", "prio", "type", "domain_id", "disabled", "name", "ordername", "auth"}, d_bulkInsertBatchSize);
+    if (!d_bulkInserter) {
+      d_bulkInsertBatchSize = 0;
+    }
+  }
+  return d_bulkInserter.get();
+}
+
+void GSQLBackend::flushBulkInserts()
+{
+  if (!d_bulkInserter) {
+    return;
+  }
+  try {
+    d_bulkInserter->flush();
+  }
+  catch (SSqlException &e) {
+    throw PDNSException("GSQLBackend unable to feed records: " + e.txtReason());
+  }
+}
+
 bool GSQLBackend::startTransaction(const ZoneName &domain, domainid_t domain_id)
 {
   try {
@@ -2340,6 +2416,9 @@ bool GSQLBackend::startTransaction(const ZoneName &domain, domainid_t domain_id)
 bool GSQLBackend::commitTransaction()
 {
   try {
+    if (d_bulkInserter) {
+      d_bulkInserter->flush();
+    }
     d_db->commit();
     d_inTransaction = false;
   }
@@ -2353,6 +2432,9 @@ bool GSQLBackend::commitTransaction()
 bool GSQLBackend::abortTransaction()
 {
   try {
+    if (d_bulkInserter) {
+      d_bulkInserter->discard();
+    }
     d_db->rollback();
     d_inTransaction = false;
   }
@@ -2737,3 +2819,84 @@ void GSQLBackend::extractComment(SSqlStatement::row_t& row, Comment& comment)
 
 // make sure vtable won't break
 SSqlStatement::~SSqlStatement() = default;
+
+SSqlMultiRowInserter::SSqlMultiRowInserter(SSql* database, const string& table, const vector<string>& columns, size_t batchSize, bool namedParameters) :
+  d_db(database), d_prefix("insert into " + table + " (" + boost::join(columns, ",") + ") values "), d_columns(columns.size()), d_batchSize(std::max(batchSize, static_cast<size_t>(1))), d_namedParameters(namedParameters)
+{
+  d_rows.reserve(d_batchSize);
+}
+
+string SSqlMultiRowInserter::makeQuery(size_t rows) const
+{
+  string query(d_prefix);
+  for (size_t row = 0; row < rows; ++row) {
+    query += row == 0 ? "(" : ",(";
+    for (size_t column = 0; column < d_columns; ++column) {
+      if (column != 0) {
+        query += ",";
+      }
+      if (d_namedParameters) {
+        query += ":p" + std::to_string(row * d_columns + column);
+      }
+      else {
+        query += "?";
+      }
+    }
+    query += ")";
+  }
+  return query;
+}
+
+void SSqlMultiRowInserter::addRow(row_t&& row)
+{
+  if (row.size() != d_columns) {
+    throw SSqlException("Bulk insertion of a row with " + std::to_string(row.size()) + " fields instead of " + std::to_string(d_columns));
+  }
+  d_rows.push_back(std::move(row));
+  if (d_rows.size() >= d_batchSize) {
+    flush();
+  }
+}
+
+void SSqlMultiRowInserter::flush()
+{
+  if (d_rows.empty()) {
+    return;
+  }
+  // the rows are gone whether the insertion succeeds or not
+  auto rows = std::move(d_rows);
+  d_rows.clear();
+  d_rows.reserve(d_batchSize);
+
+  std::unique_ptr<SSqlStatement> partial;
+  SSqlStatement* stmt{nullptr};
+  if (rows.size() == d_batchSize) {
+    if (!d_batchStmt) {
+      d_batchStmt = d_db->prepare(makeQuery(d_batchSize), static_cast<int>(d_batchSize * d_columns));
+    }
+    stmt = d_batchStmt.get();
+  }
+  else {
+    partial = d_db->prepare(makeQuery(rows.size()), static_cast<int>(rows.size() * d_columns));
+    stmt = partial.get();
+  }
+
+  size_t param = 0;
+  for (const auto& row : rows) {
+    for (const auto& field : row) {
+      const string name = "p" + std::to_string(param++);
+      if (field) {
+        stmt->bind(name, *field);
+      }
+      else {
+        stmt->bindNull(name);
+      }
+    }
+  }
+  stmt->execute()->reset();
+}
+
+void SSqlMultiRowInserter::discard()
+{
+  d_rows.clear();
+}
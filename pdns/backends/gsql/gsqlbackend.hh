@@ -134,6 +134,8 @@ protected:
   }
   void reconnectIfNeeded()
   {
+    // rows buffered for bulk insertion need to reach the database before any other query
+    flushBulkInserts();
     if (inTransaction() || isConnectionUsable()) {
       return;
     }
@@ -141,6 +143,8 @@ protected:
     reconnect();
   }
   virtual void reconnect() { }
+  SSqlBulkInserter* recordsBulkInserter();
+  void flushBulkInserts();
   bool inTransaction() override
   {
     return d_inTransaction;
@@ -307,6 +311,9 @@ private:
   unique_ptr<SSqlStatement> d_SearchRecordsQuery_stmt;
   unique_ptr<SSqlStatement> d_SearchCommentsQuery_stmt;
 
+  size_t d_bulkInsertBatchSize{0};
+  unique_ptr<SSqlBulkInserter> d_bulkInserter;
+
 protected:
   std::unique_ptr<SSql> d_db{nullptr};
   bool d_dnssecQueries;
@@ -24,6 +24,8 @@
 #include <utility>
 #include <vector>
 #include <cinttypes>
+#include <memory>
+#include <optional>
 #include "../../dnsname.hh"
 #include "../../namespaces.hh"
 #include "../../misc.hh"
@@ -83,6 +85,21 @@ public:
   virtual ~SSqlStatement();
 };
 
+// Inserts many rows into a table within the current transaction. Rows are
+// buffered and sent to the database in batches, so they only become visible
+// to other queries once flushed.
+class SSqlBulkInserter
+{
+public:
+  using field_t = std::optional<string>; // std::nullopt inserts NULL
+  using row_t = vector<field_t>;
+
+  virtual void addRow(row_t&& row) = 0;
+  virtual void flush() = 0;
+  virtual void discard() = 0;
+  virtual ~SSqlBulkInserter() = default;
+};
+
 class SSql
 {
 public:
@@ -98,8 +115,37 @@ public:
     return true;
   }
   virtual void reconnect() {};
+  // Returns nullptr if the database has no faster way to insert rows than
+  // running a prepared statement for each of them.
+  virtual std::unique_ptr<SSqlBulkInserter> bulkInserter(const string& /* table */, const vector<string>& /* columns */, size_t /* batchSize */)
+  {
+    return nullptr;
+  }
   virtual ~SSql() = default;
 
 protected:
   std::shared_ptr<Logr::Logger> d_slog;
 };
+
+// Bulk insertion through multi-row INSERT statements, for databases without a
+// dedicated facility. Placeholders are :name with namedParameters, ? otherwise.
+class SSqlMultiRowInserter : public SSqlBulkInserter
+{
+public:
+  SSqlMultiRowInserter(SSql* database, const string& table, const vector<string>& columns, size_t batchSize, bool namedParameters);
+
+  void addRow(row_t&& row) override;
+  void flush() override;
+  void discard() override;
+
+private:
+  [[nodiscard]] string makeQuery(size_t rows) const;
+
+  SSql* d_db;
+  string d_prefix;
+  size_t d_columns;
+  size_t d_batchSize;
+  bool d_namedParameters;
+  vector<row_t> d_rows;
+  std::unique_ptr<SSqlStatement> d_batchStmt; // for full batches, prepared on first use
+};
@@ -0,0 +1,126 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "arguments.hh"
+#include "auth-packetcache.hh"
+#include "dnspacket.hh"
+#include "dnswriter.hh"
+
+struct CachedPacket
+{
+  std::unique_ptr<DNSPacket> query;
+  std::unique_ptr<DNSPacket> response;
+};
+
+static std::vector<CachedPacket> makePackets(const std::string& prefix, size_t count)
+{
+  std::vector<CachedPacket> packets;
+  packets.reserve(count);
+
+  std::vector<uint8_t> buffer;
+  for (size_t idx = 0; idx < count; idx++) {
+    const DNSName qname(prefix + std::to_string(idx) + ".powerdns.com.");
+    CachedPacket entry{std::make_unique<DNSPacket>(nullptr, true), std::make_unique<DNSPacket>(nullptr, false)};
+
+    buffer.clear();
+    DNSPacketWriter queryWriter(buffer, qname, QType::A);
+    queryWriter.getHeader()->id = static_cast<uint16_t>(idx);
+    queryWriter.addOpt(1232, 0, 0);
+    queryWriter.commit();
+    entry.query->parse(reinterpret_cast<const char*>(buffer.data()), buffer.size()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+    buffer.clear();
+    DNSPacketWriter responseWriter(buffer, qname, QType::A);
+    responseWriter.getHeader()->qr = 1;
+    responseWriter.getHeader()->aa = 1;
+    responseWriter.startRecord(qname, QType::A, 3600, QClass::IN, DNSResourceRecord::ANSWER);
+    responseWriter.xfrIP(htonl(0xc0000200U + (idx % 256)));
+    responseWriter.addOpt(1232, 0, 0);
+    responseWriter.commit();
+    entry.response->parse(reinterpret_cast<const char*>(buffer.data()), buffer.size()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+    packets.push_back(std::move(entry));
+  }
+  return packets;
+}
+
+// 100k cached answers to EDNS queries, in the default view
+TEST_CASE("AuthPacketCache/Get")
+{
+  ::arg().setSwitch("no-shuffle", "Set this to prevent random shuffling of answers - for regression testing") = "off";
+
+  AuthPacketCache cache;
+  cache.setTTL(3600);
+  cache.setMaxEntries(1000000);
+
+  auto packets = makePackets("host", 100000);
+  auto unknown = makePackets("unknown", 100000);
+  DNSPacket cached(nullptr, false);
+  for (auto& entry : packets) {
+    /* the lookup computes the hash of the query, which the insert needs */
+    cache.get(*entry.query, cached);
+    cache.insert(*entry.query, *entry.response, 3600, "");
+  }
+  REQUIRE(cache.size() == packets.size());
+
+  size_t idx = 0;
+
+  BENCHMARK("hit")
+  {
+    return cache.get(*packets[idx++ % packets.size()].query, cached);
+  };
+
+  BENCHMARK("miss")
+  {
+    return cache.get(*unknown[idx++ % unknown.size()].query, cached);
+  };
+}
+
+TEST_CASE("AuthPacketCache/Insert")
+{
+  ::arg().setSwitch("no-shuffle", "Set this to prevent random shuffling of answers - for regression testing") = "off";
+
+  auto packets = makePackets("host", 10000);
+  {
+    /* compute the hashes up front, we only want to measure the inserts */
+    AuthPacketCache cache;
+    cache.setTTL(3600);
+    DNSPacket cached(nullptr, false);
+    for (auto& entry : packets) {
+      cache.get(*entry.query, cached);
+    }
+  }
+
+  BENCHMARK("10000-entries")
+  {
+    AuthPacketCache cache;
+    cache.setTTL(3600);
+    cache.setMaxEntries(1000000);
+    for (auto& entry : packets) {
+      cache.insert(*entry.query, *entry.response, 3600, "");
+    }
+    return cache.size();
+  };
+}
@@ -0,0 +1,153 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "dnsrecords.hh"
+#include "dnswriter.hh"
+
+// a typical recursor answer: CNAME chain, NS set with glue
+static std::vector<DNSRecord> makeAnswer()
+{
+  std::vector<DNSRecord> records;
+  auto add = [&records](const DNSName& name, uint16_t qtype, DNSResourceRecord::Place place, const std::string& content) {
+    DNSRecord record;
+    record.d_name = name;
+    record.d_type = qtype;
+    record.d_ttl = 3600;
+    record.d_place = place;
+    record.setContent(DNSRecordContent::make(qtype, QClass::IN, content));
+    records.push_back(std::move(record));
+  };
+
+  add(DNSName("www.powerdns.com."), QType::CNAME, DNSResourceRecord::ANSWER, "www.example.powerdns.com.");
+  for (unsigned int idx = 1; idx <= 4; idx++) {
+    add(DNSName("www.example.powerdns.com."), QType::A, DNSResourceRecord::ANSWER, "192.0.2." + std::to_string(idx));
+  }
+  for (unsigned int idx = 1; idx <= 4; idx++) {
+    add(DNSName("powerdns.com."), QType::NS, DNSResourceRecord::AUTHORITY, "ns" + std::to_string(idx) + ".powerdns.com.");
+  }
+  for (unsigned int idx = 1; idx <= 4; idx++) {
+    add(DNSName("ns" + std::to_string(idx) + ".powerdns.com."), QType::A, DNSResourceRecord::ADDITIONAL, "198.51.100." + std::to_string(idx));
+    add(DNSName("ns" + std::to_string(idx) + ".powerdns.com."), QType::AAAA, DNSResourceRecord::ADDITIONAL, "2001:db8::" + std::to_string(idx));
+  }
+  return records;
+}
+
+// an AXFR chunk of a zone with delegations, MX and service records
+static std::vector<DNSRecord> makeZoneChunk(size_t count)
+{
+  std::vector<DNSRecord> records;
+  records.reserve(count);
+  const std::string zone = "example.org.";
+  for (size_t idx = 0; records.size() < count; idx++) {
+    const auto label = std::to_string(idx);
+    DNSRecord record;
+    record.d_ttl = 3600;
+    record.d_place = DNSResourceRecord::ANSWER;
+
+    record.d_name = DNSName("host" + label + "." + zone);
+    record.d_type = QType::A;
+    record.setContent(DNSRecordContent::make(QType::A, QClass::IN, "192.0.2." + std::to_string(idx % 256)));
+    records.push_back(record);
+
+    record.d_name = DNSName("sub" + label + "." + zone);
+    record.d_type = QType::NS;
+    record.setContent(DNSRecordContent::make(QType::NS, QClass::IN, "ns" + std::to_string(idx % 4) + ".provider.net."));
+    records.push_back(record);
+
+    record.d_name = DNSName("host" + label + "." + zone);
+    record.d_type = QType::MX;
+    record.setContent(DNSRecordContent::make(QType::MX, QClass::IN, "10 mail" + std::to_string(idx % 8) + "." + zone));
+    records.push_back(record);
+
+    record.d_name = DNSName("_sip._udp.host" + label + "." + zone);
+    record.d_type = QType::SRV;
+    record.setContent(DNSRecordContent::make(QType::SRV, QClass::IN, "0 5 5060 host" + label + "." + zone));
+    records.push_back(record);
+  }
+  return records;
+}
+
+static size_t writePacket(std::vector<uint8_t>& packet, const DNSName& qname, uint16_t qtype, const std::vector<DNSRecord>& records, DNSNameCompressionTable* table)
+{
+  DNSPacketWriter writer(packet, qname, qtype);
+  writer.setCompressionTable(table);
+  for (const auto& record : records) {
+    writer.startRecord(record.d_name, record.d_type, record.d_ttl, QClass::IN, record.d_place);
+    record.getContent()->toPacket(writer);
+  }
+  writer.commit();
+  return packet.size();
+}
+
+TEST_CASE("DNSPacketWriter/Answer")
+{
+  const auto records = makeAnswer();
+  const DNSName qname("www.powerdns.com.");
+  DNSNameCompressionTable table;
+
+  BENCHMARK("linear")
+  {
+    std::vector<uint8_t> packet;
+    return writePacket(packet, qname, QType::A, records, nullptr);
+  };
+
+  BENCHMARK("hashed")
+  {
+    std::vector<uint8_t> packet;
+    return writePacket(packet, qname, QType::A, records, &table);
+  };
+
+  std::vector<uint8_t> reused;
+  BENCHMARK("hashed-reused-buffer")
+  {
+    return writePacket(reused, qname, QType::A, records, &table);
+  };
+}
+
+TEST_CASE("DNSPacketWriter/AXFR")
+{
+  // roughly what fits in a 64k AXFR message
+  const auto records = makeZoneChunk(1600);
+  const DNSName qname("example.org.");
+  DNSNameCompressionTable table;
+
+  BENCHMARK("linear")
+  {
+    std::vector<uint8_t> packet;
+    return writePacket(packet, qname, QType::AXFR, records, nullptr);
+  };
+
+  BENCHMARK("hashed")
+  {
+    std::vector<uint8_t> packet;
+    return writePacket(packet, qname, QType::AXFR, records, &table);
+  };
+
+  std::vector<uint8_t> reused;
+  BENCHMARK("hashed-reused-buffer")
+  {
+    return writePacket(reused, qname, QType::AXFR, records, &table);
+  };
+}
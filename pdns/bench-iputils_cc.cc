@@ -0,0 +1,121 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <random>
+
+#include "iputils.hh"
+
+// roughly the shape of a full routing table or geo database: mostly /16 to /24 prefixes
+static NetmaskTree<uint32_t> makeTable(size_t count)
+{
+  std::mt19937 gen(42);
+  NetmaskTree<uint32_t> tree;
+  while (tree.size() < count) {
+    ComboAddress address;
+    address.sin4.sin_family = AF_INET;
+    address.sin4.sin_addr.s_addr = gen();
+    tree.insert(Netmask(address, 16 + gen() % 9)).second = gen();
+  }
+  return tree;
+}
+
+static std::vector<ComboAddress> makeAddresses(size_t count)
+{
+  std::mt19937 gen(4242);
+  std::vector<ComboAddress> addresses(count);
+  for (auto& address : addresses) {
+    address.sin4.sin_family = AF_INET;
+    address.sin4.sin_addr.s_addr = gen();
+  }
+  return addresses;
+}
+
+TEST_CASE("NetmaskTree/500k")
+{
+  const auto tree = makeTable(500000);
+  const CompressedNetmaskTree<uint32_t> compressed(tree);
+  const auto addresses = makeAddresses(10000);
+
+  BENCHMARK("NetmaskTree")
+  {
+    uint32_t sum = 0;
+    for (const auto& address : addresses) {
+      const auto* found = tree.lookup(address);
+      sum += found != nullptr ? found->second : 0;
+    }
+    return sum;
+  };
+
+  BENCHMARK("CompressedNetmaskTree")
+  {
+    uint32_t sum = 0;
+    for (const auto& address : addresses) {
+      const auto* found = compressed.lookup(address);
+      sum += found != nullptr ? found->second : 0;
+    }
+    return sum;
+  };
+
+  BENCHMARK("CompressedNetmaskTree build")
+  {
+    return CompressedNetmaskTree<uint32_t>(tree).size();
+  };
+
+  auto updated = compressed;
+  uint32_t counter = 0;
+  BENCHMARK("CompressedNetmaskTree update")
+  {
+    updated.insert_or_assign(Netmask("192.0.2.0/24"), ++counter);
+    return updated.size();
+  };
+}
+
+TEST_CASE("NetmaskGroup/ACL")
+{
+  // a typical ACL
+  NetmaskGroup group;
+  group.toMasks("127.0.0.0/8, 10.0.0.0/8, 100.64.0.0/10, 169.254.0.0/16, 192.168.0.0/16, 172.16.0.0/12, ::1/128, fc00::/7, fe80::/10");
+  auto compressed = group;
+  compressed.compress();
+  const auto addresses = makeAddresses(10000);
+
+  BENCHMARK("NetmaskGroup")
+  {
+    size_t matches = 0;
+    for (const auto& address : addresses) {
+      matches += group.match(address) ? 1 : 0;
+    }
+    return matches;
+  };
+
+  BENCHMARK("NetmaskGroup compressed")
+  {
+    size_t matches = 0;
+    for (const auto& address : addresses) {
+      matches += compressed.match(address) ? 1 : 0;
+    }
+    return matches;
+  };
+}
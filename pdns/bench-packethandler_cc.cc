@@ -0,0 +1,244 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "arguments.hh"
+#include "auth-querycache.hh"
+#include "auth-zonecache.hh"
+#include "dnsbackend.hh"
+#include "dnspacket.hh"
+#include "dnswriter.hh"
+#include "packethandler.hh"
+#include "statbag.hh"
+#include "ueberbackend.hh"
+
+extern StatBag S;
+extern AuthQueryCache QC;
+
+/* A read-only backend serving a single, unsigned, synthetic zone from memory, so that
+   the benchmarks measure the PacketHandler and UeberBackend rather than a database. */
+class StaticZoneBackend : public DNSBackend
+{
+public:
+  static constexpr domainid_t s_zoneId{1};
+
+  unsigned int getCapabilities() override
+  {
+    return 0;
+  }
+
+  void lookup(const QType& qtype, const DNSName& qdomain, domainid_t /* zoneId */, DNSPacket* /* pkt_p */) override
+  {
+    d_iter = d_end = {};
+    auto entry = s_records.find(qdomain);
+    if (entry == s_records.end()) {
+      return;
+    }
+    d_qtype = qtype.getCode();
+    d_iter = entry->second.cbegin();
+    d_end = entry->second.cend();
+  }
+
+  bool get(DNSResourceRecord& record) override
+  {
+    for (; d_iter != d_end; ++d_iter) {
+      if (d_qtype == QType::ANY || d_iter->qtype == d_qtype) {
+        record = *d_iter++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool list(const ZoneName& /* target */, domainid_t /* domainId */, bool /* include_disabled */) override
+  {
+    return false;
+  }
+
+  static void addRecord(const std::string& name, QType qtype, const std::string& content)
+  {
+    DNSResourceRecord record;
+    record.qname = DNSName(name);
+    record.qtype = qtype;
+    record.content = content;
+    record.ttl = 3600;
+    record.domain_id = s_zoneId;
+    record.auth = true;
+    s_records[record.qname].push_back(std::move(record));
+  }
+
+  static std::map<DNSName, std::vector<DNSResourceRecord>, CanonDNSNameCompare> s_records;
+
+private:
+  std::vector<DNSResourceRecord>::const_iterator d_iter;
+  std::vector<DNSResourceRecord>::const_iterator d_end;
+  uint16_t d_qtype{0};
+};
+
+std::map<DNSName, std::vector<DNSResourceRecord>, CanonDNSNameCompare> StaticZoneBackend::s_records;
+
+class StaticZoneBackendFactory : public BackendFactory
+{
+public:
+  StaticZoneBackendFactory() :
+    BackendFactory("StaticZone")
+  {
+  }
+
+  DNSBackend* make(const string& /* suffix */ = "") override
+  {
+    return new StaticZoneBackend();
+  }
+};
+
+static void setupStaticZone(size_t count)
+{
+  const std::vector<std::pair<std::string, std::string>> args = {
+    {"allow-unsigned-autoprimary", "yes"},
+    {"allow-unsigned-notify", "yes"},
+    {"autosecondary", "no"},
+    {"consistent-backends", "yes"},
+    {"default-publish-cdnskey", ""},
+    {"default-publish-cds", ""},
+    {"default-soa-edit", ""},
+    {"default-soa-edit-signed", ""},
+    {"direct-dnskey", "no"},
+    {"direct-dnskey-signature", "no"},
+    {"dname-processing", "no"},
+    {"dnssec-key-cache-ttl", "30"},
+    {"expand-alias", "no"},
+    {"log-dns-details", "no"},
+    {"lua-global-include-dir", ""},
+    {"lua-prequery-script", ""},
+    {"max-ent-entries", "100000"},
+    {"max-nsec3-iterations", "100"},
+    {"max-signature-cache-entries", ""},
+    {"module-dir", ""},
+    /* keep the query cache out of the way, we want to measure the lookups themselves */
+    {"negquery-cache-ttl", "0"},
+    {"no-shuffle", "off"},
+    {"primary", "no"},
+    {"query-cache-ttl", "0"},
+    {"resolve-across-zones", "yes"},
+    {"secondary", "no"},
+    {"server-id", ""},
+    {"version-string", "full"},
+    {"zone-metadata-cache-ttl", "60"},
+  };
+  for (const auto& [name, value] : args) {
+    ::arg().set(name) = value;
+  }
+
+  S.declare("corrupt-packets", "Number of corrupt packets received");
+  S.declare("noerror-packets", "Number of times a NOERROR packet was sent out");
+  S.declare("rd-queries", "Number of recursion desired questions");
+  S.declare("servfail-packets", "Number of times a server-failed packet was sent out");
+  S.declareDNSNameQTypeRing("noerror-queries", "Queries for existing records, but for type we don't have");
+  S.declareDNSNameQTypeRing("servfail-queries", "Queries that could not be answered due to backend errors");
+  S.declareComboRing("remotes-corrupt", "Remote hosts sending corrupt packets");
+
+  QC.purge();
+  g_zoneCache.setRefreshInterval(0);
+  g_zoneCache.clear();
+
+  StaticZoneBackend::s_records.clear();
+  StaticZoneBackend::addRecord("example.com.", QType::SOA, "ns1.example.com. hostmaster.example.com. 2024010101 10800 3600 604800 3600");
+  StaticZoneBackend::addRecord("example.com.", QType::NS, "ns1.example.com.");
+  StaticZoneBackend::addRecord("example.com.", QType::NS, "ns2.example.com.");
+  StaticZoneBackend::addRecord("ns1.example.com.", QType::A, "192.0.2.1");
+  StaticZoneBackend::addRecord("ns2.example.com.", QType::A, "192.0.2.2");
+  StaticZoneBackend::addRecord("*.wild.example.com.", QType::A, "192.0.2.3");
+  for (size_t idx = 0; idx < count; idx++) {
+    const auto host = "host" + std::to_string(idx) + ".example.com.";
+    StaticZoneBackend::addRecord(host, QType::A, "198.51.100." + std::to_string(idx % 256));
+    StaticZoneBackend::addRecord("alias" + std::to_string(idx) + ".example.com.", QType::CNAME, host);
+  }
+
+  BackendMakers().clear();
+  BackendMakers().report(std::make_unique<StaticZoneBackendFactory>());
+  BackendMakers().launch("StaticZone");
+  UeberBackend::go();
+}
+
+static std::vector<std::unique_ptr<DNSPacket>> makeQueries(const std::string& prefix, const std::string& suffix, size_t count)
+{
+  std::vector<std::unique_ptr<DNSPacket>> queries;
+  queries.reserve(count);
+
+  const ComboAddress remote("192.0.2.42:53");
+  std::vector<uint8_t> buffer;
+  for (size_t idx = 0; idx < count; idx++) {
+    buffer.clear();
+    DNSPacketWriter writer(buffer, DNSName(prefix + std::to_string(idx) + suffix), QType::A);
+    writer.getHeader()->id = static_cast<uint16_t>(idx);
+    writer.addOpt(1232, 0, 0);
+    writer.commit();
+
+    auto query = std::make_unique<DNSPacket>(nullptr, true);
+    query->setRemote(&remote);
+    query->parse(reinterpret_cast<const char*>(buffer.data()), buffer.size()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    queries.push_back(std::move(query));
+  }
+  return queries;
+}
+
+// 10k A records with a CNAME each, plus a wildcard, in one unsigned zone
+TEST_CASE("PacketHandler/StaticZone")
+{
+  const size_t count = 10000;
+  setupStaticZone(count);
+
+  PacketHandler handler(g_slog->withName("benchmark"));
+  auto answers = makeQueries("host", ".example.com.", count);
+  auto aliases = makeQueries("alias", ".example.com.", count);
+  auto wildcards = makeQueries("name", ".wild.example.com.", count);
+  auto missing = makeQueries("missing", ".example.com.", count);
+
+  REQUIRE(handler.question(*answers.at(0))->d.rcode == RCode::NoError);
+  REQUIRE(handler.question(*aliases.at(0))->d.rcode == RCode::NoError);
+  REQUIRE(handler.question(*wildcards.at(0))->d.rcode == RCode::NoError);
+  REQUIRE(handler.question(*missing.at(0))->d.rcode == RCode::NXDomain);
+
+  size_t idx = 0;
+
+  BENCHMARK("answer")
+  {
+    return handler.question(*answers[idx++ % count])->getString().size();
+  };
+
+  BENCHMARK("cname")
+  {
+    return handler.question(*aliases[idx++ % count])->getString().size();
+  };
+
+  BENCHMARK("wildcard")
+  {
+    return handler.question(*wildcards[idx++ % count])->getString().size();
+  };
+
+  BENCHMARK("nxdomain")
+  {
+    return handler.question(*missing[idx++ % count])->getString().size();
+  };
+}
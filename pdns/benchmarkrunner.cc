@@ -0,0 +1,94 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch_config.hpp>
+#include <catch2/reporters/catch_reporter_event_listener.hpp>
+#include <catch2/reporters/catch_reporter_registrars.hpp>
+
+#include "arguments.hh"
+#include "auth-denialcache.hh"
+#include "auth-packetcache.hh"
+#include "auth-querycache.hh"
+#include "auth-zonecache.hh"
+#include "communicator.hh"
+#include "dnsproxy.hh"
+#include "dnsrecords.hh"
+#include "logging.hh"
+#include "remote_logger.hh"
+#include "statbag.hh"
+
+/* The globals normally living in auth-main.cc, so that the benchmarks can exercise
+   the PacketHandler without linking the whole daemon. */
+
+StatBag S;
+AuthPacketCache PC;
+AuthQueryCache QC;
+AuthDenialCache DC;
+AuthZoneCache g_zoneCache;
+uint16_t g_maxNSEC3Iterations{0};
+bool g_slogStructured{false};
+bool g_logDNSQueries{false};
+bool g_anyToTcp{false};
+bool g_8bitDNS{false};
+bool g_views{false};
+#ifdef HAVE_LUA_RECORDS
+bool g_doLuaRecord{false};
+int g_luaRecordExecLimit{1000};
+time_t g_luaHealthChecksInterval{5};
+time_t g_luaHealthChecksExpireDelay{3600};
+size_t g_luaHealthChecksMaxConcurrent{256};
+time_t g_luaConsistentHashesExpireDelay{86400};
+time_t g_luaConsistentHashesCleanupInterval{3600};
+#endif
+#ifdef ENABLE_GSS_TSIG
+bool g_doGssTSIG{false};
+#endif
+string g_programname = "pdns";
+std::string g_memberCatalogGroup;
+std::vector<std::unique_ptr<RemoteLogger>> g_remote_loggers;
+std::unique_ptr<DNSProxy> DP{nullptr};
+CommunicatorClass Communicator;
+
+ArgvMap& arg()
+{
+  static ArgvMap theArg;
+  return theArg;
+}
+
+static void discardLogEntry(const Logging::Entry& /* entry */)
+{
+}
+
+class BenchmarkRunnerSetup : public Catch::EventListenerBase
+{
+public:
+  using Catch::EventListenerBase::EventListenerBase;
+
+  void testRunStarting(Catch::TestRunInfo const& /* testRunInfo */) override
+  {
+    S.d_allowRedeclare = true;
+    g_slog = Logging::Logger::create(discardLogEntry);
+    reportAllTypes();
+  }
+};
+
+CATCH_REGISTER_LISTENER(BenchmarkRunnerSetup)
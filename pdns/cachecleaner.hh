@@ -21,11 +21,130 @@
  */
 #pragma once
 
+#include <atomic>
 #include <cmath>
+#include <functional>
+#include <limits>
 #include <boost/multi_index_container.hpp>
 
 #include "dnsname.hh"
 #include "lock.hh"
+#include "misc.hh"
+
+// Records a hit on a cache entry that was served while holding a shared lock, when the entry could
+// not be moved to the back of the sequence index. The pruning code below gives such entries a second
+// chance instead of evicting them, approximating LRU without exclusive access on the hit path.
+class DeferredHit
+{
+public:
+  DeferredHit() = default;
+  ~DeferredHit() = default;
+  DeferredHit(const DeferredHit& rhs) noexcept :
+    d_hit(rhs.d_hit.load(std::memory_order_relaxed))
+  {
+  }
+  DeferredHit& operator=(const DeferredHit& rhs) noexcept
+  {
+    d_hit.store(rhs.d_hit.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+  }
+  DeferredHit(DeferredHit&& rhs) noexcept :
+    DeferredHit(static_cast<const DeferredHit&>(rhs))
+  {
+  }
+  DeferredHit& operator=(DeferredHit&& rhs) noexcept
+  {
+    return *this = static_cast<const DeferredHit&>(rhs);
+  }
+
+  void mark() const noexcept
+  {
+    // avoid dirtying the cache line if the flag is already set
+    if (!d_hit.load(std::memory_order_relaxed)) {
+      d_hit.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  bool take() const noexcept
+  {
+    return d_hit.exchange(false, std::memory_order_relaxed);
+  }
+
+private:
+  mutable std::atomic<bool> d_hit{false};
+};
+
+// Approximate number of hits on a cache entry, kept in a single byte. The first s_exactHits hits
+// are counted exactly, after that, like the LFU counter of Redis, a hit only increments the
+// counter with probability 1 / (10 * (value - s_exactHits) + 1). The value grows roughly with the
+// square root of the number of hits (255 is about 300k hits) and popular entries rarely write to
+// it. Safe to use while holding a shared lock, a lost increment does not matter.
+class HitCounter
+{
+public:
+  HitCounter() = default;
+  ~HitCounter() = default;
+  HitCounter(const HitCounter& rhs) noexcept :
+    d_value(rhs.d_value.load(std::memory_order_relaxed))
+  {
+  }
+  HitCounter& operator=(const HitCounter& rhs) noexcept
+  {
+    d_value.store(rhs.d_value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+  }
+  HitCounter(HitCounter&& rhs) noexcept :
+    HitCounter(static_cast<const HitCounter&>(rhs))
+  {
+  }
+  HitCounter& operator=(HitCounter&& rhs) noexcept
+  {
+    return *this = static_cast<const HitCounter&>(rhs);
+  }
+
+  void hit() const noexcept
+  {
+    auto value = d_value.load(std::memory_order_relaxed);
+    if (value == std::numeric_limits<uint8_t>::max()) {
+      return;
+    }
+    if (value < s_exactHits || nextRandom() % (10U * (value - s_exactHits) + 1) == 0) {
+      d_value.store(value + 1, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] uint8_t value() const noexcept
+  {
+    return d_value.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr uint8_t s_exactHits = 8;
+
+  // xorshift32, good enough for this and much cheaper than a call to dns_random()
+  static uint32_t nextRandom() noexcept
+  {
+    thread_local uint32_t state = 0x9e3779b9U ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  mutable std::atomic<uint8_t> d_value{0};
+};
+
+template <typename E>
+auto takeDeferredHit(const E& entry, int /* preferred overload */) -> decltype(entry.d_deferredHit.take())
+{
+  return entry.d_deferredHit.take();
+}
+
+template <typename E>
+bool takeDeferredHit(const E& /* entry */, long /* fallback */)
+{
+  return false;
+}
 
 // this function can clean any cache that has an isStale() method on its entries, a preRemoval() method and a 'sequence' index as its second index
 // the ritual is that the oldest entries are in *front* of the sequence collection, so on a hit, move an item to the end
@@ -131,63 +250,91 @@ uint64_t pruneLockedCollectionsVector(std::vector<T>& maps)
   return totErased;
 }
 
-template <typename S, typename T>
-uint64_t pruneMutexCollectionsVector(time_t now, std::vector<T>& maps, uint64_t maxCached, uint64_t cacheSize)
+// Controls how pruneMutexCollectionsVector() spreads its work. A shard lock is never held while
+// looking at more than d_batchSize entries, the lock is released and taken again in between. The
+// time each lock was held is reported to d_pauseRecorder, in microseconds. With d_parts > 1 only
+// the shards with index % d_parts == d_part are pruned, so several threads can share the work.
+struct PruneControl
 {
-  uint64_t totErased = 0;
-  uint64_t toTrim = 0;
-  uint64_t lookAt = 0;
-
-  // two modes - if toTrim is 0, just look through 10%  of the cache and nuke everything that is expired
-  // otherwise, scan first max(5*toTrim, 10%) records, and stop once we've nuked enough
-  if (cacheSize > maxCached) {
-    toTrim = cacheSize - maxCached;
-    lookAt = std::max(5 * toTrim, cacheSize / 10);
-  }
-  else {
-    lookAt = cacheSize / 10;
-  }
-
-  const uint64_t numberOfShards = maps.size();
-  if (numberOfShards == 0 || cacheSize == 0) {
-    return 0;
-  }
+  size_t d_batchSize{std::numeric_limits<size_t>::max()};
+  size_t d_part{0};
+  size_t d_parts{1};
+  std::function<void(uint64_t)> d_pauseRecorder;
+};
+
+// To be called when the stale time of the entry at iter went down: d_expiry has to remain a lower bound of it (see
+// pruneMutexCollectionsVector() below), so it is reset and the pruner will look at the entry again on its next run.
+template <typename X, typename T, typename I>
+void resetCacheItemExpiry(T& collection, const I& iter)
+{
+  auto xiter = collection.template project<X>(iter);
+  collection.template get<X>().modify(xiter, [](auto& entry) { entry.d_expiry = 0; });
+}
 
-  // first we scan a fraction of the shards for expired entries orderded by LRU
-  for (auto& content : maps) {
-    auto shard = content.lock();
-    const auto shardSize = shard->d_map.size();
-    const uint64_t toScanForThisShard = std::ceil(lookAt * ((1.0 * shardSize) / cacheSize));
-    shard->invalidate();
-    auto& sidx = boost::multi_index::get<S>(shard->d_map);
-    uint64_t erased = 0;
-    uint64_t lookedAt = 0;
-    for (auto i = sidx.begin(); i != sidx.end(); lookedAt++) {
-      if (i->isStale(now)) {
-        shard->preRemoval(*i);
-        i = sidx.erase(i);
-        erased++;
-        content.decEntriesCount();
-      }
-      else {
-        ++i;
-      }
+// Prunes caches sharded into a vector of MapCombo-like objects, which have an isStale() and a getStaleTime() method on
+// their entries, a preRemoval() method and a sequenced index S and an expiry index X on their d_map. X is an ordered
+// index on the d_expiry member of the entries, which is a lower bound of getStaleTime(). New entries can have 0 there,
+// they get their proper place in the expiry index the first time they are looked at.
+// This way, finding the expired entries does not need a scan, and the expiry index only has to be updated (via
+// resetCacheItemExpiry() or by replacing the entry with one having d_expiry at 0) when the TTL of an entry goes down.
+template <typename S, typename X, typename T>
+uint64_t pruneMutexCollectionsVector(time_t now, std::vector<T>& maps, uint64_t maxCached, const PruneControl& control = PruneControl())
+{
+  const size_t numberOfShards = maps.size();
+  const size_t batchSize = std::max(control.d_batchSize, static_cast<size_t>(1));
+  uint64_t totErased = 0;
 
-      if (lookedAt >= toScanForThisShard) {
-        break;
+  auto recordPause = [&control](DTime& held) {
+    if (control.d_pauseRecorder) {
+      control.d_pauseRecorder(held.udiff());
+    }
+  };
+
+  // first we remove the expired entries
+  for (size_t index = control.d_part; index < numberOfShards; index += control.d_parts) {
+    auto& content = maps[index];
+    bool more = true;
+    while (more) {
+      more = false;
+      auto shard = content.lock();
+      DTime held;
+      held.set();
+      shard->invalidate();
+      auto& xidx = boost::multi_index::get<X>(shard->d_map);
+      size_t lookedAt = 0;
+      for (auto iter = xidx.begin(); iter != xidx.end() && iter->d_expiry < now; iter = xidx.begin()) {
+        if (lookedAt++ == batchSize) {
+          more = true;
+          break;
+        }
+        if (iter->isStale(now)) {
+          shard->preRemoval(*iter);
+          xidx.erase(iter);
+          content.decEntriesCount();
+          ++totErased;
+        }
+        else {
+          xidx.modify(iter, [expiry = std::max(iter->getStaleTime(), now)](auto& entry) { entry.d_expiry = expiry; });
+        }
       }
+      recordPause(held);
     }
-    totErased += erased;
   }
 
-  if (totErased >= toTrim) { // done
+  // If the cache is still too big, we need to remove entries that are
+  // not expired, using the LRU index. Every part may keep its share of
+  // maxCached, in proportion to its number of shards.
+  uint64_t cacheSize = 0;
+  size_t shardsInPart = 0;
+  for (size_t index = control.d_part; index < numberOfShards; index += control.d_parts) {
+    cacheSize += maps[index].getEntriesCount();
+    ++shardsInPart;
+  }
+  const uint64_t maxCachedInPart = std::round(static_cast<double>(maxCached) * shardsInPart / numberOfShards);
+  if (cacheSize <= maxCachedInPart) {
     return totErased;
   }
-
-  toTrim -= totErased;
-
-  // It was not enough, so we need to remove entries that are not
-  // expired, still using the LRU index.
+  uint64_t toTrim = cacheSize - maxCachedInPart;
 
   // From here on cacheSize is the total number of entries in the
   // shards that still need to be cleaned. When a shard is processed,
@@ -208,28 +355,43 @@ uint64_t pruneMutexCollectionsVector(time_t now, std::vector<T>& maps, uint64_t
   // becomes slightly larger than 10%, since we "missed" one item in
   // shard 0.
 
-  cacheSize -= totErased;
-
-  for (auto& content : maps) {
-    auto shard = content.lock();
-    const auto shardSize = shard->d_map.size();
-
-    const uint64_t toTrimForThisShard = std::round(static_cast<double>(toTrim) * shardSize / cacheSize);
+  for (size_t index = control.d_part; index < numberOfShards && toTrim > 0 && cacheSize > 0; index += control.d_parts) {
+    auto& content = maps[index];
+    const uint64_t shardSize = std::min(static_cast<uint64_t>(content.getEntriesCount()), cacheSize);
+    uint64_t toTrimForThisShard = std::round(static_cast<double>(toTrim) * shardSize / cacheSize);
     // See explanation above
     cacheSize -= shardSize;
-    if (toTrimForThisShard == 0) {
-      continue;
-    }
-    shard->invalidate();
-    auto& sidx = boost::multi_index::get<S>(shard->d_map);
-    size_t removed = 0;
-    for (auto i = sidx.begin(); i != sidx.end() && removed < toTrimForThisShard; removed++) {
-      shard->preRemoval(*i);
-      i = sidx.erase(i);
-      content.decEntriesCount();
-      ++totErased;
-      if (--toTrim == 0) {
-        return totErased;
+    while (toTrimForThisShard > 0) {
+      auto shard = content.lock();
+      DTime held;
+      held.set();
+      shard->invalidate();
+      auto& sidx = boost::multi_index::get<S>(shard->d_map);
+      size_t lookedAt = 0;
+      // entries hit under a shared lock since the last pass get moved to the back once instead of
+      // being removed, so this loop visits each entry at most twice
+      auto iter = sidx.begin();
+      while (iter != sidx.end() && toTrimForThisShard > 0 && lookedAt++ < batchSize) {
+        if (takeDeferredHit(*iter, 0)) {
+          auto next = std::next(iter);
+          if (next != sidx.end()) {
+            sidx.relocate(sidx.end(), iter);
+            iter = next;
+          }
+          continue;
+        }
+        shard->preRemoval(*iter);
+        iter = sidx.erase(iter);
+        content.decEntriesCount();
+        --toTrimForThisShard;
+        ++totErased;
+        if (--toTrim == 0) {
+          break;
+        }
+      }
+      recordPause(held);
+      if (iter == sidx.end() || toTrim == 0) {
+        break;
       }
     }
   }
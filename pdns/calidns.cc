@@ -24,6 +24,7 @@
 #endif
 
 #include <atomic>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <memory>
@@ -32,6 +33,8 @@
 
 #include <boost/program_options.hpp>
 
+#include "json11.hpp"
+
 #include "dns_random.hh"
 #include "dnsparser.hh"
 #include "dnswriter.hh"
@@ -42,6 +45,7 @@
 #include "proxy-protocol.hh"
 #include "sstuff.hh"
 #include "statbag.hh"
+#include "tcpiohandler.hh"
 
 using std::thread;
 using std::unique_ptr;
@@ -51,6 +55,7 @@ bool g_slogStructured{false};
 StatBag S;
 
 static std::atomic<unsigned int> g_recvcounter, g_recvbytes;
+static std::atomic<uint64_t> g_dropped, g_ioerrors;
 static volatile bool g_done;
 
 namespace po = boost::program_options;
@@ -58,14 +63,136 @@ static po::variables_map g_vm;
 
 static bool g_quiet;
 
+static uint64_t getMonotonicUsec()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Latency histogram with 1 usec resolution up to 1 ms, then 64 sub-buckets per
+   power of two, up to about 2 minutes. Written by a single thread, read and reset
+   by the main thread between runs. */
+class LatencyHistogram
+{
+public:
+  static constexpr size_t s_linear = 1024;
+  static constexpr size_t s_subBuckets = 64;
+  static constexpr size_t s_subBits = 6;
+  static constexpr size_t s_maxExponent = 26;
+  static constexpr size_t s_count = s_linear + (s_maxExponent - 10 + 1) * s_subBuckets;
+
+  LatencyHistogram() :
+    d_buckets(std::make_unique<std::atomic<uint64_t>[]>(s_count))
+  {
+  }
+
+  void operator()(uint64_t usec)
+  {
+    d_buckets[getIndex(usec)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void collect(std::vector<uint64_t>& counts)
+  {
+    counts.resize(s_count);
+    for (size_t idx = 0; idx < s_count; idx++) {
+      counts[idx] += d_buckets[idx].exchange(0, std::memory_order_relaxed);
+    }
+  }
+
+  static size_t getIndex(uint64_t usec)
+  {
+    if (usec < s_linear) {
+      return usec;
+    }
+    size_t exponent = 63 - __builtin_clzll(usec);
+    if (exponent > s_maxExponent) {
+      return s_count - 1;
+    }
+    size_t sub = (usec >> (exponent - s_subBits)) & (s_subBuckets - 1);
+    return s_linear + (exponent - 10) * s_subBuckets + sub;
+  }
+
+  /* highest latency that falls into this bucket */
+  static uint64_t getUpperBound(size_t idx)
+  {
+    if (idx < s_linear) {
+      return idx;
+    }
+    size_t exponent = 10 + (idx - s_linear) / s_subBuckets;
+    size_t sub = (idx - s_linear) % s_subBuckets;
+    return ((s_subBuckets + sub + 1) << (exponent - s_subBits)) - 1;
+  }
+
+  static uint64_t getPercentile(const std::vector<uint64_t>& counts, uint64_t total, double percentile)
+  {
+    if (total == 0) {
+      return 0;
+    }
+    auto wanted = static_cast<uint64_t>(std::ceil(total * percentile / 100.0));
+    uint64_t seen = 0;
+    for (size_t idx = 0; idx < counts.size(); idx++) {
+      seen += counts[idx];
+      if (seen >= wanted && seen > 0) {
+        return getUpperBound(idx);
+      }
+    }
+    return getUpperBound(counts.size() - 1);
+  }
+
+private:
+  std::unique_ptr<std::atomic<uint64_t>[]> d_buckets;
+};
+
+/* Send timestamps of the queries in flight on one socket or connection, indexed
+   by the DNS ID we rewrote into the query. */
+struct InFlightQueries
+{
+  InFlightQueries() :
+    d_sent(std::make_unique<std::atomic<uint64_t>[]>(std::numeric_limits<uint16_t>::max() + 1))
+  {
+  }
+
+  uint16_t add(uint64_t now)
+  {
+    auto qid = d_nextID++;
+    d_sent[qid].store(now, std::memory_order_relaxed);
+    return qid;
+  }
+
+  /* returns 0 if we were not waiting for that ID (anymore) */
+  uint64_t remove(uint16_t qid)
+  {
+    return d_sent[qid].exchange(0, std::memory_order_relaxed);
+  }
+
+  std::unique_ptr<std::atomic<uint64_t>[]> d_sent;
+  uint16_t d_nextID{0};
+};
+
+struct UDPWorker
+{
+  std::vector<std::unique_ptr<Socket>> d_sockets;
+  std::vector<std::unique_ptr<InFlightQueries>> d_inFlight;
+  LatencyHistogram d_latency;
+};
+
+static void accountResponse(InFlightQueries& inFlight, LatencyHistogram& latency, const char* response, size_t responseLen, uint64_t now)
+{
+  if (responseLen < sizeof(dnsheader)) {
+    return;
+  }
+  uint16_t qid{0};
+  memcpy(&qid, response, sizeof(qid));
+  auto sent = inFlight.remove(ntohs(qid));
+  if (sent != 0 && now >= sent) {
+    latency(now - sent);
+  }
+}
+
 //NOLINTNEXTLINE(performance-unnecessary-value-param): we do want a copy to increase the reference count, thank you very much
-static void recvThread(const std::shared_ptr<std::vector<std::unique_ptr<Socket>>> sockets)
+static void recvThread(const std::shared_ptr<UDPWorker> worker)
 {
   vector<pollfd> rfds, fds;
-  for (const auto& s : *sockets) {
-    if (s == nullptr) {
-      continue;
-    }
+  for (const auto& s : worker->d_sockets) {
     struct pollfd pfd;
     pfd.fd = s->getHandle();
     pfd.events = POLLIN;
@@ -97,26 +224,33 @@ static void recvThread(const std::shared_ptr<std::vector<std::unique_ptr<Socket>
       unixDie("Unable to poll for new UDP events");
     }
 
-    for(auto &pfd : fds) {
+    for (size_t idx = 0; idx < fds.size(); idx++) {
+      const auto& pfd = fds[idx];
       if (pfd.revents & POLLIN) {
+        auto& inFlight = *worker->d_inFlight[idx];
 #ifdef HAVE_RECVMMSG
         if ((err=recvmmsg(pfd.fd, &buf[0], buf.size(), MSG_WAITFORONE, 0)) < 0 ) {
           if(errno != EAGAIN)
             unixDie("recvmmsg");
           continue;
         }
-        g_recvcounter+=err;
-        for(int n=0; n < err; ++n)
-          g_recvbytes += buf[n].msg_len;
+        const auto now = getMonotonicUsec();
+        unsigned int bytes = 0;
+        for(int n=0; n < err; ++n) {
+          bytes += buf[n].msg_len;
+          accountResponse(inFlight, worker->d_latency, static_cast<const char*>(buf[n].msg_hdr.msg_iov->iov_base), buf[n].msg_len, now);
+        }
+        g_recvcounter += err;
+        g_recvbytes += bytes;
 #else
         if ((err = recvmsg(pfd.fd, &buf, 0)) < 0) {
           if (errno != EAGAIN)
             unixDie("recvmsg");
           continue;
         }
+        accountResponse(inFlight, worker->d_latency, static_cast<const char*>(buf.msg_iov->iov_base), err, getMonotonicUsec());
         g_recvcounter++;
-        for (decltype(buf.msg_iovlen) i = 0; i < buf.msg_iovlen; i++)
-          g_recvbytes += buf.msg_iov[i].iov_len;
+        g_recvbytes += err;
 #endif
       }
     }
@@ -168,57 +302,325 @@ static void replaceSourceIPInProxyProtocolPayload(std::vector<uint8_t>& packet,
   memcpy(&packet.at(position), &addr, sizeof(addr));
 }
 
-static void sendPackets(const vector<std::unique_ptr<Socket>>& sockets, const vector<vector<uint8_t>* >& packets, uint32_t qps, ComboAddress dest, const Netmask& range, bool ecs, bool proxyProtocol)
+static size_t getDNSPayloadOffset(const std::vector<uint8_t>& packet, bool proxyProtocol)
 {
-  unsigned int burst=100;
-  const auto nsecPerBurst=1*(unsigned long)(burst*1000000000.0/qps);
+  /* the Proxy Protocol v2 header is 16 bytes long, the last two being the length of the addresses and TLVs that follow */
+  constexpr size_t proxyHeaderSize = 16;
+  if (!proxyProtocol || packet.size() < proxyHeaderSize) {
+    return 0;
+  }
+  return proxyHeaderSize + ((packet.at(14) << 8) | packet.at(15));
+}
+
+static void sendPackets(UDPWorker& worker, const vector<vector<uint8_t>* >& packets, uint32_t qps, ComboAddress dest, const Netmask& range, bool ecs, bool proxyProtocol)
+{
+  const size_t burst = 100;
+  const auto nsecPerBurst = static_cast<int64_t>(burst * 1000000000.0 / qps);
   struct timespec nsec;
-  nsec.tv_sec=0;
-  nsec.tv_nsec=0;
-  int count=0;
-  unsigned int nBursts=0;
+  int64_t nBursts = 0;
   DTime dt;
   dt.set();
 
-  struct Unit {
-    struct msghdr msgh;
-    struct iovec iov;
-    cmsgbuf_aligned cbuf;
-  };
-  vector<unique_ptr<Unit> > units;
+  /* we work on copies of the queries since they are shared between senders, and
+     each copy gets a DNS ID allowing the receiver to match the response */
+  vector<vector<uint8_t>> buffers(burst);
+  vector<struct iovec> iovs(burst);
+#ifdef HAVE_SENDMMSG
+  vector<struct mmsghdr> msgs(burst);
+#else
+  vector<struct msghdr> msgs(burst);
+#endif
+
+  size_t pos = 0;
+  while (pos < packets.size()) {
+    const auto socketIdx = nBursts % worker.d_sockets.size();
+    const int socketHandle = worker.d_sockets[socketIdx]->getHandle();
+    auto& inFlight = *worker.d_inFlight[socketIdx];
+    const size_t count = std::min(burst, packets.size() - pos);
+    const auto now = getMonotonicUsec();
+
+    for (size_t idx = 0; idx < count; idx++) {
+      auto& buffer = buffers[idx];
+      buffer = *packets[pos + idx];
+
+      if (ecs) {
+        replaceEDNSClientSubnet(buffer, range);
+      }
+      else if (proxyProtocol) {
+        replaceSourceIPInProxyProtocolPayload(buffer, range);
+      }
+
+      const auto offset = getDNSPayloadOffset(buffer, proxyProtocol);
+      if (buffer.size() >= offset + sizeof(dnsheader)) {
+        uint16_t qid = htons(inFlight.add(now));
+        memcpy(&buffer.at(offset), &qid, sizeof(qid));
+      }
+
+#ifdef HAVE_SENDMMSG
+      fillMSGHdr(&msgs[idx].msg_hdr, &iovs[idx], nullptr, 0, reinterpret_cast<char*>(buffer.data()), buffer.size(), &dest);
+      msgs[idx].msg_len = 0;
+#else
+      fillMSGHdr(&msgs[idx], &iovs[idx], nullptr, 0, reinterpret_cast<char*>(buffer.data()), buffer.size(), &dest);
+#endif
+    }
+
+#ifdef HAVE_SENDMMSG
+    size_t sent = 0;
+    while (sent < count) {
+      int ret = sendmmsg(socketHandle, &msgs[sent], count - sent, 0);
+      if (ret < 0) {
+        unixDie("sendmmsg");
+      }
+      sent += ret;
+    }
+#else
+    for (size_t idx = 0; idx < count; idx++) {
+      if (sendmsg(socketHandle, &msgs[idx], 0) < 0) {
+        unixDie("sendmsg");
+      }
+    }
+#endif
+
+    pos += count;
+    nBursts++;
+    // Calculate the time in nsec we need to sleep to the next burst.
+    // If this is negative, it means that we are not achieving the requested
+    // target rate, in which case we skip the sleep.
+    int64_t toSleep = nBursts * nsecPerBurst - 1000 * static_cast<int64_t>(dt.udiffNoReset());
+    if (toSleep > 0) {
+      nsec.tv_sec = toSleep / 1000000000;
+      nsec.tv_nsec = toSleep % 1000000000;
+      nanosleep(&nsec, nullptr);
+    }
+  }
+}
+
+/* A TCP or DoT connection with pipelining: queries are written as soon as they are
+   scheduled, without waiting for the responses to the previous ones. */
+struct TCPQueryConnection
+{
+  std::unique_ptr<TCPIOHandler> d_handler;
+  InFlightQueries d_inFlight;
+  PacketBuffer d_writing;
+  PacketBuffer d_queued;
+  PacketBuffer d_reading;
+  size_t d_writePos{0};
+  size_t d_readPos{0};
+  size_t d_outstanding{0};
+  bool d_readingLength{true};
+};
+
+struct TCPWorker
+{
+  std::vector<std::unique_ptr<TCPQueryConnection>> d_connections;
+  std::shared_ptr<TLSCtx> d_tlsCtx;
+  LatencyHistogram d_latency;
+  vector<uint8_t> d_query;
+  size_t d_next{0};
+};
+
+static void connectTCPConnection(TCPQueryConnection& conn, const ComboAddress& dest, const std::shared_ptr<TLSCtx>& tlsCtx)
+{
+  const struct timeval timeout{2, 0};
+  Socket sock(dest.sin4.sin_family, SOCK_STREAM);
+  sock.setNonBlocking();
+  setTCPNoDelay(sock.getHandle());
+  conn.d_handler = std::make_unique<TCPIOHandler>(dest.toString(), true, sock.releaseHandle(), timeout, tlsCtx);
+  conn.d_handler->connect(false, dest, timeout);
+  conn.d_writing.clear();
+  conn.d_queued.clear();
+  conn.d_writePos = 0;
+  conn.d_readPos = 0;
+  conn.d_readingLength = true;
+  conn.d_outstanding = 0;
+}
+
+static void closeTCPConnection(TCPQueryConnection& conn)
+{
+  g_ioerrors++;
+  conn.d_handler.reset();
+  conn.d_outstanding = 0;
+}
+
+static void flushTCPConnection(TCPQueryConnection& conn)
+{
+  while (conn.d_handler) {
+    if (conn.d_writing.empty()) {
+      if (conn.d_queued.empty()) {
+        return;
+      }
+      /* the TLS layer might want us to retry a partial write with the exact same buffer,
+         so queries scheduled while a write is in progress go to a second one */
+      conn.d_writing.swap(conn.d_queued);
+      conn.d_writePos = 0;
+    }
+    try {
+      if (conn.d_handler->tryWrite(conn.d_writing, conn.d_writePos, conn.d_writing.size()) != IOState::Done) {
+        return;
+      }
+      conn.d_writing.clear();
+    }
+    catch (const std::exception& e) {
+      closeTCPConnection(conn);
+    }
+  }
+}
 
-  for(const auto& p : packets) {
-    count++;
+static void readTCPConnection(TCPQueryConnection& conn, LatencyHistogram& latency)
+{
+  while (conn.d_handler) {
+    try {
+      if (conn.d_readingLength) {
+        conn.d_reading.resize(sizeof(uint16_t));
+      }
+      if (conn.d_handler->tryRead(conn.d_reading, conn.d_readPos, conn.d_reading.size()) != IOState::Done) {
+        return;
+      }
+    }
+    catch (const std::exception& e) {
+      closeTCPConnection(conn);
+      return;
+    }
+
+    conn.d_readPos = 0;
+    if (conn.d_readingLength) {
+      const size_t responseLen = (conn.d_reading.at(0) << 8) | conn.d_reading.at(1);
+      if (responseLen == 0) {
+        closeTCPConnection(conn);
+        return;
+      }
+      conn.d_reading.resize(responseLen);
+      conn.d_readingLength = false;
+      continue;
+    }
+
+    accountResponse(conn.d_inFlight, latency, reinterpret_cast<const char*>(conn.d_reading.data()), conn.d_reading.size(), getMonotonicUsec());
+    g_recvcounter++;
+    g_recvbytes += conn.d_reading.size();
+    if (conn.d_outstanding > 0) {
+      conn.d_outstanding--;
+    }
+    conn.d_readingLength = true;
+  }
+}
 
-    Unit u;
+static bool queueTCPQuery(TCPWorker& worker, const vector<uint8_t>& packet, const ComboAddress& dest, const Netmask& range, bool ecs, size_t pipeline)
+{
+  for (size_t attempt = 0; attempt < worker.d_connections.size(); attempt++) {
+    auto& conn = *worker.d_connections[worker.d_next];
+    worker.d_next = (worker.d_next + 1) % worker.d_connections.size();
+    if (!conn.d_handler) {
+      try {
+        connectTCPConnection(conn, dest, worker.d_tlsCtx);
+      }
+      catch (const std::exception& e) {
+        g_ioerrors++;
+        continue;
+      }
+    }
+    if (conn.d_outstanding >= pipeline) {
+      continue;
+    }
 
+    auto& query = worker.d_query;
+    query = packet;
     if (ecs) {
-      replaceEDNSClientSubnet(*p, range);
+      replaceEDNSClientSubnet(query, range);
     }
-    else if (proxyProtocol) {
-      replaceSourceIPInProxyProtocolPayload(*p, range);
+    if (query.size() >= sizeof(dnsheader)) {
+      uint16_t qid = htons(conn.d_inFlight.add(getMonotonicUsec()));
+      memcpy(query.data(), &qid, sizeof(qid));
     }
 
-    fillMSGHdr(&u.msgh, &u.iov, nullptr, 0, (char*)&(*p)[0], p->size(), &dest);
+    const auto querySize = static_cast<uint16_t>(query.size());
+    conn.d_queued.push_back(static_cast<uint8_t>(querySize >> 8));
+    conn.d_queued.push_back(static_cast<uint8_t>(querySize & 0xff));
+    conn.d_queued.insert(conn.d_queued.end(), query.begin(), query.end());
+    conn.d_outstanding++;
+    flushTCPConnection(conn);
+    return true;
+  }
+  return false;
+}
 
-    auto socketHandle = sockets[count % sockets.size()]->getHandle();
-    ssize_t sendmsgRet = sendmsg(socketHandle, &u.msgh, 0);
-    if (sendmsgRet != 0) {
-      if (sendmsgRet < 0) {
-        unixDie("sendmsg");
+static void sendTCPPackets(TCPWorker& worker, const vector<vector<uint8_t>* >& packets, uint32_t qps, ComboAddress dest, const Netmask& range, bool ecs, size_t pipeline)
+{
+  /* open-loop: the query schedule only depends on the requested rate, never on
+     the responses. Queries that cannot be placed on a connection are dropped. */
+  const double usecPerQuery = 1000000.0 / qps;
+  const uint64_t drainUsec = 50000;
+  const auto start = getMonotonicUsec();
+  uint64_t sendDone = 0;
+  size_t pos = 0;
+  vector<pollfd> fds;
+  vector<TCPQueryConnection*> polled;
+
+  for (;;) {
+    auto now = getMonotonicUsec();
+    while (pos < packets.size() && start + static_cast<uint64_t>(pos * usecPerQuery) <= now) {
+      if (!queueTCPQuery(worker, *packets[pos], dest, range, ecs, pipeline)) {
+        g_dropped++;
       }
+      pos++;
     }
 
-    if(!(count%burst)) {
-      nBursts++;
-      // Calculate the time in nsec we need to sleep to the next burst.
-      // If this is negative, it means that we are not achieving the requested
-      // target rate, in which case we skip the sleep.
-      int toSleep = nBursts*nsecPerBurst - 1000*dt.udiffNoReset();
-      if (toSleep > 0) {
-        nsec.tv_nsec = toSleep;
-        nanosleep(&nsec, 0);
+    size_t outstanding = 0;
+    fds.clear();
+    polled.clear();
+    for (auto& conn : worker.d_connections) {
+      if (!conn->d_handler) {
+        continue;
+      }
+      outstanding += conn->d_outstanding;
+      struct pollfd pfd;
+      pfd.fd = conn->d_handler->getDescriptor();
+      pfd.events = POLLIN;
+      if (!conn->d_writing.empty() || !conn->d_queued.empty()) {
+        pfd.events |= POLLOUT;
       }
+      pfd.revents = 0;
+      fds.push_back(pfd);
+      polled.push_back(conn.get());
+    }
+
+    int timeout = 0;
+    if (pos < packets.size()) {
+      auto nextDue = start + static_cast<uint64_t>(pos * usecPerQuery);
+      timeout = nextDue > now ? static_cast<int>((nextDue - now) / 1000) : 0;
+    }
+    else {
+      if (sendDone == 0) {
+        sendDone = now;
+      }
+      if (outstanding == 0 || now >= sendDone + drainUsec) {
+        break;
+      }
+      timeout = static_cast<int>((sendDone + drainUsec - now) / 1000);
+    }
+
+    if (fds.empty()) {
+      if (timeout > 0) {
+        usleep(timeout * 1000);
+      }
+      continue;
+    }
+
+    int ret = poll(fds.data(), fds.size(), timeout);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      unixDie("Unable to poll for new TCP events");
+    }
+
+    for (size_t idx = 0; idx < fds.size() && ret > 0; idx++) {
+      if (fds[idx].revents == 0) {
+        continue;
+      }
+      /* the TLS layer might need to read to be able to write, and the other way around,
+         so we try both whenever a connection becomes ready */
+      flushTCPConnection(*polled[idx]);
+      readTCPConnection(*polled[idx], worker.d_latency);
     }
   }
 }
@@ -324,10 +726,18 @@ static std::optional<int> parse_options(int argc, char** argv)
     ("proxy-protocol", po::value<string>(), "Send a Proxy Protocol payload in front of outgoing queries using random addresses from the specified range (IPv4 only) as the initial source IP")
     ("proxy-protocol-from-file", "Read IP or subnet values from the query file and use them as the source IP in Proxy Protocol payloads in front of outgoing queries")
     ("increment", po::value<float>()->default_value(1.1),  "Set the factor to increase the QPS load per run")
+    ("json-file", po::value<string>(), "Write the results of every run, including latency percentiles, to the specified file in JSON format")
     ("maximum-qps", po::value<uint32_t>(), "Stop incrementing once this rate has been reached, to provide a stable load")
     ("minimum-success-rate", po::value<double>()->default_value(0), "Stop the test as soon as the success rate drops below this value, in percent")
     ("plot-file", po::value<string>(), "Write results to the specific file")
+    ("protocol", po::value<string>()->default_value("udp"), "Transport to send queries over: udp, tcp or dot")
     ("quiet", "Whether to run quietly, outputting only the maximum QPS reached. This option is mostly useful when used with --minimum-success-rate")
+    ("tcp-connections", po::value<uint32_t>()->default_value(4), "Number of TCP or DoT connections per thread")
+    ("tcp-pipeline", po::value<uint32_t>()->default_value(100), "Maximum number of queries in flight on a single TCP or DoT connection")
+    ("threads", po::value<uint32_t>()->default_value(1), "Number of sender threads, each with its own receiver (UDP) or connections (TCP, DoT)")
+    ("tls-insecure", "Do not validate the certificate presented by the DoT server")
+    ("tls-provider", po::value<string>()->default_value("openssl"), "TLS library to use for DoT: openssl or gnutls")
+    ("udp-sockets", po::value<uint32_t>()->default_value(24), "Number of UDP sockets (source ports) to send from, spread over the threads")
     ("want-recursion", "Set the Recursion Desired flag on queries");
   po::options_description alloptions;
   po::options_description hidden("hidden options");
@@ -411,6 +821,28 @@ try
     return EXIT_FAILURE;
   }
 
+  const auto protocol = g_vm["protocol"].as<string>();
+  if (protocol != "udp" && protocol != "tcp" && protocol != "dot") {
+    cerr<<"Unsupported protocol '"<<protocol<<"', please use one of udp, tcp or dot"<<endl;
+    return EXIT_FAILURE;
+  }
+  const bool overTCP = protocol != "udp";
+#ifndef HAVE_DNS_OVER_TLS
+  if (protocol == "dot") {
+    cerr<<"DoT requested but not compiled in"<<endl;
+    return EXIT_FAILURE;
+  }
+#endif
+  if (overTCP && addProxyProtocol) {
+    cerr<<"The Proxy Protocol is only supported over UDP at the moment!"<<endl;
+    return EXIT_FAILURE;
+  }
+
+  const uint32_t threadsCount = std::max(g_vm["threads"].as<uint32_t>(), 1U);
+  const uint32_t udpSocketsCount = std::max(g_vm["udp-sockets"].as<uint32_t>(), threadsCount);
+  const uint32_t tcpConnectionsCount = std::max(g_vm["tcp-connections"].as<uint32_t>(), 1U);
+  const uint32_t tcpPipeline = std::max(g_vm["tcp-pipeline"].as<uint32_t>(), 1U);
+
   Netmask range;
   if (g_vm.count("ecs") || g_vm.count("proxy-protocol")) {
     try {
@@ -468,41 +900,72 @@ try
     cout<<"Generated "<<unknown.size()<<" ready to use queries"<<endl;
   }
 
-  auto sockets = std::make_shared<std::vector<std::unique_ptr<Socket>>>();
   ComboAddress dest;
   try {
-    dest = ComboAddress(g_vm["destination"].as<string>(), 53);
+    dest = ComboAddress(g_vm["destination"].as<string>(), protocol == "dot" ? 853 : 53);
   }
   catch (PDNSException &e) {
     cerr<<e.reason<<endl;
     return EXIT_FAILURE;
   }
-  for(int i=0; i < 24; ++i) {
-    auto sock = make_unique<Socket>(dest.sin4.sin_family, SOCK_DGRAM);
-    //    sock->connect(dest);
-    try {
-      setSocketSendBuffer(sock->getHandle(), 2000000);
+
+  vector<std::shared_ptr<UDPWorker>> udpWorkers;
+  vector<std::unique_ptr<TCPWorker>> tcpWorkers;
+  if (!overTCP) {
+    for (uint32_t idx = 0; idx < threadsCount; idx++) {
+      udpWorkers.emplace_back(std::make_shared<UDPWorker>());
     }
-    catch (const std::exception& e) {
-      if (!g_quiet) {
-        cerr<<e.what()<<endl;
+    for (uint32_t i = 0; i < udpSocketsCount; ++i) {
+      auto sock = make_unique<Socket>(dest.sin4.sin_family, SOCK_DGRAM);
+      //    sock->connect(dest);
+      try {
+        setSocketSendBuffer(sock->getHandle(), 2000000);
       }
-    }
-    try {
-      setSocketReceiveBuffer(sock->getHandle(), 2000000);
-    }
-    catch (const std::exception& e) {
-      if (!g_quiet) {
-        cerr<<e.what()<<endl;
+      catch (const std::exception& e) {
+        if (!g_quiet) {
+          cerr<<e.what()<<endl;
+        }
       }
+      try {
+        setSocketReceiveBuffer(sock->getHandle(), 2000000);
+      }
+      catch (const std::exception& e) {
+        if (!g_quiet) {
+          cerr<<e.what()<<endl;
+        }
+      }
+
+      auto& worker = udpWorkers.at(i % threadsCount);
+      worker->d_sockets.emplace_back(std::move(sock));
+      worker->d_inFlight.emplace_back(std::make_unique<InFlightQueries>());
     }
 
-    sockets->emplace_back(std::move(sock));
+    for (const auto& worker : udpWorkers) {
+      std::thread receiver(recvThread, worker);
+      receiver.detach();
+    }
   }
-
-  {
-    std::thread receiver(recvThread, sockets);
-    receiver.detach();
+  else {
+    std::shared_ptr<TLSCtx> tlsCtx{nullptr};
+    if (protocol == "dot") {
+      TLSContextParameters tlsParams;
+      tlsParams.d_provider = g_vm["tls-provider"].as<string>();
+      tlsParams.d_validateCertificates = g_vm.count("tls-insecure") == 0;
+      tlsCtx = getTLSContext(tlsParams);
+    }
+    for (uint32_t idx = 0; idx < threadsCount; idx++) {
+      auto worker = std::make_unique<TCPWorker>();
+      worker->d_tlsCtx = tlsCtx;
+      for (uint32_t connIdx = 0; connIdx < tcpConnectionsCount; connIdx++) {
+        auto conn = std::make_unique<TCPQueryConnection>();
+        connectTCPConnection(*conn, dest, tlsCtx);
+        worker->d_connections.emplace_back(std::move(conn));
+      }
+      tcpWorkers.emplace_back(std::move(worker));
+    }
+    if (!g_quiet) {
+      cout<<"Opened "<<threadsCount * tcpConnectionsCount<<" "<<(protocol == "dot" ? "DoT" : "TCP")<<" connections to "<<dest.toStringWithPort()<<endl;
+    }
   }
 
   uint32_t qps;
@@ -519,6 +982,27 @@ try
   double bestQPS = 0.0;
   double bestPerfectQPS = 0.0;
 
+  json11::Json::array jsonRuns;
+  auto writeJSON = [&]() {
+    if (g_vm.count("json-file") == 0) {
+      return;
+    }
+    json11::Json::object results{
+      {"protocol", protocol},
+      {"threads", static_cast<int>(threadsCount)},
+      {"hitrate", 100.0 * hitrate},
+      {"best-qps", bestQPS},
+      {"best-perfect-qps", bestPerfectQPS},
+      {"runs", jsonRuns}};
+    ofstream jsonFile(g_vm["json-file"].as<string>());
+    if (!jsonFile) {
+      cerr<<"Error opening "<<g_vm["json-file"].as<string>()<<" for writing: "<<stringerror()<<endl;
+      return;
+    }
+    jsonFile<<json11::Json(results).dump()<<endl;
+  };
+  vector<uint64_t> latencyCounts;
+
   for(qps=qpsstart;;) {
     double seconds=1;
     if (!g_quiet) {
@@ -535,6 +1019,7 @@ try
 
     if (misses > unknown.size()) {
       cerr<<"Not enough queries remaining (need at least "<<misses<<" and got "<<unknown.size()<<", please add more to the query file), exiting."<<endl;
+      writeJSON();
       return EXIT_FAILURE;
     }
     vector<vector<uint8_t>*> toSend;
@@ -552,10 +1037,41 @@ try
     shuffle(toSend.begin(), toSend.end(), pdns::dns_random_engine());
     g_recvcounter.store(0);
     g_recvbytes=0;
+    g_dropped.store(0);
+    g_ioerrors.store(0);
     DTime dt;
     dt.set();
 
-    sendPackets(*sockets, toSend, qps, dest, range, addECS, addProxyProtocol);
+    if (threadsCount == 1) {
+      if (overTCP) {
+        sendTCPPackets(*tcpWorkers.at(0), toSend, qps, dest, range, addECS, tcpPipeline);
+      }
+      else {
+        sendPackets(*udpWorkers.at(0), toSend, qps, dest, range, addECS, addProxyProtocol);
+      }
+    }
+    else {
+      /* every thread gets a contiguous slice of the (shuffled) queries and an equal share of the rate */
+      vector<vector<vector<uint8_t>*>> slices(threadsCount);
+      const size_t sliceSize = (toSend.size() + threadsCount - 1) / threadsCount;
+      for (size_t idx = 0; idx < toSend.size(); idx++) {
+        slices.at(idx / sliceSize).push_back(toSend[idx]);
+      }
+      const uint32_t threadQPS = std::max(qps / threadsCount, 1U);
+      vector<std::thread> senders;
+      senders.reserve(threadsCount);
+      for (uint32_t idx = 0; idx < threadsCount; idx++) {
+        if (overTCP) {
+          senders.emplace_back(sendTCPPackets, std::ref(*tcpWorkers.at(idx)), std::cref(slices.at(idx)), threadQPS, dest, std::cref(range), addECS, tcpPipeline);
+        }
+        else {
+          senders.emplace_back(sendPackets, std::ref(*udpWorkers.at(idx)), std::cref(slices.at(idx)), threadQPS, dest, std::cref(range), addECS, addProxyProtocol);
+        }
+      }
+      for (auto& sender : senders) {
+        sender.join();
+      }
+    }
 
     const auto udiff = dt.udiffNoReset();
     const auto realqps=toSend.size()/(udiff/1000000.0);
@@ -572,11 +1088,49 @@ try
        cout<<"Received "<<received<<" packets over "<< udiffReceived/1000000.0<<" seconds ("<<perc<<"%, adjusted received rate "<<realReceivedQPS<<" qps)"<<endl;
      }
 
+    latencyCounts.assign(LatencyHistogram::s_count, 0);
+    for (const auto& worker : udpWorkers) {
+      worker->d_latency.collect(latencyCounts);
+    }
+    for (const auto& worker : tcpWorkers) {
+      worker->d_latency.collect(latencyCounts);
+    }
+    uint64_t matched = 0;
+    for (const auto count : latencyCounts) {
+      matched += count;
+    }
+    const auto p50 = LatencyHistogram::getPercentile(latencyCounts, matched, 50);
+    const auto p99 = LatencyHistogram::getPercentile(latencyCounts, matched, 99);
+    const auto p999 = LatencyHistogram::getPercentile(latencyCounts, matched, 99.9);
+    const auto dropped = g_dropped.load();
+    const auto ioerrors = g_ioerrors.load();
+    if (!g_quiet) {
+      cout<<"Latency over "<<matched<<" matched responses: p50 "<<p50<<" usec, p99 "<<p99<<" usec, p99.9 "<<p999<<" usec"<<endl;
+      if (dropped > 0 || ioerrors > 0) {
+        cout<<dropped<<" queries could not be sent because all connections were busy, "<<ioerrors<<" connection errors"<<endl;
+      }
+    }
+
     if (plot) {
-      plot<<qps<<" "<<realqps<<" "<<perc<<" "<<received/(udiff/1000000.0)<<" " << 8*g_recvbytes.load()/(udiff/1000000.0)<<endl;
+      plot<<qps<<" "<<realqps<<" "<<perc<<" "<<received/(udiff/1000000.0)<<" " << 8*g_recvbytes.load()/(udiff/1000000.0)<<" "<<p50<<" "<<p99<<" "<<p999<<endl;
       plot.flush();
     }
 
+    jsonRuns.push_back(json11::Json::object{
+      {"target-qps", static_cast<double>(qps)},
+      {"achieved-qps", realqps},
+      {"sent", static_cast<double>(toSend.size())},
+      {"received", static_cast<double>(received)},
+      {"success-rate", perc},
+      {"received-qps", realReceivedQPS},
+      {"dropped", static_cast<double>(dropped)},
+      {"connection-errors", static_cast<double>(ioerrors)},
+      {"latency-usec", json11::Json::object{
+        {"p50", static_cast<double>(p50)},
+        {"p99", static_cast<double>(p99)},
+        {"p99.9", static_cast<double>(p999)},
+        {"matched", static_cast<double>(matched)}}}});
+
     if (qps < maximumQps) {
       qps *= increment;
     }
@@ -605,6 +1159,8 @@ try
     plot.flush();
   }
 
+  writeJSON();
+
   // t1.detach();
 }
 catch (const std::exception& exp)
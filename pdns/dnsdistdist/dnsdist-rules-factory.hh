@@ -229,6 +229,7 @@ public:
   {
     d_src = src;
     d_quiet = quiet;
+    d_nmg.compress();
   }
   bool matches(const DNSQuestion* dq) const override
   {
@@ -630,6 +631,8 @@ public:
   SuffixMatchNodeRule(const SuffixMatchNode& smn, bool quiet = false) :
     d_smn(smn), d_quiet(quiet)
   {
+    // rules are not modified once created, and might hold very large lists
+    d_smn.compact();
   }
   bool matches(const DNSQuestion* dq) const override
   {
@@ -882,6 +882,165 @@ bool DNSName::matchesUncompressedName(const std::string_view& wire_uncompressed)
   return pdns_ilexicographical_compare_three_way(std::string_view(wire_uncompressed.data(), d_storage.size()), d_storage) == 0;
 }
 
+CompactSuffixMatchTree::CompactSuffixMatchTree(const std::vector<DNSName>& names)
+{
+  size_t labels = 0;
+  for (const auto& name : names) {
+    labels += name.countLabels();
+  }
+  if (labels >= s_noNode / 2) {
+    throw std::length_error("too many labels for a CompactSuffixMatchTree");
+  }
+
+  // every label might be a new node, we shrink the table afterwards if a lot of suffixes were shared
+  size_t slots = 16;
+  while (slots < labels * 2) {
+    slots *= 2;
+  }
+  d_slots.resize(slots, Slot{0, 0});
+  d_nodes.reserve(labels + 1);
+  d_nodes.push_back(Node{0, 0, 0, false});
+
+  for (const auto& name : names) {
+    uint32_t current = 0;
+    auto visitor = name.getRawLabelsVisitor();
+    while (!visitor.empty()) {
+      const auto label = visitor.back();
+      const auto hash = hashLabel(current, label);
+      auto child = findChild(current, label, hash);
+      if (child == 0) {
+        child = static_cast<uint32_t>(d_nodes.size());
+        d_nodes.push_back(Node{current, static_cast<uint32_t>(d_labels.size()), static_cast<uint8_t>(label.size()), false});
+        d_labels.append(label);
+        insertSlot(hash, child);
+      }
+      current = child;
+      visitor.pop_back();
+    }
+    if (!d_nodes.at(current).endNode) {
+      d_nodes.at(current).endNode = true;
+      d_count++;
+    }
+  }
+
+  slots = 16;
+  while (slots < d_nodes.size() * 2) {
+    slots *= 2;
+  }
+  if (slots < d_slots.size()) {
+    auto old = std::move(d_slots);
+    d_slots.clear();
+    d_slots.resize(slots, Slot{0, 0});
+    for (const auto& slot : old) {
+      if (slot.node != 0) {
+        insertSlot(slot.hash, slot.node);
+      }
+    }
+  }
+  d_nodes.shrink_to_fit();
+  d_labels.shrink_to_fit();
+}
+
+uint32_t CompactSuffixMatchTree::hashLabel(uint32_t parent, std::string_view label)
+{
+  return burtleCI(label, parent);
+}
+
+uint32_t CompactSuffixMatchTree::findChild(uint32_t parent, std::string_view label, uint32_t hash) const
+{
+  const size_t mask = d_slots.size() - 1;
+  // the table is never more than half full, so there always is an empty slot to stop at
+  for (size_t idx = hash & mask;; idx = (idx + 1) & mask) {
+    const auto& slot = d_slots[idx];
+    if (slot.node == 0) {
+      return 0;
+    }
+    if (slot.hash != hash) {
+      continue;
+    }
+    const auto& node = d_nodes[slot.node];
+    if (node.parent == parent && node.labelLength == label.size() && pdns_ilexicographical_compare_three_way(label, std::string_view(&d_labels[node.labelOffset], node.labelLength)) == 0) {
+      return slot.node;
+    }
+  }
+}
+
+void CompactSuffixMatchTree::insertSlot(uint32_t hash, uint32_t node)
+{
+  const size_t mask = d_slots.size() - 1;
+  size_t idx = hash & mask;
+  while (d_slots[idx].node != 0) {
+    idx = (idx + 1) & mask;
+  }
+  d_slots[idx] = Slot{hash, node};
+}
+
+uint32_t CompactSuffixMatchTree::findNode(const DNSName& name, bool exact) const
+{
+  if (d_count == 0) {
+    return s_noNode;
+  }
+  uint32_t best = d_nodes[0].endNode ? 0 : s_noNode;
+  uint32_t current = 0;
+  auto visitor = name.getRawLabelsVisitor();
+  while (!visitor.empty()) {
+    const auto label = visitor.back();
+    current = findChild(current, label, hashLabel(current, label));
+    if (current == 0) {
+      return exact ? s_noNode : best;
+    }
+    if (d_nodes[current].endNode) {
+      best = current;
+    }
+    visitor.pop_back();
+  }
+  if (exact) {
+    return d_nodes[current].endNode ? current : s_noNode;
+  }
+  return best;
+}
+
+DNSName CompactSuffixMatchTree::getName(uint32_t node) const
+{
+  if (node == 0) {
+    return g_rootdnsname;
+  }
+  DNSName ret;
+  // walking up from the node yields the labels in the order they are appended in
+  while (node != 0) {
+    const auto& current = d_nodes[node];
+    ret.appendRawLabel(&d_labels[current.labelOffset], current.labelLength);
+    node = current.parent;
+  }
+  return ret;
+}
+
+std::optional<DNSName> CompactSuffixMatchTree::getBestMatch(const DNSName& name) const
+{
+  const auto node = getBestNode(name);
+  if (node == s_noNode) {
+    return std::nullopt;
+  }
+  return getName(node);
+}
+
+bool CompactSuffixMatchTree::contains(const DNSName& name) const
+{
+  return findNode(name, true) != s_noNode;
+}
+
+std::vector<DNSName> CompactSuffixMatchTree::getNames() const
+{
+  std::vector<DNSName> ret;
+  ret.reserve(d_count);
+  for (uint32_t node = 0; node < d_nodes.size(); node++) {
+    if (d_nodes[node].endNode) {
+      ret.push_back(getName(node));
+    }
+  }
+  return ret;
+}
+
 #if defined(PDNS_AUTH) // [
 std::ostream & operator<<(std::ostream &ostr, const ZoneName& zone)
 {
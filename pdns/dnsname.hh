@@ -20,8 +20,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 #pragma once
+#include <algorithm>
 #include <array>
 #include <cstring>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -719,6 +722,67 @@ private:
   }
 };
 
+/* Immutable counterpart of SuffixMatchTree<bool>, built in bulk from a list of names. All labels
+   are stored in a single buffer and the children of every node are found via one open addressing
+   table keyed on (parent node, label), so a lookup costs a hash probe per label instead of a
+   std::set walk, and there is no heap allocation per label. Meant for large lists such as block
+   lists, where the per-node overhead of SuffixMatchTree dominates. */
+class CompactSuffixMatchTree
+{
+public:
+  CompactSuffixMatchTree() = default;
+  explicit CompactSuffixMatchTree(const std::vector<DNSName>& names);
+
+  bool check(const DNSName& name) const
+  {
+    return getBestNode(name) != s_noNode;
+  }
+  std::optional<DNSName> getBestMatch(const DNSName& name) const;
+  //! Whether exactly this name (and not only a suffix of it) was part of the list
+  bool contains(const DNSName& name) const;
+  std::vector<DNSName> getNames() const;
+
+  size_t size() const
+  {
+    return d_count;
+  }
+  bool empty() const
+  {
+    return d_count == 0;
+  }
+
+private:
+  static constexpr uint32_t s_noNode = std::numeric_limits<uint32_t>::max();
+
+  struct Node
+  {
+    uint32_t parent;
+    uint32_t labelOffset;
+    uint8_t labelLength;
+    bool endNode;
+  };
+  struct Slot
+  {
+    uint32_t hash;
+    uint32_t node; // 0 is the root, which is never a child, so it marks an empty slot
+  };
+
+  static uint32_t hashLabel(uint32_t parent, std::string_view label);
+  uint32_t findChild(uint32_t parent, std::string_view label, uint32_t hash) const;
+  uint32_t findNode(const DNSName& name, bool exact) const;
+  uint32_t getBestNode(const DNSName& name) const
+  {
+    return findNode(name, false);
+  }
+  void insertSlot(uint32_t hash, uint32_t node);
+  DNSName getName(uint32_t node) const;
+
+  std::vector<Node> d_nodes;
+  std::vector<Slot> d_slots;
+  std::string d_labels;
+  size_t d_count{0};
+};
+
 /* Quest in life: serve as a rapid block list. If you add a DNSName to a root SuffixMatchNode,
    anything part of that domain will return 'true' in check */
 struct SuffixMatchNode
@@ -753,6 +817,7 @@ struct SuffixMatchNode
     {
       d_tree.remove(name);
       d_nodes.erase(name);
+      removeFromCompact(name);
     }
 
     void remove(std::vector<std::string> labels)
@@ -764,23 +829,52 @@ struct SuffixMatchNode
         labels.pop_back(); // This is safe because we have a copy of labels
       }
       d_nodes.erase(tmp);
+      removeFromCompact(tmp);
+    }
+
+    /* Moves every name into a CompactSuffixMatchTree, which is shared (not copied) between copies
+       of this node. Call it once a large list has been added. Names added later go into the
+       regular tree until the next call, removing a compacted name rebuilds the compact tree. */
+    void compact()
+    {
+      if (d_nodes.empty()) {
+        return;
+      }
+      std::vector<DNSName> names;
+      if (d_compact) {
+        names = d_compact->getNames();
+      }
+      names.insert(names.end(), d_nodes.begin(), d_nodes.end());
+      d_compact = std::make_shared<const CompactSuffixMatchTree>(names);
+      d_tree = SuffixMatchTree<bool>();
+      d_nodes.clear();
     }
 
     bool check(const DNSName& dnsname) const
     {
+      if (d_compact && d_compact->check(dnsname)) {
+        return true;
+      }
       return d_tree.lookup(dnsname) != nullptr;
     }
 
     std::optional<DNSName> getBestMatch(const DNSName& name) const
     {
-      return d_tree.getBestMatch(name);
+      auto best = d_tree.getBestMatch(name);
+      if (d_compact) {
+        auto compactBest = d_compact->getBestMatch(name);
+        if (compactBest && (!best || compactBest->countLabels() > best->countLabels())) {
+          return compactBest;
+        }
+      }
+      return best;
     }
 
     std::string toString() const
     {
       std::string ret;
       bool first = true;
-      for (const auto& n : d_nodes) {
+      for (const auto& n : getAllNodes()) {
         if (!first) {
           ret += ", ";
         }
@@ -792,16 +886,35 @@ struct SuffixMatchNode
 
   std::vector<DNSName> toVector() const
     {
-      std::vector<DNSName> ret;
-      ret.reserve(d_nodes.size());
-      for (const auto& n : d_nodes) {
-        ret.emplace_back(n);
+      const auto nodes = getAllNodes();
+      return {nodes.begin(), nodes.end()};
+    }
+
+  private:
+    std::set<DNSName> getAllNodes() const
+    {
+      if (!d_compact) {
+        return d_nodes;
+      }
+      auto ret = d_nodes;
+      for (auto& name : d_compact->getNames()) {
+        ret.insert(std::move(name));
       }
       return ret;
     }
 
-  private:
+    void removeFromCompact(const DNSName& name)
+    {
+      if (!d_compact || !d_compact->contains(name)) {
+        return;
+      }
+      auto names = d_compact->getNames();
+      names.erase(std::remove(names.begin(), names.end(), name), names.end());
+      d_compact = std::make_shared<const CompactSuffixMatchTree>(names);
+    }
+
     mutable std::set<DNSName> d_nodes; // Only used for string generation
+    std::shared_ptr<const CompactSuffixMatchTree> d_compact;
 };
 
 std::ostream & operator<<(std::ostream &os, const DNSName& d);
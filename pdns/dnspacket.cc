@@ -173,8 +173,11 @@ void DNSPacket::addRecord(DNSZoneRecord&& rr)
   // in case we are not compressing for AXFR, no such checking is performed!
 
   if(d_compress) {
-    std::string ser = rr.dr.getContent()->serialize(rr.dr.d_name);
-    auto hash = boost::hash< std::pair<DNSName, std::string> >()({rr.dr.d_name, ser});
+    // the rendering is kept with the content, wrapup() will reuse it
+    const auto& rendered = rr.dr.getContent()->getPrerendered();
+    size_t hash = 0;
+    boost::hash_combine(hash, rr.dr.d_name);
+    boost::hash_combine(hash, rendered.wire);
     if(d_dedup.count(hash)) { // might be a dup
       for(auto & i : d_rrs) {
         if(rr.dr == i.dr)  // XXX SUPER SLOW
@@ -251,8 +254,12 @@ void DNSPacket::wrapup(bool throwsOnTruncation)
   }
   d_wrapped=true;
 
-  vector<uint8_t> packet;
+  // reused for every packet built by this thread: large answers and AXFR chunks neither grow a
+  // fresh buffer nor scan all names written so far when looking for compression targets
+  static thread_local vector<uint8_t> packet;
+  static thread_local DNSNameCompressionTable compressionTable;
   DNSPacketWriter pw(packet, qdomain, qtype.getCode(), qclass);
+  pw.setCompressionTable(&compressionTable);
 
   pw.getHeader()->rcode=d.rcode;
   pw.getHeader()->opcode = d.opcode;
@@ -318,7 +325,7 @@ void DNSPacket::wrapup(bool throwsOnTruncation)
         maxScopeMask = max(maxScopeMask, pos->scopeMask);
 
         pw.startRecord(pos->dr.d_name, pos->dr.d_type, pos->dr.d_ttl, pos->dr.d_class, pos->dr.d_place);
-        pos->dr.getContent()->toPacket(pw);
+        pw.xfrPrerendered(pos->dr.getContent()->getPrerendered());
         if(pw.size() + optsize > (d_tcp ? 65535 : getMaxReplyLen())) {
           if (throwsOnTruncation) {
             throw PDNSException("attempt to write an oversized chunk, see https://docs.powerdns.com/authoritative/settings.html#workaround-11804");
@@ -175,6 +175,32 @@ std::shared_ptr<DNSRecordContent> DNSRecordContent::make(const DNSRecord& dr, Pa
   return i->second(dr, pr);
 }
 
+#if defined(PDNS_AUTH) // [
+const PrerenderedRData& DNSRecordContent::getPrerendered() const
+{
+  if (const auto* ret = d_prerendered.d_data.load(std::memory_order_acquire)) {
+    return *ret;
+  }
+
+  auto rendered = std::make_unique<PrerenderedRData>();
+  vector<uint8_t> packet;
+  DNSPacketWriter packetWriter(packet, g_rootdnsname, QType::A);
+  // no compression at all, names are compressed when the rendering is written into a packet
+  packetWriter.startRecord(g_rootdnsname, getType(), 0, QClass::IN, DNSResourceRecord::ANSWER, false);
+  packetWriter.setPrerenderTarget(rendered.get());
+  toPacket(packetWriter);
+  packetWriter.setPrerenderTarget(nullptr);
+  packetWriter.getRecordPayload(rendered->wire);
+
+  // if another thread beat us to it, keep theirs, both renderings are identical
+  const PrerenderedRData* expected = nullptr;
+  if (d_prerendered.d_data.compare_exchange_strong(expected, rendered.get(), std::memory_order_acq_rel)) {
+    return *rendered.release();
+  }
+  return *expected;
+}
+#endif // ]
+
 string DNSRecordContent::upgradeContent(const DNSName& qname, const QType& qtype, const string& content) {
   // seamless upgrade for previously unsupported but now implemented types.
   UnknownRecordContent unknown_content(content);
@@ -367,6 +393,325 @@ bool MOADNSParser::hasEDNS() const
   return false;
 }
 
+/* Walks over the labels of the name at offset with the same checks as DNSName::packetParser()
+   and a minimum offset of sizeof(dnsheader), as PacketReader::getName(), calling visitor(label, length) for each label until it returns false.
+   Returns the number of bytes the name occupies at offset, and sets wirelength to the length
+   of the uncompressed name, if the whole name has been walked */
+template <typename Visitor>
+static size_t walkPacketName(const std::string_view& packet, size_t offset, bool uncompress, size_t* wirelength, const Visitor& visitor)
+{
+  size_t consumed = 0;
+  size_t length = 1;
+  size_t segmentStart = offset;
+  size_t pos = offset;
+  unsigned int depth = 0;
+  bool followed = false;
+
+  if (offset < sizeof(dnsheader)) {
+    throw std::range_error("Trying to read before the beginning of the buffer (" + std::to_string(offset) + " < " + std::to_string(sizeof(dnsheader)) + ")");
+  }
+
+  for (;;) {
+    if (pos >= packet.size()) {
+      throw std::range_error("Trying to read past the end of the buffer (" + std::to_string(pos) + " >= " + std::to_string(packet.size()) + ")");
+    }
+    const auto labellen = static_cast<uint8_t>(packet[pos]);
+    if (labellen == 0) {
+      pos++;
+      break;
+    }
+    if (labellen >= 0xc0) {
+      if (!uncompress) {
+        throw std::range_error("Found compressed label, instructed not to follow");
+      }
+      if (pos + 1 >= packet.size()) {
+        throw std::range_error("Trying to read past the end of the buffer (" + std::to_string(pos + 1) + " >= " + std::to_string(packet.size()) + ")");
+      }
+      size_t newpos = ((labellen & ~0xc0) << 8) + static_cast<uint8_t>(packet[pos + 1]);
+      if (newpos >= segmentStart) {
+        throw std::range_error("Found a forward reference during label decompression");
+      }
+      if (newpos < sizeof(dnsheader)) {
+        throw std::range_error("Invalid label position during decompression (" + std::to_string(newpos) + " < " + std::to_string(sizeof(dnsheader)) + ")");
+      }
+      if (++depth > 100) {
+        throw std::range_error("Abort label decompression after 100 redirects");
+      }
+      if (!followed) {
+        consumed = pos + 2 - offset;
+        followed = true;
+      }
+      pos = segmentStart = newpos;
+      continue;
+    }
+    if (labellen > 63) {
+      throw std::range_error("Invalid label byte during decompression (" + std::to_string(labellen) + ")");
+    }
+    if (pos + 1 + labellen > packet.size()) {
+      throw std::range_error("Trying to read past the end of the buffer (" + std::to_string(pos + 1 + labellen) + " > " + std::to_string(packet.size()) + ")");
+    }
+    length += labellen + 1;
+    if (length > 255) {
+      throw std::range_error("name too long to append");
+    }
+    if (!visitor(&packet[pos + 1], labellen)) {
+      return 0;
+    }
+    pos += labellen + 1;
+  }
+
+  if (!followed) {
+    consumed = pos - offset;
+  }
+  if (wirelength != nullptr) {
+    *wirelength = length;
+  }
+  return consumed;
+}
+
+bool DNSPacketView::NameView::operator==(const DNSName& rhs) const
+{
+  if (empty() || rhs.empty()) {
+    return empty() && rhs.empty();
+  }
+
+  const auto& storage = rhs.getStorage();
+  size_t idx = 0;
+  bool mismatch = false;
+  try {
+    walkPacketName(d_packet, d_offset, true, nullptr, [&storage, &idx, &mismatch](const char* label, uint8_t length) {
+      if (idx + 1 + length > storage.size() || static_cast<uint8_t>(storage[idx]) != length) {
+        mismatch = true;
+        return false;
+      }
+      for (size_t pos = 0; pos < length; pos++) {
+        if (dns_tolower(label[pos]) != dns_tolower(storage[idx + 1 + pos])) {
+          mismatch = true;
+          return false;
+        }
+      }
+      idx += 1 + length;
+      return true;
+    });
+  }
+  catch (const std::range_error&) {
+    return false;
+  }
+
+  return !mismatch && idx + 1 == storage.size();
+}
+
+size_t DNSPacketView::NameView::getOnWireLength(bool uncompress) const
+{
+  return walkPacketName(d_packet, d_offset, uncompress, nullptr, [](const char*, uint8_t) { return true; });
+}
+
+size_t DNSPacketView::NameView::wirelength() const
+{
+  size_t length = 0;
+  walkPacketName(d_packet, d_offset, true, &length, [](const char*, uint8_t) { return true; });
+  return length;
+}
+
+DNSName DNSPacketView::NameView::toDNSName() const
+{
+  if (empty()) {
+    return {};
+  }
+  return DNSName(d_packet.data(), d_packet.size(), d_offset, true, nullptr, nullptr, nullptr, sizeof(dnsheader));
+}
+
+std::shared_ptr<DNSRecordContent> DNSPacketView::Record::getContent(uint16_t opcode) const
+{
+  DNSRecord record;
+  record.d_type = d_type;
+  record.d_class = d_class;
+  record.d_ttl = d_ttl;
+  record.d_clen = d_clen;
+  record.d_place = d_place;
+
+  /* needed to get the record boundaries right */
+  PacketReader reader(d_packet, d_contentPos - sizeof(dnsrecordheader));
+  dnsrecordheader header{};
+  reader.getDnsrecordheader(header);
+  return DNSRecordContent::make(record, reader, opcode);
+}
+
+DNSRecord DNSPacketView::Record::toDNSRecord(uint16_t opcode) const
+{
+  DNSRecord record;
+  record.d_name = d_name.toDNSName();
+  record.d_type = d_type;
+  record.d_class = d_class;
+  record.d_ttl = d_ttl;
+  record.d_clen = d_clen;
+  record.d_place = d_place;
+  record.setContent(getContent(opcode));
+  return record;
+}
+
+DNSPacketView::const_iterator::const_iterator(const DNSPacketView& view, uint16_t index, uint16_t position) :
+  d_view(&view), d_index(index), d_position(position)
+{
+  parse();
+}
+
+DNSPacketView::const_iterator& DNSPacketView::const_iterator::operator++()
+{
+  d_position = d_record.d_contentPos + d_record.d_clen;
+  ++d_index;
+  parse();
+  return *this;
+}
+
+// the framing has been validated by the constructor of the view, so this cannot fail
+void DNSPacketView::const_iterator::parse()
+{
+  const auto& header = d_view->d_header;
+  if (d_index >= d_view->size()) {
+    return;
+  }
+
+  const auto& packet = d_view->d_packet;
+  d_record.d_packet = packet;
+  d_record.d_name = NameView(packet, d_position);
+  size_t pos = d_position;
+  // no need to follow compression pointers
+  for (uint8_t labellen = packet[pos]; labellen != 0; labellen = packet[pos]) {
+    if (labellen >= 0xc0) {
+      pos++;
+      break;
+    }
+    pos += labellen + 1;
+  }
+  pos++;
+
+  dnsrecordheader recordHeader{};
+  memcpy(&recordHeader, &packet[pos], sizeof(recordHeader));
+  d_record.d_type = ntohs(recordHeader.d_type);
+  d_record.d_class = ntohs(recordHeader.d_class);
+  d_record.d_ttl = ntohl(recordHeader.d_ttl);
+  d_record.d_clen = ntohs(recordHeader.d_clen);
+  d_record.d_contentPos = pos + sizeof(recordHeader);
+
+  if (d_index < header.ancount) {
+    d_record.d_place = DNSResourceRecord::ANSWER;
+  }
+  else if (d_index < header.ancount + header.nscount) {
+    d_record.d_place = DNSResourceRecord::AUTHORITY;
+  }
+  else {
+    d_record.d_place = DNSResourceRecord::ADDITIONAL;
+  }
+}
+
+DNSPacketView::DNSPacketView(const std::string_view& packet) :
+  d_packet(packet)
+{
+  if (packet.size() < sizeof(dnsheader)) {
+    throw MOADNSException("Packet shorter than minimal header");
+  }
+  if (packet.size() > std::numeric_limits<uint16_t>::max()) {
+    throw MOADNSException("Packet too large (" + std::to_string(packet.size()) + " bytes)");
+  }
+
+  memcpy(&d_header, packet.data(), sizeof(dnsheader));
+
+  if (d_header.opcode != Opcode::Query && d_header.opcode != Opcode::Notify && d_header.opcode != Opcode::Update) {
+    throw MOADNSException("Can't parse non-query packet with opcode=" + std::to_string(d_header.opcode));
+  }
+
+  d_header.qdcount = ntohs(d_header.qdcount);
+  d_header.ancount = ntohs(d_header.ancount);
+  d_header.nscount = ntohs(d_header.nscount);
+  d_header.arcount = ntohs(d_header.arcount);
+
+  // name errors are out of range errors as well, as in PacketReader::getName()
+  auto skipName = [&packet](size_t pos) {
+    try {
+      return pos + NameView(packet, pos).getOnWireLength();
+    }
+    catch (const std::range_error& exp) {
+      throw std::out_of_range(string("dnsname issue: ") + exp.what());
+    }
+  };
+
+  size_t pos = sizeof(dnsheader);
+  unsigned int n = 0;
+  bool validPacket = false;
+  try {
+    for (n = 0; n < d_header.qdcount; ++n) {
+      NameView qname(packet, pos);
+      pos = skipName(pos);
+      if (pos + 4 > packet.size()) {
+        throw std::out_of_range("Question goes beyond the packet's content (" + std::to_string(packet.size()) + ")");
+      }
+      d_qname = qname;
+      d_qtype = (static_cast<uint8_t>(packet[pos]) << 8) + static_cast<uint8_t>(packet[pos + 1]);
+      d_qclass = (static_cast<uint8_t>(packet[pos + 2]) << 8) + static_cast<uint8_t>(packet[pos + 3]);
+      pos += 4;
+    }
+    d_firstRecordPos = pos;
+
+    validPacket = true;
+    bool seenTSIG = false;
+    const unsigned int supposedRecordCount = size();
+    for (n = 0; n < supposedRecordCount; ++n) {
+      pos = skipName(pos);
+      if (pos + sizeof(dnsrecordheader) > packet.size()) {
+        throw std::out_of_range("DNS record header (starting at " + std::to_string(pos) + ") goes beyond the packet's content (" + std::to_string(packet.size()) + ")");
+      }
+      dnsrecordheader recordHeader{};
+      memcpy(&recordHeader, &packet[pos], sizeof(recordHeader));
+      pos += sizeof(recordHeader);
+      const uint16_t clen = ntohs(recordHeader.d_clen);
+      if (packet.size() - pos < clen) {
+        throw std::out_of_range("DNS record length (" + std::to_string(clen) + " starting at " + std::to_string(pos) + ") goes beyond the packet's content (" + std::to_string(packet.size()) + ")");
+      }
+      pos += clen;
+
+      const bool additional = n >= static_cast<unsigned int>(d_header.ancount + d_header.nscount);
+      if (additional && seenTSIG) {
+        throw MOADNSException("Packet has an unexpected record (" + std::to_string(ntohs(recordHeader.d_type)) + ") after a TSIG one.");
+      }
+      if (ntohs(recordHeader.d_type) == QType::TSIG && ntohs(recordHeader.d_class) == QClass::ANY) {
+        if (seenTSIG || !additional) {
+          throw MOADNSException("Packet has a TSIG record in an invalid position.");
+        }
+        seenTSIG = true;
+      }
+    }
+  }
+  catch (const std::out_of_range& exp) {
+    if (validPacket && d_header.tc) { // don't sweat it over truncated packets, but do adjust an, ns and arcount
+      if (n < d_header.ancount) {
+        d_header.ancount = n;
+        d_header.nscount = d_header.arcount = 0;
+      }
+      else if (n < d_header.ancount + d_header.nscount) {
+        d_header.nscount = n - d_header.ancount;
+        d_header.arcount = 0;
+      }
+      else {
+        d_header.arcount = n - d_header.ancount - d_header.nscount;
+      }
+    }
+    else {
+      throw MOADNSException("Error parsing packet of " + std::to_string(packet.size()) + " bytes (rd=" + std::to_string(d_header.rd) + "), out of bounds: " + string(exp.what()));
+    }
+  }
+}
+
+std::vector<DNSRecord> DNSPacketView::getRecords() const
+{
+  std::vector<DNSRecord> records;
+  records.reserve(size());
+  for (const auto& record : *this) {
+    records.push_back(record.toDNSRecord(d_header.opcode));
+  }
+  return records;
+}
+
 void PacketReader::getDnsrecordheader(struct dnsrecordheader &ah)
 {
   unsigned char *p = reinterpret_cast<unsigned char*>(&ah);
@@ -257,6 +257,11 @@ public:
     return typeid(*this)==typeid(rhs) && this->getZoneRepresentation() == rhs.getZoneRepresentation();
   }
 
+#if defined(PDNS_AUTH) // [
+  // returns the uncompressed wire format of the content, rendered on first use and kept for the lifetime of this object
+  [[nodiscard]] const PrerenderedRData& getPrerendered() const;
+#endif // ]
+
   // parse the content in wire format, possibly including compressed pointers pointing to the owner name.
   // internalRepresentation is set when the data comes from an internal source,
   // such as the LMDB backend.
@@ -330,6 +335,28 @@ protected:
   static n2typemap_t& getN2Typemap();
   static zmakermap_t& getZmakermap();
   static std::atomic<bool> d_locked;
+
+#if defined(PDNS_AUTH) // [
+private:
+  // copies of a content may be altered before use, so they start without a rendering
+  struct PrerenderedSlot
+  {
+    PrerenderedSlot() = default;
+    PrerenderedSlot(const PrerenderedSlot& /* rhs */) {}
+    PrerenderedSlot& operator=(const PrerenderedSlot& /* rhs */)
+    {
+      delete d_data.exchange(nullptr);
+      return *this;
+    }
+    ~PrerenderedSlot()
+    {
+      delete d_data.load();
+    }
+
+    std::atomic<const PrerenderedRData*> d_data{nullptr};
+  };
+  mutable PrerenderedSlot d_prerendered;
+#endif // ]
 };
 
 struct DNSRecord
@@ -555,6 +582,133 @@ private:
   uint16_t d_tsigPos;
 };
 
+/* Zero-copy alternative to MOADNSParser for responses, for hot paths.
+   The framing of the packet is validated once, by the constructor, with the same rules
+   and exceptions as MOADNSParser, after which the question and records can be iterated
+   over without allocating: owner names are views into the packet, and DNSName or
+   DNSRecordContent objects are only materialized when asked for.
+   The packet has to outlive the view and everything obtained from it. */
+class DNSPacketView
+{
+public:
+  //! A (possibly compressed) name in a packet
+  class NameView
+  {
+  public:
+    NameView() = default;
+    NameView(const std::string_view& packet, uint16_t offset) :
+      d_packet(packet), d_offset(offset)
+    {
+    }
+
+    //! An empty view, as returned for a packet without a question, is not the root
+    bool empty() const
+    {
+      return d_packet.empty();
+    }
+    //! DNS-native comparison (case insensitive), false if the name is invalid
+    bool operator==(const DNSName& rhs) const;
+    bool operator!=(const DNSName& rhs) const
+    {
+      return !(*this == rhs);
+    }
+    //! Number of bytes the name occupies at its offset, throws std::range_error if the name is invalid
+    size_t getOnWireLength(bool uncompress = true) const;
+    //! Number of bytes of the uncompressed name, as DNSName::wirelength()
+    size_t wirelength() const;
+    DNSName toDNSName() const;
+
+  private:
+    std::string_view d_packet;
+    uint16_t d_offset{0};
+  };
+
+  struct Record
+  {
+    std::string_view getRData() const
+    {
+      return d_packet.substr(d_contentPos, d_clen);
+    }
+    std::shared_ptr<DNSRecordContent> getContent(uint16_t opcode = Opcode::Query) const;
+    DNSRecord toDNSRecord(uint16_t opcode = Opcode::Query) const;
+
+    std::string_view d_packet;
+    NameView d_name;
+    uint32_t d_ttl{0};
+    uint16_t d_type{0};
+    uint16_t d_class{0};
+    uint16_t d_clen{0};
+    uint16_t d_contentPos{0};
+    DNSResourceRecord::Place d_place{DNSResourceRecord::ANSWER};
+  };
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Record;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Record*;
+    using reference = const Record&;
+
+    const_iterator(const DNSPacketView& view, uint16_t index, uint16_t position);
+
+    reference operator*() const
+    {
+      return d_record;
+    }
+    pointer operator->() const
+    {
+      return &d_record;
+    }
+    const_iterator& operator++();
+    bool operator==(const const_iterator& rhs) const
+    {
+      return d_index == rhs.d_index;
+    }
+    bool operator!=(const const_iterator& rhs) const
+    {
+      return d_index != rhs.d_index;
+    }
+
+  private:
+    void parse();
+
+    const DNSPacketView* d_view;
+    uint16_t d_index;
+    uint16_t d_position;
+    Record d_record;
+  };
+
+  explicit DNSPacketView(const std::string_view& packet);
+
+  const_iterator begin() const
+  {
+    return {*this, 0, d_firstRecordPos};
+  }
+  const_iterator end() const
+  {
+    return {*this, static_cast<uint16_t>(size()), 0};
+  }
+  //! Number of records (everything *but* the question section)
+  size_t size() const
+  {
+    return d_header.ancount + d_header.nscount + d_header.arcount;
+  }
+  //! Materializes all records at once, into a vector sized up front
+  std::vector<DNSRecord> getRecords() const;
+
+  NameView d_qname;
+  uint16_t d_qclass{0};
+  uint16_t d_qtype{0};
+  //! counts are in host byte order, and adjusted for truncated packets like MOADNSParser does
+  dnsheader d_header;
+
+private:
+  std::string_view d_packet;
+  uint16_t d_firstRecordPos{sizeof(dnsheader)};
+};
+
 string simpleCompress(const string& label, const string& root="");
 void shuffleDNSPacket(char* packet, size_t length, const dnsheader_aligned& aligned_dh);
 void ageDNSPacket(char* packet, size_t length, uint32_t seconds, const dnsheader_aligned&);
@@ -38,27 +38,62 @@ PcapPacketReader::PcapPacketReader(const string& fname) : d_fname(fname)
   int flags = fcntl(fileno(d_fp.get()), F_GETFL, 0);
   fcntl(fileno(d_fp.get()), F_SETFL, flags & (~O_NONBLOCK)); // bsd needs this in stdin (??)
 
-  checkedFread(&d_pfh);
+  // the default stdio buffer is tiny, and we are going to read the whole file sequentially
+  setvbuf(d_fp.get(), nullptr, _IOFBF, 1024 * 1024);
 
-  if (d_pfh.magic != 2712847316UL) {
-    throw runtime_error((boost::format("PCAP file %s has bad magic %x, should be %x") % fname % d_pfh.magic % 2712847316UL).str());
+  uint32_t magic{0};
+  checkedFread(&magic);
+
+  if (magic == s_pcapngSectionHeaderBlock) {
+    d_pcapng = true;
+    uint32_t blockLength{0};
+    checkedFread(&blockLength);
+    readPcapngSectionHeader(blockLength);
+    /* we might have to write the packets we read to a regular PCAP file, the link type
+       is filled in once we know it from the first interface description block */
+    d_pfh.magic = s_pcapMagic;
+    d_pfh.version_major = 2;
+    d_pfh.version_minor = 4;
+    d_pfh.thiszone = 0;
+    d_pfh.sigfigs = 0;
+    d_pfh.snaplen = 65535;
+    d_pfh.linktype = 1;
+  }
+  else {
+    d_pfh.magic = magic;
+    checkedFreadSize(reinterpret_cast<char*>(&d_pfh) + sizeof(magic), sizeof(d_pfh) - sizeof(magic));
+
+    if (d_pfh.magic != s_pcapMagic) {
+      throw runtime_error((boost::format("PCAP file %s has bad magic %x, should be %x") % fname % d_pfh.magic % s_pcapMagic).str());
+    }
+    setLinkType(d_pfh.linktype);
+  }
+
+  d_runts = d_oversized = d_correctpackets = d_nonetheripudp = 0;
+}
+
+void PcapPacketReader::setLinkType(uint32_t linktype)
+{
+  if (linktype == d_linktype && d_buffer != nullptr) {
+    return;
   }
 
-  if( d_pfh.linktype==1) {
+  if( linktype==1) {
     d_skipMediaHeader=sizeof(struct ether_header);
   }
-  else if( d_pfh.linktype==12) { // LOOP
+  else if( linktype==12) { // LOOP
     d_skipMediaHeader=4;
   }
-  else if(d_pfh.linktype==101) {
+  else if(linktype==101) {
     d_skipMediaHeader=0;
   }
-  else if(d_pfh.linktype==113) {
+  else if(linktype==113) {
     d_skipMediaHeader=16;
   }
-  else throw runtime_error((boost::format("Unsupported link type %d") % d_pfh.linktype).str());
+  else throw runtime_error((boost::format("Unsupported link type %d") % linktype).str());
 
-  d_runts = d_oversized = d_correctpackets = d_nonetheripudp = 0;
+  d_linktype = linktype;
+  d_pfh.linktype = linktype;
 
   size_t alignmentCorrection = d_skipMediaHeader % alignof(struct ip);
 
@@ -68,6 +103,165 @@ PcapPacketReader::PcapPacketReader(const string& fname) : d_fname(fname)
   if (d_skipMediaHeader > d_bufsize) throw runtime_error("media header is too big");
 }
 
+void PcapPacketReader::skipBytes(size_t size)
+{
+  char scratch[4096];
+  while (size > 0) {
+    auto chunk = std::min(size, sizeof(scratch));
+    checkedFreadSize(scratch, chunk);
+    size -= chunk;
+  }
+}
+
+void PcapPacketReader::readPcapngSectionHeader(uint32_t blockLength)
+{
+  // block type and length have already been read
+  uint32_t byteOrderMagic{0};
+  checkedFread(&byteOrderMagic);
+  if (byteOrderMagic != s_pcapngByteOrderMagic) {
+    throw runtime_error((boost::format("pcapng file %s has a byte order we do not support (magic %x)") % d_fname % byteOrderMagic).str());
+  }
+  if (blockLength < 28 || (blockLength % 4) != 0) {
+    throw runtime_error((boost::format("pcapng file %s has an invalid section header block length %d") % d_fname % blockLength).str());
+  }
+  skipBytes(blockLength - 3 * sizeof(uint32_t));
+  // interface IDs are scoped to their section
+  d_interfaces.clear();
+}
+
+void PcapPacketReader::readPcapngPacket()
+{
+  constexpr uint32_t interfaceDescriptionBlock = 1;
+  constexpr uint32_t simplePacketBlock = 3;
+  constexpr uint32_t enhancedPacketBlock = 6;
+  constexpr size_t blockOverhead = sizeof(pdns_pcapng_block_header) + sizeof(uint32_t);
+
+  for (;;) {
+    pdns_pcapng_block_header block{};
+    checkedFread(&block);
+
+    if (block.type == s_pcapngSectionHeaderBlock) {
+      readPcapngSectionHeader(block.length);
+      continue;
+    }
+    if (block.length < blockOverhead || (block.length % 4) != 0) {
+      throw runtime_error((boost::format("pcapng file %s has an invalid block length %d") % d_fname % block.length).str());
+    }
+    size_t bodyLength = block.length - blockOverhead;
+
+    if (block.type == interfaceDescriptionBlock) {
+      std::string body(bodyLength, '\0');
+      checkedFreadSize(body.data(), body.size());
+      skipBytes(sizeof(uint32_t));
+      if (body.size() < 8) {
+        throw runtime_error((boost::format("pcapng file %s has a truncated interface description block") % d_fname).str());
+      }
+      PcapngInterface interface;
+      uint16_t linktype{0};
+      memcpy(&linktype, body.data(), sizeof(linktype));
+      memcpy(&interface.d_snaplen, body.data() + 4, sizeof(interface.d_snaplen));
+      interface.d_linktype = linktype;
+      // options are (code, length, value padded to 32 bits), we only care about if_tsresol
+      size_t pos = 8;
+      while (pos + 4 <= body.size()) {
+        uint16_t code{0};
+        uint16_t length{0};
+        memcpy(&code, &body.at(pos), sizeof(code));
+        memcpy(&length, &body.at(pos + 2), sizeof(length));
+        pos += 4;
+        if (code == 0 || pos + length > body.size()) {
+          break;
+        }
+        if (code == 9 && length == 1) {
+          uint8_t resolution = body.at(pos);
+          uint8_t exponent = resolution & 0x7f;
+          if (exponent < 64) {
+            uint64_t units = 1;
+            for (uint8_t idx = 0; idx < exponent; idx++) {
+              units *= (resolution & 0x80) != 0 ? 2 : 10;
+            }
+            interface.d_unitsPerSecond = units;
+          }
+        }
+        pos += (length + 3) & ~3;
+      }
+      d_interfaces.push_back(interface);
+      continue;
+    }
+
+    if (block.type != enhancedPacketBlock && block.type != simplePacketBlock) {
+      skipBytes(bodyLength + sizeof(uint32_t));
+      continue;
+    }
+
+    uint32_t interfaceID{0};
+    uint32_t caplen{0};
+    uint32_t len{0};
+    uint64_t timestamp{0};
+    size_t fixedLength{0};
+    if (block.type == enhancedPacketBlock) {
+      uint32_t fields[5];
+      fixedLength = sizeof(fields);
+      if (bodyLength < fixedLength) {
+        throw runtime_error((boost::format("pcapng file %s has a truncated enhanced packet block") % d_fname).str());
+      }
+      checkedFread(&fields);
+      interfaceID = fields[0];
+      timestamp = (static_cast<uint64_t>(fields[1]) << 32) | fields[2];
+      caplen = fields[3];
+      len = fields[4];
+    }
+    else {
+      fixedLength = sizeof(len);
+      if (bodyLength < fixedLength) {
+        throw runtime_error((boost::format("pcapng file %s has a truncated simple packet block") % d_fname).str());
+      }
+      checkedFread(&len);
+      caplen = std::min(static_cast<size_t>(len), bodyLength - fixedLength);
+    }
+
+    if (interfaceID >= d_interfaces.size()) {
+      throw runtime_error((boost::format("pcapng file %s references unknown interface %d") % d_fname % interfaceID).str());
+    }
+    const auto& interface = d_interfaces.at(interfaceID);
+    if (block.type == simplePacketBlock && interface.d_snaplen > 0) {
+      caplen = std::min(caplen, interface.d_snaplen);
+    }
+    if (caplen > bodyLength - fixedLength) {
+      throw runtime_error((boost::format("pcapng file %s has a packet larger than its block") % d_fname).str());
+    }
+    setLinkType(interface.d_linktype);
+
+    d_pheader.ts.tv_sec = static_cast<uint32_t>(timestamp / interface.d_unitsPerSecond);
+    d_pheader.ts.tv_usec = static_cast<uint32_t>(static_cast<double>(timestamp % interface.d_unitsPerSecond) * 1000000.0 / static_cast<double>(interface.d_unitsPerSecond));
+    d_pheader.caplen = caplen;
+    d_pheader.len = len;
+
+    if (caplen > d_bufsize) {
+      d_oversized++;
+      throw runtime_error((boost::format("Can't handle a %d byte packet, have space for %zu")  % caplen % d_bufsize).str());
+    }
+    checkedFreadSize(d_buffer, caplen);
+    skipBytes(bodyLength - fixedLength - caplen + sizeof(uint32_t));
+    return;
+  }
+}
+
+void PcapPacketReader::readPacket()
+{
+  if (d_pcapng) {
+    readPcapngPacket();
+    return;
+  }
+
+  checkedFread(&d_pheader);
+  if (d_pheader.caplen > d_bufsize) {
+    d_oversized++;
+    throw runtime_error((boost::format("Can't handle a %d byte packet, have space for %zu")  % d_pheader.caplen % d_bufsize).str());
+  }
+  checkedFreadSize(d_buffer, d_pheader.caplen);
+}
+
 void PcapPacketReader::checkedFreadSize(void* ptr, size_t size) 
 {
   int ret = fread(ptr, 1, size, d_fp.get());
@@ -86,19 +280,12 @@ bool PcapPacketReader::getUDPPacket()
 try
 {
   for(;;) {
-    checkedFread(&d_pheader);
+    readPacket();
     if(!d_pheader.caplen) {
       d_runts++;
       continue;
     }
 
-    if(d_pheader.caplen > d_bufsize) {
-      d_oversized++;
-      throw runtime_error((boost::format("Can't handle a %d byte packet, have space for %zu")  % d_pheader.caplen % d_bufsize).str());
-    }
-
-    checkedFreadSize(d_buffer, d_pheader.caplen);
-
     if(d_pheader.caplen < d_pheader.len) {
       d_runts++;
       continue;
@@ -113,7 +300,7 @@ try
     d_ip6=reinterpret_cast<struct ip6_hdr*>(d_buffer + d_skipMediaHeader);
     uint16_t contentCode=0;
 
-    if(d_pfh.linktype==1) {
+    if(d_linktype==1) {
       if (d_pheader.caplen < sizeof(*d_ether)) {
         d_runts++;
         continue;
@@ -121,7 +308,7 @@ try
       d_ether=reinterpret_cast<struct ether_header*>(d_buffer);
       contentCode=ntohs(d_ether->ether_type);
     }
-    else if(d_pfh.linktype == 12) { // LOOP
+    else if(d_linktype == 12) { // LOOP
       if (d_pheader.caplen < (d_skipMediaHeader + sizeof(*d_ip))) {
         d_runts++;
         continue;
@@ -131,7 +318,7 @@ try
       else
 	contentCode = 0x86dd;
     }
-    else if(d_pfh.linktype==101) {
+    else if(d_linktype==101) {
       if (d_pheader.caplen < (d_skipMediaHeader + sizeof(*d_ip))) {
         d_runts++;
         continue;
@@ -141,7 +328,7 @@ try
       else
 	contentCode = 0x86dd;
     }
-    else if(d_pfh.linktype==113) {
+    else if(d_linktype==113) {
       if (d_pheader.caplen < sizeof(*d_lcc)) {
         d_runts++;
         continue;
@@ -213,6 +400,14 @@ ComboAddress PcapPacketReader::getSource() const
   return ret;
 }
 
+PcapUDPPacket::PcapUDPPacket(const PcapPacketReader& ppr, bool withFrame) :
+  d_pheader(ppr.d_pheader), d_source(ppr.getSource()), d_dest(ppr.getDest()), d_payload(reinterpret_cast<const char*>(ppr.d_payload), ppr.d_len), d_linktype(ppr.d_pfh.linktype)
+{
+  if (withFrame) {
+    d_frame.assign(ppr.d_buffer, ppr.d_pheader.caplen);
+  }
+}
+
 ComboAddress PcapPacketReader::getDest() const
 {
   ComboAddress ret;
@@ -257,3 +452,20 @@ void PcapPacketWriter::write()
   fwrite(&d_ppr->d_pheader, 1, sizeof(d_ppr->d_pheader), d_fp.get());
   fwrite(d_ppr->d_buffer, 1, d_ppr->d_pheader.caplen, d_fp.get());
 }
+
+void PcapPacketWriter::write(const PcapUDPPacket& packet)
+{
+  if (!d_ppr) {
+    return;
+  }
+
+  if(d_first) {
+    d_pfh.linktype = packet.d_linktype;
+    fwrite(&d_pfh, 1, sizeof(d_pfh), d_fp.get());
+    d_first=false;
+  }
+  auto header = packet.d_pheader;
+  header.caplen = packet.d_frame.size();
+  fwrite(&header, 1, sizeof(header), d_fp.get());
+  fwrite(packet.d_frame.data(), 1, packet.d_frame.size(), d_fp.get());
+}
@@ -24,6 +24,7 @@
 #include <stdexcept>
 #include "iputils.hh"
 #include <string>
+#include <vector>
 #include "misc.hh"
 #include <iostream>
 #define __FAVOR_BSD
@@ -68,6 +69,12 @@ struct pdns_pcap_pkthdr {
   uint32_t len{0};        /* length this packet (off wire) */
 };
 
+/* pcapng (https://www.ietf.org/archive/id/draft-ietf-opsawg-pcapng) block header */
+struct pdns_pcapng_block_header {
+  uint32_t type;
+  uint32_t length;   /* total length of the block, including this header and the trailing length */
+};
+
 struct pdns_lcc_header {
   uint16_t lcc_pkttype;/* packet type */
   uint16_t lcc_hatype;/* link-layer address type */
@@ -89,6 +96,10 @@ public:
 
   PcapPacketReader(const string& fname);
 
+  static constexpr uint32_t s_pcapMagic = 2712847316UL;
+  static constexpr uint32_t s_pcapngSectionHeaderBlock = 0x0A0D0D0A;
+  static constexpr uint32_t s_pcapngByteOrderMagic = 0x1A2B3C4D;
+
   template<typename T>
   void checkedFread(T* ptr)
   {
@@ -102,6 +113,11 @@ public:
   ComboAddress getSource() const;
   ComboAddress getDest() const;
 
+  bool isPcapng() const
+  {
+    return d_pcapng;
+  }
+
   struct pdns_lcc_header* d_lcc{nullptr};
   struct ether_header* d_ether{nullptr};
   struct ip *d_ip{nullptr};
@@ -115,12 +131,43 @@ public:
   pdns_pcap_file_header d_pfh;
   unsigned int d_runts, d_oversized, d_correctpackets, d_nonetheripudp;
   alignas (struct ip) char d_readbuffer[32768];
-  char *d_buffer;
-  size_t d_bufsize;
+  char *d_buffer{nullptr};
+  size_t d_bufsize{0};
 private:
+  struct PcapngInterface
+  {
+    uint32_t d_linktype{0};
+    uint32_t d_snaplen{0};
+    uint64_t d_unitsPerSecond{1000000};
+  };
+
+  void setLinkType(uint32_t linktype);
+  void readPacket();
+  void readPcapngPacket();
+  void readPcapngSectionHeader(uint32_t blockLength);
+  void skipBytes(size_t size);
+
   pdns::UniqueFilePtr d_fp{nullptr};
   string d_fname;
-  unsigned int d_skipMediaHeader;
+  std::vector<PcapngInterface> d_interfaces;
+  uint32_t d_linktype{0};
+  unsigned int d_skipMediaHeader{0};
+  bool d_pcapng{false};
+};
+
+/* A copy of the UDP packet a PcapPacketReader is positioned on, that does not
+   reference the reader's buffer and can therefore be handed to another thread. */
+struct PcapUDPPacket
+{
+  PcapUDPPacket() = default;
+  PcapUDPPacket(const PcapPacketReader& ppr, bool withFrame);
+
+  struct pdns_pcap_pkthdr d_pheader;
+  ComboAddress d_source;
+  ComboAddress d_dest;
+  std::string d_payload;
+  std::string d_frame; /* the complete captured frame, only kept on request, for PcapPacketWriter */
+  uint32_t d_linktype{0}; /* of d_frame, a pcapng reader only knows it once it has seen the interface */
 };
 
 class PcapPacketWriter
@@ -130,11 +177,18 @@ public:
   PcapPacketWriter(const string& fname);
 
   void write();
-  void setPPR(const PcapPacketReader& ppr) { d_ppr = &ppr; }
+  void write(const PcapUDPPacket& packet);
+  void setPPR(const PcapPacketReader& ppr)
+  {
+    d_ppr = &ppr;
+    d_pfh = ppr.d_pfh;
+  }
 
 private:
   string d_fname;
   const PcapPacketReader* d_ppr{nullptr};
+  pdns_pcap_file_header d_pfh{}; /* a copy, so that packets can still be written once the reader is gone.
+                                   The link type is taken from the first packet written */
 
   pdns::UniqueFilePtr d_fp{nullptr};
   bool d_first{true};
@@ -215,24 +215,29 @@ string LUARecordContent::getCode() const
 }
 #endif
 
-void OPTRecordContent::getData(vector<pair<uint16_t, string> >& options) const
+static void getOPTRecordOptions(const std::string_view& data, vector<pair<uint16_t, string> >& options)
 {
   string::size_type pos=0;
   uint16_t code, len;
-  while(d_data.size() >= 4 + pos) {
-    code = 256 * (unsigned char)d_data.at(pos) + (unsigned char)d_data.at(pos+1);
-    len = 256 * (unsigned char)d_data.at(pos+2) + (unsigned char)d_data.at(pos+3);
+  while(data.size() >= 4 + pos) {
+    code = 256 * (unsigned char)data.at(pos) + (unsigned char)data.at(pos+1);
+    len = 256 * (unsigned char)data.at(pos+2) + (unsigned char)data.at(pos+3);
     pos+=4;
 
-    if(pos + len > d_data.size())
+    if(pos + len > data.size())
       break;
 
-    string field(d_data.c_str() + pos, len);
+    string field(data.data() + pos, len);
     pos+=len;
     options.emplace_back(code, std::move(field));
   }
 }
 
+void OPTRecordContent::getData(vector<pair<uint16_t, string> >& options) const
+{
+  getOPTRecordOptions(d_data, options);
+}
+
 //NOLINTBEGIN
 boilerplate_conv(TSIG,
                  conv.xfrName(d_algoName);
@@ -956,6 +961,30 @@ bool getEDNSOpts(const MOADNSParser& mdp, EDNSOpts* eo)
   return false;
 }
 
+bool getEDNSOpts(const DNSPacketView& view, EDNSOpts* eo)
+{
+  eo->d_extFlags=0;
+  if (view.d_header.arcount == 0) {
+    return false;
+  }
+  for (const auto& record : view) {
+    if (record.d_place == DNSResourceRecord::ADDITIONAL && record.d_type == QType::OPT) {
+      eo->d_packetsize=record.d_class;
+
+      EDNS0Record stuff;
+      uint32_t ttl=ntohl(record.d_ttl);
+      memcpy(&stuff, &ttl, sizeof(stuff));
+
+      eo->d_extRCode=stuff.extRCode;
+      eo->d_version=stuff.version;
+      eo->d_extFlags = ntohs(stuff.extFlags);
+      getOPTRecordOptions(record.getRData(), eo->d_options);
+      return true;
+    }
+  }
+  return false;
+}
+
 static void reportBasicTypes(const ReportIsOnlyCallableByReportAllTypes& guard)
 {
   ARecordContent::report(guard);
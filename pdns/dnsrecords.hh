@@ -1367,7 +1367,9 @@ struct EDNSOpts
 //! Convenience function that fills out EDNS0 options, and returns true if there are any
 
 class MOADNSParser;
+class DNSPacketView;
 bool getEDNSOpts(const MOADNSParser& mdp, EDNSOpts* eo);
+bool getEDNSOpts(const DNSPacketView& view, EDNSOpts* eo);
 void reportAllTypes();
 ComboAddress getAddr(const DNSRecord& dr, uint16_t defport=0);
 void checkHostnameCorrectness(const DNSResourceRecord& rr, bool allowUnderscore = false);
@@ -42,6 +42,9 @@
 #include "namespaces.hh"
 #include "dnsrecords.hh"
 #include "statnode.hh"
+#include "channel.hh"
+#include "lock.hh"
+#include <thread>
 
 #if !defined(IP_OFFMASK)
 // Solaris and derivatives do not define IP_OFFMASK in <netinet/ip.h>.
@@ -77,12 +80,78 @@ struct QuestionData
 };
 
 typedef map<QuestionIdentifier, QuestionData> statmap_t;
-statmap_t statmap;
+typedef map<uint32_t,uint32_t> cumul_t;
+typedef map<uint16_t,uint32_t> rcodes_t;
 
-static unsigned int liveQuestions()
+struct LiveCounts
+{
+  unsigned int questions{0};
+  unsigned int answers{0};
+  unsigned int outstanding{0};
+};
+
+struct ScopeConfig
+{
+  DNSName filtername;
+  bool haveRDFilter{false};
+  bool rdFilter{false};
+  bool doServFailTree{false};
+  bool noservfailstats{false};
+  bool keepFailures{false};
+  bool verbose{false};
+};
+
+/* What process() needs from a packet, pointing either into the reader or into a
+   PcapUDPPacket handed to a worker */
+struct ScopePacket
+{
+  const struct pdns_pcap_pkthdr& pheader;
+  const ComboAddress source;
+  const ComboAddress dest;
+  const char* payload;
+  size_t payloadLen;
+};
+
+/* Everything we learn from the packets handed to one worker. A question and its
+   answers always end up at the same worker, so the statistics of all workers can
+   simply be merged once every packet has been processed. */
+struct ScopeStats
+{
+  // returns false if the packet could not be parsed
+  bool process(const ScopePacket& packet, const ScopeConfig& config);
+  void merge(ScopeStats& rhs);
+  unsigned int liveQuestions() const;
+
+  statmap_t statmap;
+  cumul_t cumul;
+  rcodes_t rcodes;
+  // 'outstanding' is only sampled at the first packet of each second seen here, see merge()
+  map<time_t, LiveCounts> load;
+  std::unordered_set<ComboAddress, ComboAddress::addressOnlyHash> requestors, recipients, rdnonra;
+  StatNode servfailTree;
+  LiveCounts* currentLoad{nullptr};
+  time_t lowestTime{0}, highestTime{0}, lastsec{0};
+  unsigned int parsefail{0};
+  unsigned int untracked{0};
+  unsigned int nonRDQueries{0};
+  unsigned int queries{0};
+  unsigned int ipv4DNSPackets{0};
+  unsigned int ipv6DNSPackets{0};
+  unsigned int rdNonRAAnswers{0};
+  unsigned int answers{0};
+  unsigned int rdFilterMismatch{0};
+  unsigned int nameMismatch{0};
+  unsigned int dnssecOK{0};
+  unsigned int edns{0};
+  unsigned int dnssecCD{0};
+  unsigned int dnssecAD{0};
+  unsigned int reuses{0};
+};
+
+unsigned int ScopeStats::liveQuestions() const
 {
   unsigned int ret=0;
-  for(statmap_t::value_type& val :  statmap) {
+  for(const statmap_t::value_type& val :  statmap) {
     if(!val.second.d_answercount)
       ret++;
     //    if(val.second.d_qcount > val.second.d_answercount)
@@ -91,27 +160,6 @@ static unsigned int liveQuestions()
   return ret;
 }
 
-struct LiveCounts
-{
-  unsigned int questions;
-  unsigned int answers;
-  unsigned int outstanding;
-
-  LiveCounts()
-  {
-    questions=answers=outstanding=0;
-  }
-
-  LiveCounts operator-(const LiveCounts& rhs)
-  {
-    LiveCounts ret;
-    ret.questions = questions - rhs.questions;
-    ret.answers = answers - rhs.answers;
-    ret.outstanding = outstanding;
-    return ret;
-  }
-};
-
 static void visitor(const StatNode* node, const StatNode::Stat& /* selfstat */, const StatNode::Stat& childstat)
 {
   // 20% servfails, >100 children, on average less than 2 copies of a query
@@ -136,6 +184,207 @@ static const struct timeval operator-(const struct pdns_timeval& lhs, const stru
   return operator-(a,b);
 }
 
+bool ScopeStats::process(const ScopePacket& packet, const ScopeConfig& config)
+try
+{
+  const auto& pheader = packet.pheader;
+  const char* payload = packet.payload;
+  const size_t payloadLen = packet.payloadLen;
+
+  uint16_t qtype;
+  DNSName qname(payload, payloadLen, 12, false, &qtype);
+  struct dnsheader header;
+  memcpy(&header, payload, 12);
+
+  if(config.haveRDFilter && header.rd != config.rdFilter) {
+    rdFilterMismatch++;
+    return true;
+  }
+
+  if(!config.filtername.empty() && !qname.isPartOf(config.filtername)) {
+    nameMismatch++;
+    return true;
+  }
+
+  if(!header.qr) {
+    uint16_t udpsize, z;
+    if(getEDNSUDPPayloadSizeAndZ(payload, payloadLen, &udpsize, &z)) {
+      edns++;
+      if(z & EDNSOpts::DNSSECOK)
+        dnssecOK++;
+      if(header.cd)
+        dnssecCD++;
+      if(header.ad)
+        dnssecAD++;
+    }
+  }
+
+  if(packet.source.isIPv4())
+    ++ipv4DNSPackets;
+  else
+    ++ipv6DNSPackets;
+
+  if(pheader.ts.tv_sec != lastsec) {
+    auto [iter, inserted] = load.try_emplace(pheader.ts.tv_sec);
+    currentLoad = &iter->second;
+    if(inserted) {
+      currentLoad->outstanding = liveQuestions();
+    }
+    lastsec = pheader.ts.tv_sec;
+  }
+
+  if(lowestTime) { lowestTime = min((time_t)lowestTime,  (time_t)pheader.ts.tv_sec); }
+  else { lowestTime = pheader.ts.tv_sec; }
+  highestTime=max((time_t)highestTime, (time_t)pheader.ts.tv_sec);
+
+  QuestionIdentifier qi=QuestionIdentifier::create(packet.source, packet.dest, header, qname, qtype);
+
+  if(!header.qr) { // question
+    //	    cout<<"Query "<<qi<<endl;
+    if(!header.rd)
+      nonRDQueries++;
+    queries++;
+    currentLoad->questions++;
+
+    ComboAddress rem = packet.source;
+    rem.sin4.sin_port=0;
+    requestors.insert(rem);
+
+    QuestionData& qd=statmap[qi];
+
+    if(!qd.d_firstquestiontime.tv_sec)
+      qd.d_firstquestiontime=pheader.ts;
+    else {
+      auto delta=makeFloat(pheader.ts - qd.d_firstquestiontime);
+      //	      cout<<"Reuse of "<<qi<<", delta t="<<delta<<", count="<<qd.d_qcount<<endl;
+      if(delta > 2.0) {
+        //		cout<<"Resetting old entry for "<<qi<<", too old"<<endl;
+        qd.d_qcount=0;
+        qd.d_answercount=0;
+        qd.d_firstquestiontime=pheader.ts;
+      }
+    }
+    if(qd.d_qcount++)
+      reuses++;
+  }
+  else  {  // answer
+    //	    cout<<"Response "<<qi<<endl;
+    rcodes[header.rcode]++;
+    answers++;
+    currentLoad->answers++;
+    if(header.rd && !header.ra) {
+      rdNonRAAnswers++;
+      rdnonra.insert(packet.dest);
+    }
+
+    if(header.ra) {
+      ComboAddress rem = packet.dest;
+      rem.sin4.sin_port=0;
+      recipients.insert(rem);
+    }
+
+    QuestionData& qd=statmap[qi];
+    if(!qd.d_qcount) {
+      //	      cout<<"Untracked answer: "<<qi<<endl;
+      untracked++;
+    }
+
+    qd.d_answercount++;
+
+    if(qd.d_qcount) {
+      uint32_t usecs= (pheader.ts.tv_sec - qd.d_firstquestiontime.tv_sec) * 1000000 +
+        (pheader.ts.tv_usec - qd.d_firstquestiontime.tv_usec) ;
+
+      //	      cout<<"Usecs for "<<qi<<": "<<usecs<<endl;
+      if(!config.noservfailstats || header.rcode != 2)
+        cumul[usecs]++;
+
+      ComboAddress rem = packet.dest;
+      rem.sin4.sin_port=0;
+
+      if (config.doServFailTree) {
+        servfailTree.submit(qname, header.rcode, static_cast<uint32_t>(payloadLen), false, rem, 0);
+      }
+    }
+
+    if(!qd.d_qcount || qd.d_qcount == qd.d_answercount) {
+      //	      cout<<"Clearing state for "<<qi<<endl<<endl;
+      statmap.erase(qi);
+    }
+    else {
+      //	      cout<<"State for qi remains open, qcount="<<qd.d_qcount<<", answercount="<<qd.d_answercount<<endl;
+    }
+  }
+  return true;
+}
+catch(std::exception& e) {
+  if(config.verbose)
+    cout<<"error parsing packet: "<<e.what()<<endl;
+
+  parsefail++;
+  return false;
+}
+
+void ScopeStats::merge(ScopeStats& rhs)
+{
+  /* The questions outstanding at the start of a second are those of every worker.
+     A worker that saw no packet in that second still has the questions it had
+     outstanding at its next packet, or at the end of the capture. This gives the
+     same result as sampling them all at once, whatever the number of workers,
+     as long as the packets are in capture time order. */
+  auto outstandingAt = [](const ScopeStats& stats, time_t sec, unsigned int atEnd) {
+    auto iter = stats.load.lower_bound(sec);
+    return iter != stats.load.end() ? iter->second.outstanding : atEnd;
+  };
+  const auto ourLive = liveQuestions();
+  const auto theirLive = rhs.liveQuestions();
+  map<time_t, LiveCounts> mergedLoad;
+  for (const auto* stats : {this, &rhs}) {
+    for (const auto& [sec, counts] : stats->load) {
+      auto& merged = mergedLoad[sec];
+      merged.questions += counts.questions;
+      merged.answers += counts.answers;
+    }
+  }
+  for (auto& [sec, counts] : mergedLoad) {
+    counts.outstanding = outstandingAt(*this, sec, ourLive) + outstandingAt(rhs, sec, theirLive);
+  }
+  load = std::move(mergedLoad);
+  currentLoad = nullptr;
+  lastsec = 0;
+
+  statmap.merge(rhs.statmap);
+  for (const auto& [usecs, count] : rhs.cumul) {
+    cumul[usecs] += count;
+  }
+  for (const auto& [rcode, count] : rhs.rcodes) {
+    rcodes[rcode] += count;
+  }
+  requestors.merge(rhs.requestors);
+  recipients.merge(rhs.recipients);
+  rdnonra.merge(rhs.rdnonra);
+  servfailTree.merge(std::move(rhs.servfailTree));
+  if (rhs.lowestTime && (!lowestTime || rhs.lowestTime < lowestTime)) {
+    lowestTime = rhs.lowestTime;
+  }
+  highestTime = max(highestTime, rhs.highestTime);
+  parsefail += rhs.parsefail;
+  untracked += rhs.untracked;
+  nonRDQueries += rhs.nonRDQueries;
+  queries += rhs.queries;
+  ipv4DNSPackets += rhs.ipv4DNSPackets;
+  ipv6DNSPackets += rhs.ipv6DNSPackets;
+  rdNonRAAnswers += rhs.rdNonRAAnswers;
+  answers += rhs.answers;
+  rdFilterMismatch += rhs.rdFilterMismatch;
+  nameMismatch += rhs.nameMismatch;
+  dnssecOK += rhs.dnssecOK;
+  edns += rhs.edns;
+  dnssecCD += rhs.dnssecCD;
+  dnssecAD += rhs.dnssecAD;
+  reuses += rhs.reuses;
+}
+
 
 int main(int argc, char** argv)
 try
@@ -155,6 +404,7 @@ try
     ("port", po::value<uint16_t>()->default_value(0), "The source and destination port to consider. Default is looking at packets from and to ports 53 and 5300")
     ("servfail-tree", "Figure out subtrees that generate servfails")
     ("stats-dir", po::value<string>()->default_value("."), "Directory where statistics will be saved")
+    ("threads", po::value<unsigned int>()->default_value(1), "Number of threads parsing packets and gathering statistics, in addition to the one reading the files")
     ("write-failures,w", po::value<string>()->default_value(""), "if set, write weird packets to this PCAP file")
     ("verbose,v", "be verbose");
 
@@ -184,67 +434,81 @@ try
     exit(0);
   }
 
-  DNSName filtername;
+  ScopeConfig config;
   if(g_vm.count("filter-name"))
-    filtername = DNSName(g_vm["filter-name"].as<string>());
-  uint32_t nameMismatch = 0;
-
-  StatNode root;
+    config.filtername = DNSName(g_vm["filter-name"].as<string>());
 
-  bool verbose = g_vm.count("verbose");
+  config.verbose = g_vm.count("verbose");
 
-  bool haveRDFilter=0, rdFilter=0;
   if(g_vm.count("rd")) {
-    rdFilter = g_vm["rd"].as<bool>();
-    haveRDFilter=1;
-    cout<<"Filtering on recursion desired="<<rdFilter<<endl;
+    config.rdFilter = g_vm["rd"].as<bool>();
+    config.haveRDFilter=true;
+    cout<<"Filtering on recursion desired="<<config.rdFilter<<endl;
   }
   else
     cout<<"Warning, looking at both RD and non-RD traffic!"<<endl;
 
   bool doIPv4 = g_vm["ipv4"].as<bool>();
   bool doIPv6 = g_vm["ipv6"].as<bool>();
-  bool doServFailTree = g_vm.count("servfail-tree");
-  bool noservfailstats = g_vm.count("no-servfail-stats");
+  config.doServFailTree = g_vm.count("servfail-tree");
+  config.noservfailstats = g_vm.count("no-servfail-stats");
+  config.keepFailures = !g_vm["write-failures"].as<string>().empty();
   int dnserrors = 0;
-  int parsefail = 0;
-  typedef map<uint32_t,uint32_t> cumul_t;
-  cumul_t cumul;
-  unsigned int untracked = 0;
-  unsigned int nonRDQueries = 0;
-  unsigned int queries = 0;
-  unsigned int ipv4DNSPackets = 0;
-  unsigned int ipv6DNSPackets = 0;
-  unsigned int fragmented = 0;
-  unsigned int rdNonRAAnswers = 0;
-  unsigned int answers = 0;
   unsigned int nonDNSIP = 0;
-  unsigned int rdFilterMismatch = 0;
-  unsigned int dnssecOK = 0;
-  unsigned int edns = 0;
-  unsigned int dnssecCD = 0;
-  unsigned int dnssecAD = 0;
-  unsigned int reuses = 0;
-  typedef map<uint16_t,uint32_t> rcodes_t;
-  rcodes_t rcodes;
-
-  time_t lowestTime=0, highestTime=0;
-  time_t lastsec=0;
-  LiveCounts lastcounts;
-  std::unordered_set<ComboAddress, ComboAddress::addressOnlyHash> requestors, recipients, rdnonra;
-  typedef vector<pair<time_t, LiveCounts> > pcounts_t;
-  pcounts_t pcounts;
+  unsigned int fragmented = 0;
   const uint16_t port = g_vm["port"].as<uint16_t>();
+  const unsigned int threadsCount = std::max(g_vm["threads"].as<unsigned int>(), 1U);
 
   reportAllTypes();
 
+  /* The reading thread only does the cheap filtering on the IP and UDP headers, the DNS
+     parsing and the accounting are done by the workers. All packets of a given exchange
+     are sent to the same worker, based on the client address and port and the DNS ID. */
+  using batch_t = vector<PcapUDPPacket>;
+  const size_t batchSize = 256;
+  vector<ScopeStats> stats(threadsCount);
+  vector<pdns::channel::Sender<batch_t>> senders;
+  vector<std::unique_ptr<batch_t>> batches;
+  vector<std::thread> workers;
+  /* parse failures are written out as they are found, by whichever thread finds them */
+  LockGuarded<std::unique_ptr<PcapPacketWriter>> failureWriter;
+  if (threadsCount > 1) {
+    for (unsigned int idx = 0; idx < threadsCount; idx++) {
+      auto [sender, receiver] = pdns::channel::createObjectQueue<batch_t>(pdns::channel::SenderBlockingMode::SenderBlocking, pdns::channel::ReceiverBlockingMode::ReceiverBlocking, 0, false);
+      senders.push_back(std::move(sender));
+      batches.push_back(std::make_unique<batch_t>());
+      batches.back()->reserve(batchSize);
+      workers.emplace_back([&stats, &config, &failureWriter, idx, receiver = std::move(receiver)]() mutable {
+        for (;;) {
+          auto batch = receiver.receive();
+          if (!batch) {
+            if (receiver.isClosed()) {
+              break;
+            }
+            continue;
+          }
+          for (const auto& packet : **batch) {
+            if (!stats[idx].process({packet.d_pheader, packet.d_source, packet.d_dest, packet.d_payload.data(), packet.d_payload.size()}, config) && config.keepFailures) {
+              (*failureWriter.lock())->write(packet);
+            }
+          }
+        }
+      });
+    }
+  }
+
   for(unsigned int fno=0; fno < files.size(); ++fno) {
     PcapPacketReader pr(files[fno]);
-    std::unique_ptr<PcapPacketWriter> pw=nullptr;
-    if(!g_vm["write-failures"].as<string>().empty())
-      pw = std::make_unique<PcapPacketWriter>(g_vm["write-failures"].as<string>(), pr);
+    if(config.keepFailures) {
+      auto writer = failureWriter.lock();
+      if (!*writer) {
+        *writer = std::make_unique<PcapPacketWriter>(g_vm["write-failures"].as<string>(), pr);
+      }
+      else {
+        (*writer)->setPPR(pr);
+      }
+    }
 
-    EDNSOpts edo;
     while(pr.getUDPPacket()) {
 
       if (pr.d_len <= 12) {
@@ -267,205 +531,103 @@ try
         continue;
       }
 
-      try {
-        if ((pr.d_ip->ip_v == 4 && !doIPv4) || (pr.d_ip->ip_v == 6 && !doIPv6)) {
-          continue;
-        }
-
-        if (pr.d_ip->ip_v == 4) {
-          uint16_t frag = ntohs(pr.d_ip->ip_off);
-          if((frag & IP_MF) || (frag & IP_OFFMASK)) { // more fragments or IS a fragment
-            fragmented++;
-            continue;
-          }
-        }
-        uint16_t qtype;
-        DNSName qname((const char*)pr.d_payload, pr.d_len, 12, false, &qtype);
-        struct dnsheader header;
-        memcpy(&header, (struct dnsheader*)pr.d_payload, 12);
-
-        if(haveRDFilter && header.rd != rdFilter) {
-          rdFilterMismatch++;
-          continue;
-        }
+      if ((pr.d_ip->ip_v == 4 && !doIPv4) || (pr.d_ip->ip_v == 6 && !doIPv6)) {
+        continue;
+      }
 
-        if(!filtername.empty() && !qname.isPartOf(filtername)) {
-          nameMismatch++;
+      if (pr.d_ip->ip_v == 4) {
+        uint16_t frag = ntohs(pr.d_ip->ip_off);
+        if((frag & IP_MF) || (frag & IP_OFFMASK)) { // more fragments or IS a fragment
+          fragmented++;
           continue;
         }
+      }
 
-        if(!header.qr) {
-          uint16_t udpsize, z;
-          if(getEDNSUDPPayloadSizeAndZ((const char*)pr.d_payload, pr.d_len, &udpsize, &z)) {
-            edns++;
-            if(z & EDNSOpts::DNSSECOK)
-              dnssecOK++;
-            if(header.cd)
-              dnssecCD++;
-            if(header.ad)
-              dnssecAD++;
-          }
-        }
-
-        if(pr.d_ip->ip_v == 4)
-          ++ipv4DNSPackets;
-        else
-          ++ipv6DNSPackets;
-
-        if(pr.d_pheader.ts.tv_sec != lastsec) {
-          LiveCounts lc;
-          if(lastsec) {
-            lc.questions = queries;
-            lc.answers = answers;
-            lc.outstanding = liveQuestions();
-
-            LiveCounts diff = lc - lastcounts;
-            pcounts.emplace_back(pr.d_pheader.ts.tv_sec, diff);
-          }
-          lastsec = pr.d_pheader.ts.tv_sec;
-          lastcounts = lc;
-        }
-
-        if(lowestTime) { lowestTime = min((time_t)lowestTime,  (time_t)pr.d_pheader.ts.tv_sec); }
-        else { lowestTime = pr.d_pheader.ts.tv_sec; }
-        highestTime=max((time_t)highestTime, (time_t)pr.d_pheader.ts.tv_sec);
-
-        QuestionIdentifier qi=QuestionIdentifier::create(pr.getSource(), pr.getDest(), header, qname, qtype);
-
-        if(!header.qr) { // question
-          //	    cout<<"Query "<<qi<<endl;
-          if(!header.rd)
-            nonRDQueries++;
-          queries++;
-
-          ComboAddress rem = pr.getSource();
-          rem.sin4.sin_port=0;
-          requestors.insert(rem);
-
-          QuestionData& qd=statmap[qi];
-
-          if(!qd.d_firstquestiontime.tv_sec)
-            qd.d_firstquestiontime=pr.d_pheader.ts;
-          else {
-            auto delta=makeFloat(pr.d_pheader.ts - qd.d_firstquestiontime);
-            //	      cout<<"Reuse of "<<qi<<", delta t="<<delta<<", count="<<qd.d_qcount<<endl;
-            if(delta > 2.0) {
-              //		cout<<"Resetting old entry for "<<qi<<", too old"<<endl;
-              qd.d_qcount=0;
-              qd.d_answercount=0;
-              qd.d_firstquestiontime=pr.d_pheader.ts;
-            }
-          }
-          if(qd.d_qcount++)
-            reuses++;
-        }
-        else  {  // answer
-          //	    cout<<"Response "<<qi<<endl;
-          rcodes[header.rcode]++;
-          answers++;
-          if(header.rd && !header.ra) {
-            rdNonRAAnswers++;
-            rdnonra.insert(pr.getDest());
-          }
-
-          if(header.ra) {
-            ComboAddress rem = pr.getDest();
-            rem.sin4.sin_port=0;
-            recipients.insert(rem);
-          }
-
-          QuestionData& qd=statmap[qi];
-          if(!qd.d_qcount) {
-            //	      cout<<"Untracked answer: "<<qi<<endl;
-            untracked++;
-          }
-
-          qd.d_answercount++;
-
-          if(qd.d_qcount) {
-            uint32_t usecs= (pr.d_pheader.ts.tv_sec - qd.d_firstquestiontime.tv_sec) * 1000000 +
-              (pr.d_pheader.ts.tv_usec - qd.d_firstquestiontime.tv_usec) ;
-
-            //	      cout<<"Usecs for "<<qi<<": "<<usecs<<endl;
-            if(!noservfailstats || header.rcode != 2)
-              cumul[usecs]++;
-
-            ComboAddress rem = pr.getDest();
-            rem.sin4.sin_port=0;
-
-            if (doServFailTree) {
-              root.submit(qname, header.rcode, pr.d_len, false, rem, 0U);
-            }
-          }
-
-          if(!qd.d_qcount || qd.d_qcount == qd.d_answercount) {
-            //	      cout<<"Clearing state for "<<qi<<endl<<endl;
-            statmap.erase(qi);
-          }
-          else {
-            //	      cout<<"State for qi remains open, qcount="<<qd.d_qcount<<", answercount="<<qd.d_answercount<<endl;
-          }
+      if (threadsCount == 1) {
+        if (!stats[0].process({pr.d_pheader, pr.getSource(), pr.getDest(), reinterpret_cast<const char*>(pr.d_payload), pr.d_len}, config) && config.keepFailures) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+          (*failureWriter.lock())->write();
         }
+        continue;
       }
-      catch(std::exception& e) {
-        if(verbose)
-          cout<<"error parsing packet: "<<e.what()<<endl;
 
-        if(pw)
-          pw->write();
-        parsefail++;
-        continue;
+      struct dnsheader header;
+      memcpy(&header, pr.d_payload, sizeof(header));
+      const ComboAddress client = header.qr ? pr.getDest() : pr.getSource();
+      size_t hash = ComboAddress::addressOnlyHash()(client);
+      boost::hash_combine(hash, client.getPort());
+      boost::hash_combine(hash, header.id);
+      const auto idx = hash % threadsCount;
+
+      batches[idx]->emplace_back(pr, config.keepFailures);
+      if (batches[idx]->size() >= batchSize) {
+        senders[idx].send(std::move(batches[idx]));
+        batches[idx] = std::make_unique<batch_t>();
+        batches[idx]->reserve(batchSize);
       }
     }
 
     cout<<"PCAP contained "<<pr.d_correctpackets<<" correct packets, "<<pr.d_runts<<" runts, "<< pr.d_oversized<<" oversize, "<<pr.d_nonetheripudp<<" non-UDP.\n";
   }
 
+  for (size_t idx = 0; idx < workers.size(); idx++) {
+    if (!batches[idx]->empty()) {
+      senders[idx].send(std::move(batches[idx]));
+    }
+    senders[idx].close();
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (size_t idx = 1; idx < stats.size(); idx++) {
+    stats[0].merge(stats[idx]);
+  }
+  auto& result = stats[0];
+
   /*
   cout<<"Open when done: "<<endl;
-  for(const auto& a : statmap) {
+  for(const auto& a : result.statmap) {
     cout<<a.first<<": qcount="<<a.second.d_qcount<<", answercount="<<a.second.d_answercount<<endl;
   }
   */
 
-  cout<<"Timespan: "<<(highestTime-lowestTime)/3600.0<<" hours"<<endl;
+  cout<<"Timespan: "<<(result.highestTime-result.lowestTime)/3600.0<<" hours"<<endl;
 
-  cout<<nonDNSIP<<" non-DNS UDP, "<<dnserrors<<" dns decoding errors, "<<parsefail<<" packets failed to parse"<<endl;
+  cout<<nonDNSIP<<" non-DNS UDP, "<<dnserrors<<" dns decoding errors, "<<result.parsefail<<" packets failed to parse"<<endl;
   cout<<"Ignored fragment packets: "<<fragmented<<endl;
-  cout<<"Dropped DNS packets based on recursion-desired filter: "<<rdFilterMismatch<<endl;
-  if(!filtername.empty())
-    cout <<"Dropped DNS packets because not part of '"<<filtername<<"': "<<nameMismatch << endl;
-  cout<<"DNS IPv4: "<<ipv4DNSPackets<<" packets, IPv6: "<<ipv6DNSPackets<<" packets"<<endl;
-  cout<<"Questions: "<<queries<<", answers: "<<answers<<endl;
-  cout<<"Reuses of same state entry: "<<reuses<<endl;
+  cout<<"Dropped DNS packets based on recursion-desired filter: "<<result.rdFilterMismatch<<endl;
+  if(!config.filtername.empty())
+    cout <<"Dropped DNS packets because not part of '"<<config.filtername<<"': "<<result.nameMismatch << endl;
+  cout<<"DNS IPv4: "<<result.ipv4DNSPackets<<" packets, IPv6: "<<result.ipv6DNSPackets<<" packets"<<endl;
+  cout<<"Questions: "<<result.queries<<", answers: "<<result.answers<<endl;
+  cout<<"Reuses of same state entry: "<<result.reuses<<endl;
   unsigned int unanswered=0;
 
 
   //  ofstream openf("openf");
-  for(statmap_t::const_iterator i=statmap.begin(); i!=statmap.end(); ++i) {
+  for(statmap_t::const_iterator i=result.statmap.begin(); i!=result.statmap.end(); ++i) {
     if(!i->second.d_answercount) {
       unanswered++;
     }
     //openf<< i->first.d_source.toStringWithPort()<<' ' <<i->first.d_dest.toStringWithPort()<<' '<<i->first.d_id<<' '<<i->first.d_qname <<" " <<i->first.d_qtype<< " "<<i->second.d_qcount <<" " <<i->second.d_answercount<<endl;
   }
 
-  cout<< boost::format("%d (%.02f%% of all) queries did not request recursion") % nonRDQueries % ((nonRDQueries*100.0)/queries) << endl;
-  cout<< rdNonRAAnswers << " answers had recursion desired bit set, but recursion available=0 (for "<<rdnonra.size()<<" remotes)"<<endl;
-  cout<<statmap.size()<<" queries went unanswered, of which "<< statmap.size()-unanswered<<" were answered on exact retransmit"<<endl;
-  cout<<untracked<<" responses could not be matched to questions"<<endl;
-  cout<<edns <<" questions requested EDNS processing, do=1: "<<dnssecOK<<", ad=1: "<<dnssecAD<<", cd=1: "<<dnssecCD<<endl;
+  cout<< boost::format("%d (%.02f%% of all) queries did not request recursion") % result.nonRDQueries % ((result.nonRDQueries*100.0)/result.queries) << endl;
+  cout<< result.rdNonRAAnswers << " answers had recursion desired bit set, but recursion available=0 (for "<<result.rdnonra.size()<<" remotes)"<<endl;
+  cout<<result.statmap.size()<<" queries went unanswered, of which "<< result.statmap.size()-unanswered<<" were answered on exact retransmit"<<endl;
+  cout<<result.untracked<<" responses could not be matched to questions"<<endl;
+  cout<<result.edns <<" questions requested EDNS processing, do=1: "<<result.dnssecOK<<", ad=1: "<<result.dnssecAD<<", cd=1: "<<result.dnssecCD<<endl;
 
-  if(answers) {
+  if(result.answers) {
     cout<<(boost::format("%1% %|25t|%2%") % "Rcode" % "Count\n");
-    for(rcodes_t::const_iterator i=rcodes.begin(); i!=rcodes.end(); ++i)
-      cout<<(boost::format("%s %|25t|%d %|35t|(%.1f%%)") % RCode::to_s(i->first) % i->second % (i->second*100.0/answers))<<endl;
+    for(rcodes_t::const_iterator i=result.rcodes.begin(); i!=result.rcodes.end(); ++i)
+      cout<<(boost::format("%s %|25t|%d %|35t|(%.1f%%)") % RCode::to_s(i->first) % i->second % (i->second*100.0/result.answers))<<endl;
   }
 
   uint32_t sum=0;
   //  ofstream stats("stats");
   uint32_t totpairs=0;
   double tottime=0;
-  for(cumul_t::const_iterator i=cumul.begin(); i!=cumul.end(); ++i) {
+  for(cumul_t::const_iterator i=result.cumul.begin(); i!=result.cumul.end(); ++i) {
     //    stats<<i->first<<"\t"<<(sum+=i->second)<<"\n";
     totpairs+=i->second;
     tottime+=i->first*i->second;
@@ -486,7 +648,7 @@ try
     if(!loglog)
       throw runtime_error("Unable to write statistics to "+fname);
 
-    writeLogHistogramFile(cumul, loglog);
+    writeLogHistogramFile(result.cumul, loglog);
   }
 
   if(g_vm.count("full-histogram")) {
@@ -494,14 +656,14 @@ try
     ofstream loglog(fname);
     if(!loglog)
       throw runtime_error("Unable to write statistics to "+fname);
-    writeFullHistogramFile(cumul, g_vm["full-histogram"].as<double>(), loglog);
+    writeFullHistogramFile(result.cumul, g_vm["full-histogram"].as<double>(), loglog);
   }
 
   sum=0;
   double lastperc=0, perc=0;
   uint64_t lastsum=0;
 
-  for(cumul_t::const_iterator i=cumul.begin(); i!=cumul.end(); ++i) {
+  for(cumul_t::const_iterator i=result.cumul.begin(); i!=result.cumul.end(); ++i) {
     for(done_t::iterator j=done.begin(); j!=done.end(); ++j) {
       if(!j->second && i->first > j->first) {
         j->second=true;
@@ -535,7 +697,7 @@ try
     }
   }
 
-  cout<< (totpairs-lastsum)<<" responses ("<<((totpairs-lastsum)*100.0/answers) <<"%) older than "<< (done.rbegin()->first/1000000.0) <<" seconds"<<endl;
+  cout<< (totpairs-lastsum)<<" responses ("<<((totpairs-lastsum)*100.0/result.answers) <<"%) older than "<< (done.rbegin()->first/1000000.0) <<" seconds"<<endl;
   if(totpairs)
     cout<<"Average non-late response time: "<<tottime/totpairs<<" us"<<endl;
 
@@ -543,20 +705,25 @@ try
     ofstream load(g_vm["load-stats"].as<string>().c_str());
     if(!load)
       throw runtime_error("Error writing load statistics to "+g_vm["load-stats"].as<string>());
-    for(pcounts_t::value_type& val :  pcounts) {
+    for(const auto& val :  result.load) {
       load<<val.first<<'\t'<<val.second.questions<<'\t'<<val.second.answers<<'\t'<<val.second.outstanding<<'\n';
     }
   }
 
 
-  cout<<"Saw questions from "<<requestors.size()<<" distinct remotes, answers to "<<recipients.size()<<endl;
+  cout<<"Saw questions from "<<result.requestors.size()<<" distinct remotes, answers to "<<result.recipients.size()<<endl;
   ofstream remotes("remotes");
-  for(const ComboAddress& rem :  requestors) {
+  for(const ComboAddress& rem :  result.requestors) {
     remotes<<rem.toString()<<'\n';
   }
 
   vector<ComboAddress> diff;
-  set_difference(requestors.begin(), requestors.end(), recipients.begin(), recipients.end(), back_inserter(diff), ComboAddress::addressOnlyLessThan());
+  // both sets are unordered, so set_difference() cannot be used here
+  for (const auto& rem : result.requestors) {
+    if (result.recipients.count(rem) == 0) {
+      diff.push_back(rem);
+    }
+  }
   cout<<"Saw "<<diff.size()<<" unique remotes asking questions, but not getting RA answers"<<endl;
 
   ofstream ignored("ignored");
@@ -564,13 +731,13 @@ try
     ignored<<rem.toString()<<'\n';
   }
   ofstream rdnonrafs("rdnonra");
-  for(const ComboAddress& rem :  rdnonra) {
+  for(const ComboAddress& rem :  result.rdnonra) {
     rdnonrafs<<rem.toString()<<'\n';
   }
 
-  if(doServFailTree) {
+  if(config.doServFailTree) {
     StatNode::Stat node;
-    root.visit(visitor, node);
+    result.servfailTree.visit(visitor, node);
   }
 
 }
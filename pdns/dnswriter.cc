@@ -25,6 +25,7 @@
 #include <boost/version.hpp>
 #include <boost/container/static_vector.hpp>
 #include "dnswriter.hh"
+#include "burtle.hh"
 #include "misc.hh"
 #include "dnsparser.hh"
 
@@ -38,6 +39,52 @@
 
 */
 
+DNSNameCompressionTable::DNSNameCompressionTable(size_t capacity)
+{
+  size_t size = 16;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  d_slots.resize(size);
+  d_mask = size - 1;
+}
+
+void DNSNameCompressionTable::clear()
+{
+  d_used = 0;
+  if (++d_generation == 0) {
+    std::fill(d_slots.begin(), d_slots.end(), Slot{});
+    d_generation = 1;
+  }
+}
+
+void DNSNameCompressionTable::insert(uint32_t hash, uint16_t offset)
+{
+  // keep at least half of the slots free, so that probing stays short and always ends
+  if ((d_used + 1) * 2 > d_slots.size()) {
+    grow();
+  }
+  size_t idx = hash & d_mask;
+  while (d_slots[idx].generation == d_generation) {
+    idx = (idx + 1) & d_mask;
+  }
+  d_slots[idx] = {hash, offset, d_generation};
+  d_used++;
+}
+
+void DNSNameCompressionTable::grow()
+{
+  std::vector<Slot> old(d_slots.size() * 2);
+  old.swap(d_slots);
+  d_mask = d_slots.size() - 1;
+  d_used = 0;
+  for (const auto& slot : old) {
+    if (slot.generation == d_generation) {
+      insert(slot.hash, slot.offset);
+    }
+  }
+}
+
 template <typename Container>
 GenericDNSPacketWriter<Container>::GenericDNSPacketWriter(Container& content, const DNSName& qname, uint16_t qtype, uint16_t qclass, uint8_t opcode) :
   d_qname(qname), d_content(content)
@@ -390,11 +437,160 @@ template <typename Container> uint16_t GenericDNSPacketWriter<Container>::lookup
   }
   return bestpos;
 }
+/* hashes of all the suffixes of a name, from the whole name to the last label, computed from
+   the last label on so that the hash of a suffix does not depend on what precedes it */
+template <typename Labels, typename Hashes>
+static void hashNameSuffixes(const unsigned char* raw, const Labels& positions, Hashes& hashes)
+{
+  hashes.resize(positions.size());
+  uint32_t hash = 0;
+  for (size_t idx = positions.size(); idx > 0; idx--) {
+    const auto position = positions[idx - 1];
+    hash = burtleCI(raw + position, raw[position] + 1, hash); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    hashes[idx - 1] = hash;
+  }
+}
+
+template <typename Container> bool GenericDNSPacketWriter<Container>::nameInPacketMatches(uint16_t position, const DNSName::string_t& raw, size_t rawPosition) const
+{
+  size_t pointerQuota = 50U;
+  size_t pos = position;
+  for (;;) {
+    if (pos >= d_content.size()) {
+      return false;
+    }
+    const uint8_t labelLength = d_content[pos];
+    if ((labelLength & 0xc0) == 0xc0) {
+      if (pos + 1 >= d_content.size() || pointerQuota-- == 0) {
+        return false;
+      }
+      const size_t npos = 0x100 * (labelLength & (~0xc0)) + d_content[pos + 1];
+      if (npos >= pos || npos < sizeof(dnsheader)) {
+        return false;
+      }
+      pos = npos;
+      continue;
+    }
+    if (rawPosition >= raw.size() || static_cast<uint8_t>(raw[rawPosition]) != labelLength) {
+      return false;
+    }
+    if (labelLength == 0) {
+      return true;
+    }
+    if (labelLength > 63 || pos + 1 + labelLength > d_content.size()) {
+      return false;
+    }
+    auto rawpart = std::string_view(raw.c_str() + rawPosition + 1, labelLength); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    auto pktpart = std::string_view(reinterpret_cast<const char*>(&d_content[pos]) + 1, labelLength); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic,cppcoreguidelines-pro-type-reinterpret-cast)
+    if (pdns_ilexicographical_compare_three_way(rawpart, pktpart) != 0) {
+      return false;
+    }
+    pos += labelLength + 1;
+    rawPosition += labelLength + 1;
+  }
+}
+
+template <typename Container> uint16_t GenericDNSPacketWriter<Container>::lookupNameInTable(const DNSName& name, uint16_t* matchLen)
+{
+  const auto& raw = name.getStorage();
+  *matchLen = 0;
+
+  boost::container::static_vector<uint16_t, 34> positionsInName;
+  boost::container::static_vector<uint32_t, 34> hashes;
+  try {
+    for (size_t pos = 0; pos < raw.size() && raw[pos] != 0; pos += static_cast<uint8_t>(raw[pos]) + 1) {
+      positionsInName.push_back(pos);
+    }
+    hashNameSuffixes(reinterpret_cast<const unsigned char*>(raw.c_str()), positionsInName, hashes); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  }
+  catch (const std::bad_alloc& ba) {
+    return 0;
+  }
+
+  // the longest suffix first, the first match is the best one
+  for (size_t idx = 0; idx < positionsInName.size(); idx++) {
+    uint16_t found = 0;
+    const auto rawPosition = positionsInName[idx];
+    if (d_compressionTable->find(hashes[idx], [this, &raw, rawPosition, &found](uint16_t offset) {
+          if (offset < maxCompressionOffset && nameInPacketMatches(offset, raw, rawPosition)) {
+            found = offset;
+            return true;
+          }
+          return false;
+        })) {
+      *matchLen = raw.size() - rawPosition;
+      return found;
+    }
+  }
+  return 0;
+}
+
+// indexes the labels of the name written at position, not the ones it points to as these are already there
+template <typename Container> void GenericDNSPacketWriter<Container>::addToCompressionTable(uint16_t position)
+{
+  boost::container::static_vector<uint16_t, 34> positionsInPacket;
+  boost::container::static_vector<uint32_t, 34> hashes;
+  size_t pointerQuota = 50U;
+  try {
+    for (size_t pos = position; pos < d_content.size();) {
+      const uint8_t labelLength = d_content[pos];
+      if ((labelLength & 0xc0) == 0xc0) {
+        if (pos + 1 >= d_content.size() || pointerQuota-- == 0) {
+          return;
+        }
+        const size_t npos = 0x100 * (labelLength & (~0xc0)) + d_content[pos + 1];
+        if (npos >= pos || npos < sizeof(dnsheader)) {
+          return;
+        }
+        pos = npos;
+        continue;
+      }
+      if (labelLength == 0) {
+        break;
+      }
+      if (labelLength > 63 || pos + 1 + labelLength > d_content.size()) {
+        return;
+      }
+      positionsInPacket.push_back(pos);
+      pos += labelLength + 1;
+    }
+    hashNameSuffixes(&d_content[0], positionsInPacket, hashes);
+  }
+  catch (const std::bad_alloc& ba) {
+    return;
+  }
+
+  for (size_t idx = 0; idx < positionsInPacket.size(); idx++) {
+    const auto pos = positionsInPacket[idx];
+    if (pos < position || pos >= maxCompressionOffset) {
+      break;
+    }
+    d_compressionTable->insert(hashes[idx], pos);
+  }
+}
+
+template <typename Container> void GenericDNSPacketWriter<Container>::setCompressionTable(DNSNameCompressionTable* table)
+{
+  d_compressionTable = table;
+  if (d_compressionTable == nullptr) {
+    return;
+  }
+  d_compressionTable->clear();
+  for (const auto position : d_namepositions) {
+    addToCompressionTable(position);
+  }
+}
+
 // this is the absolute hottest function in the pdns recursor
 template <typename Container> void GenericDNSPacketWriter<Container>::xfrName(const DNSName& name, bool compress)
 {
   if(l_verbose)
     cout<<"Wants to write "<<name<<", compress="<<compress<<", canonic="<<d_canonic<<", LC="<<d_lowerCase<<endl;
+#if defined(PDNS_AUTH) // [
+  if (d_prerender != nullptr) {
+    d_prerender->names.push_back({name, static_cast<uint16_t>(d_content.size() - d_sor), static_cast<uint16_t>(name.empty() ? 1 : name.wirelength()), compress});
+  }
+#endif // ]
   if(d_canonic || d_lowerCase)   // d_lowerCase implies canonic
     compress=false;
 
@@ -405,7 +601,7 @@ template <typename Container> void GenericDNSPacketWriter<Container>::xfrName(co
 
   uint16_t li=0;
   uint16_t matchlen=0;
-  if(d_compress && compress && (li=lookupName(name, &matchlen)) && li < maxCompressionOffset) {
+  if(d_compress && compress && (li=(d_compressionTable != nullptr ? lookupNameInTable(name, &matchlen) : lookupName(name, &matchlen))) && li < maxCompressionOffset) {
     const auto& dns=name.getStorage();
     if(l_verbose)
       cout<<"Found a substring of "<<matchlen<<" bytes from the back, offset: "<<li<<", dnslen: "<<dns.size()<<endl;
@@ -426,6 +622,10 @@ template <typename Container> void GenericDNSPacketWriter<Container>::xfrName(co
 
     d_content.push_back((char)(offset >> 8));
     d_content.push_back((char)(offset & 0xff));
+
+    if (d_compressionTable != nullptr && pos < maxCompressionOffset && matchlen != dns.size()) {
+      addToCompressionTable(pos);
+    }
   }
   else {
     unsigned int pos=d_content.size();
@@ -445,8 +645,27 @@ template <typename Container> void GenericDNSPacketWriter<Container>::xfrName(co
     if(l_verbose)
       cout<<"Writing out the whole thing "<<makeHexDump(string(raw.c_str(),  raw.c_str() + raw.length()))<<endl;
     d_content.insert(d_content.end(), raw.c_str(), raw.c_str() + raw.size());
+
+    if (d_compressionTable != nullptr && pos < maxCompressionOffset) {
+      addToCompressionTable(pos);
+    }
+  }
+}
+
+#if defined(PDNS_AUTH) // [
+template <typename Container> void GenericDNSPacketWriter<Container>::xfrPrerendered(const PrerenderedRData& rdata)
+{
+  // copy the bytes between names as they are, and write the names again so they compress against this packet
+  const auto* wire = reinterpret_cast<const uint8_t*>(rdata.wire.data());
+  size_t pos = 0;
+  for (const auto& name : rdata.names) {
+    d_content.insert(d_content.end(), wire + pos, wire + name.offset);
+    xfrName(name.name, name.compress);
+    pos = name.offset + name.length;
   }
+  d_content.insert(d_content.end(), wire + pos, wire + rdata.wire.size());
 }
+#endif // ]
 
 template <typename Container> void GenericDNSPacketWriter<Container>::xfrBlob(const string& blob, int  )
 {
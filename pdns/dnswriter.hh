@@ -31,6 +31,66 @@
 #include <arpa/inet.h>
 
 
+#if defined(PDNS_AUTH) // [
+/** The record data of a DNSRecordContent, rendered once without any compression.
+    The names it contains are remembered with their position, so that replaying it
+    into a packet can still compress them against what that packet already holds. */
+struct PrerenderedRData
+{
+  struct Name
+  {
+    DNSName name;
+    uint16_t offset; // from the start of the record data
+    uint16_t length; // uncompressed wire length
+    bool compress;
+  };
+  std::string wire;
+  std::vector<Name> names;
+};
+#endif // ]
+
+/** Hashed dictionary of the names written into a packet, keyed on a case-insensitive hash of
+    every name suffix, so that looking for a compression target does not require scanning all the
+    names written so far. Candidates are always verified against the packet, so stale entries
+    (after a rollback or truncate) and hash collisions are harmless.
+    Meant to be reused between packets, clear() is O(1) and keeps the storage. */
+class DNSNameCompressionTable
+{
+public:
+  explicit DNSNameCompressionTable(size_t capacity = 256);
+
+  void clear();
+  void insert(uint32_t hash, uint16_t offset);
+  //! calls visitor(offset) for every entry with that hash, until it returns true
+  template <typename Visitor>
+  bool find(uint32_t hash, const Visitor& visitor) const
+  {
+    for (size_t idx = hash & d_mask;; idx = (idx + 1) & d_mask) {
+      const auto& slot = d_slots[idx];
+      if (slot.generation != d_generation) {
+        return false;
+      }
+      if (slot.hash == hash && visitor(slot.offset)) {
+        return true;
+      }
+    }
+  }
+
+private:
+  struct Slot
+  {
+    uint32_t hash{0};
+    uint16_t offset{0};
+    uint16_t generation{0};
+  };
+  void grow();
+
+  std::vector<Slot> d_slots;
+  size_t d_mask;
+  size_t d_used{0};
+  uint16_t d_generation{1};
+};
+
 /** this class can be used to write DNS packets. It knows about DNS in the sense that it makes
     the packet header and record headers.
 
@@ -166,20 +226,40 @@ public:
   void consumeRemaining() const
   {
   }
+
+  //! Writes record data rendered earlier, instead of running DNSRecordContent::toPacket() again
+  void xfrPrerendered(const PrerenderedRData& rdata);
+  //! While set, every name written into the current record is noted in rdata, for DNSRecordContent::getPrerendered()
+  void setPrerenderTarget(PrerenderedRData* rdata)
+  {
+    d_prerender = rdata;
+  }
 #endif // ]
 
   size_t getSizeWithOpts(const optvect_t& options) const;
 
+  /** Use a hashed dictionary instead of a linear scan of the names already written when looking
+      for compression targets, pays off for large packets. The table is cleared and filled with the
+      names written so far, and has to outlive its use by this writer (nullptr to stop using it) */
+  void setCompressionTable(DNSNameCompressionTable* table);
+
 private:
   uint16_t lookupName(const DNSName& name, uint16_t* matchlen);
+  uint16_t lookupNameInTable(const DNSName& name, uint16_t* matchlen);
+  bool nameInPacketMatches(uint16_t position, const DNSName::string_t& raw, size_t rawPosition) const;
+  void addToCompressionTable(uint16_t position);
 
   std::vector<uint16_t> d_namepositions;
+  DNSNameCompressionTable* d_compressionTable{nullptr};
   DNSName d_qname;
   Container& d_content;
   size_t d_sor{0};
   uint16_t d_rollbackmarker{0}; // start of last complete packet, for rollback
   uint16_t d_truncatemarker{0}; // end of header, for truncate
   DNSResourceRecord::Place d_recordplace{DNSResourceRecord::QUESTION};
+#if defined(PDNS_AUTH) // [
+  PrerenderedRData* d_prerender{nullptr};
+#endif // ]
   bool d_canonic{false};
   bool d_lowerCase{false};
   bool d_compress{false};
@@ -39,6 +39,7 @@
 #include "responsestats.hh"
 #include "ueberbackend.hh"
 #include "auth-main.hh"
+#include "lua-auth4.hh"
 
 extern ResponseStats g_rs;
 
@@ -426,6 +427,13 @@ string DLListZones(const vector<string>& parts, Utility::pid_t /* ppid */, Logr:
   return ret.str();
 }
 
+#ifdef HAVE_LUA_RECORDS
+string DLLuaHealthChecksHandler(const vector<string>& /* parts */, Utility::pid_t /* ppid */, Logr::log_t /* slog */)
+{
+  return getLuaHealthChecksReport();
+}
+#endif /* HAVE_LUA_RECORDS */
+
 string DLFlushHandler(const vector<string>& /*parts*/, Utility::pid_t /*ppid*/, Logr::log_t slog)
 {
   UeberBackend B; // NOLINT(readability-identifier-length)
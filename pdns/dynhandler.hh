@@ -36,6 +36,9 @@ string DLCCHandler(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t
 string DLCurrentConfigHandler(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t slog);
 string DLFlushHandler(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t slog);
 string DLListZones(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t slog);
+#ifdef HAVE_LUA_RECORDS
+string DLLuaHealthChecksHandler(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t slog);
+#endif /* HAVE_LUA_RECORDS */
 string DLNotifyHandler(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t slog);
 string DLNotifyHostHandler(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t slog);
 string DLNotifyRetrieveHandler(const vector<string>&parts, Utility::pid_t ppid, Logr::log_t slog);
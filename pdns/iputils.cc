@@ -482,6 +482,7 @@ pdns::expected<size_t, int> sendMsgWithOptions(int socketDesc, const void* buffe
 }
 
 template class NetmaskTree<bool, Netmask>;
+template class CompressedNetmaskTree<bool>;
 
 /* requires a non-blocking socket.
    On Linux, we could use MSG_DONTWAIT on a blocking socket
@@ -20,6 +20,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 #pragma once
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <string>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -1711,6 +1716,347 @@ private:
   size_type d_size{0};
 };
 
+/** Read-only, compressed counterpart of NetmaskTree for large prefix lists (full table geo data,
+ * threat feeds), where the pointer chasing of NetmaskTree dominates the cost of a lookup.
+ *
+ * The first 8 bits of an address index a direct table. Below that, every /8 has its own poptrie:
+ * a multibit trie with a stride of 6 bits where each node holds two 64-bit bitmaps plus the base
+ * indexes of its children and leaves, which are stored contiguously and found with a popcount.
+ * An IPv4 lookup therefore touches at most 4 nodes. Prefixes of 8 bits or less live in the
+ * direct table itself.
+ *
+ * insert_or_assign() and erase() only rebuild the poptrie of the /8 the prefix falls in (or the
+ * direct table for short prefixes), and poptries are shared between copies of the tree.
+ */
+template <typename T>
+class CompressedNetmaskTree
+{
+public:
+  using entry_type = std::pair<Netmask, T>;
+
+  CompressedNetmaskTree() = default;
+
+  explicit CompressedNetmaskTree(const NetmaskTree<T>& tree)
+  {
+    std::array<std::vector<std::vector<entry_type>>, 2> blocks;
+    for (const auto& entry : tree) {
+      const auto fam = family(entry.first.getNetwork());
+      if (entry.first.getBits() <= s_directBits) {
+        d_short.at(fam).emplace_back(entry.first, entry.second);
+        continue;
+      }
+      auto& familyBlocks = blocks.at(fam);
+      familyBlocks.resize(s_directSlots);
+      familyBlocks.at(firstBits(toBits(entry.first.getNetwork()))).emplace_back(entry.first, entry.second);
+    }
+    d_size = tree.size();
+
+    for (size_t fam = 0; fam < d_slots.size(); fam++) {
+      if (blocks.at(fam).empty() && d_short.at(fam).empty()) {
+        continue;
+      }
+      d_slots.at(fam).resize(s_directSlots);
+      for (size_t slot = 0; slot < blocks.at(fam).size(); slot++) {
+        auto& entries = blocks.at(fam).at(slot);
+        if (!entries.empty()) {
+          d_slots.at(fam).at(slot).subtrie = std::make_shared<const Subtrie>(std::move(entries));
+        }
+      }
+      refreshShort(fam);
+    }
+  }
+
+  //<! Returns the longest prefix matching this address, if any
+  [[nodiscard]] const entry_type* lookup(const ComboAddress& address) const
+  {
+    const auto fam = family(address);
+    const auto& slots = d_slots.at(fam);
+    if (slots.empty()) {
+      return nullptr;
+    }
+    const auto bits = toBits(address);
+    const auto& slot = slots[firstBits(bits)];
+    if (slot.subtrie) {
+      const auto* entry = slot.subtrie->lookup(bits);
+      if (entry != nullptr) {
+        return entry;
+      }
+    }
+    if (slot.shortEntry != s_none) {
+      return &d_short.at(fam)[slot.shortEntry];
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] bool match(const ComboAddress& address) const
+  {
+    return lookup(address) != nullptr;
+  }
+
+  void insert_or_assign(const Netmask& netmask, const T& value)
+  {
+    update(netmask.getNormalized(), &value);
+  }
+
+  void erase(const Netmask& netmask)
+  {
+    update(netmask.getNormalized(), nullptr);
+  }
+
+  [[nodiscard]] bool empty() const
+  {
+    return d_size == 0;
+  }
+
+  [[nodiscard]] size_t size() const
+  {
+    return d_size;
+  }
+
+private:
+  using Bits = std::array<uint64_t, 2>;
+
+  static constexpr unsigned int s_directBits = 8;
+  static constexpr size_t s_directSlots = 1U << s_directBits;
+  static constexpr unsigned int s_stride = 6;
+  static constexpr uint32_t s_none = std::numeric_limits<uint32_t>::max();
+
+  static size_t family(const ComboAddress& address)
+  {
+    if (address.isIPv4()) {
+      return 0;
+    }
+    if (address.isIPv6()) {
+      return 1;
+    }
+    throw NetmaskException("invalid address family");
+  }
+
+  //<! The address as a 128-bit big-endian value, IPv4 addresses occupy the 32 most significant bits
+  static Bits toBits(const ComboAddress& address)
+  {
+    Bits ret{0, 0};
+    if (address.isIPv4()) {
+      ret[0] = static_cast<uint64_t>(ntohl(address.sin4.sin_addr.s_addr)) << 32;
+    }
+    else {
+      for (size_t idx = 0; idx < 16; idx++) {
+        ret.at(idx / 8) = (ret.at(idx / 8) << 8) | address.sin6.sin6_addr.s6_addr[idx]; // NOLINT(cppcoreguidelines-pro-bounds-constant-array-index)
+      }
+    }
+    return ret;
+  }
+
+  static unsigned int firstBits(const Bits& bits)
+  {
+    return static_cast<unsigned int>(bits[0] >> (64 - s_directBits));
+  }
+
+  //<! The s_stride bits starting at offset (0 being the most significant one), zero past the end
+  static unsigned int chunk(const Bits& bits, unsigned int offset)
+  {
+    const unsigned int word = offset / 64;
+    const unsigned int shift = offset % 64;
+    uint64_t value = bits.at(word) << shift;
+    if (word == 0 && shift > 64 - s_stride) {
+      value |= bits[1] >> (64 - shift);
+    }
+    return static_cast<unsigned int>(value >> (64 - s_stride));
+  }
+
+  class Subtrie
+  {
+  public:
+    explicit Subtrie(std::vector<entry_type>&& entries) :
+      d_entries(std::move(entries))
+    {
+      std::vector<Prefix> prefixes;
+      prefixes.reserve(d_entries.size());
+      for (size_t idx = 0; idx < d_entries.size(); idx++) {
+        prefixes.push_back({toBits(d_entries[idx].first.getNetwork()), d_entries[idx].first.getBits(), static_cast<uint32_t>(idx)});
+      }
+      std::vector<const Prefix*> pointers;
+      pointers.reserve(prefixes.size());
+      for (const auto& prefix : prefixes) {
+        pointers.push_back(&prefix);
+      }
+      d_nodes.resize(1);
+      build(0, s_directBits, s_none, pointers);
+      d_nodes.shrink_to_fit();
+      d_leaves.shrink_to_fit();
+    }
+
+    [[nodiscard]] const entry_type* lookup(const Bits& bits) const
+    {
+      uint32_t index = 0;
+      for (unsigned int offset = s_directBits;; offset += s_stride) {
+        const auto& node = d_nodes[index];
+        const uint64_t bit = uint64_t(1) << chunk(bits, offset);
+        const uint64_t upTo = (bit << 1) - 1;
+        if ((node.internal & bit) != 0) {
+          index = node.childBase + __builtin_popcountll(node.internal & upTo) - 1;
+          continue;
+        }
+        const auto leaf = d_leaves[node.leafBase + __builtin_popcountll(node.leafStarts & upTo) - 1];
+        return leaf == s_none ? nullptr : &d_entries[leaf];
+      }
+    }
+
+    [[nodiscard]] const std::vector<entry_type>& getEntries() const
+    {
+      return d_entries;
+    }
+
+  private:
+    struct Prefix
+    {
+      Bits bits;
+      uint8_t length;
+      uint32_t entry;
+    };
+
+    struct Node
+    {
+      uint64_t internal{0}; //<! slots which have a child node
+      uint64_t leafStarts{0}; //<! slots where a run of identical leaves starts, internal ones are skipped
+      uint32_t leafBase{0};
+      uint32_t childBase{0};
+    };
+
+    void build(uint32_t index, unsigned int offset, uint32_t inherited, std::vector<const Prefix*>& prefixes)
+    {
+      // shorter prefixes first, so that longer ones override them in the slots they both cover
+      std::sort(prefixes.begin(), prefixes.end(), [](const Prefix* lhs, const Prefix* rhs) { return lhs->length < rhs->length; });
+
+      std::array<uint32_t, 64> best{};
+      best.fill(inherited);
+      std::array<std::vector<const Prefix*>, 64> deeper;
+      for (const auto* prefix : prefixes) {
+        const auto slot = chunk(prefix->bits, offset);
+        if (prefix->length > offset + s_stride) {
+          deeper.at(slot).push_back(prefix);
+          continue;
+        }
+        const unsigned int span = 1U << (offset + s_stride - prefix->length);
+        std::fill_n(best.begin() + (slot & ~(span - 1)), span, prefix->entry);
+      }
+
+      Node node;
+      node.leafBase = static_cast<uint32_t>(d_leaves.size());
+      node.childBase = static_cast<uint32_t>(d_nodes.size());
+      for (unsigned int slot = 0; slot < 64; slot++) {
+        const uint64_t bit = uint64_t(1) << slot;
+        if (!deeper.at(slot).empty()) {
+          node.internal |= bit;
+        }
+        else if (node.leafStarts == 0 || d_leaves.back() != best.at(slot)) {
+          node.leafStarts |= bit;
+          d_leaves.push_back(best.at(slot));
+        }
+      }
+      d_nodes.at(index) = node;
+      d_nodes.resize(d_nodes.size() + __builtin_popcountll(node.internal));
+
+      uint32_t child = node.childBase;
+      for (unsigned int slot = 0; slot < 64; slot++) {
+        if (!deeper.at(slot).empty()) {
+          build(child++, offset + s_stride, best.at(slot), deeper.at(slot));
+        }
+      }
+    }
+
+    std::vector<Node> d_nodes;
+    std::vector<uint32_t> d_leaves;
+    std::vector<entry_type> d_entries;
+  };
+
+  struct Slot
+  {
+    std::shared_ptr<const Subtrie> subtrie;
+    uint32_t shortEntry{s_none}; //<! longest prefix of at most s_directBits bits covering this slot
+  };
+
+  void update(const Netmask& netmask, const T* value)
+  {
+    const auto fam = family(netmask.getNetwork());
+    auto& slots = d_slots.at(fam);
+    if (slots.empty()) {
+      if (value == nullptr) {
+        return;
+      }
+      slots.resize(s_directSlots);
+    }
+
+    std::vector<entry_type> copy;
+    auto& entries = netmask.getBits() <= s_directBits ? d_short.at(fam) : copy;
+    Slot* slot = nullptr;
+    if (netmask.getBits() > s_directBits) {
+      slot = &slots.at(firstBits(toBits(netmask.getNetwork())));
+      if (slot->subtrie) {
+        // copy on write, the current poptrie might be shared with another tree
+        copy = slot->subtrie->getEntries();
+      }
+    }
+
+    auto existing = std::find_if(entries.begin(), entries.end(), [&netmask](const entry_type& entry) { return entry.first == netmask; });
+    if (existing != entries.end()) {
+      if (value != nullptr) {
+        existing->second = *value;
+      }
+      else {
+        entries.erase(existing);
+        d_size--;
+      }
+    }
+    else if (value != nullptr) {
+      entries.emplace_back(netmask, *value);
+      d_size++;
+    }
+    else {
+      return;
+    }
+
+    if (slot == nullptr) {
+      refreshShort(fam);
+    }
+    else if (copy.empty()) {
+      slot->subtrie.reset();
+    }
+    else {
+      slot->subtrie = std::make_shared<const Subtrie>(std::move(copy));
+    }
+  }
+
+  void refreshShort(size_t fam)
+  {
+    const auto& shortEntries = d_short.at(fam);
+    std::vector<Bits> shortBits;
+    shortBits.reserve(shortEntries.size());
+    for (const auto& entry : shortEntries) {
+      shortBits.push_back(toBits(entry.first.getNetwork()));
+    }
+
+    for (unsigned int slot = 0; slot < d_slots.at(fam).size(); slot++) {
+      uint32_t best = s_none;
+      for (size_t idx = 0; idx < shortEntries.size(); idx++) {
+        const unsigned int length = shortEntries[idx].first.getBits();
+        const unsigned int shift = s_directBits - length;
+        if ((slot >> shift) != (firstBits(shortBits[idx]) >> shift)) {
+          continue;
+        }
+        if (best == s_none || length > shortEntries[best].first.getBits()) {
+          best = static_cast<uint32_t>(idx);
+        }
+      }
+      d_slots.at(fam).at(slot).shortEntry = best;
+    }
+  }
+
+  std::array<std::vector<Slot>, 2> d_slots; //<! per address family, empty if it never had any prefix
+  std::array<std::vector<entry_type>, 2> d_short;
+  size_t d_size{0};
+};
+
 /** This class represents a group of supplemental Netmask classes. An IP address matches
     if it is matched by one or more of the Netmask objects within.
 */
@@ -1723,6 +2069,10 @@ public:
 
   bool match(const ComboAddress* address) const
   {
+    if (d_compressed) {
+      const auto* ret = d_compressed->lookup(*address);
+      return ret != nullptr && ret->second;
+    }
     const auto& ret = tree.lookup(*address);
     if (ret != nullptr) {
       return ret->second;
@@ -1737,6 +2087,16 @@ public:
 
   bool lookup(const ComboAddress* address, Netmask* nmp) const
   {
+    if (d_compressed) {
+      const auto* ret = d_compressed->lookup(*address);
+      if (ret != nullptr) {
+        if (nmp != nullptr) {
+          *nmp = ret->first;
+        }
+        return ret->second;
+      }
+      return false;
+    }
     const auto& ret = tree.lookup(*address);
     if (ret != nullptr) {
       if (nmp != nullptr) {
@@ -1767,6 +2127,9 @@ public:
   void addMask(const Netmask& netmask, bool positive = true)
   {
     tree.insert(netmask).second = positive;
+    if (d_compressed) {
+      d_compressed->insert_or_assign(netmask, positive);
+    }
   }
 
   void addMasks(const NetmaskGroup& group, std::optional<bool> positive)
@@ -1780,6 +2143,9 @@ public:
   void deleteMask(const Netmask& netmask)
   {
     tree.erase(netmask);
+    if (d_compressed) {
+      d_compressed->erase(netmask);
+    }
   }
 
   void deleteMasks(const NetmaskGroup& group)
@@ -1799,6 +2165,15 @@ public:
   void clear()
   {
     tree.clear();
+    d_compressed.reset();
+  }
+
+  /* Also keep the masks in a CompressedNetmaskTree, which is used for lookups from now on.
+     Worth it for large groups that are mostly read, since every later change rebuilds a part
+     of the compressed tree. */
+  void compress()
+  {
+    d_compressed = CompressedNetmaskTree<bool>(tree);
   }
 
   [[nodiscard]] bool empty() const
@@ -1848,6 +2223,7 @@ public:
 
 private:
   NetmaskTree<bool> tree;
+  std::optional<CompressedNetmaskTree<bool>> d_compressed;
 };
 
 struct SComboAddress
@@ -2089,6 +2465,7 @@ int sendOnNBSocket(int fileDesc, const struct msghdr* msgh);
 bool isTCPSocketUsable(int sock);
 
 extern template class NetmaskTree<bool>;
+extern template class CompressedNetmaskTree<bool>;
 ComboAddress parseIPAndPort(const std::string& input, uint16_t port);
 
 std::set<std::string> getListOfNetworkInterfaces();
@@ -68,6 +68,8 @@ std::string ixfrdistStats::getStats() {
     stats<<"# TYPE "<<prefix<<"ixfr_inqueries_total counter"<<std::endl;
     stats<<"# HELP "<<prefix<<"ixfr_failures_total Number of times an IXFR query was not properly answered"<<std::endl;
     stats<<"# TYPE "<<prefix<<"ixfr_failures_total counter"<<std::endl;
+    stats<<"# HELP "<<prefix<<"wire_cache_bytes Memory used by the serialized AXFR and IXFR answers of a domain"<<std::endl;
+    stats<<"# TYPE "<<prefix<<"wire_cache_bytes gauge"<<std::endl;
   }
 
   for (auto const &d : domainStats) {
@@ -83,6 +85,7 @@ std::string ixfrdistStats::getStats() {
     stats<<prefix<<"axfr_failures_total{domain=\""<<d.first<<"\"} "<<d.second.numAXFRFailures<<std::endl;
     stats<<prefix<<"ixfr_inqueries_total{domain=\""<<d.first<<"\"} "<<d.second.numIXFRinQueries<<std::endl;
     stats<<prefix<<"ixfr_failures_total{domain=\""<<d.first<<"\"} "<<d.second.numIXFRFailures<<std::endl;
+    stats<<prefix<<"wire_cache_bytes{domain=\""<<d.first<<"\"} "<<d.second.wireCacheBytes<<std::endl;
   }
 
   if (!notimpStats.empty()) {
@@ -62,6 +62,12 @@ class ixfrdistStats {
     void incrementIXFRFailures(const ZoneName& d, const uint64_t amount = 1) {
       getRegisteredDomain(d)->second.numIXFRFailures += amount;
     }
+    void incrementWireCacheBytes(const ZoneName& d, const uint64_t amount) {
+      getRegisteredDomain(d)->second.wireCacheBytes += amount;
+    }
+    void decrementWireCacheBytes(const ZoneName& d, const uint64_t amount) {
+      getRegisteredDomain(d)->second.wireCacheBytes -= amount;
+    }
     void registerDomain(const ZoneName& d) {
       domainStats[d].haveZone = false;
     }
@@ -91,6 +97,8 @@ class ixfrdistStats {
 
         std::atomic<uint64_t> numAXFRFailures{0};
         std::atomic<uint64_t> numIXFRFailures{0};
+
+        std::atomic<uint64_t> wireCacheBytes{0};
     };
     class programStats {
       public:
@@ -31,6 +31,7 @@
 #include <grp.h>
 #include <pwd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <mutex>
 #include <thread>
 #include "threadname.hh"
@@ -59,6 +60,7 @@
 #pragma GCC diagnostic pop
 #include "auth-packetcache.hh"
 #include "auth-querycache.hh"
+#include "auth-denialcache.hh"
 #include "auth-zonecache.hh"
 
 /* BEGIN Needed because of deeper dependencies */
@@ -69,6 +71,8 @@ StatBag S;
 AuthPacketCache PC;
 // NOLINTNEXTLINE(readability-identifier-length)
 AuthQueryCache QC;
+// NOLINTNEXTLINE(readability-identifier-length)
+AuthDenialCache DC;
 AuthZoneCache g_zoneCache;
 bool g_logDNSQueries{false};
 
@@ -144,6 +148,44 @@ struct convert<Netmask> {
 };
 } // namespace YAML
 
+/* AXFR answers and IXFR diffs are serialized once per zone version and per
+   spelling of the question, then sent as-is to every requester. Only the ID and
+   RD bit of the messages depend on the query, they are patched while sending. */
+struct wireMessages_t {
+  explicit wireMessages_t(ZoneName zoneName) :
+    zone(std::move(zoneName))
+  {
+  }
+  wireMessages_t(const wireMessages_t&) = delete;
+  wireMessages_t(wireMessages_t&&) = delete;
+  wireMessages_t& operator=(const wireMessages_t&) = delete;
+  wireMessages_t& operator=(wireMessages_t&&) = delete;
+  ~wireMessages_t();
+
+  void add(const vector<uint8_t>& packet)
+  {
+    offsets.push_back(data.size());
+    data.push_back(static_cast<char>(packet.size() / 256));
+    data.push_back(static_cast<char>(packet.size() % 256));
+    data.append(reinterpret_cast<const char*>(packet.data()), packet.size()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  }
+  [[nodiscard]] size_t memoryUsage() const
+  {
+    return data.capacity() + offsets.capacity() * sizeof(size_t);
+  }
+
+  ZoneName zone;
+  std::string data; // length-prefixed messages, back to back
+  std::vector<size_t> offsets; // where each message starts in data
+  size_t accountedBytes{0};
+};
+
+/* keyed on the question name as sent by the client, in wire format, and the query type */
+using wireCacheKey_t = std::pair<std::string, uint16_t>;
+using wireCache_t = LockGuarded<std::map<wireCacheKey_t, std::shared_ptr<const wireMessages_t>>>;
+/* Clients can ask for any spelling of the zone name, but we only keep that many of them per zone version */
+static const size_t s_maxWireCacheVariants{4};
+
 struct ixfrdiff_t {
   shared_ptr<const SOARecordContent> oldSOA;
   shared_ptr<const SOARecordContent> newSOA;
@@ -151,6 +193,7 @@ struct ixfrdiff_t {
   vector<DNSRecord> additions;
   uint32_t oldSOATTL;
   uint32_t newSOATTL;
+  mutable wireCache_t wire; // the serialized diff, old SOA to additions
 };
 
 struct ixfrinfo_t {
@@ -158,6 +201,7 @@ struct ixfrinfo_t {
   records_t latestAXFR;             // The most recent AXFR
   vector<std::shared_ptr<ixfrdiff_t>> ixfrDiffs;
   uint32_t soaTTL;
+  mutable wireCache_t wire; // the serialized AXFR, SOA to SOA
 };
 
 // Why a struct? This way we can add more options to a domain in the future
@@ -170,6 +214,9 @@ struct ixfrdistdomain_t {
 // This contains the configuration for each domain
 static map<ZoneName, ixfrdistdomain_t> g_domainConfigs;
 
+// Declared before g_soas, as the cached answers of the zones update it when destroyed
+static ixfrdistStats g_stats;
+
 // Map domains and their data
 static LockGuarded<std::map<ZoneName, std::shared_ptr<ixfrinfo_t>>> g_soas;
 
@@ -193,7 +240,16 @@ static NetmaskGroup g_acl;            // networks that can QUERY us
 static NetmaskGroup g_notifySources;  // networks (well, IPs) that can NOTIFY us
 static bool g_compress = false;
 
-static ixfrdistStats g_stats;
+wireMessages_t::~wireMessages_t()
+{
+  try {
+    if (accountedBytes != 0) {
+      g_stats.decrementWireCacheBytes(zone, accountedBytes);
+    }
+  }
+  catch (...) {
+  }
+}
 
 // g_stats is static, so local to this file. But the webserver needs this info
 string doGetStats() {
@@ -519,6 +575,8 @@ static void updateThread(const string& workdir, const uint16_t& keep, const uint
       shared_ptr<const SOARecordContent> soa;
       uint32_t soaTTL = 0;
       records_t records;
+      // The zone is written to disk while it is received, but only shows up there once complete
+      ZoneFileWriter zoneFile(domain, dir);
       try {
         AXFRRetriever axfr(nullptr /* no structured logging */, primary, domain, tt, &local);
         uint32_t nrecords=0;
@@ -534,6 +592,7 @@ static void updateThread(const string& workdir, const uint16_t& keep, const uint
               throw PDNSException("Out-of-zone data received during AXFR of "+domain.toLogString());
             }
             dr.d_name.makeUsRelative(domain);
+            zoneFile.write(dr);
             records.insert(dr);
             nrecords++;
             if (dr.d_type == QType::SOA) {
@@ -568,7 +627,7 @@ static void updateThread(const string& workdir, const uint16_t& keep, const uint
 
       try {
 
-        writeZoneToDisk(records, domain, dir);
+        zoneFile.commit();
         g_log<<Logger::Notice<<"Wrote zonedata for "<<domain<<" with serial "<<soa->d_st.serial<<" to "<<dir<<endl;
 
         const auto oldZoneInfo = getCurrentZoneInfo(domain);
@@ -784,20 +843,24 @@ static bool makeNotimpPacket(const MOADNSParser& mdp, vector<uint8_t>& packet) {
   return true;
 }
 
-static vector<uint8_t> getSOAPacket(const MOADNSParser& mdp, const shared_ptr<const SOARecordContent>& soa, uint32_t soaTTL) {
+static vector<uint8_t> getSOAPacket(const DNSName& qname, uint16_t qtype, uint16_t qid, bool rd, const shared_ptr<const SOARecordContent>& soa, uint32_t soaTTL) {
   vector<uint8_t> packet;
-  DNSPacketWriter pw(packet, mdp.d_qname, mdp.d_qtype);
-  pw.getHeader()->id = mdp.d_header.id;
-  pw.getHeader()->rd = mdp.d_header.rd;
+  DNSPacketWriter pw(packet, qname, qtype);
+  pw.getHeader()->id = qid;
+  pw.getHeader()->rd = rd;
   pw.getHeader()->qr = 1;
 
   // Add the first SOA
-  pw.startRecord(mdp.d_qname, QType::SOA, soaTTL);
+  pw.startRecord(qname, QType::SOA, soaTTL);
   soa->toPacket(pw);
   pw.commit();
   return packet;
 }
 
+static vector<uint8_t> getSOAPacket(const MOADNSParser& mdp, const shared_ptr<const SOARecordContent>& soa, uint32_t soaTTL) {
+  return getSOAPacket(mdp.d_qname, mdp.d_qtype, mdp.d_header.id, mdp.d_header.rd, soa, soaTTL);
+}
+
 static bool sendPacketOverTCP(int fd, const std::vector<uint8_t>& packet)
 {
   char sendBuf[2];
@@ -821,7 +884,92 @@ static bool addRecordToWriter(DNSPacketWriter& pwr, const DNSName& zoneName, con
   return true;
 }
 
-template <typename T> static bool sendRecordsOverTCP(int fd, const MOADNSParser& mdp, const T& records)
+/* writes all of iov, which is modified in the process, on a blocking socket */
+static void writevn2(int fd, iovec* iov, size_t count)
+{
+  while (count > 0) {
+    auto res = ::writev(fd, iov, static_cast<int>(count));
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN) {
+        throw std::runtime_error("used writevn2 on non-blocking socket, got EAGAIN");
+      }
+      unixDie("failed in writevn2");
+    }
+    if (res == 0) {
+      throw std::runtime_error("could not write all bytes, got eof in writevn2");
+    }
+    auto written = static_cast<size_t>(res);
+    while (count > 0 && written >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      iov->iov_len -= written;
+    }
+  }
+}
+
+/* Sends serialized messages without copying them, except for their length
+   and header which are patched with the ID and RD bit of the query */
+static bool sendWireMessagesOverTCP(int fd, const wireMessages_t& wire, const MOADNSParser& mdp)
+{
+  static const size_t batchSize = 256;
+  static const size_t prefixSize = 2 + sizeof(dnsheader);
+  std::array<std::array<char, prefixSize>, batchSize> prefixes{};
+  std::array<iovec, 2 * batchSize> iov{};
+
+  for (size_t idx = 0; idx < wire.offsets.size();) {
+    size_t count = 0;
+    for (; count < batchSize && idx < wire.offsets.size(); ++count, ++idx) {
+      const size_t start = wire.offsets.at(idx);
+      const size_t end = idx + 1 < wire.offsets.size() ? wire.offsets.at(idx + 1) : wire.data.size();
+      auto& prefix = prefixes.at(count);
+      wire.data.copy(prefix.data(), prefix.size(), start);
+      dnsheader header{};
+      memcpy(&header, &prefix.at(2), sizeof(header));
+      header.id = mdp.d_header.id;
+      header.rd = mdp.d_header.rd;
+      memcpy(&prefix.at(2), &header, sizeof(header));
+      iov.at(2 * count) = {prefix.data(), prefix.size()};
+      iov.at(2 * count + 1) = {const_cast<char*>(&wire.data.at(start + prefix.size())), end - start - prefix.size()}; // NOLINT(cppcoreguidelines-pro-type-const-cast): writev's API
+    }
+    writevn2(fd, iov.data(), 2 * count);
+  }
+  return true;
+}
+
+/* Returns the messages cached for this question, building them if needed. Concurrent requests
+   for the same zone version wait for the first one to be done serializing. */
+static std::shared_ptr<const wireMessages_t> getWireMessages(wireCache_t& cache, const MOADNSParser& mdp, const std::function<bool(wireMessages_t&)>& build)
+{
+  auto key = wireCacheKey_t(mdp.d_qname.toDNSString(), mdp.d_qtype);
+  auto entries = cache.lock();
+  auto iter = entries->find(key);
+  if (iter != entries->end()) {
+    return iter->second;
+  }
+
+  auto wire = std::make_shared<wireMessages_t>(ZoneName(mdp.d_qname));
+  if (!build(*wire)) {
+    return nullptr;
+  }
+  wire->data.shrink_to_fit();
+  wire->offsets.shrink_to_fit();
+  if (entries->size() >= s_maxWireCacheVariants) {
+    return wire;
+  }
+  wire->accountedBytes = wire->memoryUsage();
+  g_stats.incrementWireCacheBytes(wire->zone, wire->accountedBytes);
+  entries->emplace(std::move(key), wire);
+  return wire;
+}
+
+template <typename T> static bool serializeRecords(const MOADNSParser& mdp, const T& records, wireMessages_t& wire)
 {
   vector<uint8_t> packet;
 
@@ -830,8 +978,6 @@ template <typename T> static bool sendRecordsOverTCP(int fd, const MOADNSParser&
     bool recordsAdded = false;
     packet.clear();
     DNSPacketWriter pw(packet, mdp.d_qname, mdp.d_qtype);
-    pw.getHeader()->id = mdp.d_header.id;
-    pw.getHeader()->rd = mdp.d_header.rd;
     pw.getHeader()->qr = 1;
 
     while (it != records.cend()) {
@@ -853,7 +999,7 @@ template <typename T> static bool sendRecordsOverTCP(int fd, const MOADNSParser&
         }
         if (recordsAdded) {
           pw.commit();
-          sendPacketOverTCP(fd, packet);
+          wire.add(packet);
           wasRolledBack = true;
         }
         if (it == records.cbegin()) {
@@ -867,7 +1013,7 @@ template <typename T> static bool sendRecordsOverTCP(int fd, const MOADNSParser&
 
     if (it == records.cend() && recordsAdded) {
       pw.commit();
-      sendPacketOverTCP(fd, packet);
+      wire.add(packet);
     }
   }
 
@@ -889,26 +1035,22 @@ static bool handleAXFR(int fd, const MOADNSParser& mdp) {
     return false;
   }
 
-  shared_ptr<const SOARecordContent> soa = zoneInfo->soa;
-  uint32_t soaTTL = zoneInfo->soaTTL;
-  const records_t& records = zoneInfo->latestAXFR;
-
-  // Initial SOA
-  const auto soaPacket = getSOAPacket(mdp, soa, soaTTL);
-  if (!sendPacketOverTCP(fd, soaPacket)) {
-    return false;
-  }
-
-  if (!sendRecordsOverTCP(fd, mdp, records)) {
-    return false;
-  }
-
-  // Final SOA
-  if (!sendPacketOverTCP(fd, soaPacket)) {
+  auto wire = getWireMessages(zoneInfo->wire, mdp, [&mdp, &zoneInfo](wireMessages_t& messages) {
+    const auto soaPacket = getSOAPacket(mdp.d_qname, mdp.d_qtype, 0, false, zoneInfo->soa, zoneInfo->soaTTL);
+    // Initial SOA
+    messages.add(soaPacket);
+    if (!serializeRecords(mdp, zoneInfo->latestAXFR, messages)) {
+      return false;
+    }
+    // Final SOA
+    messages.add(soaPacket);
+    return true;
+  });
+  if (wire == nullptr) {
     return false;
   }
 
-  return true;
+  return sendWireMessagesOverTCP(fd, *wire, mdp);
 }
 
 /* Produces an IXFR if one can be made according to the rules in RFC 1995 and
@@ -992,22 +1134,15 @@ static bool handleIXFR(int fd, const MOADNSParser& mdp, const shared_ptr<const S
   }
 
   for (const auto& diff : toSend) {
-    const auto newSOAPacket = getSOAPacket(mdp, diff->newSOA, diff->newSOATTL);
-    const auto oldSOAPacket = getSOAPacket(mdp, diff->oldSOA, diff->oldSOATTL);
-
-    if (!sendPacketOverTCP(fd, oldSOAPacket)) {
-      return false;
-    }
-
-    if (!sendRecordsOverTCP(fd, mdp, diff->removals)) {
-      return false;
-    }
-
-    if (!sendPacketOverTCP(fd, newSOAPacket)) {
-      return false;
-    }
-
-    if (!sendRecordsOverTCP(fd, mdp, diff->additions)) {
+    auto wire = getWireMessages(diff->wire, mdp, [&mdp, &diff](wireMessages_t& messages) {
+      messages.add(getSOAPacket(mdp.d_qname, mdp.d_qtype, 0, false, diff->oldSOA, diff->oldSOATTL));
+      if (!serializeRecords(mdp, diff->removals, messages)) {
+        return false;
+      }
+      messages.add(getSOAPacket(mdp.d_qname, mdp.d_qtype, 0, false, diff->newSOA, diff->newSOATTL));
+      return serializeRecords(mdp, diff->additions, messages);
+    });
+    if (wire == nullptr || !sendWireMessagesOverTCP(fd, *wire, mdp)) {
       return false;
     }
   }
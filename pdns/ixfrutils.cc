@@ -113,60 +113,93 @@ uint32_t getSerialFromRecords(const records_t& records, DNSRecord& soaret)
   return 0;
 }
 
-static void writeRecords(FILE* fp, const records_t& records)
+ZoneFileWriter::ZoneFileWriter(ZoneName zone, std::string directory) :
+  d_zone(std::move(zone)), d_directory(std::move(directory))
 {
-  for(const auto& r: records) {
-    if(fprintf(fp, "%s\t%" PRIu32 "\tIN\t%s\t%s\n",
-            r.d_name.isRoot() ? "@" :  r.d_name.toStringNoDot().c_str(),
-            r.d_ttl,
-            DNSRecordContent::NumberToType(r.d_type).c_str(),
-            r.getContent()->getZoneRepresentation().c_str()) < 0) {
-      throw runtime_error(stringerror());
-    }
+}
+
+ZoneFileWriter::~ZoneFileWriter()
+{
+  if (d_fp) {
+    d_fp.reset();
+    unlink((d_fname + ".partial").c_str());
   }
 }
 
-void writeZoneToDisk(const records_t& records, const ZoneName& zone, const std::string& directory)
+void ZoneFileWriter::fail(const std::string& what)
 {
-  DNSRecord soa;
-  auto serial = getSerialFromRecords(records, soa);
-  string fname = directory + "/" + std::to_string(serial);
-  /* ensure that the partial zone file will only be accessible by the current user, not even
-     by other users in the same group, and certainly not by other users. */
-  umask(S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH);
-  auto filePtr = pdns::UniqueFilePtr(fopen((fname+".partial").c_str(), "w"));
-  if (!filePtr) {
-    throw runtime_error("Unable to open file '"+fname+".partial' for writing: "+stringerror());
-  }
-
-  records_t soarecord;
-  soarecord.insert(soa);
-  if (fprintf(filePtr.get(), "$ORIGIN %s\n", zone.operator const DNSName&().toString().c_str()) < 0) {
-    string error = "Error writing to zone file for " + zone.toLogString() + " in file " + fname + ".partial" + ": " + stringerror();
-    filePtr.reset();
-    unlink((fname+".partial").c_str());
-    throw std::runtime_error(error);
+  string error = "Error writing to zone file for " + d_zone.toLogString() + " in file " + d_fname + ".partial" + ": " + what;
+  d_fp.reset();
+  unlink((d_fname + ".partial").c_str());
+  throw std::runtime_error(error);
+}
+
+void ZoneFileWriter::write(const DNSRecord& record)
+{
+  if (!d_fp) {
+    if (!d_fname.empty()) {
+      throw std::runtime_error("Writing to the zone file for " + d_zone.toLogString() + " after it was committed");
+    }
+    auto soa = getRR<SOARecordContent>(record);
+    if (record.d_type != QType::SOA || !soa) {
+      throw std::runtime_error("The first record of the zone file for " + d_zone.toLogString() + " is not a SOA");
+    }
+    d_serial = soa->d_st.serial;
+    d_fname = d_directory + "/" + std::to_string(d_serial);
+    /* ensure that the partial zone file will only be accessible by the current user, not even
+       by other users in the same group, and certainly not by other users. */
+    umask(S_IRGRP|S_IWGRP|S_IROTH|S_IWOTH);
+    d_fp = pdns::UniqueFilePtr(fopen((d_fname+".partial").c_str(), "w"));
+    if (!d_fp) {
+      throw runtime_error("Unable to open file '"+d_fname+".partial' for writing: "+stringerror());
+    }
+    if (fprintf(d_fp.get(), "$ORIGIN %s\n", d_zone.operator const DNSName&().toString().c_str()) < 0) {
+      fail(stringerror());
+    }
   }
 
-  try {
-    writeRecords(filePtr.get(), soarecord);
-    writeRecords(filePtr.get(), records);
-    writeRecords(filePtr.get(), soarecord);
-  } catch (runtime_error &e) {
-    filePtr.reset();
-    unlink((fname+".partial").c_str());
-    throw runtime_error("Error closing zone file for " + zone.toLogString() + " in file " + fname + ".partial" + ": " + e.what());
+  if (fprintf(d_fp.get(), "%s\t%" PRIu32 "\tIN\t%s\t%s\n",
+              record.d_name.isRoot() ? "@" :  record.d_name.toStringNoDot().c_str(),
+              record.d_ttl,
+              DNSRecordContent::NumberToType(record.d_type).c_str(),
+              record.getContent()->getZoneRepresentation().c_str()) < 0) {
+    fail(stringerror());
   }
+  d_lastType = record.d_type;
+}
 
-  if (fclose(filePtr.release()) != 0) {
-    string error = "Error closing zone file for " + zone.toLogString() + " in file " + fname + ".partial" + ": " + stringerror();
-    unlink((fname+".partial").c_str());
+void ZoneFileWriter::commit()
+{
+  if (!d_fp) {
+    throw std::runtime_error("Committing the zone file for " + d_zone.toLogString() + " without any record");
+  }
+  if (d_lastType != QType::SOA) {
+    fail("the last record is not a SOA");
+  }
+
+  if (fclose(d_fp.release()) != 0) {
+    string error = "Error closing zone file for " + d_zone.toLogString() + " in file " + d_fname + ".partial" + ": " + stringerror();
+    unlink((d_fname+".partial").c_str());
     throw std::runtime_error(error);
   }
 
-  if (rename( (fname+".partial").c_str(), fname.c_str()) != 0) {
-    throw std::runtime_error("Unable to move the zone file for " + zone.toLogString() + " from " + fname + ".partial to " + fname + ": " + stringerror());
+  if (rename( (d_fname+".partial").c_str(), d_fname.c_str()) != 0) {
+    throw std::runtime_error("Unable to move the zone file for " + d_zone.toLogString() + " from " + d_fname + ".partial to " + d_fname + ": " + stringerror());
+  }
+}
+
+void writeZoneToDisk(const records_t& records, const ZoneName& zone, const std::string& directory)
+{
+  DNSRecord soa;
+  getSerialFromRecords(records, soa);
+
+  ZoneFileWriter writer(zone, directory);
+  writer.write(soa);
+  for (const auto& record : records) {
+    writer.write(record);
   }
+  writer.write(soa);
+  writer.commit();
 }
 
 void loadZoneFromDisk(records_t& records, const string& fname, const ZoneName& zone)
@@ -31,6 +31,7 @@
 #include "dnsparser.hh"
 #include "dnsrecords.hh"
 #include "logr.hh"
+#include "misc.hh"
 
 using namespace boost::multi_index;
 
@@ -57,6 +58,36 @@ typedef multi_index_container <
     > /* indexed_by */
 > /* multi_index_container */ records_t;
 
+/* Writes a zone file while its records are received, so that it can be loaded back with
+   loadZoneFromDisk(). Records are relative to the zone, and the first one has to be the SOA.
+   The file is named after the serial of that SOA and only appears under that name once
+   commit() has been called, it is removed if the writer is destroyed before that. */
+class ZoneFileWriter : public boost::noncopyable
+{
+public:
+  ZoneFileWriter(ZoneName zone, std::string directory);
+  ~ZoneFileWriter();
+
+  void write(const DNSRecord& record);
+  /* the last record written has to be a SOA */
+  void commit();
+
+  [[nodiscard]] uint32_t getSerial() const
+  {
+    return d_serial;
+  }
+
+private:
+  [[noreturn]] void fail(const std::string& what);
+
+  ZoneName d_zone;
+  std::string d_directory;
+  std::string d_fname;
+  pdns::UniqueFilePtr d_fp{nullptr};
+  uint32_t d_serial{0};
+  uint16_t d_lastType{0};
+};
+
 uint32_t getSerialFromPrimary(Logr::log_t slog, const ComboAddress& primary, const ZoneName& zone, shared_ptr<const SOARecordContent>& soarecord, const TSIGTriplet& tsig = TSIGTriplet(), const uint16_t timeout = 2);
 uint32_t getSerialFromDir(const std::string& dir);
 uint32_t getSerialFromRecords(const records_t& records, DNSRecord& soaret);
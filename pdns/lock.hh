@@ -497,6 +497,11 @@ public:
     return d_lock.owns_lock();
   }
 
+  void lock()
+  {
+    d_lock.lock();
+  }
+
 private:
   std::unique_lock<std::shared_mutex> d_lock;
   T& d_value;
@@ -561,6 +566,11 @@ public:
     return d_lock.owns_lock();
   }
 
+  void lock()
+  {
+    d_lock.lock();
+  }
+
 private:
   std::shared_lock<std::shared_mutex> d_lock;
   const T& d_value;
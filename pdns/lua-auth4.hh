@@ -48,3 +48,6 @@ private:
 };
 std::vector<shared_ptr<DNSRecordContent>> luaSynth(Logr::log_t slog, const std::string& code, const DNSName& query, const DNSZoneRecord& zone_record,
                                                    const DNSName& zone, const DNSPacket& dnsp, uint16_t qtype, unique_ptr<AuthLua4>& LUA);
+// Per-target status of the health checks performed for ifportup() and ifurlup()
+std::string getLuaHealthChecksReport();
+uint64_t getLuaHealthChecksStat(const std::string& name);
@@ -1,6 +1,6 @@
 #include <algorithm>
 #include <condition_variable>
-#include <future>
+#include <deque>
 #include <random>
 #include <stdexcept>
 #include <thread>
@@ -20,6 +20,7 @@
 #include "lua-auth4.hh"
 #include "sstuff.hh"
 #include "minicurl.hh"
+#include "mplexer.hh"
 #include "ueberbackend.hh"
 #include "dns_random.hh"
 #include "auth-main.hh"
@@ -119,6 +120,28 @@ private:
     std::atomic<time_t> lastAccess{0};
     /* last time the status was modified */
     std::atomic<time_t> lastStatusUpdate{0};
+    /* a check is either waiting for a free slot or in progress */
+    std::atomic<bool> queued{false};
+    /* when the next check is due, in milliseconds since the epoch */
+    std::atomic<int64_t> nextCheckMsec{0};
+    /* duration of the last check, in microseconds */
+    std::atomic<uint64_t> lastLatencyUsec{0};
+    /* moving average of the duration of the checks, in microseconds */
+    std::atomic<uint64_t> avgLatencyUsec{0};
+  };
+  /* a check in progress, only ever accessed from the checker thread */
+  struct RunningCheck
+  {
+    CheckDesc desc;
+    CheckState* state{nullptr};
+    /* status when the check was started */
+    bool status{false};
+    bool first{true};
+    std::chrono::steady_clock::time_point start;
+    string remstring;
+    int httpCode{200};
+    std::unique_ptr<MiniCurl> curl;
+    std::unique_ptr<Socket> sock;
   };
 
 public:
@@ -131,21 +154,26 @@ public:
   int isUp(Logr::log_t slog, const ComboAddress& remote, const std::string& url, const opts_t& opts);
   //NOLINTNEXTLINE(readability-identifier-length)
   int isUp(const CheckDesc& cd);
+  std::string getStatusReport();
+  uint64_t getStat(const std::string& name) const;
 
 private:
-  void checkURL(const CheckDesc& cd, const bool status, const bool first) // NOLINT(readability-identifier-length)
+  static int64_t nowMsec()
   {
-    setThreadName("pdns/lua-c-url");
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  }
 
-    string remstring;
+  void startURL(RunningCheck&& check)
+  {
+    const auto& cd = check.desc;
     try {
       int timeout = std::atoi(cd.getOption<string>("timeout", "2").c_str());
       string useragent = cd.getOption("useragent", productName());
       size_t byteslimit = pdns::checked_stoi<size_t>(cd.getOption<string>("byteslimit", "0"));
-      int http_code = pdns::checked_stoi<int>(cd.getOption<string>("httpcode", "200"));
+      check.httpCode = pdns::checked_stoi<int>(cd.getOption<string>("httpcode", "200"));
+
+      auto minicurl = std::make_unique<MiniCurl>(useragent, false);
 
-      MiniCurl minicurl(useragent, false);
-      
       MiniCurl::MiniCurlHeaders mch;
       for (auto const & header:cd.getOption<LuaAssociativeTable<string>>("headers", {})) {
         auto headername = header.first;
@@ -153,22 +181,36 @@ private:
         mch.emplace(headername, header.second);
       }
 
-      string content;
       const ComboAddress* rem = nullptr;
       if(cd.rem.sin4.sin_family != AF_UNSPEC) {
         rem = &cd.rem;
-        remstring = rem->toString();
-      } else {
-        remstring = "[externally checked IP]";
       }
 
       if (cd.opts.count("source")) {
         ComboAddress src{cd.getOption<string>("source")};
-        content=minicurl.getURL(cd.url, rem, &src, timeout, &mch, false, false, byteslimit, http_code);
+        minicurl->prepareGetURL(cd.url, rem, &src, timeout, &mch, false, false, byteslimit);
       }
       else {
-        content=minicurl.getURL(cd.url, rem, nullptr, timeout, &mch, false, false, byteslimit, http_code);
+        minicurl->prepareGetURL(cd.url, rem, nullptr, timeout, &mch, false, false, byteslimit);
       }
+      d_curlMulti->add(*minicurl);
+      auto* key = minicurl.get();
+      check.curl = std::move(minicurl);
+      d_urlChecks.emplace(key, std::move(check));
+    }
+    catch (const std::exception& e) {
+      urlDown(check, e.what());
+    }
+    catch (const PDNSException& e) {
+      urlDown(check, e.reason);
+    }
+  }
+
+  void urlDone(RunningCheck& check, CURLcode res)
+  {
+    const auto& cd = check.desc;
+    try {
+      string content = check.curl->finishGetURL(res, check.httpCode);
       if (cd.opts.count("stringmatch") && content.find(cd.getOption<string>("stringmatch")) == string::npos) {
         throw std::runtime_error(boost::str(boost::format("unable to match content with `%s`") % cd.getOption<string>("stringmatch")));
       }
@@ -176,141 +218,284 @@ private:
       int weight = 0;
       try {
         weight = stoi(content);
-        if(!status) {
-          SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring "<<remstring<<" UP for URL "<<cd.url<<"!"<<" with WEIGHT "<<content<<"!"<<endl,
-               cd.slog->info(Logr::Info, "Lua record monitoring declares url UP", "ip", Logging::Loggable(remstring), "url", Logging::Loggable(cd.url), "weight", Logging::Loggable(content)));
+        if(!check.status) {
+          SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring "<<check.remstring<<" UP for URL "<<cd.url<<"!"<<" with WEIGHT "<<content<<"!"<<endl,
+               cd.slog->info(Logr::Info, "Lua record monitoring declares url UP", "ip", Logging::Loggable(check.remstring), "url", Logging::Loggable(cd.url), "weight", Logging::Loggable(content)));
         }
       }
       catch (const std::exception&) {
-        if(!status) {
-          SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring "<<remstring<<" UP for URL "<<cd.url<<"!"<<endl,
-               cd.slog->info(Logr::Info, "Lua record monitoring declares url UP", "ip", Logging::Loggable(remstring), "url", Logging::Loggable(cd.url)));
+        if(!check.status) {
+          SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring "<<check.remstring<<" UP for URL "<<cd.url<<"!"<<endl,
+               cd.slog->info(Logr::Info, "Lua record monitoring declares url UP", "ip", Logging::Loggable(check.remstring), "url", Logging::Loggable(cd.url)));
         }
       }
 
-      setWeight(cd, weight);
-      setUp(cd);
+      setWeight(*check.state, weight);
+      setUp(check);
     }
-    catch(std::exception& ne) {
-      if(status || first) {
-        SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring "<<remstring<<" DOWN for URL "<<cd.url<<", error: "<<ne.what()<<endl,
-             cd.slog->error(Logr::Info, ne.what(), "Lua record monitoring declares url DOWN", "ip", Logging::Loggable(remstring), "url", Logging::Loggable(cd.url)));
-      }
-      setWeight(cd, 0);
-      setDown(cd);
+    catch (const std::exception& ne) {
+      urlDown(check, ne.what());
     }
   }
-  void checkTCP(const CheckDesc& cd, const bool status, const bool first) { // NOLINT(readability-identifier-length)
-    setThreadName("pdns/lua-c-tcp");
+
+  void urlDown(RunningCheck& check, const std::string& error)
+  {
+    const auto& cd = check.desc;
+    if(check.status || check.first) {
+      SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring "<<check.remstring<<" DOWN for URL "<<cd.url<<", error: "<<error<<endl,
+           cd.slog->error(Logr::Info, error, "Lua record monitoring declares url DOWN", "ip", Logging::Loggable(check.remstring), "url", Logging::Loggable(cd.url)));
+    }
+    setWeight(*check.state, 0);
+    setDown(check);
+  }
+
+  void startTCP(RunningCheck&& check)
+  {
+    const auto& cd = check.desc;
     try {
       int timeout = std::atoi(cd.getOption<string>("timeout", "2").c_str());
-      Socket s(cd.rem.sin4.sin_family, SOCK_STREAM);
-      ComboAddress src;
-      s.setNonBlocking();
+      auto sock = std::make_unique<Socket>(cd.rem.sin4.sin_family, SOCK_STREAM);
+      sock->setNonBlocking();
       if (cd.opts.count("source")) {
-        src = ComboAddress(cd.getOption<string>("source"));
-        s.bind(src);
+        sock->bind(ComboAddress(cd.getOption<string>("source")));
       }
-      s.connect(cd.rem, timeout);
-      if (!status) {
-        if (g_slogStructured) {
-          if(cd.opts.count("source")) {
-            cd.slog->info(Logr::Info, "Lua record monitoring declares remote UP", "remote", Logging::Loggable(cd.rem.toStringWithPort()), "source", Logging::Loggable(src));
-          }
-          else {
-            cd.slog->info(Logr::Info, "Lua record monitoring declares remote UP", "remote", Logging::Loggable(cd.rem.toStringWithPort()));
-          }
+      if (SConnectWithTimeout(sock->getHandle(), false, cd.rem, timeval{0, 0}) == 0) {
+        tcpUp(check);
+        return;
+      }
+      struct timeval ttd{};
+      gettimeofday(&ttd, nullptr);
+      ttd.tv_sec += timeout;
+      int fd = sock->getHandle();
+      d_fdm->addWriteFD(fd, [this](int sockfd, FDMultiplexer::funcparam_t& /* param */) {
+        d_readyTCP.push_back(sockfd);
+      }, FDMultiplexer::funcparam_t(), &ttd);
+      check.sock = std::move(sock);
+      d_tcpChecks.emplace(fd, std::move(check));
+    }
+    catch (const std::exception& e) {
+      tcpDown(check, e.what());
+    }
+    catch (const PDNSException& e) {
+      tcpDown(check, e.reason);
+    }
+  }
+
+  void tcpConnected(RunningCheck& check)
+  {
+    int err = 0;
+    socklen_t errlen = sizeof(err);
+    if (getsockopt(check.sock->getHandle(), SOL_SOCKET, SO_ERROR, &err, &errlen) != 0) {
+      err = errno;
+    }
+    if (err != 0) {
+      tcpDown(check, "connecting to " + check.desc.rem.toStringWithPort() + " failed: " + stringerror(err));
+    }
+    else {
+      tcpUp(check);
+    }
+  }
+
+  void tcpUp(RunningCheck& check)
+  {
+    const auto& cd = check.desc;
+    if (!check.status) {
+      if (g_slogStructured) {
+        if(cd.opts.count("source")) {
+          ComboAddress src(cd.getOption<string>("source"));
+          cd.slog->info(Logr::Info, "Lua record monitoring declares remote UP", "remote", Logging::Loggable(cd.rem.toStringWithPort()), "source", Logging::Loggable(src));
         }
         else {
-          g_log<<Logger::Info<<"Lua record monitoring declaring TCP/IP "<<cd.rem.toStringWithPort()<<" ";
-          if(cd.opts.count("source")) {
-            g_log<<"(source "<<src.toString()<<") ";
-          }
-          g_log<<"UP!"<<endl;
+          cd.slog->info(Logr::Info, "Lua record monitoring declares remote UP", "remote", Logging::Loggable(cd.rem.toStringWithPort()));
         }
       }
-      setUp(cd);
+      else {
+        g_log<<Logger::Info<<"Lua record monitoring declaring TCP/IP "<<cd.rem.toStringWithPort()<<" ";
+        if(cd.opts.count("source")) {
+          g_log<<"(source "<<ComboAddress(cd.getOption<string>("source")).toString()<<") ";
+        }
+        g_log<<"UP!"<<endl;
+      }
     }
-    catch (const NetworkError& ne) {
-      if(status || first) {
-        SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring TCP/IP "<<cd.rem.toStringWithPort()<<" DOWN: "<<ne.what()<<endl,
-            cd.slog->error(Logr::Info, ne.what(), "Lua record monitoring declares remote DOWN", "remote", Logging::Loggable(cd.rem.toStringWithPort())));
+    setUp(check);
+  }
+
+  void tcpDown(RunningCheck& check, const std::string& error)
+  {
+    const auto& cd = check.desc;
+    if(check.status || check.first) {
+      SLOG(g_log<<Logger::Info<<"Lua record monitoring declaring TCP/IP "<<cd.rem.toStringWithPort()<<" DOWN: "<<error<<endl,
+           cd.slog->error(Logr::Info, error, "Lua record monitoring declares remote DOWN", "remote", Logging::Loggable(cd.rem.toStringWithPort())));
+    }
+    setDown(check);
+  }
+
+  void startCheck(const CheckDesc& desc, CheckState* state)
+  {
+    RunningCheck check;
+    check.desc = desc;
+    check.state = state;
+    check.status = state->status;
+    check.first = state->first;
+    check.start = std::chrono::steady_clock::now();
+
+    if (desc.url.empty()) { // TCP
+      startTCP(std::move(check));
+    }
+    else { // URL
+      check.remstring = desc.rem.sin4.sin_family != AF_UNSPEC ? desc.rem.toString() : "[externally checked IP]";
+      startURL(std::move(check));
+    }
+  }
+
+  // Watch the sockets curl asks us to, only recording readiness from the
+  // multiplexer callbacks: curl is free to close them once called.
+  void curlSocketCallback(int fd, int what)
+  {
+    auto current = d_curlSockets.find(fd);
+    if (current != d_curlSockets.end()) {
+      if (current->second == CURL_POLL_IN || current->second == CURL_POLL_INOUT) {
+        d_fdm->removeReadFD(fd);
+      }
+      if (current->second == CURL_POLL_OUT || current->second == CURL_POLL_INOUT) {
+        d_fdm->removeWriteFD(fd);
       }
-      setDown(cd);
+      d_curlSockets.erase(current);
+    }
+    if (what == CURL_POLL_REMOVE) {
+      return;
+    }
+    if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) {
+      d_fdm->addReadFD(fd, [this](int sockfd, FDMultiplexer::funcparam_t& /* param */) {
+        d_readyCurl.emplace_back(sockfd, CURL_CSELECT_IN);
+      });
+    }
+    if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) {
+      d_fdm->addWriteFD(fd, [this](int sockfd, FDMultiplexer::funcparam_t& /* param */) {
+        d_readyCurl.emplace_back(sockfd, CURL_CSELECT_OUT);
+      });
     }
+    d_curlSockets[fd] = what;
   }
+
+  // Walk the statuses to queue the checks that are due and to expire the
+  // unused ones, returning when the next check is due.
+  int64_t scheduleChecks(int64_t now)
+  {
+    int64_t nextDue = now + g_luaHealthChecksInterval * 1000;
+    std::vector<CheckDesc> toDelete;
+    {
+      // make sure there's no insertion
+      auto statuses = d_statuses.read_lock();
+      for (auto& it: *statuses) {
+        auto& desc = it.first;
+        auto& state = it.second;
+        if (state->queued) {
+          continue;
+        }
+        // Give it a chance to run at least once.
+        // If minimumFailures * interval > lua-health-checks-expire-delay, then a down status will never get reported.
+        // This is unlikely to be a problem in practice due to the default value of the expire delay being one hour.
+        if (not state->first &&
+            state->lastAccess < (now / 1000 - g_luaHealthChecksExpireDelay)) {
+          toDelete.push_back(desc);
+          continue;
+        }
+        if (not state->first && now < state->nextCheckMsec) {
+          nextDue = std::min(nextDue, state->nextCheckMsec.load());
+          continue; // too early
+        }
+        state->queued = true;
+        d_pending.emplace_back(desc, state.get());
+      }
+    }
+    // checks in progress are never removed, so this does not invalidate any pending state
+    if (!toDelete.empty()) {
+      auto statuses = d_statuses.write_lock();
+      for (auto& it: toDelete) {
+        statuses->erase(it);
+      }
+    }
+    return nextDue;
+  }
+
   void checkThread()
   {
     setThreadName("pdns/luaupcheck");
+    d_fdm = std::unique_ptr<FDMultiplexer>(FDMultiplexer::getMultiplexerSilent());
+    d_curlMulti = std::make_unique<MiniCurlMulti>([this](int fd, int what) { curlSocketCallback(fd, what); });
+    int64_t nextScan = 0;
+
     while (true)
     {
-      std::chrono::system_clock::time_point checkStart = std::chrono::system_clock::now();
-      std::vector<std::future<void>> results;
-      std::vector<CheckDesc> toDelete;
-      {
-        // make sure there's no insertion
-        auto statuses = d_statuses.read_lock();
-        for (auto& it: *statuses) {
-          auto& desc = it.first;
-          auto& state = it.second;
-          time_t interval{g_luaHealthChecksInterval};
-          time_t checkInterval{0};
-          auto lastAccess = std::chrono::system_clock::from_time_t(state->lastAccess);
-
-          checkInterval = std::atoi(desc.getOption<string>("interval", "0").c_str());
-          if (checkInterval != 0) {
-            interval = std::gcd(interval, checkInterval);
-          }
+      int64_t now = nowMsec();
+      if (now >= nextScan || d_newChecks.exchange(false)) {
+        nextScan = scheduleChecks(now);
+      }
 
-          if (not state->first) {
-            time_t nextCheckSecond = state->lastStatusUpdate;
-            if (checkInterval != 0) {
-               nextCheckSecond += checkInterval;
-            }
-            else {
-               nextCheckSecond += g_luaHealthChecksInterval;
-            }
-            if (checkStart < std::chrono::system_clock::from_time_t(nextCheckSecond)) {
-              continue; // too early
-            }
-          }
+      while (!d_pending.empty() && (d_tcpChecks.size() + d_urlChecks.size()) < g_luaHealthChecksMaxConcurrent) {
+        auto [desc, state] = std::move(d_pending.front());
+        d_pending.pop_front();
+        startCheck(desc, state);
+      }
+      d_queuedCount = d_pending.size();
+      d_inProgressCount = d_tcpChecks.size() + d_urlChecks.size();
 
-          if (desc.url.empty()) { // TCP
-            results.push_back(std::async(std::launch::async, &IsUpOracle::checkTCP, this, desc, state->status.load(), state->first.load()));
-          } else { // URL
-            results.push_back(std::async(std::launch::async, &IsUpOracle::checkURL, this, desc, state->status.load(), state->first.load()));
-          }
-          // Give it a chance to run at least once.
-          // If minimumFailures * interval > lua-health-checks-expire-delay, then a down status will never get reported.
-          // This is unlikely to be a problem in practice due to the default value of the expire delay being one hour.
-          if (not state->first &&
-              lastAccess < (checkStart - std::chrono::seconds(g_luaHealthChecksExpireDelay))) {
-            toDelete.push_back(desc);
-          }
+      if (d_tcpChecks.empty() && d_urlChecks.empty()) {
+        // Nothing in progress: wait until the next check is due, but allow
+        // an earlier wakeup in case more work is being put in d_statuses.
+        std::unique_lock<std::mutex> lock(d_mutex);
+        now = nowMsec();
+        if (nextScan > now && !d_newChecks) {
+          d_condvar.wait_for(lock, std::chrono::milliseconds(nextScan - now));
         }
+        continue;
+      }
+
+      int64_t timeout = std::min(nextScan - now, static_cast<int64_t>(s_maxRunTimeMsec));
+      if (auto curlTimeout = d_curlMulti->getTimeout(); curlTimeout >= 0) {
+        timeout = std::min(timeout, static_cast<int64_t>(curlTimeout));
       }
-      // we can release the lock as nothing will be deleted
-      for (auto& future: results) {
-        future.wait();
+
+      struct timeval tv{};
+      d_fdm->run(&tv, static_cast<int>(std::max(timeout, static_cast<int64_t>(0))));
+
+      for (const auto& [fd, events] : d_readyCurl) {
+        d_curlMulti->socketReady(fd, events);
       }
-      if (!toDelete.empty()) {
-        auto statuses = d_statuses.write_lock();
-        for (auto& it: toDelete) {
-          statuses->erase(it);
+      d_readyCurl.clear();
+      // curl moves its deadline itself whenever it needs to, via its timer callback
+      if (d_curlMulti->getTimeout() == 0) {
+        d_curlMulti->timeoutExpired();
+      }
+      for (const auto& [curl, res] : d_curlMulti->getCompleted()) {
+        auto iter = d_urlChecks.find(curl);
+        if (iter == d_urlChecks.end()) {
+          continue;
         }
+        d_curlMulti->remove(*curl);
+        urlDone(iter->second, res);
+        d_urlChecks.erase(iter);
       }
 
-      // set thread name again, in case std::async surprised us by doing work in this thread
-      setThreadName("pdns/luaupcheck");
-
-      // Wait for at most one complete check interval, but allow an earlier
-      // wakeup in case more work is being put in d_statuses.
-      {
-        std::unique_lock<std::mutex> lock(d_mutex);
-        auto sleepTime = std::chrono::seconds(g_luaHealthChecksInterval) - (std::chrono::system_clock::now() - checkStart);
-        if (sleepTime > std::chrono::seconds::zero()) {
-          d_condvar.wait_until(lock, std::chrono::system_clock::now() + sleepTime);
+      for (const auto fd : d_readyTCP) {
+        auto iter = d_tcpChecks.find(fd);
+        if (iter == d_tcpChecks.end()) {
+          continue;
+        }
+        d_fdm->removeWriteFD(fd);
+        tcpConnected(iter->second);
+        d_tcpChecks.erase(iter);
+      }
+      d_readyTCP.clear();
+      for (const auto& timedOut : d_fdm->getTimeouts(tv, true)) {
+        auto iter = d_tcpChecks.find(timedOut.first);
+        if (iter == d_tcpChecks.end()) {
+          continue;
         }
+        d_fdm->removeWriteFD(timedOut.first);
+        tcpDown(iter->second, "timeout while connecting to " + iter->second.desc.rem.toStringWithPort());
+        d_tcpChecks.erase(iter);
       }
     }
   }
@@ -323,44 +508,84 @@ private:
 
   std::mutex d_mutex; // used with the condition variable below
   std::condition_variable d_condvar;
-
-  void setStatus(const CheckDesc& cd, bool status)
+  std::atomic<bool> d_newChecks{false};
+
+  std::atomic<uint64_t> d_checksCount{0};
+  std::atomic<uint64_t> d_failedCount{0};
+  std::atomic<uint64_t> d_inProgressCount{0};
+  std::atomic<uint64_t> d_queuedCount{0};
+  std::atomic<uint64_t> d_avgLatencyCount{0};
+
+  /* everything below is only accessed from the checker thread */
+  static constexpr int s_maxRunTimeMsec{250};
+  std::unique_ptr<FDMultiplexer> d_fdm;
+  std::unique_ptr<MiniCurlMulti> d_curlMulti;
+  std::deque<std::pair<CheckDesc, CheckState*>> d_pending;
+  std::map<int, RunningCheck> d_tcpChecks;
+  std::map<MiniCurl*, RunningCheck> d_urlChecks;
+  /* sockets curl asked us to watch, and for which events */
+  std::map<int, int> d_curlSockets;
+  std::vector<int> d_readyTCP;
+  std::vector<std::pair<int, int>> d_readyCurl;
+  /* moving average of the duration of all checks, in microseconds */
+  double d_avgLatencyUsec{0};
+
+  void setStatus(RunningCheck& check, bool status)
   {
-    auto statuses = d_statuses.write_lock();
-    auto& state = (*statuses)[cd];
-    state->lastStatusUpdate = time(nullptr);
-    state->first = false;
+    auto& state = *check.state;
+    auto now = time(nullptr);
+    state.lastStatusUpdate = now;
+    state.first = false;
     if (status) {
-      state->failures = 0;
-      state->status = true;
+      state.failures = 0;
+      state.status = true;
     } else {
       unsigned int minimumFailures = 1;
-      unsigned int value = std::atoi(cd.getOption<string>("minimumFailures", "0").c_str());
+      unsigned int value = std::atoi(check.desc.getOption<string>("minimumFailures", "0").c_str());
       if (value != 0) {
         minimumFailures = std::max(minimumFailures, value);
       }
       // Since `status' was set to false at constructor time, we need to
       // recompute its value unconditionally to expose "down, but not enough
       // times yet" targets as up.
-      state->status = ++state->failures < minimumFailures;
+      state.status = ++state.failures < minimumFailures;
+      ++d_failedCount;
+    }
+
+    auto latency = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - check.start).count());
+    state.lastLatencyUsec = latency;
+    state.avgLatencyUsec = state.avgLatencyUsec == 0 ? latency : (7 * state.avgLatencyUsec + latency) / 8;
+    d_avgLatencyUsec = 0.999 * d_avgLatencyUsec + 0.001 * static_cast<double>(latency);
+    d_avgLatencyCount = static_cast<uint64_t>(d_avgLatencyUsec);
+    ++d_checksCount;
+
+    // Schedule the next check, removing up to a tenth of the interval so
+    // that targets registered at the same time drift apart instead of all
+    // being checked in the same burst, without ever checking later than
+    // asked.
+    time_t interval = std::atoi(check.desc.getOption<string>("interval", "0").c_str());
+    if (interval == 0) {
+      interval = g_luaHealthChecksInterval;
     }
+    int64_t intervalMsec = static_cast<int64_t>(interval) * 1000;
+    int64_t jitter = intervalMsec >= 10 ? dns_random(static_cast<uint32_t>(intervalMsec / 10)) : 0;
+    state.nextCheckMsec = nowMsec() + intervalMsec - jitter;
+    state.queued = false;
   }
 
   //NOLINTNEXTLINE(readability-identifier-length)
-  void setWeight(const CheckDesc& cd, int weight){
-    auto statuses = d_statuses.write_lock();
-    auto& state = (*statuses)[cd];
-    state->weight = weight;
+  static void setWeight(CheckState& state, int weight){
+    state.weight = weight;
   }
 
-  void setDown(const CheckDesc& cd)
+  void setDown(RunningCheck& check)
   {
-    setStatus(cd, false);
+    setStatus(check, false);
   }
 
-  void setUp(const CheckDesc& cd)
+  void setUp(RunningCheck& check)
   {
-    setStatus(cd, true);
+    setStatus(check, true);
   }
 };
 
@@ -399,6 +624,7 @@ int IsUpOracle::isUp(const CheckDesc& cd)
   }
   // Now that we have given it work to do, make sure the checker thread runs,
   // and notify it if it had already been running.
+  d_newChecks = true;
   if (!d_checkerThreadStarted.test_and_set()) {
     d_checkerThread = std::make_unique<std::thread>([this] { return checkThread(); });
   }
@@ -428,7 +654,59 @@ int IsUpOracle::isUp(Logr::log_t slog, const ComboAddress& remote, const std::st
   return isUp(cd);
 }
 
+std::string IsUpOracle::getStatusReport()
+{
+  ostringstream ret;
+  boost::format fmt("%-40s %-6s %6d %8d %12.3f %12.3f\n");
+  ret << boost::format("%-40s %-6s %6s %8s %12s %12s\n") % "target" % "status" % "weight" % "failures" % "last-ms" % "avg-ms";
+  auto statuses = d_statuses.read_lock();
+  for (const auto& [desc, state] : *statuses) {
+    string target;
+    if (desc.url.empty()) {
+      target = desc.rem.toStringWithPort();
+    }
+    else if (desc.rem.sin4.sin_family != AF_UNSPEC) {
+      target = desc.url + " (" + desc.rem.toString() + ")";
+    }
+    else {
+      target = desc.url;
+    }
+    ret << fmt % target % (state->first ? "-" : (state->status ? "up" : "down")) % state->weight % state->failures % (static_cast<double>(state->lastLatencyUsec) / 1000.0) % (static_cast<double>(state->avgLatencyUsec) / 1000.0);
+  }
+  return ret.str();
+}
+
+uint64_t IsUpOracle::getStat(const std::string& name) const
+{
+  if (name == "lua-health-checks") {
+    return d_checksCount;
+  }
+  if (name == "lua-health-checks-failed") {
+    return d_failedCount;
+  }
+  if (name == "lua-health-checks-in-progress") {
+    return d_inProgressCount;
+  }
+  if (name == "lua-health-checks-queued") {
+    return d_queuedCount;
+  }
+  if (name == "lua-health-checks-latency") {
+    return d_avgLatencyCount;
+  }
+  return 0;
+}
+
 IsUpOracle g_up;
+
+std::string getLuaHealthChecksReport()
+{
+  return g_up.getStatusReport();
+}
+
+uint64_t getLuaHealthChecksStat(const std::string& name)
+{
+  return g_up.getStat(name);
+}
 namespace {
 template<typename T, typename C>
 bool doCompare(const T& var, const std::string& res, const C& cmp)
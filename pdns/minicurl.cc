@@ -197,16 +197,27 @@ void MiniCurl::setupURL(const std::string& str, const ComboAddress* rem, const C
 }
 
 std::string MiniCurl::getURL(const std::string& str, const ComboAddress* rem, const ComboAddress* src, int timeout, const MiniCurlHeaders* headers, [[maybe_unused]] bool fastopen, bool verify, size_t byteslimit, int http_status)
+{
+  prepareGetURL(str, rem, src, timeout, headers, fastopen, verify, byteslimit);
+  auto res = curl_easy_perform(getCURLPtr(d_curl));
+  return finishGetURL(res, http_status);
+}
+
+void MiniCurl::prepareGetURL(const std::string& str, const ComboAddress* rem, const ComboAddress* src, int timeout, const MiniCurlHeaders* headers, [[maybe_unused]] bool fastopen, bool verify, size_t byteslimit)
 {
   setupURL(str, rem, src, timeout, byteslimit, fastopen, verify);
   if (headers != nullptr) {
     setHeaders(*headers);
   }
-  auto res = curl_easy_perform(getCURLPtr(d_curl));
+}
+
+std::string MiniCurl::finishGetURL(CURLcode res, int http_status)
+{
   long http_code = 0;
   curl_easy_getinfo(getCURLPtr(d_curl), CURLINFO_RESPONSE_CODE, &http_code);
 
   if ((res != CURLE_OK && res != CURLE_ABORTED_BY_CALLBACK) || http_code != http_status)  {
+    d_data.clear();
     throw std::runtime_error("Unable to retrieve URL ("+std::to_string(http_code)+"): "+string(curl_easy_strerror(res)));
   }
   std::string ret = d_data;
@@ -280,3 +291,107 @@ void MiniCurl::setHeaders(const MiniCurlHeaders& headers)
     curl_easy_setopt(getCURLPtr(d_curl), CURLOPT_HTTPHEADER, getCURLPtr(d_header_list));
   }
 }
+
+MiniCurlMulti::MiniCurlMulti(socket_callback_t callback) :
+  d_callback(std::move(callback))
+{
+#ifdef CURL_STRICTER
+  d_multi = std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)>(curl_multi_init(), curl_multi_cleanup);
+#else
+  d_multi = curl_multi_init();
+#endif
+  if (d_multi == nullptr) {
+    throw std::runtime_error("Error creating a MiniCurlMulti session");
+  }
+  curl_multi_setopt(getCURLPtr(d_multi), CURLMOPT_SOCKETFUNCTION, socketCallback);
+  curl_multi_setopt(getCURLPtr(d_multi), CURLMOPT_SOCKETDATA, this);
+  curl_multi_setopt(getCURLPtr(d_multi), CURLMOPT_TIMERFUNCTION, timerCallback);
+  curl_multi_setopt(getCURLPtr(d_multi), CURLMOPT_TIMERDATA, this);
+}
+
+MiniCurlMulti::~MiniCurlMulti()
+{
+#ifndef CURL_STRICTER
+  curl_multi_cleanup(d_multi);
+#endif
+}
+
+int MiniCurlMulti::socketCallback(CURL* /* easy */, curl_socket_t sock, int what, void* userp, void* /* socketp */)
+{
+  auto* multi = static_cast<MiniCurlMulti*>(userp);
+  try {
+    multi->d_callback(sock, what);
+  }
+  catch (...) {
+    return -1;
+  }
+  return 0;
+}
+
+int MiniCurlMulti::timerCallback(CURLM* /* multi */, long timeout_ms, void* userp)
+{
+  auto* multi = static_cast<MiniCurlMulti*>(userp);
+  if (timeout_ms < 0) {
+    multi->d_deadline.reset();
+  }
+  else {
+    multi->d_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  }
+  return 0;
+}
+
+long MiniCurlMulti::getTimeout() const
+{
+  if (!d_deadline) {
+    return -1;
+  }
+  auto left = std::chrono::ceil<std::chrono::milliseconds>(*d_deadline - std::chrono::steady_clock::now()).count();
+  return std::max(left, static_cast<decltype(left)>(0));
+}
+
+void MiniCurlMulti::add(MiniCurl& curl)
+{
+  curl_easy_setopt(getCURLPtr(curl.d_curl), CURLOPT_PRIVATE, &curl);
+  auto res = curl_multi_add_handle(getCURLPtr(d_multi), getCURLPtr(curl.d_curl));
+  if (res != CURLM_OK) {
+    throw std::runtime_error("Unable to add a transfer to a MiniCurlMulti session: " + string(curl_multi_strerror(res)));
+  }
+  ++d_transfers;
+}
+
+void MiniCurlMulti::remove(MiniCurl& curl)
+{
+  if (curl_multi_remove_handle(getCURLPtr(d_multi), getCURLPtr(curl.d_curl)) == CURLM_OK) {
+    --d_transfers;
+  }
+}
+
+void MiniCurlMulti::socketReady(int fd, int events)
+{
+  int running = 0;
+  curl_multi_socket_action(getCURLPtr(d_multi), fd, events, &running);
+}
+
+void MiniCurlMulti::timeoutExpired()
+{
+  int running = 0;
+  d_deadline.reset();
+  curl_multi_socket_action(getCURLPtr(d_multi), CURL_SOCKET_TIMEOUT, 0, &running);
+}
+
+std::vector<std::pair<MiniCurl*, CURLcode>> MiniCurlMulti::getCompleted()
+{
+  std::vector<std::pair<MiniCurl*, CURLcode>> result;
+  int pending = 0;
+  while (CURLMsg* msg = curl_multi_info_read(getCURLPtr(d_multi), &pending)) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    char* priv = nullptr;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+    if (priv != nullptr) {
+      result.emplace_back(reinterpret_cast<MiniCurl*>(priv), msg->data.result); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast): that's how we stored it
+    }
+  }
+  return result;
+}
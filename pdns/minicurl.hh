@@ -34,6 +34,9 @@
 #define CURL_STRICTER 1
 #endif
 #include <curl/curl.h>
+#include <chrono>
+#include <functional>
+#include <optional>
 #include "iputils.hh"
 
 class MiniCurl
@@ -50,7 +53,14 @@ public:
   std::string getURL(const std::string& str, const ComboAddress* rem=nullptr, const ComboAddress* src=nullptr, int timeout = 2, const MiniCurlHeaders* headers = nullptr, bool fastopen = false, bool verify = false, size_t byteslimit = 0, int http_status = 200);
   std::string postURL(const std::string& str, const std::string& postdata, MiniCurlHeaders& headers, int timeout = 2, bool fastopen = false, bool verify = false);
 
+  /* Asynchronous version of getURL(): prepareGetURL() sets the transfer up, the transfer is then
+     driven by a MiniCurlMulti object, and finishGetURL() checks the outcome and returns the content */
+  void prepareGetURL(const std::string& str, const ComboAddress* rem=nullptr, const ComboAddress* src=nullptr, int timeout = 2, const MiniCurlHeaders* headers = nullptr, bool fastopen = false, bool verify = false, size_t byteslimit = 0);
+  std::string finishGetURL(CURLcode res, int http_status = 200);
+
 private:
+  friend class MiniCurlMulti;
+
   static size_t write_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
 #if defined(LIBCURL_VERSION_NUM) && LIBCURL_VERSION_NUM >= 0x072000 // 7.32.0
   static size_t progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
@@ -77,3 +87,54 @@ private:
   void clearHeaders();
   void clearHostsList();
 };
+
+/* Runs several MiniCurl transfers concurrently from a single thread. The sockets used by the
+   transfers are handed over to the caller via a callback, so they can be watched by the caller's
+   own event loop (an FDMultiplexer, for example), which then reports readiness via socketReady()
+   and calls timeoutExpired() once getTimeout() reaches 0. */
+class MiniCurlMulti
+{
+public:
+  /* what is one of CURL_POLL_IN, CURL_POLL_OUT, CURL_POLL_INOUT or CURL_POLL_REMOVE */
+  using socket_callback_t = std::function<void(int fd, int what)>;
+
+  MiniCurlMulti(socket_callback_t callback);
+  ~MiniCurlMulti();
+  MiniCurlMulti(const MiniCurlMulti&) = delete;
+  MiniCurlMulti(MiniCurlMulti&&) = delete;
+  MiniCurlMulti& operator=(const MiniCurlMulti&) = delete;
+  MiniCurlMulti& operator=(MiniCurlMulti&&) = delete;
+
+  /* the transfer must have been set up via MiniCurl::prepareGetURL() first,
+     and the MiniCurl object needs to stay alive until it has been removed */
+  void add(MiniCurl& curl);
+  void remove(MiniCurl& curl);
+
+  /* events is a combination of CURL_CSELECT_IN and CURL_CSELECT_OUT */
+  void socketReady(int fd, int events);
+  void timeoutExpired();
+  /* milliseconds left until timeoutExpired() has to be called, 0 if that is already due,
+     -1 if no timeout is currently needed */
+  [[nodiscard]] long getTimeout() const;
+  /* returns the transfers that have completed since the last call, with their result code.
+     Completed transfers are not removed automatically. */
+  std::vector<std::pair<MiniCurl*, CURLcode>> getCompleted();
+  [[nodiscard]] size_t size() const
+  {
+    return d_transfers;
+  }
+
+private:
+  static int socketCallback(CURL* easy, curl_socket_t sock, int what, void* userp, void* socketp);
+  static int timerCallback(CURLM* multi, long timeout_ms, void* userp);
+
+#ifdef CURL_STRICTER
+  std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)> d_multi{nullptr, curl_multi_cleanup};
+#else
+  CURLM* d_multi{};
+#endif
+  socket_callback_t d_callback;
+  // set by curl's timer callback only, as an absolute time since curl reports a relative delay once
+  std::optional<std::chrono::steady_clock::time_point> d_deadline;
+  size_t d_transfers{0};
+};
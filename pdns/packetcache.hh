@@ -168,6 +168,11 @@ public:
   }
 
   static bool queryMatches(const std::string& cachedQuery, const std::string& query, const DNSName& qname, const std::unordered_set<uint16_t>& optionsToIgnore)
+  {
+    return queryMatches(cachedQuery, query, qname.wirelength(), optionsToIgnore);
+  }
+
+  static bool queryMatches(const std::string& cachedQuery, const std::string& query, size_t qnameWireLength, const std::unordered_set<uint16_t>& optionsToIgnore)
   {
     const size_t querySize = query.size();
     const size_t cachedQuerySize = cachedQuery.size();
@@ -179,7 +184,7 @@ public:
       return false;
     }
 
-    size_t pos = sizeof(dnsheader) + qname.wirelength();
+    size_t pos = sizeof(dnsheader) + qnameWireLength;
 
     /* we need at least 2 (QTYPE) + 2 (QCLASS)
        + OPT root label (1), type (2), class (2) and ttl (4)
@@ -840,7 +840,7 @@ void PacketHandler::addNSECX(DNSPacket& p, std::unique_ptr<DNSPacket>& r, const
 {
   NSEC3PARAMRecordContent ns3rc;
   bool narrow = false;
-  if(d_dk.getNSEC3PARAM(d_sd.zonename, &ns3rc, &narrow))  {
+  if(getNSEC3PARAM(&ns3rc, &narrow))  {
     if (mode != 5) // no direct NSEC3 queries, rfc5155 7.2.8
       addNSEC3(p, r, target, wildcard, ns3rc, narrow, mode);
   }
@@ -1305,6 +1305,77 @@ void PacketHandler::makeNXDomain(DNSPacket& p, std::unique_ptr<DNSPacket>& r, co
   r->setRcode(RCode::NXDomain);
 }
 
+// The denial cache is keyed on the NSEC chain, which only NSEC-signed zones we sign ourselves maintain
+bool PacketHandler::denialCacheApplies()
+{
+  return DC.enabled() && d_sd.db != nullptr && d_sd.db->doesDNSSEC() && isSecuredZone() && !isPresigned() && !getNSEC3PARAM();
+}
+
+bool PacketHandler::tryDenialCache(std::unique_ptr<DNSPacket>& r, const DNSName& target)
+{
+  if (target == d_sd.qname() || !denialCacheApplies()) {
+    return false;
+  }
+
+  vector<DNSZoneRecord> nsecs;
+  if (!DC.get(d_sd.zonename, d_sd.domain_id, d_sd.serial, target, d_dnssec, nsecs)) {
+    return false;
+  }
+
+  DNSZoneRecord rr;
+  rr=makeEditedDNSZRFromSOAData(d_dk, d_sd, DNSResourceRecord::AUTHORITY, d_slog);
+  rr.dr.d_ttl=d_sd.getNegativeTTL();
+  r->addRecord(std::move(rr));
+
+  for (auto& nsec : nsecs) {
+    r->addRecord(std::move(nsec));
+  }
+
+  r->setRcode(RCode::NXDomain);
+  return true;
+}
+
+// Called after makeNXDomain() for a name that had no wildcard, 'wildcard' then holds the next closer name
+void PacketHandler::cacheDenial(std::unique_ptr<DNSPacket>& r, const DNSName& target, const DNSName& wildcard)
+{
+  if (!denialCacheApplies()) {
+    return;
+  }
+
+  DNSName closest(wildcard);
+  closest.chopOff();
+
+  DNSName before, after;
+  vector<DNSZoneRecord> nsecs;
+  if (d_dnssec) {
+    // reuse what addNSEC() just looked up, the first NSEC covers the name itself
+    for (const auto& rec : r->getRRS()) {
+      if (rec.dr.d_type != QType::NSEC || rec.dr.d_place != DNSResourceRecord::AUTHORITY) {
+        continue;
+      }
+      if (nsecs.empty()) {
+        before = rec.dr.d_name;
+        after = getRR<NSECRecordContent>(rec.dr)->d_next;
+      }
+      nsecs.push_back(rec);
+    }
+  }
+  else {
+    d_sd.db->getBeforeAndAfterNames(d_sd.domain_id, d_sd.zonename, target, before, after);
+  }
+
+  if (before.empty() || after.empty()) {
+    return;
+  }
+
+  // only trust chains that agree with the walk we just did, an unrectified zone may not
+  if (AuthDenialCache::getClosestEncloser(target, before, after) != closest) {
+    return;
+  }
+
+  DC.insert(d_sd.zonename, d_sd.domain_id, d_sd.serial, before, after, closest, std::move(nsecs));
+}
+
 void PacketHandler::makeNOError(DNSPacket& p, std::unique_ptr<DNSPacket>& r, const DNSName& target, const DNSName& wildcard, int mode)
 {
   DNSZoneRecord rr;
@@ -1384,7 +1455,7 @@ bool PacketHandler::tryAuthSignal(DNSPacket& p, std::unique_ptr<DNSPacket>& r, D
     return false;
   }
   bool narrow{false};
-  if (!d_dk.getNSEC3PARAM(d_sd.zonename, nullptr, &narrow) || !narrow) {
+  if (!getNSEC3PARAM(nullptr, &narrow) || !narrow) {
     SLOG(g_log << Logger::Warning << "Signaling zone '" << d_sd.zonename << "' must use NSEC3 narrow; synthesis disabled (" << target << "/" << p.qtype << ")" << " from " << p.getRemoteString() << ")" << endl,
          d_slog->info(Logr::Warning, "Signaling zone must use NSEC3 narrow; synthesis disabled", "zone", Logging::Loggable(d_sd.zonename), "target", Logging::Loggable(p.qtype), "from", Logging::Loggable(p.getRemoteString())));
     return false;
@@ -1789,6 +1860,7 @@ bool PacketHandler::opcodeQueryInner2(DNSPacket& pkt, queryState &state, bool re
   // Reset possibly dangling data associated to d_sd.
   d_ispresigned.reset();
   d_issecuredzone.reset();
+  d_nsec3state.reset();
 
   if(!B.getAuth(ZoneName(state.target), pkt.qtype, &d_sd, pkt.getRealRemote(), true, &pkt)) {
     DLOG(SLOG(g_log<<Logger::Error<<"We have no authority over zone '"<<state.target<<"'"<<endl,
@@ -1847,7 +1919,7 @@ bool PacketHandler::opcodeQueryInner2(DNSPacket& pkt, queryState &state, bool re
   }
 
   // this TRUMPS a cname!
-  if(d_dnssec && pkt.qtype.getCode() == QType::NSEC && !d_dk.getNSEC3PARAM(d_sd.zonename, nullptr)) {
+  if(d_dnssec && pkt.qtype.getCode() == QType::NSEC && !getNSEC3PARAM()) {
     addNSEC(pkt, state.r, state.target, DNSName(), 5);
     if (!state.r->isEmpty()) {
       return true;
@@ -1862,6 +1934,10 @@ bool PacketHandler::opcodeQueryInner2(DNSPacket& pkt, queryState &state, bool re
     return true;
   }
 
+  if (!retargeted && tryDenialCache(state.r, state.target)) {
+    return true;
+  }
+
   DLOG(SLOG(g_log<<"Checking for referrals first, unless this is a DS query"<<endl,
             d_slog->info(Logr::Debug, "Checking for referrals first, unless this is a DS query")));
   if(pkt.qtype.getCode() != QType::DS && tryReferral(pkt, state.r, state.target, retargeted)) {
@@ -2065,6 +2141,9 @@ bool PacketHandler::opcodeQueryInner2(DNSPacket& pkt, queryState &state, bool re
 
     if (!(((pkt.qtype.getCode() == QType::CNAME) || (pkt.qtype.getCode() == QType::ANY)) && retargeted)) {
       makeNXDomain(pkt, state.r, state.target, wildcard);
+      if (!retargeted) {
+        cacheDenial(state.r, state.target, wildcard);
+      }
     }
 
     return true;
@@ -2281,3 +2360,19 @@ bool PacketHandler::isSecuredZone()
   }
   return *d_issecuredzone;
 }
+
+bool PacketHandler::getNSEC3PARAM(NSEC3PARAMRecordContent* ns3rc, bool* narrow)
+{
+  if (!d_nsec3state) {
+    NSEC3State state;
+    state.haveNSEC3 = d_dk.getNSEC3PARAM(d_sd.zonename, &state.ns3rc, &state.narrow);
+    d_nsec3state = std::move(state);
+  }
+  if (ns3rc != nullptr) {
+    *ns3rc = d_nsec3state->ns3rc;
+  }
+  if (narrow != nullptr) {
+    *narrow = d_nsec3state->narrow;
+  }
+  return d_nsec3state->haveNSEC3;
+}
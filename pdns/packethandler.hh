@@ -101,6 +101,9 @@ private:
 
   void makeNXDomain(DNSPacket& p, std::unique_ptr<DNSPacket>& r, const DNSName& target, const DNSName& wildcard);
   void makeNOError(DNSPacket& p, std::unique_ptr<DNSPacket>& r, const DNSName& target, const DNSName& wildcard, int mode);
+  bool denialCacheApplies();
+  bool tryDenialCache(std::unique_ptr<DNSPacket>& r, const DNSName& target);
+  void cacheDenial(std::unique_ptr<DNSPacket>& r, const DNSName& target, const DNSName& wildcard);
   vector<DNSZoneRecord> getBestReferralNS(DNSPacket& p, const DNSName &target);
   void getBestDNAMESynth(DNSPacket& p, DNSName &target, vector<DNSZoneRecord> &ret);
   bool tryAuthSignal(DNSPacket& p, std::unique_ptr<DNSPacket>& r, DNSName &target);
@@ -137,9 +140,17 @@ private:
   // Wrapper around d_dk.isSecuredZone(d_sd.zonename), caching its result
   bool isSecuredZone();
   std::optional<bool> d_issecuredzone;
+  // Wrapper around d_dk.getNSEC3PARAM(d_sd.zonename), caching its result
+  bool getNSEC3PARAM(NSEC3PARAMRecordContent* ns3rc = nullptr, bool* narrow = nullptr);
+  struct NSEC3State
+  {
+    bool haveNSEC3{false};
+    NSEC3PARAMRecordContent ns3rc;
+    bool narrow{false};
+  };
+  std::optional<NSEC3State> d_nsec3state;
 
   static AtomicCounter s_count;
-  static std::mutex s_rfc2136lock;
   bool d_logDNSDetails;
   bool d_doDNAME;
   bool d_doExpandALIAS;
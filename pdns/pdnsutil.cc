@@ -6,6 +6,7 @@
 #include <iomanip>
 #include <string>
 #include <termios.h>            //termios, TCSANOW, ECHO, ICANON
+#include <thread>
 #include <utility>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -19,6 +20,7 @@
 #include "arguments.hh"
 #include "auth-packetcache.hh"
 #include "auth-querycache.hh"
+#include "auth-denialcache.hh"
 #include "auth-zonecache.hh"
 #include "base32.hh"
 #include "base64.hh"
@@ -55,6 +57,7 @@
 StatBag S;
 AuthPacketCache PC;
 AuthQueryCache QC;
+AuthDenialCache DC;
 AuthZoneCache g_zoneCache;
 uint16_t g_maxNSEC3Iterations{0};
 std::string g_memberCatalogGroup;
@@ -2700,6 +2703,7 @@ static int loadZone(const ZoneName& zone, const string& fname) {
   ZoneParserTNG zpt(fname, zone, "", ::arg().mustDo("upgrade-unknown-types"));
   zpt.setDefaultTTL(::arg().asNum("default-ttl"));
   zpt.setMaxGenerateSteps(::arg().asNum("max-generate-steps"));
+  zpt.setParallel(std::thread::hardware_concurrency());
 
   DNSResourceRecord rr;
   if(!db->startTransaction(zone, di.id)) {
@@ -0,0 +1,121 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "dnsparser.hh"
+#include "dnsrecords.hh"
+#include "dnswriter.hh"
+
+// a typical answer from an authoritative server: CNAME chain, NS set with glue and EDNS
+static std::vector<uint8_t> makeResponse()
+{
+  const DNSName qname("www.powerdns.com.");
+  const DNSName target("www.example.powerdns.com.");
+  const DNSName zone("powerdns.com.");
+
+  std::vector<uint8_t> packet;
+  DNSPacketWriter writer(packet, qname, QType::A);
+  writer.getHeader()->qr = 1;
+  writer.getHeader()->aa = 1;
+
+  writer.startRecord(qname, QType::CNAME, 3600, QClass::IN, DNSResourceRecord::ANSWER);
+  CNAMERecordContent(target).toPacket(writer);
+  for (unsigned int idx = 1; idx <= 4; idx++) {
+    writer.startRecord(target, QType::A, 300, QClass::IN, DNSResourceRecord::ANSWER);
+    ARecordContent(ComboAddress("192.0.2." + std::to_string(idx))).toPacket(writer);
+  }
+  for (unsigned int idx = 1; idx <= 4; idx++) {
+    writer.startRecord(zone, QType::NS, 86400, QClass::IN, DNSResourceRecord::AUTHORITY);
+    NSRecordContent(DNSName("ns" + std::to_string(idx) + ".powerdns.com.")).toPacket(writer);
+  }
+  for (unsigned int idx = 1; idx <= 4; idx++) {
+    const DNSName nsName("ns" + std::to_string(idx) + ".powerdns.com.");
+    writer.startRecord(nsName, QType::A, 86400, QClass::IN, DNSResourceRecord::ADDITIONAL);
+    ARecordContent(ComboAddress("198.51.100." + std::to_string(idx))).toPacket(writer);
+    writer.startRecord(nsName, QType::AAAA, 86400, QClass::IN, DNSResourceRecord::ADDITIONAL);
+    AAAARecordContent(ComboAddress("2001:db8::" + std::to_string(idx))).toPacket(writer);
+  }
+  writer.addOpt(1232, 0, 0);
+  writer.commit();
+  return packet;
+}
+
+TEST_CASE("DNSParser/Response")
+{
+  const auto packet = makeResponse();
+  const std::string_view wire(reinterpret_cast<const char*>(packet.data()), packet.size()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+  const DNSName qname("www.powerdns.com.");
+
+  BENCHMARK("MOADNSParser")
+  {
+    MOADNSParser parser(false, wire.data(), wire.size());
+    return parser.d_answers.size();
+  };
+
+  BENCHMARK("DNSPacketView/iterate")
+  {
+    DNSPacketView view(wire);
+    uint32_t minTTL = std::numeric_limits<uint32_t>::max();
+    for (const auto& record : view) {
+      minTTL = std::min(minTTL, record.d_ttl);
+    }
+    return minTTL;
+  };
+
+  BENCHMARK("DNSPacketView/qname-and-edns")
+  {
+    DNSPacketView view(wire);
+    EDNSOpts edns;
+    return view.d_qname == qname && getEDNSOpts(view, &edns);
+  };
+
+  // what lwres.cc does for every response: parse, check the qname then materialize all records and the EDNS options
+  BENCHMARK("MOADNSParser/lwres")
+  {
+    MOADNSParser parser(false, wire.data(), wire.size());
+    if (parser.d_qname != qname) {
+      return size_t{0};
+    }
+    std::vector<DNSRecord> records;
+    records.reserve(parser.d_answers.size());
+    for (const auto& answer : parser.d_answers) {
+      records.push_back(answer);
+    }
+    EDNSOpts edns;
+    getEDNSOpts(parser, &edns);
+    return records.size();
+  };
+
+  BENCHMARK("DNSPacketView/lwres")
+  {
+    DNSPacketView view(wire);
+    if (view.d_qname != qname) {
+      return size_t{0};
+    }
+    auto records = view.getRecords();
+    EDNSOpts edns;
+    getEDNSOpts(view, &edns);
+    return records.size();
+  };
+}
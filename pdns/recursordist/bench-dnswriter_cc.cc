@@ -0,0 +1 @@
+../bench-dnswriter_cc.cc
\ No newline at end of file
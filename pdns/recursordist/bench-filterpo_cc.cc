@@ -0,0 +1,103 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "filterpo.hh"
+
+static std::vector<DNSName> makeNames(const std::string& prefix, const std::string& suffix, size_t count)
+{
+  std::vector<DNSName> names;
+  names.reserve(count);
+  for (size_t idx = 0; idx < count; idx++) {
+    names.emplace_back(prefix + std::to_string(idx) + suffix);
+  }
+  return names;
+}
+
+// Four RPZ feeds of 100k exact and 10k wildcard QName triggers plus 10k client IP triggers each,
+// the typical case being a query that matches none of them
+TEST_CASE("DNSFilterEngine/Lookups")
+{
+  constexpr size_t zonesCount = 4;
+  constexpr size_t namesPerZone = 100000;
+  constexpr size_t wildcardsPerZone = 10000;
+  constexpr size_t netmasksPerZone = 10000;
+
+  DNSFilterEngine dfe;
+  for (size_t zoneIdx = 0; zoneIdx < zonesCount; zoneIdx++) {
+    auto zone = std::make_shared<DNSFilterEngine::Zone>();
+    zone->setName("feed" + std::to_string(zoneIdx));
+    zone->setDomain(DNSName("feed" + std::to_string(zoneIdx) + ".rpz."));
+    for (const auto& name : makeNames("blocked", ".zone" + std::to_string(zoneIdx) + ".example.", namesPerZone)) {
+      zone->addQNameTrigger(name, DNSFilterEngine::Policy(DNSFilterEngine::PolicyKind::NXDOMAIN, DNSFilterEngine::PolicyType::QName));
+    }
+    for (const auto& name : makeNames("*.wildcard", ".zone" + std::to_string(zoneIdx) + ".example.", wildcardsPerZone)) {
+      zone->addQNameTrigger(name, DNSFilterEngine::Policy(DNSFilterEngine::PolicyKind::NXDOMAIN, DNSFilterEngine::PolicyType::QName));
+    }
+    for (size_t idx = 0; idx < netmasksPerZone; idx++) {
+      const Netmask netmask(ComboAddress("10." + std::to_string(zoneIdx) + "." + std::to_string(idx / 256 % 256) + "." + std::to_string(idx % 256)), 32);
+      zone->addClientTrigger(netmask, DNSFilterEngine::Policy(DNSFilterEngine::PolicyKind::Drop, DNSFilterEngine::PolicyType::ClientIP));
+    }
+    dfe.addZone(zone);
+  }
+  REQUIRE(dfe.size() == zonesCount);
+
+  const auto allowed = makeNames("www.host", ".powerdns.com.", 100000);
+  const auto blocked = makeNames("blocked", ".zone3.example.", namesPerZone);
+  const auto wildcarded = makeNames("a.b.wildcard", ".zone3.example.", wildcardsPerZone);
+  const std::unordered_map<std::string, bool> discardedPolicies;
+  const ComboAddress allowedClient("192.0.2.1");
+  const ComboAddress blockedClient("10.3.0.1");
+  size_t idx = 0;
+
+  BENCHMARK("query-miss")
+  {
+    DNSFilterEngine::Policy policy;
+    return dfe.getQueryPolicy(allowed[idx++ % allowed.size()], discardedPolicies, policy);
+  };
+
+  BENCHMARK("query-hit-exact")
+  {
+    DNSFilterEngine::Policy policy;
+    return dfe.getQueryPolicy(blocked[idx++ % blocked.size()], discardedPolicies, policy);
+  };
+
+  BENCHMARK("query-hit-wildcard")
+  {
+    DNSFilterEngine::Policy policy;
+    return dfe.getQueryPolicy(wildcarded[idx++ % wildcarded.size()], discardedPolicies, policy);
+  };
+
+  BENCHMARK("client-miss")
+  {
+    DNSFilterEngine::Policy policy;
+    return dfe.getClientPolicy(allowedClient, discardedPolicies, policy);
+  };
+
+  BENCHMARK("client-hit")
+  {
+    DNSFilterEngine::Policy policy;
+    return dfe.getClientPolicy(blockedClient, discardedPolicies, policy);
+  };
+}
@@ -0,0 +1 @@
+../bench-iputils_cc.cc
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "negcache.hh"
+#include "dnsrecords.hh"
+
+static recordsAndSignatures makeRecordsAndSignatures(const DNSName& name, uint16_t qtype, const std::string& content)
+{
+  recordsAndSignatures ret;
+
+  DNSRecord record;
+  record.d_name = name;
+  record.d_type = qtype;
+  record.d_ttl = 600;
+  record.d_place = DNSResourceRecord::AUTHORITY;
+  record.setContent(DNSRecordContent::make(qtype, QClass::IN, content));
+  ret.records.push_back(record);
+
+  record.d_type = QType::RRSIG;
+  record.setContent(std::make_shared<RRSIGRecordContent>(QType(qtype).toString() + " 13 2 600 20370101000000 20250101000000 24567 " + name.toStringNoDot() + ". c2lnbmF0dXJlc2lnbmF0dXJlc2lnbmF0dXJlc2lnbmF0dXJlc2lnbmF0dXJlc2lnbmF0dXJl"));
+  ret.signatures.push_back(record);
+
+  return ret;
+}
+
+static NegCache::NegCacheEntry makeEntry(const DNSName& name, const DNSName& auth, time_t now, uint16_t qtype)
+{
+  NegCache::NegCacheEntry entry;
+  entry.d_name = name;
+  entry.d_qtype = QType(qtype);
+  entry.d_auth = auth;
+  entry.d_ttd = now + 3600;
+  entry.d_orig_ttl = 3600;
+  entry.authoritySOA = makeRecordsAndSignatures(auth, QType::SOA, "ns1.powerdns.com. hostmaster.powerdns.com. 1 2 3 4 5");
+  entry.DNSSECRecords = makeRecordsAndSignatures(name, QType::NSEC, "\\000." + name.toString() + " A RRSIG NSEC");
+  return entry;
+}
+
+static std::vector<DNSName> makeNames(const std::string& prefix, size_t count)
+{
+  std::vector<DNSName> names;
+  names.reserve(count);
+  for (size_t idx = 0; idx < count; idx++) {
+    names.emplace_back(prefix + std::to_string(idx) + ".powerdns.com.");
+  }
+  return names;
+}
+
+// 100k NXDOMAIN and 100k NODATA entries under a single zone, as left behind by a random subdomain attack
+TEST_CASE("NegCache/Get")
+{
+  const DNSName auth("powerdns.com.");
+  const time_t now = time(nullptr);
+  const struct timeval tnow{now, 0};
+  const auto nxNames = makeNames("nx", 100000);
+  const auto noDataNames = makeNames("nodata", 100000);
+  const auto unknownNames = makeNames("unknown", 100000);
+
+  NegCache cache;
+  for (const auto& name : nxNames) {
+    cache.add(makeEntry(name, auth, now, QType::ENT));
+  }
+  for (const auto& name : noDataNames) {
+    cache.add(makeEntry(name, auth, now, QType::AAAA));
+  }
+  REQUIRE(cache.size() == nxNames.size() + noDataNames.size());
+
+  size_t idx = 0;
+  NegCache::NegCacheEntry found;
+
+  BENCHMARK("nxdomain-hit")
+  {
+    return cache.get(nxNames[idx++ % nxNames.size()], QType(QType::A), tnow, found);
+  };
+
+  BENCHMARK("nodata-hit")
+  {
+    return cache.get(noDataNames[idx++ % noDataNames.size()], QType(QType::AAAA), tnow, found, true);
+  };
+
+  BENCHMARK("miss")
+  {
+    return cache.get(unknownNames[idx++ % unknownNames.size()], QType(QType::A), tnow, found);
+  };
+}
+
+TEST_CASE("NegCache/Add")
+{
+  const DNSName auth("powerdns.com.");
+  const time_t now = time(nullptr);
+  std::vector<NegCache::NegCacheEntry> entries;
+  for (const auto& name : makeNames("nx", 10000)) {
+    entries.push_back(makeEntry(name, auth, now, QType::ENT));
+  }
+
+  BENCHMARK("10000-entries")
+  {
+    NegCache cache;
+    for (const auto& entry : entries) {
+      cache.add(entry);
+    }
+    return cache.size();
+  };
+}
@@ -0,0 +1,139 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "recpacketcache.hh"
+#include "dnsrecords.hh"
+#include "dnswriter.hh"
+
+struct CachedQuery
+{
+  DNSName qname;
+  std::string query;
+  std::string response;
+};
+
+static std::vector<CachedQuery> makeQueries(const std::string& prefix, size_t count)
+{
+  std::vector<CachedQuery> queries;
+  queries.reserve(count);
+
+  for (size_t idx = 0; idx < count; idx++) {
+    CachedQuery entry;
+    entry.qname = DNSName(prefix + std::to_string(idx) + ".powerdns.com.");
+
+    std::vector<uint8_t> packet;
+    DNSPacketWriter queryWriter(packet, entry.qname, QType::A);
+    queryWriter.getHeader()->rd = 1;
+    queryWriter.getHeader()->id = static_cast<uint16_t>(idx);
+    queryWriter.addOpt(1232, 0, 0);
+    queryWriter.commit();
+    entry.query.assign(packet.begin(), packet.end());
+
+    packet.clear();
+    DNSPacketWriter responseWriter(packet, entry.qname, QType::A);
+    responseWriter.getHeader()->rd = 1;
+    responseWriter.getHeader()->ra = 1;
+    responseWriter.getHeader()->qr = 1;
+    responseWriter.getHeader()->id = static_cast<uint16_t>(idx);
+    responseWriter.startRecord(entry.qname, QType::A, 3600);
+    ARecordContent(ComboAddress("192.0.2." + std::to_string(idx % 256))).toPacket(responseWriter);
+    responseWriter.addOpt(1232, 0, 0);
+    responseWriter.commit();
+    entry.response.assign(packet.begin(), packet.end());
+
+    queries.push_back(std::move(entry));
+  }
+  return queries;
+}
+
+// 100k cached answers, looked up with queries that only differ from the cached ones by their ID
+TEST_CASE("RecursorPacketCache/Get")
+{
+  const time_t now = time(nullptr);
+  const auto queries = makeQueries("host", 100000);
+  const auto unknown = makeQueries("unknown", 100000);
+
+  RecursorPacketCache cache(queries.size() * 2);
+  for (const auto& entry : queries) {
+    uint32_t qhash = 0;
+    std::string response;
+    uint32_t age = 0;
+    cache.getResponsePacket(0, entry.query, entry.qname, QType::A, QClass::IN, now, &response, &age, &qhash);
+    cache.insertResponsePacket(0, qhash, std::string(entry.query), entry.qname, QType::A, QClass::IN, std::string(entry.response), now, 3600, vState::Indeterminate, std::nullopt, false);
+  }
+  REQUIRE(cache.size() == queries.size());
+
+  size_t idx = 0;
+  std::string response;
+  uint32_t age = 0;
+  uint32_t qhash = 0;
+
+  BENCHMARK("hit")
+  {
+    const auto& entry = queries[idx++ % queries.size()];
+    return cache.getResponsePacket(0, entry.query, now, &response, &age, &qhash);
+  };
+
+  BENCHMARK("hit-known-qname")
+  {
+    const auto& entry = queries[idx++ % queries.size()];
+    return cache.getResponsePacket(0, entry.query, entry.qname, QType::A, QClass::IN, now, &response, &age, &qhash);
+  };
+
+  BENCHMARK("miss")
+  {
+    const auto& entry = unknown[idx++ % unknown.size()];
+    return cache.getResponsePacket(0, entry.query, now, &response, &age, &qhash);
+  };
+}
+
+TEST_CASE("RecursorPacketCache/Insert")
+{
+  const time_t now = time(nullptr);
+  const auto queries = makeQueries("host", 10000);
+  std::vector<uint32_t> hashes;
+  hashes.reserve(queries.size());
+  {
+    // the hash is computed by the (missed) lookup preceding each insert, which we do not want to measure here
+    RecursorPacketCache cache(1);
+    for (const auto& entry : queries) {
+      uint32_t qhash = 0;
+      std::string response;
+      uint32_t age = 0;
+      cache.getResponsePacket(0, entry.query, entry.qname, QType::A, QClass::IN, now, &response, &age, &qhash);
+      hashes.push_back(qhash);
+    }
+  }
+
+  BENCHMARK("10000-entries")
+  {
+    RecursorPacketCache cache(queries.size());
+    for (size_t idx = 0; idx < queries.size(); idx++) {
+      const auto& entry = queries[idx];
+      cache.insertResponsePacket(0, hashes[idx], std::string(entry.query), entry.qname, QType::A, QClass::IN, std::string(entry.response), now, 3600, vState::Indeterminate, std::nullopt, false);
+    }
+    return cache.size();
+  };
+}
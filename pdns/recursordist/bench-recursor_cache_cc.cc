@@ -0,0 +1,189 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "recursor_cache.hh"
+
+static void fillCache(MemRecursorCache& cache, time_t now, const std::vector<DNSName>& names)
+{
+  const MemRecursorCache::SigRecsVec signatures;
+  const MemRecursorCache::AuthRecsVec authRecords;
+  const DNSName authZone(".");
+  uint32_t counter = 0;
+
+  for (const auto& name : names) {
+    DNSRecord record;
+    record.d_name = name;
+    record.d_type = QType::A;
+    record.d_class = QClass::IN;
+    record.d_ttl = static_cast<uint32_t>(now + 3600);
+    record.d_place = DNSResourceRecord::ANSWER;
+    record.setContent(std::make_shared<ARecordContent>(htonl(0xc0000200U + counter++)));
+    cache.replace(now, name, QType(QType::A), {record}, signatures, authRecords, true, authZone, std::nullopt);
+  }
+}
+
+static std::vector<DNSName> makeNames(size_t count)
+{
+  std::vector<DNSName> names;
+  names.reserve(count);
+  for (size_t idx = 0; idx < count; idx++) {
+    names.emplace_back("host" + std::to_string(idx) + ".powerdns.com.");
+  }
+  return names;
+}
+
+// A small set of very popular names all landing in a handful of shards, queried from many threads at once
+TEST_CASE("RecursorCache/HotNames")
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache cache;
+  const time_t now = time(nullptr);
+  const auto names = makeNames(16);
+  fillCache(cache, now, names);
+  const ComboAddress who("192.0.2.1");
+
+  const size_t iterations = 200000U;
+  auto testCode = [&](size_t iterationsPerThread) {
+    std::vector<DNSRecord> result;
+    for (size_t idx = 0U; idx < iterationsPerThread; idx++) {
+      if (cache.get(now, names.at(idx % names.size()), QType(QType::A), MemRecursorCache::None, &result, who) <= 0) {
+        FAIL("unexpected cache miss");
+      }
+    }
+  };
+
+  for (size_t threadsCount : std::vector<size_t>{1, 4, 8, 16}) {
+    std::vector<std::thread> threads;
+    threads.reserve(threadsCount);
+
+    BENCHMARK(std::to_string(threadsCount))
+    {
+      threads.clear();
+      for (size_t idx = 0U; idx < threadsCount; idx++) {
+        threads.emplace_back(testCode, iterations / threadsCount);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      return threads.size();
+    };
+  }
+
+  auto [contended, acquired] = cache.stats();
+  CHECK(acquired >= contended);
+}
+
+// The same hot names, while another thread keeps inserting unrelated entries and pruning the cache
+TEST_CASE("RecursorCache/HotNamesWithWriter")
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache cache;
+  const time_t now = time(nullptr);
+  const auto names = makeNames(16);
+  fillCache(cache, now, names);
+  const auto coldNames = makeNames(20000);
+  const ComboAddress who("192.0.2.1");
+
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    size_t offset = 0;
+    while (!done) {
+      std::vector<DNSName> batch(coldNames.begin() + static_cast<ssize_t>(offset), coldNames.begin() + static_cast<ssize_t>(offset + 100));
+      fillCache(cache, now, batch);
+      offset = (offset + 100) % (coldNames.size() - 100);
+      cache.doPrune(now, 10000);
+    }
+  });
+
+  const size_t iterations = 200000U;
+  auto testCode = [&](size_t iterationsPerThread) {
+    std::vector<DNSRecord> result;
+    for (size_t idx = 0U; idx < iterationsPerThread; idx++) {
+      cache.get(now, names.at(idx % names.size()), QType(QType::A), MemRecursorCache::None, &result, who);
+    }
+  };
+
+  for (size_t threadsCount : std::vector<size_t>{1, 4, 8, 16}) {
+    std::vector<std::thread> threads;
+    threads.reserve(threadsCount);
+
+    BENCHMARK(std::to_string(threadsCount))
+    {
+      threads.clear();
+      for (size_t idx = 0U; idx < threadsCount; idx++) {
+        threads.emplace_back(testCode, iterations / threadsCount);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      return threads.size();
+    };
+  }
+
+  done = true;
+  writer.join();
+}
+
+// Delegations to a limited set of hosting providers: the NS contents are shared between entries
+TEST_CASE("RecursorCache/BytesPerEntry")
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache cache;
+  const time_t now = time(nullptr);
+  const MemRecursorCache::SigRecsVec signatures;
+  const MemRecursorCache::AuthRecsVec authRecords;
+  const DNSName authZone("com.");
+  const size_t domains = 100000U;
+  const size_t hosters = 500U;
+
+  BENCHMARK("insert")
+  {
+    for (size_t idx = 0; idx < domains; idx++) {
+      const DNSName name("domain" + std::to_string(idx) + ".com.");
+      std::vector<DNSRecord> records;
+      for (const auto* nameserver : {"ns1.", "ns2."}) {
+        DNSRecord record;
+        record.d_name = name;
+        record.d_type = QType::NS;
+        record.d_class = QClass::IN;
+        record.d_ttl = static_cast<uint32_t>(now + 3600);
+        record.d_place = DNSResourceRecord::AUTHORITY;
+        // each record is parsed from its own packet in real life, so they never share content up front
+        record.setContent(std::make_shared<NSRecordContent>(DNSName(std::string(nameserver) + "hoster" + std::to_string(idx % hosters) + ".net.")));
+        records.push_back(std::move(record));
+      }
+      cache.replace(now, name, QType(QType::NS), records, signatures, authRecords, false, authZone, std::nullopt);
+    }
+    return cache.size();
+  };
+
+  REQUIRE(cache.size() == domains);
+  std::cerr << "bytes per entry: " << cache.bytes() / cache.size() << ", shared contents: " << cache.sharedContentsCount() << std::endl;
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "aggressive_nsec.hh"
+#include "negcache.hh"
+#include "rec-lua-conf.hh"
+#include "recursor_cache.hh"
+#include "syncres.hh"
+#include "validate-recursor.hh"
+
+// The subset of initSR() from test-syncres_cc.cc that matters for cache-only resolution
+static void initSyncRes()
+{
+  MemRecursorCache::resetStaticsForTests();
+  NegCache::s_maxServedStaleExtensions = 0;
+  g_recCache = std::make_unique<MemRecursorCache>();
+  g_negCache = std::make_unique<NegCache>();
+  g_aggressiveNSECCache.reset();
+  g_dnssecmode = DNSSECMode::Off;
+
+  SyncRes::s_maxqperq = 50;
+  SyncRes::s_maxnsaddressqperq = 10;
+  SyncRes::s_maxbytesperq = 100000;
+  SyncRes::s_maxtotusec = 1000 * 7000;
+  SyncRes::s_maxdepth = 40;
+  SyncRes::s_maxnegttl = 3600;
+  SyncRes::s_maxbogusttl = 3600;
+  SyncRes::s_maxcachettl = 86400;
+  SyncRes::s_doIPv4 = true;
+  SyncRes::s_doIPv6 = true;
+  SyncRes::s_rootNXTrust = true;
+  SyncRes::s_hardenNXD = SyncRes::HardenNXD::DNSSEC;
+  SyncRes::s_minimumTTL = 0;
+  SyncRes::s_serverID = "PowerDNS Benchmark Server ID";
+  SyncRes::s_qnameminimization = false;
+  SyncRes::s_refresh_ttlperc = 0;
+  SyncRes::s_locked_ttlperc = 0;
+  SyncRes::s_max_CNAMES_followed = 10;
+  SyncRes::clearEDNSLocalSubnets();
+  SyncRes::clearEDNSRemoteSubnets();
+  SyncRes::clearEDNSDomains();
+  SyncRes::clearDontQuery();
+  SyncRes::setDomainMap(std::make_shared<SyncRes::domainmap_t>());
+
+  auto luaconfsCopy = g_luaconfs.getCopy();
+  luaconfsCopy.dfe.clear();
+  luaconfsCopy.dsAnchors.clear();
+  luaconfsCopy.negAnchors.clear();
+  g_luaconfs.setState(luaconfsCopy);
+}
+
+static void addToCache(time_t now, const DNSName& name, uint16_t qtype, const std::shared_ptr<const DNSRecordContent>& content)
+{
+  DNSRecord record;
+  record.d_name = name;
+  record.d_type = qtype;
+  record.d_class = QClass::IN;
+  record.d_ttl = static_cast<uint32_t>(now + 3600);
+  record.d_place = DNSResourceRecord::ANSWER;
+  record.setContent(content);
+  g_recCache->replace(now, name, QType(qtype), {record}, {}, {}, true, DNSName("powerdns.com."), std::nullopt);
+}
+
+// 10k names with an A record, 10k CNAMEs pointing to them and 10k NXDOMAINs, all answered from the caches
+TEST_CASE("SyncRes/CacheOnly")
+{
+  initSyncRes();
+
+  constexpr size_t namesCount = 10000;
+  struct timeval now{};
+  Utility::gettimeofday(&now, nullptr);
+
+  std::vector<DNSName> names;
+  std::vector<DNSName> aliases;
+  std::vector<DNSName> nonExistent;
+  const DNSName auth("powerdns.com.");
+  for (size_t idx = 0; idx < namesCount; idx++) {
+    names.emplace_back("host" + std::to_string(idx) + ".powerdns.com.");
+    aliases.emplace_back("alias" + std::to_string(idx) + ".powerdns.com.");
+    nonExistent.emplace_back("nx" + std::to_string(idx) + ".powerdns.com.");
+
+    addToCache(now.tv_sec, names.back(), QType::A, std::make_shared<ARecordContent>(htonl(0xc0000200U + (idx % 256))));
+    addToCache(now.tv_sec, aliases.back(), QType::CNAME, std::make_shared<CNAMERecordContent>(names.back()));
+
+    NegCache::NegCacheEntry negEntry;
+    negEntry.d_name = nonExistent.back();
+    negEntry.d_qtype = QType::ENT;
+    negEntry.d_auth = auth;
+    negEntry.d_ttd = now.tv_sec + 3600;
+    negEntry.d_orig_ttl = 3600;
+    DNSRecord soa;
+    soa.d_name = auth;
+    soa.d_type = QType::SOA;
+    soa.d_ttl = 3600;
+    soa.d_place = DNSResourceRecord::AUTHORITY;
+    soa.setContent(DNSRecordContent::make(QType::SOA, QClass::IN, "ns1.powerdns.com. hostmaster.powerdns.com. 1 2 3 4 5"));
+    negEntry.authoritySOA.records.push_back(std::move(soa));
+    g_negCache->add(negEntry);
+  }
+
+  auto resolve = [&now](const DNSName& qname, std::vector<DNSRecord>& ret) {
+    SyncRes resolver(now);
+    resolver.setCacheOnly();
+    resolver.setLogMode(SyncRes::LogNone);
+    ret.clear();
+    return resolver.beginResolve(qname, QType(QType::A), QClass::IN, ret);
+  };
+
+  {
+    std::vector<DNSRecord> ret;
+    REQUIRE(resolve(names.at(0), ret) == RCode::NoError);
+    REQUIRE(ret.size() == 1);
+    REQUIRE(resolve(aliases.at(0), ret) == RCode::NoError);
+    REQUIRE(ret.size() == 2);
+    REQUIRE(resolve(nonExistent.at(0), ret) == RCode::NXDomain);
+  }
+
+  size_t idx = 0;
+  std::vector<DNSRecord> ret;
+
+  BENCHMARK("answer")
+  {
+    return resolve(names[idx++ % names.size()], ret);
+  };
+
+  BENCHMARK("cname")
+  {
+    return resolve(aliases[idx++ % aliases.size()], ret);
+  };
+
+  BENCHMARK("nxdomain")
+  {
+    return resolve(nonExistent[idx++ % nonExistent.size()], ret);
+  };
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_NO_MAIN
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "dnssec.hh"
+#include "dnssecinfra.hh"
+#include "logging.hh"
+#include "validate.hh"
+
+struct SignedRRSet
+{
+  sortedRecords_t records;
+  std::vector<std::shared_ptr<const RRSIGRecordContent>> signatures;
+  skeyset_t keys;
+};
+
+// Two A records signed by a single key of the requested algorithm, valid for the next day
+static SignedRRSet makeSignedRRSet(const DNSName& name, unsigned int algorithm, time_t now)
+{
+  auto log = g_slog->withName("benchmark");
+  auto engine = DNSCryptoKeyEngine::make(log, algorithm);
+  engine->create(algorithm <= 10 ? 2048 : engine->getBits());
+  DNSSECPrivateKey key;
+  key.setKey(std::move(engine), 256);
+
+  SignedRRSet ret;
+  ret.records.insert(DNSRecordContent::make(QType::A, QClass::IN, "192.0.2.1"));
+  ret.records.insert(DNSRecordContent::make(QType::A, QClass::IN, "192.0.2.2"));
+
+  const auto dnskey = key.getDNSKEY();
+  RRSIGRecordContent rrsig;
+  rrsig.d_type = QType::A;
+  rrsig.d_labels = name.countLabels();
+  rrsig.d_originalttl = 3600;
+  rrsig.d_siginception = now - 3600;
+  rrsig.d_sigexpire = now + 86400;
+  rrsig.d_signer = name;
+  rrsig.d_tag = dnskey.getTag();
+  rrsig.d_algorithm = dnskey.d_algorithm;
+  rrsig.d_signature = key.getKey()->sign(getMessageForRRSET(name, rrsig, ret.records));
+
+  ret.signatures.push_back(std::make_shared<RRSIGRecordContent>(std::move(rrsig)));
+  ret.keys.insert(std::make_shared<DNSKEYRecordContent>(dnskey));
+  return ret;
+}
+
+// The cost of checking one RRSIG, which dominates the CPU usage of a validating resolver
+TEST_CASE("Validate/Signature")
+{
+  const DNSName name("www.powerdns.com.");
+  const time_t now = time(nullptr);
+
+  for (const auto& [algorithm, algorithmName] : std::vector<std::pair<unsigned int, const char*>>{{DNSSEC::RSASHA256, "rsasha256-2048"}, {DNSSEC::ECDSA256, "ecdsap256sha256"}, {DNSSEC::ED25519, "ed25519"}}) {
+    if (!DNSCryptoKeyEngine::isAlgorithmSupported(algorithm)) {
+      continue;
+    }
+
+    const auto rrset = makeSignedRRSet(name, algorithm, now);
+    auto validate = [&]() {
+      pdns::validation::ValidationContext context;
+      return validateWithKeySet(now, name, rrset.records, rrset.signatures, rrset.keys, std::nullopt, context);
+    };
+
+    /* every verification parses the DNSKEY and does the crypto */
+    pdns::validation::setVerificationCacheSizes(0, 0);
+    REQUIRE(validate() == vState::Secure);
+    BENCHMARK(algorithmName)
+    {
+      return validate();
+    };
+
+    /* the DNSKEY is parsed once, the crypto is still done every time */
+    pdns::validation::setVerificationCacheSizes(1000, 0);
+    REQUIRE(validate() == vState::Secure);
+    BENCHMARK(std::string(algorithmName) + "-key-cache")
+    {
+      return validate();
+    };
+
+    /* the same signed data was already verified with that key */
+    pdns::validation::setVerificationCacheSizes(1000, 1000);
+    REQUIRE(validate() == vState::Secure);
+    BENCHMARK(std::string(algorithmName) + "-signature-cache")
+    {
+      return validate();
+    };
+  }
+  pdns::validation::setVerificationCacheSizes(0, 0);
+}
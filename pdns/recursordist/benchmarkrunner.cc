@@ -0,0 +1,115 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch_config.hpp>
+#include <catch2/reporters/catch_reporter_event_listener.hpp>
+#include <catch2/reporters/catch_reporter_registrars.hpp>
+
+#include "arguments.hh"
+#include "dnsrecords.hh"
+#include "logging.hh"
+#include "lua-recursor4.hh"
+#include "syncres.hh"
+
+/* Stubs for the parts of the recursor that live outside of rec-common, so that the
+   benchmarks can exercise SyncRes without linking the whole daemon. These mirror the
+   ones in test-syncres_cc.cc. */
+
+GlobalStateHolder<SuffixMatchNode> g_xdnssec;
+GlobalStateHolder<SuffixMatchNode> g_dontThrottleNames;
+GlobalStateHolder<NetmaskGroup> g_dontThrottleNetmasks;
+GlobalStateHolder<SuffixMatchNode> g_DoTToAuthNames;
+std::unique_ptr<MemRecursorCache> g_recCache;
+std::unique_ptr<NegCache> g_negCache;
+bool g_lowercaseOutgoing = false;
+unsigned int g_networkTimeoutMsec = 1500;
+
+ArgvMap& arg()
+{
+  static ArgvMap theArg;
+  return theArg;
+}
+
+BaseLua4::~BaseLua4() = default;
+
+void BaseLua4::getFeatures(Features& /* features */)
+{
+}
+
+void BaseLua4::prepareContext()
+{
+}
+
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+bool RecursorLua4::preoutquery(const ComboAddress& /* ns */, const ComboAddress& /* requestor */, const DNSName& /* query */, const QType& /* qtype */, bool& /* isTcp */, vector<DNSRecord>& /* res */, int& /* ret */, RecEventTrace& /* et */, const struct timeval& /* tv */) const
+{
+  return false;
+}
+
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+bool RecursorLua4::policyHitEventFilter(const ComboAddress& /* remote */, const DNSName& /* qname */, const QType& /* qtype */, bool /* tcp */, DNSFilterEngine::Policy& /* policy */, std::unordered_set<std::string>& /* tags */, std::unordered_map<std::string, bool>& /* discardedPolicies */) const
+{
+  return false;
+}
+
+RecursorLua4::~RecursorLua4() = default;
+
+void RecursorLua4::postPrepareContext()
+{
+}
+
+void RecursorLua4::postLoad()
+{
+}
+
+void RecursorLua4::getFeatures(Features& /* features */)
+{
+}
+
+LWResult::Result asyncresolve(const OptLog& /* log */, const ComboAddress& /* ip */, const DNSName& /* domain */, int /* type */, bool /* doTCP */, bool /* sendRDQuery */, int /* EDNS0Level */, struct timeval* /* now */, std::optional<Netmask>& /* srcmask */, const ResolveContext& /* context */, const std::shared_ptr<std::vector<std::unique_ptr<RemoteLogger>>>& /* outgoingLoggers */, const std::shared_ptr<std::vector<std::unique_ptr<FrameStreamLogger>>>& /* fstrmLoggers */, const std::set<uint16_t>& /* exportTypes */, LWResult* /* res */, bool* /* chained */)
+{
+  return LWResult::Result::Timeout;
+}
+
+// The benchmarks only resolve from the cache, they never need the root hints
+bool primeHints(time_t /* now */)
+{
+  return true;
+}
+
+static void discardLogEntry(const Logging::Entry& /* entry */)
+{
+}
+
+class BenchmarkRunnerSetup : public Catch::EventListenerBase
+{
+public:
+  using Catch::EventListenerBase::EventListenerBase;
+
+  void testRunStarting(Catch::TestRunInfo const& /* testRunInfo */) override
+  {
+    g_slog = Logging::Logger::create(discardLogEntry);
+    reportAllTypes();
+  }
+};
+
+CATCH_REGISTER_LISTENER(BenchmarkRunnerSetup)
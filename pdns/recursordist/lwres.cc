@@ -818,21 +818,22 @@ static LWResult::Result asyncresolve(const OptLog& log, const ComboAddress& addr
   lwr->d_records.clear();
   try {
     lwr->d_tcbit = 0;
-    MOADNSParser mdp(false, reinterpret_cast<const char*>(buf.data()), buf.size());
+    // only validates the framing, names and records are materialized once the response is known to be for us
+    DNSPacketView view(std::string_view(reinterpret_cast<const char*>(buf.data()), buf.size()));
 
     // RFC 1035 Section 4.1.1: QR must be 1 for responses
-    if (!mdp.d_header.qr) {
+    if (!view.d_header.qr) {
       lwr->d_rcode = RCode::ServFail;
       lwr->d_validpacket = false;
       t_Counters.at(rec::Counter::serverParseError)++;
       return LWResult::Result::PermanentError;
     }
 
-    lwr->d_aabit = mdp.d_header.aa;
-    lwr->d_tcbit = mdp.d_header.tc;
-    lwr->d_rcode = mdp.d_header.rcode;
+    lwr->d_aabit = view.d_header.aa;
+    lwr->d_tcbit = view.d_header.tc;
+    lwr->d_rcode = view.d_header.rcode;
 
-    if (mdp.d_header.rcode == RCode::FormErr && mdp.d_qname.empty() && mdp.d_qtype == 0 && mdp.d_qclass == 0) {
+    if (view.d_header.rcode == RCode::FormErr && view.d_qname.empty() && view.d_qtype == 0 && view.d_qclass == 0) {
       if (outgoingLoggers) {
         logIncomingResponse(outgoingLoggers, context.d_initialRequestId, uuid, address, domain, type, qid, doTCP, dnsOverTLS, srcmask, len, lwr->d_rcode, lwr->d_records, queryTime, exportTypes, nsName);
       }
@@ -840,12 +841,12 @@ static LWResult::Result asyncresolve(const OptLog& log, const ComboAddress& addr
       return LWResult::Result::Success; // this is "success", the error is set in lwr->d_rcode
     }
 
-    if (domain != mdp.d_qname) {
-      if (!mdp.d_qname.empty() && domain.toString().find((char)0) == string::npos /* ugly */) { // embedded nulls are too noisy, plus empty domains are too
+    if (view.d_qname != domain) {
+      if (!view.d_qname.empty() && domain.toString().find((char)0) == string::npos /* ugly */) { // embedded nulls are too noisy, plus empty domains are too
         g_slogout->info(Logr::Notice, "Packet purporting to come from remote server contained wrong answer",
                         "server", Logging::Loggable(address),
                         "qname", Logging::Loggable(domain),
-                        "onwire", Logging::Loggable(mdp.d_qname));
+                        "onwire", Logging::Loggable(view.d_qname.toDNSName()));
       }
       // unexpected count has already been done @ pdns_recursor.cc
       if (!lwr->d_rcode) {
@@ -854,13 +855,10 @@ static LWResult::Result asyncresolve(const OptLog& log, const ComboAddress& addr
       return LWResult::Result::PermanentError;
     }
 
-    lwr->d_records.reserve(mdp.d_answers.size());
-    for (const auto& answer : mdp.d_answers) {
-      lwr->d_records.push_back(answer);
-    }
+    lwr->d_records = view.getRecords();
 
     bool cookieFoundInReply = false;
-    if (EDNSOpts edo; EDNS0Level > 0 && getEDNSOpts(mdp, &edo)) {
+    if (EDNSOpts edo; EDNS0Level > 0 && getEDNSOpts(view, &edo)) {
       lwr->d_haveEDNS = true;
 
       // If we sent out ECS, we can also expect to see a return with or without ECS, the absent case
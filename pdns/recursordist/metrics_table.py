@@ -85,7 +85,7 @@ table = [
         "lambda": "doGetCacheBytes",
         "ptype": "gauge",
         "desc": "Size of the cache in bytes",
-        "longdesc": """Since version 5.3.0 this metric computes a rough estimate of the number of bytes allocated by the record cache. Older versions return a number that cannot be relied upon. Disabled by default, as computing this number is CPU intensive, see :ref:`setting-yaml-recursor.stats_rec_control_disabled_list`.""",
+        "longdesc": """Since version 5.3.0 this metric computes a rough estimate of the number of bytes allocated by the record cache. Older versions return a number that cannot be relied upon. Since version 5.5.0 record contents shared between entries are only counted once, dividing this metric by ``cache-entries`` gives the average number of bytes per entry. Disabled by default, as computing this number is CPU intensive, see :ref:`setting-yaml-recursor.stats_rec_control_disabled_list`.""",
         "snmp": 7,
     },
     {
@@ -852,6 +852,21 @@ table = [
         "snmp": 117,
         "desc": "Number of almost-expired tasks that caused an exception",
     },
+    {
+        "name": "almost-expired-evicted",
+        "lambda": "[]() { return getAlmostExpiredTasksEvicted(); }",
+        "ptype": "counter",
+        "desc": "Number of almost-expired tasks dropped because the queue was full",
+        "longdesc": "The least popular tasks are dropped first.",
+        # No SNMP
+    },
+    {
+        "name": "almost-expired-deduplicated",
+        "lambda": "[]() { return getAlmostExpiredTasksDeduplicated(); }",
+        "ptype": "counter",
+        "desc": "Number of almost-expired tasks not pushed because the same task was already queued or running",
+        # No SNMP
+    },
     {
         "name": "udp-in-csum-errors",
         "lambda": '[] { return udpErrorStats("udp-in-csum-errors"); }',
@@ -1408,6 +1423,96 @@ table = [
         "desc": "Number of authoritative server cookie probes not resulting in success",
         "snmp": 161,
     },
+    {
+        "name": "cache-shared-contents",
+        "lambda": "[] { return g_recCache->sharedContentsCount(); }",
+        "ptype": "gauge",
+        "desc": "Number of distinct record contents shared between record cache entries",
+        "longdesc": "Identical record contents, for example the NS records of domains hosted by the same provider, are only stored once by the record cache. A and AAAA records are not shared, as they are smaller than the index needed to share them.",
+        # No SNMP
+    },
+    {
+        "name": "dnskey-cache-hits",
+        "lambda": "[] { return pdns::validation::getVerificationCacheStats().d_keyHits; }",
+        "ptype": "counter",
+        "desc": "Number of signature verifications that used an already parsed DNSKEY",
+        "longdesc": "See :ref:`setting-yaml-dnssec.dnskey_cache_size`.",
+        # No SNMP
+    },
+    {
+        "name": "dnskey-cache-misses",
+        "lambda": "[] { return pdns::validation::getVerificationCacheStats().d_keyMisses; }",
+        "ptype": "counter",
+        "desc": "Number of signature verifications that had to parse the DNSKEY",
+        # No SNMP
+    },
+    {
+        "name": "dnskey-cache-entries",
+        "lambda": "[] { return pdns::validation::getVerificationCacheStats().d_keyEntries; }",
+        "ptype": "gauge",
+        "desc": "Number of parsed DNSKEYs kept for signature verification",
+        # No SNMP
+    },
+    {
+        "name": "signature-cache-hits",
+        "lambda": "[] { return pdns::validation::getVerificationCacheStats().d_signatureHits; }",
+        "ptype": "counter",
+        "desc": "Number of signature verifications answered from the cache of recent results",
+        "longdesc": "See :ref:`setting-yaml-dnssec.signature_cache_size`.",
+        # No SNMP
+    },
+    {
+        "name": "signature-cache-misses",
+        "lambda": "[] { return pdns::validation::getVerificationCacheStats().d_signatureMisses; }",
+        "ptype": "counter",
+        "desc": "Number of signature verifications not found in the cache of recent results",
+        # No SNMP
+    },
+    {
+        "name": "signature-cache-entries",
+        "lambda": "[] { return pdns::validation::getVerificationCacheStats().d_signatureEntries; }",
+        "ptype": "gauge",
+        "desc": "Number of entries in the cache of recent signature verification results",
+        # No SNMP
+    },
+    {
+        "name": "ecs-cache-coalesced",
+        "lambda": "[] { return g_recCache->getECSCoalesced(); }",
+        "ptype": "counter",
+        "desc": "Number of times two ECS-specific record cache entries with the same answer were merged into one",
+        # No SNMP
+    },
+    {
+        "name": "ecs-cache-evictions",
+        "lambda": "[] { return g_recCache->getECSEvictions(); }",
+        "ptype": "counter",
+        "desc": "Number of ECS-specific record cache entries removed because their name and type had too many prefixes",
+        "longdesc": "See :ref:`setting-yaml-ecs.cache_max_prefixes_per_name`.",
+        # No SNMP
+    },
+    {
+        "name": "outgoing-udp-sockets-opened",
+        "lambda": "[] { return g_Counters.sum(rec::Counter::outgoingUDPSocketsOpened); }",
+        "ptype": "counter",
+        "desc": "Number of UDP sockets created to send queries to authoritative servers",
+        # No SNMP
+    },
+    {
+        "name": "outgoing-udp-sockets-reused",
+        "lambda": "[] { return g_Counters.sum(rec::Counter::outgoingUDPSocketsReused); }",
+        "ptype": "counter",
+        "desc": "Number of queries to authoritative servers sent over an already connected UDP socket",
+        "longdesc": "See :ref:`setting-yaml-outgoing.udp_socket_max_uses`.",
+        # No SNMP
+    },
+    {
+        "name": "outgoing-udp-socket-syscalls",
+        "lambda": "[] { return g_Counters.sum(rec::Counter::outgoingUDPSocketSyscalls); }",
+        "ptype": "counter",
+        "desc": "Number of system calls made to set up, recycle and close outgoing UDP sockets",
+        "longdesc": "Divided by ``all-outqueries``, this gives the socket management overhead per outgoing UDP query. Sending, receiving and event registration are not included, as they are the same whether a socket is reused or not.",
+        # No SNMP
+    },
     {
         "name": "remote-logger-count",
         "lambda": """[]() {
@@ -1436,6 +1541,15 @@ table = [
         "pname": "cumul-authanswers-count4",  # For cumulative histogram, state the xxx_count name where xxx matches the name in rec_channel_rec
         # No SNMP
     },
+    {
+        "name": "cumul-cacheprunepauses-x",
+        # No lambda
+        "desc": "Cumulative counts of the times a cache shard was locked by pruning, in buckets less than x microseconds.",
+        "longdesc": "Covers the record cache, the negative cache and the packet cache, see :ref:`setting-yaml-recordcache.prune_batch_size`. Disabled by default, see :ref:`setting-yaml-recursor.stats_rec_control_disabled_list`. These metrics are useful for Prometheus and not listed in other outputs by default.",
+        "ptype": "histogram",
+        "pname": "cumul-cacheprunepauses-count",  # For cumulative histogram, state the xxx_count name where xxx matches the name in rec_channel_rec
+        # No SNMP
+    },
     {
         "name": "policy-hits",
         # No lambda
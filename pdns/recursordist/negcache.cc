@@ -178,8 +178,9 @@ void NegCache::updateValidationStatus(const DNSName& qname, const QType qtype, c
 
   if (range.first != range.second) {
     range.first->d_validationState = newState;
-    if (capTTD) {
-      range.first->d_ttd = std::min(range.first->d_ttd, *capTTD);
+    if (capTTD && *capTTD < range.first->d_ttd) {
+      range.first->d_ttd = *capTTD;
+      resetCacheItemExpiry<ExpiryTag>(map->d_map, range.first);
     }
   }
 }
@@ -283,10 +284,9 @@ void NegCache::clear()
  *
  * \param maxEntries The maximum number of entries that may exist in the cache.
  */
-void NegCache::prune(time_t now, size_t maxEntries)
+void NegCache::prune(time_t now, size_t maxEntries, const PruneControl& control)
 {
-  size_t cacheSize = size();
-  pruneMutexCollectionsVector<SequenceTag>(now, d_maps, maxEntries, cacheSize);
+  pruneMutexCollectionsVector<SequenceTag, ExpiryTag>(now, d_maps, maxEntries, control);
 }
 
 /*!
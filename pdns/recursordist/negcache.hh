@@ -26,6 +26,7 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/key_extractors.hpp>
+#include "cachecleaner.hh"
 #include "dnsparser.hh"
 #include "dnsname.hh"
 #include "dns.hh"
@@ -80,18 +81,24 @@ public:
     DNSName d_name; // The denied name
     DNSName d_auth; // The denying name (aka auth)
     mutable time_t d_ttd; // Timestamp when this entry should die
+    time_t d_expiry{0}; // Key of the expiry index, only updated by pruning
     uint32_t d_orig_ttl;
     mutable uint16_t d_servedStale{0};
     mutable vState d_validationState{vState::Indeterminate};
     QType d_qtype; // The denied type
 
-    bool isStale(time_t now) const
+    [[nodiscard]] time_t getStaleTime() const
     {
       // We like to keep things in cache when we (potentially) should serve stale
       if (s_maxServedStaleExtensions > 0) {
-        return d_ttd + static_cast<time_t>(s_maxServedStaleExtensions) * std::min(s_serveStaleExtensionPeriod, d_orig_ttl) < now;
+        return d_ttd + static_cast<time_t>(s_maxServedStaleExtensions) * std::min(s_serveStaleExtensionPeriod, d_orig_ttl);
       }
-      return d_ttd < now;
+      return d_ttd;
+    }
+
+    bool isStale(time_t now) const
+    {
+      return getStaleTime() < now;
     };
 
     bool isEntryUsable(time_t now, bool serveStale) const
@@ -108,7 +115,7 @@ public:
   bool getRootNXTrust(const DNSName& qname, const struct timeval& now, NegCacheEntry& negEntry, bool serveStale, bool refresh);
   size_t count(const DNSName& qname);
   size_t count(const DNSName& qname, QType qtype);
-  void prune(time_t now, size_t maxEntries);
+  void prune(time_t now, size_t maxEntries, const PruneControl& control = PruneControl());
   void clear();
   size_t doDump(int fileDesc, size_t maxCacheEntries, time_t now = time(nullptr));
   size_t wipe(const DNSName& name, bool subtree = false);
@@ -122,6 +129,9 @@ private:
   struct SequenceTag
   {
   };
+  struct ExpiryTag
+  {
+  };
   using negcache_t = boost::multi_index_container<
     NegCacheEntry,
     indexed_by<
@@ -134,7 +144,9 @@ private:
                        CanonDNSNameCompare, std::less<>>>,
       sequenced<tag<SequenceTag>>,
       hashed_non_unique<tag<NegCacheEntry>,
-                        member<NegCacheEntry, DNSName, &NegCacheEntry::d_name>>>>;
+                        member<NegCacheEntry, DNSName, &NegCacheEntry::d_name>>,
+      ordered_non_unique<tag<ExpiryTag>,
+                         member<NegCacheEntry, time_t, &NegCacheEntry::d_expiry>>>>;
 
   static void updateStaleEntry(time_t now, negcache_t::iterator& entry, QType qtype);
 
@@ -40,7 +40,7 @@ std::mutex PersistentSBF::d_cachedir_mutex;
 
 void PersistentSBF::remove_tmp_files(const filesystem::path& path, std::scoped_lock<std::mutex>& /* lock */)
 {
-  Regex file_regex(d_prefix + ".*\\." + bf_suffix + "\\..{8}$");
+  Regex file_regex(d_prefix + ".*\\.(" + bf_suffix + "|" + bf_mmap_suffix + ")\\..{8}$");
   for (const auto& file : filesystem::directory_iterator(path)) {
     if (filesystem::is_regular_file(file.path()) && file_regex.match(file.path().filename())) {
       filesystem::remove(file);
@@ -48,11 +48,32 @@ void PersistentSBF::remove_tmp_files(const filesystem::path& path, std::scoped_l
   }
 }
 
+filesystem::path PersistentSBF::find_newest_file(const filesystem::path& path, const std::string& suffix, bool ignore_pid) const
+{
+  filesystem::path newest_file;
+  // Tricky business, some C++ libs do not use 0 as epoch!
+  filesystem::file_time_type newest_time{filesystem::file_time_type::min()};
+  Regex file_regex(d_prefix + ".*\\." + suffix + "$");
+  for (const auto& file : filesystem::directory_iterator(path)) {
+    if (filesystem::is_regular_file(file.path()) && file_regex.match(file.path().filename())) {
+      if (ignore_pid || (file.path().filename().string().find(std::to_string(getpid())) == std::string::npos)) {
+        // look for the newest file matching the regex
+        if (file.last_write_time() > newest_time) {
+          newest_time = file.last_write_time();
+          newest_file = file.path();
+        }
+      }
+    }
+  }
+  return newest_file;
+}
+
 // This looks for the newest (per-thread) snapshot it can find and it restores from that. Then
 // immediately snapshots with the current thread id, before removing the old snapshot.
 // In this way, we can have per-thread SBFs, but still snapshot and restore.  The mutex has to be
 // static because we can't have multiple (i.e. per-thread) instances iterating and writing to the
 // cache dir at the same time
+// Snapshots are mapped as they are, only the stream dumps written by older versions are parsed.
 bool PersistentSBF::init(bool ignore_pid)
 {
   auto log = g_slog->withName("nod");
@@ -62,37 +83,30 @@ bool PersistentSBF::init(bool ignore_pid)
     try {
       if (filesystem::exists(path) && filesystem::is_directory(path)) {
         remove_tmp_files(path, lock);
-        filesystem::path newest_file;
-        // Tricky business, some C++ libs do not use 0 as epoch!
-        filesystem::file_time_type newest_time{filesystem::file_time_type::min()};
-        Regex file_regex(d_prefix + ".*\\." + bf_suffix + "$");
-        for (const auto& file : filesystem::directory_iterator(path)) {
-          if (filesystem::is_regular_file(file.path()) && file_regex.match(file.path().filename())) {
-            if (ignore_pid || (file.path().filename().string().find(std::to_string(getpid())) == std::string::npos)) {
-              // look for the newest file matching the regex
-              if (file.last_write_time() > newest_time) {
-                newest_time = file.last_write_time();
-                newest_file = file.path();
-              }
-            }
-          }
+        auto newest_file = find_newest_file(path, bf_mmap_suffix, ignore_pid);
+        bool legacy = false;
+        if (newest_file.empty()) {
+          newest_file = find_newest_file(path, bf_suffix, ignore_pid);
+          legacy = true;
         }
         if (!newest_file.empty() && filesystem::exists(newest_file)) {
           std::string filename = newest_file.string();
-          std::ifstream infile;
           try {
-            infile.open(filename, std::ios::in | std::ios::binary);
             log->info(Logr::Warning, "Found SBF File", "file", Logging::Loggable(filename));
             // read the file into the sbf
-            d_sbf.lock()->restore(infile);
-            infile.close();
+            if (legacy) {
+              std::ifstream infile(filename, std::ios::in | std::ios::binary);
+              d_sbf.restoreLegacy(infile);
+            }
+            else {
+              d_sbf.restore(filename);
+            }
             // now dump it out again with new thread id & process id
             snapshotCurrent(std::this_thread::get_id());
             // Remove the old file we just read to stop proliferation
             filesystem::remove(newest_file);
           }
           catch (const std::runtime_error& e) {
-            infile.close();
             filesystem::remove(newest_file);
             log->error(Logr::Warning, e.what(), "NODDB init: Cannot parse file, removed", "file", Logging::Loggable(filename));
           }
@@ -120,9 +134,7 @@ void PersistentSBF::setCacheDir(const std::string& cachedir)
 }
 
 // Dump the SBF to a file
-// To spend the least amount of time inside the mutex, we dump to an
-// intermediate stringstream, otherwise the lock would be waiting for
-// file IO to complete
+// The filter keeps being updated while it is written out, so nothing is locked
 bool PersistentSBF::snapshotCurrent(std::thread::id tid)
 {
   auto log = g_slog->withName("nod");
@@ -131,25 +143,20 @@ bool PersistentSBF::snapshotCurrent(std::thread::id tid)
     filesystem::path file(d_cachedir);
     std::stringstream strStream;
     strStream << d_prefix << "_" << tid;
-    file /= strStream.str() + "_" + std::to_string(getpid()) + "." + bf_suffix;
+    file /= strStream.str() + "_" + std::to_string(getpid()) + "." + bf_mmap_suffix;
     if (filesystem::exists(path) && filesystem::is_directory(path)) {
       try {
-        std::ostringstream oss;
-        {
-          // only lock while dumping to a stringstream
-          d_sbf.lock()->dump(oss);
-        }
-        // Now write it out to the file
         std::string ftmp = file.string() + ".XXXXXXXX";
         auto fileDesc = FDWrapper(mkstemp(ftmp.data()));
         if (fileDesc == -1) {
           throw std::runtime_error("Cannot create temp file: " + stringerror());
         }
-        const std::string str = oss.str(); // XXX creates a copy, with c++20 we can use view()
-        ssize_t len = write(fileDesc, str.data(), str.length());
-        if (len != static_cast<ssize_t>(str.length())) {
+        try {
+          d_sbf.dump(fileDesc);
+        }
+        catch (const std::runtime_error& e) {
           filesystem::remove(ftmp);
-          throw std::runtime_error("Failed to write to file:" + ftmp);
+          throw std::runtime_error("Failed to write to file:" + ftmp + ": " + e.what());
         }
         if (fileDesc.reset() != 0) {
           filesystem::remove(ftmp);
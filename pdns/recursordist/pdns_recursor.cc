@@ -86,6 +86,8 @@ std::atomic<uint32_t> g_maxCacheEntries, g_maxPacketCacheEntries;
 std::vector<bool> g_avoidUdpSourcePorts;
 uint16_t g_minUdpSourcePort;
 uint16_t g_maxUdpSourcePort;
+unsigned int g_outgoingUDPSocketMaxUses{1};
+size_t g_outgoingUDPSocketPoolSize;
 double g_balancingFactor;
 
 bool g_lowercaseOutgoing;
@@ -100,13 +102,37 @@ GlobalStateHolder<NetmaskGroup> g_dontThrottleNetmasks;
 GlobalStateHolder<SuffixMatchNode> g_DoTToAuthNames;
 uint64_t g_latencyStatSize;
 
+// how long an idle socket is kept in the pool, pooled sockets are meant for busy remotes
+static constexpr time_t s_maxIdleSocketSeconds = 10;
+
+UDPClientSocks::~UDPClientSocks()
+{
+  for (const auto& idle : d_idle) {
+    closesocket(idle.d_fd);
+  }
+}
+
 LWResult::Result UDPClientSocks::getSocket(const ComboAddress& toaddr, const std::optional<pdns::AddressAndInterface>& localAddress, std::optional<pdns::Interface>& interface, int* fileDesc)
 {
+  // a specific local address is only requested for cookies, we do not pool those sockets
+  const bool poolable = g_outgoingUDPSocketMaxUses > 1 && !localAddress;
+
+  if (poolable) {
+    *fileDesc = getIdleSocket(toaddr, interface);
+    if (*fileDesc >= 0) {
+      t_Counters.at(rec::Counter::outgoingUDPSocketsReused)++;
+      d_numsocks++;
+      return LWResult::Result::Success;
+    }
+  }
+
   *fileDesc = makeClientSocket(toaddr.sin4.sin_family, localAddress, interface);
   if (*fileDesc < 0) { // temporary error - receive exception otherwise
     return LWResult::Result::OSLimitError;
   }
+  t_Counters.at(rec::Counter::outgoingUDPSocketsOpened)++;
 
+  t_Counters.at(rec::Counter::outgoingUDPSocketSyscalls)++;
   if (connect(*fileDesc, reinterpret_cast<const struct sockaddr*>(&toaddr), toaddr.getSocklen()) < 0) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast))
     int err = errno;
     try {
@@ -123,12 +149,46 @@ LWResult::Result UDPClientSocks::getSocket(const ComboAddress& toaddr, const std
     return LWResult::Result::PermanentError;
   }
 
+  if (poolable) {
+    d_inUse[*fileDesc] = InUseSocket{toaddr, interface, 1, false};
+  }
   d_numsocks++;
   return LWResult::Result::Success;
 }
 
+int UDPClientSocks::getIdleSocket(const ComboAddress& toaddr, std::optional<pdns::Interface>& interface)
+{
+  auto& byRemote = d_idle.get<RemoteTag>();
+  auto range = byRemote.equal_range(toaddr);
+  while (range.first != range.second) {
+    auto iter = range.first;
+    auto idle = *iter;
+    range.first = byRemote.erase(iter);
+
+    if (idle.d_lastUsed + s_maxIdleSocketSeconds < g_now.tv_sec) {
+      closeSocket(idle.d_fd);
+      continue;
+    }
+
+    // Anything queued on the socket while it was idle (a late duplicate, an ICMP error or a
+    // spoofing attempt) makes us drop it: the port might be known to someone else by now.
+    std::array<char, 1> dummy{};
+    t_Counters.at(rec::Counter::outgoingUDPSocketSyscalls)++;
+    auto got = recv(idle.d_fd, dummy.data(), dummy.size(), MSG_DONTWAIT);
+    if (got >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      closeSocket(idle.d_fd);
+      continue;
+    }
+
+    interface = idle.d_interface;
+    d_inUse[idle.d_fd] = InUseSocket{idle.d_remote, idle.d_interface, idle.d_uses + 1, false};
+    return idle.d_fd;
+  }
+  return -1;
+}
+
 // return a socket to the pool, or simply erase it
-void UDPClientSocks::returnSocket(int fileDesc)
+void UDPClientSocks::returnSocket(int fileDesc, bool reusable)
 {
   try {
     t_fdm->removeReadFD(fileDesc);
@@ -137,19 +197,56 @@ void UDPClientSocks::returnSocket(int fileDesc)
     // we sometimes return a socket that has not yet been assigned to t_fdm
   }
 
+  --d_numsocks;
+
+  auto inUse = d_inUse.find(fileDesc);
+  if (inUse != d_inUse.end()) {
+    auto entry = std::move(inUse->second);
+    d_inUse.erase(inUse);
+    if (reusable && !entry.d_suspicious && entry.d_uses < g_outgoingUDPSocketMaxUses && g_outgoingUDPSocketPoolSize > 0) {
+      d_idle.get<SequencedTag>().push_back(IdleSocket{entry.d_remote, std::move(entry.d_interface), g_now.tv_sec, entry.d_uses, fileDesc});
+      pruneIdle(g_now.tv_sec);
+      return;
+    }
+  }
+
+  closeSocket(fileDesc);
+}
+
+void UDPClientSocks::markSuspicious(int fileDesc)
+{
+  auto inUse = d_inUse.find(fileDesc);
+  if (inUse != d_inUse.end()) {
+    inUse->second.d_suspicious = true;
+  }
+}
+
+// idle sockets are kept in order of return, so the oldest ones are at the front
+void UDPClientSocks::pruneIdle(time_t now)
+{
+  auto& sequence = d_idle.get<SequencedTag>();
+  while (!sequence.empty() && (sequence.size() > g_outgoingUDPSocketPoolSize || sequence.front().d_lastUsed + s_maxIdleSocketSeconds < now)) {
+    closeSocket(sequence.front().d_fd);
+    sequence.pop_front();
+  }
+}
+
+void UDPClientSocks::closeSocket(int fileDesc)
+{
+  t_Counters.at(rec::Counter::outgoingUDPSocketSyscalls)++;
   try {
     closesocket(fileDesc);
   }
   catch (const PDNSException& e) {
     g_slogout->error(Logr::Error, e.reason, "Error closing returned UDP socket", "exception", Logging::Loggable("PDNSException"));
   }
-
-  --d_numsocks;
 }
 
 // returns -1 for errors which might go away, throws for ones that won't
 int UDPClientSocks::makeClientSocket(int family, const std::optional<pdns::AddressAndInterface>& localAddress, std::optional<pdns::Interface>& interface)
 {
+  auto& syscalls = t_Counters.at(rec::Counter::outgoingUDPSocketSyscalls);
+  syscalls++;
   int ret = socket(family, SOCK_DGRAM, 0); // turns out that setting CLO_EXEC and NONBLOCK from here is not a performance win on Linux (oddly enough)
 
   if (ret < 0 && errno == EMFILE) { // this is not a catastrophic error
@@ -189,9 +286,11 @@ int UDPClientSocks::makeClientSocket(int family, const std::optional<pdns::Addre
     else {
       sin = pdns::getQueryLocalAddress(family, port); // does htons for us
     }
+    syscalls++;
     if (::bind(ret, reinterpret_cast<struct sockaddr*>(&sin.d_address), sin.d_address.getSocklen()) >= 0) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast
       if (sin.d_interface) {
 #ifdef SO_BINDTODEVICE
+        syscalls++;
         const auto& name = sin.d_interface->d_name;
         int res = setsockopt(ret, SOL_SOCKET, SO_BINDTODEVICE, name.data(), name.length());
         if (res != 0) {
@@ -213,6 +312,8 @@ int UDPClientSocks::makeClientSocket(int family, const std::optional<pdns::Addre
   }
 
   try {
+    // one setsockopt() and two fcntl() calls
+    syscalls += 3;
     setReceiveSocketErrors(ret, family);
     setNonBlocking(ret);
   }
@@ -1575,6 +1676,9 @@ void startDoResolve(void* arg) // NOLINT(readability-function-cognitive-complexi
         }
       }
 
+      // nothing in the loop below yields to another mthread, so a per-thread table is safe to use
+      static thread_local DNSNameCompressionTable t_compressionTable;
+      packetWriter.setCompressionTable(&t_compressionTable);
       bool needCommit = false;
       for (const auto& record : ret) {
         if (!DNSSECOK && (record.d_type == QType::NSEC3 || ((record.d_type == QType::RRSIG || record.d_type == QType::NSEC) && ((comboWriter->d_mdp.d_qtype != record.d_type && comboWriter->d_mdp.d_qtype != QType::ANY) || (record.d_place != DNSResourceRecord::ANSWER && record.d_place != DNSResourceRecord::ADDITIONAL))))) {
@@ -1607,6 +1711,7 @@ void startDoResolve(void* arg) // NOLINT(readability-function-cognitive-complexi
           }
         }
       }
+      packetWriter.setCompressionTable(nullptr);
       if (needCommit) {
         packetWriter.commit();
       }
@@ -3073,6 +3178,7 @@ static void handleUDPServerResponse(int fileDesc, FDMultiplexer::funcparam_t& va
     if (g_logCommonErrors) {
       g_slogout->info(Logr::Error, "Unable to parse too short packet from remote UDP server", "from", Logging::Loggable(fromaddr));
     }
+    t_udpclientsocks->markSuspicious(fileDesc);
     return;
   }
 
@@ -3092,12 +3198,14 @@ static void handleUDPServerResponse(int fileDesc, FDMultiplexer::funcparam_t& va
       g_slogout->info(Logr::Error, "Not taking data from question on outgoing socket", "from", Logging::Loggable(fromaddr));
     }
     t_Counters.at(rec::Counter::unexpectedCount)++;
+    t_udpclientsocks->markSuspicious(fileDesc);
     return;
   }
 
   if (ntohs(dnsheader.qdcount) != 1 && (ntohs(dnsheader.ancount) > 0 || ntohs(dnsheader.nscount) > 0 || ntohs(dnsheader.arcount) > 0)) {
     g_slogout->info(Logr::Error, "Invalid qdcount in answer", "from", Logging::Loggable(fromaddr));
     t_Counters.at(rec::Counter::unexpectedCount)++;
+    t_udpclientsocks->markSuspicious(fileDesc);
     return;
   }
 
@@ -3116,6 +3224,7 @@ static void handleUDPServerResponse(int fileDesc, FDMultiplexer::funcparam_t& va
     // Parse error, continue waiting for other packets
     t_Counters.at(rec::Counter::serverParseError)++; // won't be fed to lwres.cc, so we have to increment
     g_slogudpin->error(Logr::Warning, e.what(), "Error in packet from remote nameserver", "from", Logging::Loggable(fromaddr));
+    t_udpclientsocks->markSuspicious(fileDesc);
     return;
   }
 
@@ -3126,9 +3235,13 @@ static void handleUDPServerResponse(int fileDesc, FDMultiplexer::funcparam_t& va
     }
   }
 
+  // set when a header-only packet got the name of a waiter with the same id, lwres will reject it
+  bool nameGuessed = false;
+
 retryWithName:
 
-  if (pident->domain.empty() || g_multiTasker->sendEvent(pident, &packet) == 0) {
+  int eventRet = pident->domain.empty() ? 0 : g_multiTasker->sendEvent(pident, &packet);
+  if (eventRet == 0) {
     /* we did not find a match for this response, something is wrong */
 
     // we do a full scan for outstanding queries on unexpected answers. not too bad since we only accept them on the right port number, which is hard enough to guess
@@ -3144,10 +3257,12 @@ retryWithName:
       if (pident->domain.empty() && !d_waiter.key->domain.empty() && pident->type == 0 && d_waiter.key->type != 0 && pident->id == d_waiter.key->id && d_waiter.key->remote == pident->remote) {
         pident->domain = d_waiter.key->domain;
         pident->type = d_waiter.key->type;
+        nameGuessed = true;
         goto retryWithName; // note that this only passes on an error, lwres still should reject the packet NOLINT(cppcoreguidelines-avoid-goto)
       }
     }
     t_Counters.at(rec::Counter::unexpectedCount)++; // if we made it here, it really is an unexpected answer
+    t_udpclientsocks->markSuspicious(fileDesc);
     if (g_logCommonErrors) {
       g_slogudpin->info(Logr::Warning, "Discarding unexpected packet", "from", Logging::Loggable(fromaddr),
                         "qname", Logging::Loggable(pident->domain),
@@ -3157,6 +3272,6 @@ retryWithName:
   }
   else if (fileDesc >= 0) {
     /* we either found a waiter (1) or encountered an issue (-1), it's up to us to clean the socket anyway */
-    t_udpclientsocks->returnSocket(fileDesc);
+    t_udpclientsocks->returnSocket(fileDesc, eventRet == 1 && !nameGuessed);
   }
 }
@@ -0,0 +1,104 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include "rec-contentinterner.hh"
+
+RecordContentInterner::RecordContentInterner(size_t shardCount) :
+  d_shards(shardCount == 0 ? 1 : shardCount)
+{
+}
+
+static std::string canonicalWire(const DNSRecordContent& content)
+{
+  // canonic disables name compression, so the result does not depend on the owner name, but
+  // unlike lowerCase it keeps the case of the names in the content
+  return content.serialize(g_rootdnsname, true);
+}
+
+std::shared_ptr<const DNSRecordContent> RecordContentInterner::intern(const std::shared_ptr<const DNSRecordContent>& content)
+{
+  if (!content || !worthInterning(content->getType())) {
+    return content;
+  }
+
+  std::string wire;
+  try {
+    wire = canonicalWire(*content);
+  }
+  catch (const std::exception&) {
+    return content;
+  }
+
+  const auto qtype = content->getType();
+  uint64_t key = std::hash<std::string>{}(wire);
+  key ^= static_cast<uint64_t>(qtype) << 48;
+  auto& shard = d_shards.at(key % d_shards.size());
+
+  std::shared_ptr<const DNSRecordContent> existing;
+  {
+    auto map = shard.d_map.lock();
+    auto [iter, inserted] = map->try_emplace(key, content);
+    if (inserted) {
+      ++d_entries;
+      return content;
+    }
+    existing = iter->second.lock();
+    if (!existing) {
+      iter->second = content;
+      return content;
+    }
+  }
+
+  if (existing == content) {
+    return content;
+  }
+
+  // Hash collision check, done without holding the lock
+  try {
+    if (existing->getType() == qtype && canonicalWire(*existing) == wire) {
+      return existing;
+    }
+  }
+  catch (const std::exception&) {
+  }
+  return content;
+}
+
+size_t RecordContentInterner::prune(size_t shards)
+{
+  size_t removed = 0;
+  shards = std::min(shards, d_shards.size());
+  for (size_t count = 0; count < shards; count++) {
+    auto& shard = d_shards.at(d_pruneCursor++ % d_shards.size());
+    auto map = shard.d_map.lock();
+    for (auto iter = map->begin(); iter != map->end();) {
+      if (iter->second.expired()) {
+        iter = map->erase(iter);
+        ++removed;
+        --d_entries;
+      }
+      else {
+        ++iter;
+      }
+    }
+  }
+  return removed;
+}
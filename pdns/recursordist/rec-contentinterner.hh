@@ -0,0 +1,78 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "dnsparser.hh"
+#include "lock.hh"
+#include "stat_t.hh"
+
+// Makes identical record contents stored in the record cache share a single allocation. Popular
+// content (NS targets of large hosters, MX or CNAME targets, DS sets) is otherwise duplicated in
+// every entry referring to it.
+//
+// The table only holds weak references, keyed by a hash of the canonical wire format of the
+// content, so it never keeps content alive. Entries for content that is no longer referenced are
+// reused on the next insertion with the same key, or removed by prune().
+class RecordContentInterner
+{
+public:
+  explicit RecordContentInterner(size_t shardCount = 64);
+
+  // Returns a pointer to content equal to the one passed, which is shared with earlier callers if
+  // possible.
+  [[nodiscard]] std::shared_ptr<const DNSRecordContent> intern(const std::shared_ptr<const DNSRecordContent>& content);
+
+  // Drop the entries of unreferenced content from the next `shards` shards, returns the number of
+  // entries removed.
+  size_t prune(size_t shards);
+
+  [[nodiscard]] size_t size() const
+  {
+    return d_entries.load();
+  }
+
+  [[nodiscard]] size_t shardCount() const
+  {
+    return d_shards.size();
+  }
+
+  // Small fixed-size contents (A, AAAA) cost less than the table entry that would be needed to
+  // share them, and signatures are unique to the RRSet they cover.
+  static bool worthInterning(uint16_t qtype)
+  {
+    return qtype != QType::A && qtype != QType::AAAA && qtype != QType::RRSIG;
+  }
+
+private:
+  struct Shard
+  {
+    LockGuarded<std::unordered_map<uint64_t, std::weak_ptr<const DNSRecordContent>>> d_map;
+  };
+
+  std::vector<Shard> d_shards;
+  std::atomic<size_t> d_pruneCursor{0};
+  pdns::stat_t d_entries{0};
+};
@@ -903,6 +903,7 @@ static void parseIgnorelistFile(const std::string& fname, SuffixMatchNode& match
       g_slog->withName("config")->error(Logr::Warning, e.what(), "Ignoring line of ignorelist due to an error", "exception", Logging::Loggable("std::exception"));
     }
   }
+  matchNode.compact();
 }
 
 static void setupNODGlobal()
@@ -1348,6 +1349,8 @@ static std::shared_ptr<NetmaskGroup> parseACL(const std::string& aclFile, const
     log->info(Logr::Info, "Setting access control", "acl", Logging::Loggable(aclSetting), "addresses", Logging::IterLoggable(ips.begin(), ips.end()));
   }
 
+  // checked for every incoming query and never modified afterwards
+  result->compress();
   return result;
 }
 
@@ -1722,6 +1725,7 @@ static int initDNSSEC(Logr::log_t log)
   g_maxNSEC3sPerRecordToConsider = ::arg().asNum("max-nsec3s-per-record");
   g_maxDNSKEYsToConsider = ::arg().asNum("max-dnskeys");
   g_maxDSsToConsider = ::arg().asNum("max-ds-per-zone");
+  pdns::validation::setVerificationCacheSizes(::arg().asNum("dnskey-cache-size"), ::arg().asNum("signature-cache-size"));
 
   vector<string> nums;
   bool automatic = true;
@@ -1792,6 +1796,7 @@ static int initSyncRes(Logr::log_t log)
   SyncRes::s_maxnsec3iterationsperq = ::arg().asNum("max-nsec3-hash-computations-per-query");
   SyncRes::s_rootNXTrust = ::arg().mustDo("root-nx-trust");
   SyncRes::s_refresh_ttlperc = ::arg().asNum("refresh-on-ttl-perc");
+  setRefreshTaskMaxQPS(::arg().asNum("refresh-max-qps"));
   SyncRes::s_locked_ttlperc = ::arg().asNum("record-cache-locked-ttl-perc");
   RecursorPacketCache::s_refresh_ttlperc = SyncRes::s_refresh_ttlperc;
   SyncRes::s_tcp_fast_open = ::arg().asNum("tcp-fast-open");
@@ -1826,6 +1831,7 @@ static int initSyncRes(Logr::log_t log)
   SyncRes::s_ecsipv4nevercache = ::arg().mustDo("ecs-ipv4-never-cache");
   SyncRes::s_ecsipv6nevercache = ::arg().mustDo("ecs-ipv6-never-cache");
   SyncRes::s_ecscachelimitttl = ::arg().asNum("ecs-cache-limit-ttl");
+  MemRecursorCache::s_maxECSPrefixesPerName = ::arg().asNum("ecs-cache-max-prefixes-per-name");
 
   SyncRes::s_qnameminimization = ::arg().mustDo("qname-minimization");
   SyncRes::s_minimize_one_label = ::arg().asNum("qname-minimize-one-label");
@@ -2135,6 +2141,38 @@ static int initDNS64(Logr::log_t log)
   return 0;
 }
 
+static size_t s_cachePruneThreads;
+static size_t s_cachePruneBatchSize;
+
+static PruneControl cachePruneControl(size_t part, size_t parts)
+{
+  return PruneControl{s_cachePruneBatchSize, part, parts, [](uint64_t usec) {
+                        t_Counters.at(rec::Histogram::cachePrunePauses)(usec);
+                      }};
+}
+
+static void startCachePruneThreads()
+{
+  for (size_t part = 0; part < s_cachePruneThreads; ++part) {
+    std::thread thread([part]() {
+      setThreadName("rec/prune");
+      const auto control = cachePruneControl(part, s_cachePruneThreads);
+      while (true) {
+        struct timeval now{};
+        Utility::gettimeofday(&now);
+        if (g_packetCache) {
+          g_packetCache->doPruneTo(now.tv_sec, g_maxPacketCacheEntries, control);
+        }
+        g_recCache->doPrune(now.tv_sec, g_maxCacheEntries, control);
+        g_negCache->prune(now.tv_sec, g_maxCacheEntries / 8, control);
+        t_Counters.updateSnap(now, g_regressionTestMode);
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+      }
+    });
+    thread.detach();
+  }
+}
+
 static int serviceMain(Logr::log_t log)
 {
   g_log.setName(g_programname);
@@ -2164,6 +2202,8 @@ static int serviceMain(Logr::log_t log)
     return ret;
   }
   g_maxCacheEntries = ::arg().asNum("max-cache-entries");
+  s_cachePruneThreads = ::arg().asNum("cache-prune-threads");
+  s_cachePruneBatchSize = std::max(1, ::arg().asNum("cache-prune-batch-size"));
 
   auto luaResult = luaconfig(false);
   if (luaResult.d_ret != 0) {
@@ -2322,6 +2362,8 @@ static int serviceMain(Logr::log_t log)
 
   g_useKernelTimestamp = ::arg().mustDo("protobuf-use-kernel-timestamp");
   g_maxChainLength = ::arg().asNum("max-chain-length");
+  g_outgoingUDPSocketMaxUses = std::max(1, ::arg().asNum("udp-socket-max-uses"));
+  g_outgoingUDPSocketPoolSize = ::arg().asNum("udp-socket-pool-size");
 
   checkOrFixFDS(listeningSockets, log);
   checkOrFixLinuxMapCountLimits(log);
@@ -2377,6 +2419,8 @@ static int serviceMain(Logr::log_t log)
   setupNODThread(log);
 #endif /* NOD_ENABLED */
 
+  startCachePruneThreads();
+
   runStartStopLua(true, log);
   ret = RecThreadInfo::runThreads(log);
   runStartStopLua(false, log);
@@ -2681,21 +2725,25 @@ static void houseKeepingWork(Logr::log_t log)
     });
   }
   else if (info.isHandler()) {
-    if (g_packetCache) {
-      static PeriodicTask packetCacheTask{"packetCacheTask", 5};
-      packetCacheTask.runIfDue(now, [now]() {
-        g_packetCache->doPruneTo(now.tv_sec, g_maxPacketCacheEntries);
+    // Unless dedicated threads take care of it
+    if (s_cachePruneThreads == 0) {
+      static const auto control = cachePruneControl(0, 1);
+      if (g_packetCache) {
+        static PeriodicTask packetCacheTask{"packetCacheTask", 5};
+        packetCacheTask.runIfDue(now, [now]() {
+          g_packetCache->doPruneTo(now.tv_sec, g_maxPacketCacheEntries, control);
+        });
+      }
+      static PeriodicTask recordCachePruneTask{"RecordCachePruneTask", 5};
+      recordCachePruneTask.runIfDue(now, [now]() {
+        g_recCache->doPrune(now.tv_sec, g_maxCacheEntries, control);
       });
-    }
-    static PeriodicTask recordCachePruneTask{"RecordCachePruneTask", 5};
-    recordCachePruneTask.runIfDue(now, [now]() {
-      g_recCache->doPrune(now.tv_sec, g_maxCacheEntries);
-    });
 
-    static PeriodicTask negCachePruneTask{"NegCachePrunteTask", 5};
-    negCachePruneTask.runIfDue(now, [now]() {
-      g_negCache->prune(now.tv_sec, g_maxCacheEntries / 8);
-    });
+      static PeriodicTask negCachePruneTask{"NegCachePrunteTask", 5};
+      negCachePruneTask.runIfDue(now, [now]() {
+        g_negCache->prune(now.tv_sec, g_maxCacheEntries / 8, control);
+      });
+    }
 
     static PeriodicTask aggrNSECPruneTask{"AggrNSECPruneTask", 5};
     aggrNSECPruneTask.runIfDue(now, [now]() {
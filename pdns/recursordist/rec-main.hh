@@ -24,6 +24,12 @@
 
 #include "config.h"
 
+#include <unordered_map>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/key_extractors.hpp>
+
 #include "logr.hh"
 #include "iputils.hh"
 #include "lua-recursor4.hh"
@@ -150,15 +156,70 @@ extern DoneRunning g_doneRunning;
 // you can ask this class for a UDP socket to send a query from
 // this socket is not yours, don't even think about deleting it
 // but after you call 'returnSocket' on it, don't assume anything anymore
+//
+// If g_outgoingUDPSocketMaxUses is larger than 1, sockets that got a proper answer are kept
+// (still bound and connected) in a per-thread pool of idle sockets and handed out again for
+// the next query to the same remote, at most g_outgoingUDPSocketMaxUses times in total.
 class UDPClientSocks
 {
 public:
+  UDPClientSocks() = default;
+  UDPClientSocks(const UDPClientSocks&) = delete;
+  UDPClientSocks& operator=(const UDPClientSocks&) = delete;
+  ~UDPClientSocks();
+
   LWResult::Result getSocket(const ComboAddress& toaddr, const std::optional<pdns::AddressAndInterface>& localAddress, std::optional<pdns::Interface>& interface, int* fileDesc);
 
   // return a socket to the pool, or simply erase it
-  void returnSocket(int fileDesc);
+  // only sockets that received the answer they were waiting for should be marked reusable
+  void returnSocket(int fileDesc, bool reusable = false);
+
+  // an unexpected packet was received on this socket, never reuse it
+  void markSuspicious(int fileDesc);
+
+  [[nodiscard]] size_t idleSockets() const
+  {
+    return d_idle.size();
+  }
 
 private:
+  struct InUseSocket
+  {
+    ComboAddress d_remote;
+    std::optional<pdns::Interface> d_interface;
+    unsigned int d_uses{0};
+    bool d_suspicious{false};
+  };
+
+  struct IdleSocket
+  {
+    ComboAddress d_remote;
+    std::optional<pdns::Interface> d_interface;
+    time_t d_lastUsed{0};
+    unsigned int d_uses{0};
+    int d_fd{-1};
+  };
+
+  struct RemoteTag
+  {
+  };
+  struct SequencedTag
+  {
+  };
+
+  using idle_t = boost::multi_index_container<
+    IdleSocket,
+    boost::multi_index::indexed_by<
+      boost::multi_index::hashed_non_unique<boost::multi_index::tag<RemoteTag>, boost::multi_index::member<IdleSocket, ComboAddress, &IdleSocket::d_remote>, ComboAddress::addressPortOnlyHash>,
+      boost::multi_index::sequenced<boost::multi_index::tag<SequencedTag>>>>;
+
+  // returns -1 if no usable idle socket connected to toaddr is available
+  int getIdleSocket(const ComboAddress& toaddr, std::optional<pdns::Interface>& interface);
+  void closeSocket(int fileDesc);
+  void pruneIdle(time_t now);
+
+  idle_t d_idle;
+  std::unordered_map<int, InUseSocket> d_inUse;
   unsigned int d_numsocks{0};
   // returns -1 for errors which might go away, throws for ones that won't
   static int makeClientSocket(int family, const std::optional<pdns::AddressAndInterface>& localAddress, std::optional<pdns::Interface>& interface);
@@ -200,6 +261,8 @@ extern size_t g_maxUDPQueriesPerRound;
 extern bool g_useKernelTimestamp;
 extern bool g_allowNoRD;
 extern unsigned int g_maxChainLength;
+extern unsigned int g_outgoingUDPSocketMaxUses;
+extern size_t g_outgoingUDPSocketPoolSize;
 extern thread_local std::shared_ptr<NetmaskGroup> t_allowFrom;
 extern thread_local std::shared_ptr<NetmaskGroup> t_allowNotifyFrom;
 extern thread_local std::shared_ptr<notifyset_t> t_allowNotifyFor;
@@ -20,6 +20,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <limits>
+
 #include "rec-taskqueue.hh"
 #include "taskqueue.hh"
 #include "lock.hh"
@@ -97,10 +99,46 @@ private:
   unsigned int d_count{0};
 };
 
+// Token bucket limiting the number of refresh tasks started per second, allowing a burst of one
+// second worth of tasks. A rate of zero means no limit.
+class TaskBudget
+{
+public:
+  void setRate(uint32_t rate)
+  {
+    d_rate = rate;
+    d_tokens = rate;
+  }
+
+  bool take(const struct timeval& now)
+  {
+    if (d_rate == 0) {
+      return true;
+    }
+    double elapsed = static_cast<double>(now.tv_sec - d_last.tv_sec) + static_cast<double>(now.tv_usec - d_last.tv_usec) / 1000000.0;
+    if (elapsed > 0) {
+      d_tokens = std::min(static_cast<double>(d_rate), d_tokens + elapsed * d_rate);
+      d_last = now;
+    }
+    if (d_tokens < 1.0) {
+      return false;
+    }
+    d_tokens -= 1.0;
+    return true;
+  }
+
+private:
+  struct timeval d_last{0, 0};
+  double d_tokens{0};
+  uint32_t d_rate{0};
+};
+
 struct Queue
 {
   pdns::TaskQueue queue;
+  pdns::RefreshTaskQueue refreshQueue;
   TimedSet rateLimitSet{60};
+  TaskBudget refreshBudget;
 };
 static LockGuarded<Queue> s_taskQueue;
 
@@ -235,29 +273,51 @@ void runTasks(size_t max, bool logErrors)
 bool runTaskOnce(bool logErrors)
 {
   pdns::ResolveTask task;
+  bool refresh = false;
   {
     auto lock = s_taskQueue.lock();
-    if (lock->queue.empty()) {
-      return false;
+    if (!lock->queue.empty()) {
+      task = lock->queue.pop();
+    }
+    else {
+      struct timeval now{};
+      Utility::gettimeofday(&now);
+      // Expired refresh tasks are dropped without running them, so they do not use up the budget
+      while (!lock->refreshQueue.empty() && lock->refreshQueue.top().d_deadline < now.tv_sec) {
+        lock->refreshQueue.dropTop();
+        lock->refreshQueue.incExpired();
+      }
+      if (lock->refreshQueue.empty() || !lock->refreshBudget.take(now)) {
+        return false;
+      }
+      task = lock->refreshQueue.pop();
+      refresh = true;
     }
-    task = lock->queue.pop();
   }
   bool expired = task.run(logErrors);
-  if (expired) {
+  if (refresh) {
+    auto lock = s_taskQueue.lock();
+    lock->refreshQueue.done(task);
+    if (expired) {
+      lock->refreshQueue.incExpired();
+    }
+  }
+  else if (expired) {
     s_taskQueue.lock()->queue.incExpired();
   }
   return true;
 }
 
-void pushAlmostExpiredTask(const DNSName& qname, uint16_t qtype, time_t deadline, const Netmask& netmask, bool force)
+void pushAlmostExpiredTask(const DNSName& qname, uint16_t qtype, time_t deadline, const Netmask& netmask, bool force, uint32_t popularity)
 {
   if (SyncRes::isUnsupported(qtype)) {
     auto log = g_slog->withName("taskq")->withValues("name", Logging::Loggable(qname), "qtype", Logging::Loggable(QType(qtype).toString()), "netmask", Logging::Loggable(netmask.empty() ? "" : netmask.toString()));
     log->error(Logr::Error, "Cannot push task", "qtype unsupported");
     return;
   }
-  pdns::ResolveTask task{qname, qtype, deadline, force ? pdns::ResolveTask::ResolveTask::Forced : pdns::ResolveTask::RefreshMode::Refresh, resolve, {}, {}, netmask};
-  if (s_taskQueue.lock()->queue.push(std::move(task))) {
+  // Forced refreshes are explicitly requested, so they go before anything seen by clients
+  pdns::ResolveTask task{qname, qtype, deadline, force ? pdns::ResolveTask::ResolveTask::Forced : pdns::ResolveTask::RefreshMode::Refresh, resolve, {}, {}, netmask, force ? std::numeric_limits<uint32_t>::max() : popularity};
+  if (s_taskQueue.lock()->refreshQueue.push(std::move(task))) {
     ++s_almost_expired_tasks.pushed;
   }
 }
@@ -298,29 +358,44 @@ bool pushTryDoTTask(const DNSName& qname, uint16_t qtype, const ComboAddress& ip
 
 uint64_t getTaskPushes()
 {
-  return s_taskQueue.lock()->queue.getPushes();
+  auto lock = s_taskQueue.lock();
+  return lock->queue.getPushes() + lock->refreshQueue.getPushes();
 }
 
 uint64_t getTaskExpired()
 {
-  return s_taskQueue.lock()->queue.getExpired();
+  auto lock = s_taskQueue.lock();
+  return lock->queue.getExpired() + lock->refreshQueue.getExpired();
 }
 
 uint64_t getTaskSize()
 {
-  return s_taskQueue.lock()->queue.size();
+  auto lock = s_taskQueue.lock();
+  return lock->queue.size() + lock->refreshQueue.size();
 }
 
 void taskQueueClear()
 {
   auto lock = s_taskQueue.lock();
   lock->queue.clear();
+  lock->refreshQueue.clear();
   lock->rateLimitSet.clear();
 }
 
 pdns::ResolveTask taskQueuePop()
 {
-  return s_taskQueue.lock()->queue.pop();
+  auto lock = s_taskQueue.lock();
+  if (!lock->queue.empty()) {
+    return lock->queue.pop();
+  }
+  auto task = lock->refreshQueue.pop();
+  lock->refreshQueue.done(task);
+  return task;
+}
+
+void setRefreshTaskMaxQPS(uint32_t qps)
+{
+  s_taskQueue.lock()->refreshBudget.setRate(qps);
 }
 
 uint64_t getAlmostExpiredTasksPushed()
@@ -338,6 +413,16 @@ uint64_t getAlmostExpiredTaskExceptions()
   return s_almost_expired_tasks.exceptions;
 }
 
+uint64_t getAlmostExpiredTasksEvicted()
+{
+  return s_taskQueue.lock()->refreshQueue.getEvicted();
+}
+
+uint64_t getAlmostExpiredTasksDeduplicated()
+{
+  return s_taskQueue.lock()->refreshQueue.getDeduplicated();
+}
+
 uint64_t getResolveTasksPushed()
 {
   return s_almost_expired_tasks.pushed;
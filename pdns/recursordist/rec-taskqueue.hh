@@ -35,11 +35,13 @@ struct ResolveTask;
 }
 void runTasks(size_t max, bool logErrors);
 bool runTaskOnce(bool logErrors);
-void pushAlmostExpiredTask(const DNSName& qname, uint16_t qtype, time_t deadline, const Netmask& netmask, bool force = false);
+void pushAlmostExpiredTask(const DNSName& qname, uint16_t qtype, time_t deadline, const Netmask& netmask, bool force = false, uint32_t popularity = 0);
 void pushResolveTask(const DNSName& qname, uint16_t qtype, time_t now, time_t deadline, bool forceQMOff);
 bool pushTryDoTTask(const DNSName& qname, uint16_t qtype, const ComboAddress& ipAddress, time_t deadline, const DNSName& nsname);
 void taskQueueClear();
 pdns::ResolveTask taskQueuePop();
+// Maximum number of almost expired refresh tasks started per second, 0 is unlimited
+void setRefreshTaskMaxQPS(uint32_t qps);
 
 // General task stats
 uint64_t getTaskPushes();
@@ -55,5 +57,7 @@ uint64_t getResolveTaskExceptions();
 uint64_t getAlmostExpiredTasksPushed();
 uint64_t getAlmostExpiredTasksRun();
 uint64_t getAlmostExpiredTaskExceptions();
+uint64_t getAlmostExpiredTasksEvicted();
+uint64_t getAlmostExpiredTasksDeduplicated();
 
 bool taskQTypeIsSupported(QType qtype);
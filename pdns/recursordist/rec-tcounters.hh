@@ -107,6 +107,9 @@ enum class Counter : uint8_t
   cookieRetry,
   cookieProbeSupported,
   cookieProbeUnsupported,
+  outgoingUDPSocketsOpened,
+  outgoingUDPSocketsReused,
+  outgoingUDPSocketSyscalls,
 
   numberOfCounters
 };
@@ -143,6 +146,7 @@ enum class Histogram : uint8_t
   cumulativeAnswers,
   cumulativeAuth4Answers,
   cumulativeAuth6Answers,
+  cachePrunePauses,
 
   numberOfCounters
 };
@@ -217,7 +221,8 @@ struct Counters
     pdns::Histogram{"ourtime", {1000, 2000, 4000, 8000, 16000, 32000}},
     pdns::Histogram{"cumul-clientanswers-", 10, 19},
     pdns::Histogram{"cumul-authanswers-", 1000, 13},
-    pdns::Histogram{"cumul-authanswers-", 1000, 13}};
+    pdns::Histogram{"cumul-authanswers-", 1000, 13},
+    pdns::Histogram{"cumul-cacheprunepauses-", 10, 16}};
 
   // Response stats
   RecResponseStats responseStats;
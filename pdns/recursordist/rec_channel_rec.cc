@@ -1461,6 +1461,9 @@ static void registerAllStats1()
   addGetStat("cumul-authanswers", []() {
     return toStatsMap(t_Counters.at(rec::Histogram::cumulativeAuth4Answers).getName(), g_Counters.sum(rec::Histogram::cumulativeAuth4Answers), g_Counters.sum(rec::Histogram::cumulativeAuth6Answers));
   });
+  addGetStat("cumul-cacheprunepauses", []() {
+    return toStatsMap(t_Counters.at(rec::Histogram::cachePrunePauses).getName(), g_Counters.sum(rec::Histogram::cachePrunePauses));
+  });
   addGetStat("policy-hits", []() {
     return toRPZStatsMap("policy-hits", g_Counters.sum(rec::PolicyNameHits::policyName).counts);
   });
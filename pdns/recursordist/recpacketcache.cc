@@ -7,6 +7,7 @@
 #include "recpacketcache.hh"
 #include "cachecleaner.hh"
 #include "dns.hh"
+#include "dnsparser.hh"
 #include "namespaces.hh"
 #include "rec-taskqueue.hh"
 
@@ -123,17 +124,19 @@ uint64_t RecursorPacketCache::doWipePacketCache(const std::unordered_set<DNSName
 
 static const std::unordered_set<uint16_t> s_skipOptions = {EDNSOptionCode::ECS, EDNSOptionCode::COOKIE, EDNSOptionCode::TRACEPARENT};
 
-bool RecursorPacketCache::qrMatch(const packetCache_t::index<HashTag>::type::iterator& iter, const std::string& queryPacket, const DNSName& qname, uint16_t qtype, uint16_t qclass)
+template <typename Name>
+bool RecursorPacketCache::qrMatch(const packetCache_t::index<HashTag>::type::iterator& iter, const std::string& queryPacket, const Name& qname, uint16_t qtype, uint16_t qclass)
 {
   // this ignores checking on the EDNS subnet flags!
   if (qname != iter->d_name || iter->d_type != qtype || iter->d_class != qclass) {
     return false;
   }
 
-  return queryMatches(iter->d_query, queryPacket, qname, s_skipOptions);
+  return queryMatches(iter->d_query, queryPacket, qname.wirelength(), s_skipOptions);
 }
 
-bool RecursorPacketCache::checkResponseMatches(MapCombo::LockedContent& shard, std::pair<packetCache_t::index<HashTag>::type::iterator, packetCache_t::index<HashTag>::type::iterator> range, const std::string& queryPacket, const DNSName& qname, uint16_t qtype, uint16_t qclass, time_t now, std::string* responsePacket, uint32_t* age, vState* valState, OptPBData* pbdata)
+template <typename Name>
+bool RecursorPacketCache::checkResponseMatches(MapCombo::LockedContent& shard, std::pair<packetCache_t::index<HashTag>::type::iterator, packetCache_t::index<HashTag>::type::iterator> range, const std::string& queryPacket, const Name& qname, uint16_t qtype, uint16_t qclass, time_t now, std::string* responsePacket, uint32_t* age, vState* valState, OptPBData* pbdata)
 {
   for (auto iter = range.first; iter != range.second; ++iter) {
     // the possibility is VERY real that we get hits that are not right - birthday paradox
@@ -142,6 +145,7 @@ bool RecursorPacketCache::checkResponseMatches(MapCombo::LockedContent& shard, s
     }
 
     if (now < iter->d_ttd) { // it is right, it is fresh!
+      iter->d_hits.hit();
       // coverity[store_truncates_time_t]
       *age = static_cast<uint32_t>(now - iter->d_creation);
       // we know ttl is > 0
@@ -156,7 +160,7 @@ bool RecursorPacketCache::checkResponseMatches(MapCombo::LockedContent& shard, s
           const bool almostExpired = ttl <= deadline;
           if (almostExpired) {
             iter->d_submitted = true;
-            pushAlmostExpiredTask(qname, qtype, iter->d_ttd, Netmask());
+            pushAlmostExpiredTask(iter->d_name, qtype, iter->d_ttd, Netmask(), false, iter->d_hits.value());
           }
         }
       }
@@ -214,18 +218,31 @@ bool RecursorPacketCache::getResponsePacket(unsigned int tag, const std::string&
 {
   *qhash = canHashPacket(queryPacket, s_skipOptions);
   auto& map = getMap(tag, *qhash, tcp);
-  auto shard = map.lock();
-  const auto& idx = shard->d_map.get<HashTag>();
-  auto range = idx.equal_range(std::tie(tag, *qhash, tcp));
+  const DNSPacketView::NameView qnameView(queryPacket, sizeof(dnsheader));
+  bool found = false;
+  {
+    auto shard = map.lock();
+    const auto& idx = shard->d_map.get<HashTag>();
+    auto range = idx.equal_range(std::tie(tag, *qhash, tcp));
 
-  if (range.first == range.second) {
-    shard->d_misses++;
-    return false;
-  }
+    if (range.first == range.second) {
+      shard->d_misses++;
+      return false;
+    }
+
+    // match against the name in the packet, so that the DNSName is not built while holding the lock
+    const size_t pos = sizeof(dnsheader) + qnameView.getOnWireLength(false);
+    if (pos + 4 > queryPacket.size()) {
+      throw std::range_error("Trying to read qtype and qclass past the end of the buffer (" + std::to_string(pos + 4) + " > " + std::to_string(queryPacket.size()) + ")");
+    }
+    *qtype = static_cast<uint8_t>(queryPacket[pos]) * 256 + static_cast<uint8_t>(queryPacket[pos + 1]);
+    *qclass = static_cast<uint8_t>(queryPacket[pos + 2]) * 256 + static_cast<uint8_t>(queryPacket[pos + 3]);
 
-  qname = DNSName(queryPacket.c_str(), static_cast<int>(queryPacket.length()), sizeof(dnsheader), false, qtype, qclass);
+    found = checkResponseMatches(*shard, range, queryPacket, qnameView, *qtype, *qclass, now, responsePacket, age, valState, pbdata);
+  }
 
-  return checkResponseMatches(*shard, range, queryPacket, qname, *qtype, *qclass, now, responsePacket, age, valState, pbdata);
+  qname = qnameView.toDNSName();
+  return found;
 }
 
 void RecursorPacketCache::insertResponsePacket(unsigned int tag, uint32_t qhash, std::string&& query, const DNSName& qname, uint16_t qtype, uint16_t qclass, std::string&& responsePacket, time_t now, uint32_t ttl, const vState& valState, OptPBData&& pbdata, bool tcp)
@@ -244,6 +261,9 @@ void RecursorPacketCache::insertResponsePacket(unsigned int tag, uint32_t qhash,
     moveCacheItemToBack<SequencedTag>(shard->d_map, iter);
     iter->d_packet = std::move(responsePacket);
     iter->d_query = std::move(query);
+    if (now + ttl < iter->d_ttd) {
+      resetCacheItemExpiry<ExpiryTag>(shard->d_map, iter);
+    }
     iter->d_ttd = now + ttl;
     iter->d_creation = now;
     iter->d_vstate = valState;
@@ -271,10 +291,9 @@ void RecursorPacketCache::insertResponsePacket(unsigned int tag, uint32_t qhash,
   assert(map.getEntriesCount() == shard->d_map.size()); // NOLINT(cppcoreguidelines-pro-bounds-array-to-pointer-decay): clib implementation
 }
 
-void RecursorPacketCache::doPruneTo(time_t now, size_t maxSize)
+void RecursorPacketCache::doPruneTo(time_t now, size_t maxSize, const PruneControl& control)
 {
-  size_t cacheSize = size();
-  pruneMutexCollectionsVector<SequencedTag>(now, d_maps, maxSize, cacheSize);
+  pruneMutexCollectionsVector<SequencedTag, ExpiryTag>(now, d_maps, maxSize, control);
 }
 
 uint64_t RecursorPacketCache::doDump(int file)
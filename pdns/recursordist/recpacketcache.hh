@@ -31,6 +31,7 @@
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/key_extractors.hpp>
 
+#include "cachecleaner.hh"
 #include "packetcache.hh"
 #include "validate.hh"
 #include "lock.hh"
@@ -83,7 +84,7 @@ public:
   bool getResponsePacket(unsigned int tag, const std::string& queryPacket, DNSName& qname, uint16_t* qtype, uint16_t* qclass, time_t now, std::string* responsePacket, uint32_t* age, vState* valState, uint32_t* qhash, OptPBData* pbdata, bool tcp);
 
   void insertResponsePacket(unsigned int tag, uint32_t qhash, std::string&& query, const DNSName& qname, uint16_t qtype, uint16_t qclass, std::string&& responsePacket, time_t now, uint32_t ttl, const vState& valState, OptPBData&& pbdata, bool tcp);
-  void doPruneTo(time_t now, size_t maxSize);
+  void doPruneTo(time_t now, size_t maxSize, const PruneControl& control = PruneControl());
   uint64_t doDump(int file);
   uint64_t doWipePacketCache(const DNSName& name, uint16_t qtype = 0xffff, bool subtree = false);
   uint64_t doWipePacketCache(const std::unordered_set<DNSName>& names);
@@ -127,6 +128,7 @@ private:
     mutable std::string d_query;
     mutable OptPBData d_pbdata;
     mutable time_t d_ttd;
+    time_t d_expiry{0}; // key of the expiry index, only updated by pruning
     mutable time_t d_creation; // so we can 'age' our packets
     uint32_t d_qhash;
     uint32_t d_tag;
@@ -134,12 +136,18 @@ private:
     uint16_t d_class;
     mutable vState d_vstate;
     mutable bool d_submitted{false}; // whether this entry has been queued for refetch
+    HitCounter d_hits; // popularity of this entry, used to prioritize refetches
     bool d_tcp; // whether this entry was created from a TCP query
     inline bool operator<(const struct Entry& rhs) const;
 
+    [[nodiscard]] time_t getStaleTime() const
+    {
+      return d_ttd;
+    }
+
     bool isStale(time_t now) const
     {
-      return d_ttd < now;
+      return getStaleTime() < now;
     }
 
     uint32_t getOrigTTL() const
@@ -157,6 +165,9 @@ private:
   struct SequencedTag
   {
   };
+  struct ExpiryTag
+  {
+  };
   using packetCache_t = multi_index_container<Entry,
                                               indexed_by<hashed_non_unique<tag<HashTag>,
                                                                            composite_key<Entry,
@@ -164,7 +175,8 @@ private:
                                                                                          member<Entry, uint32_t, &Entry::d_qhash>,
                                                                                          member<Entry, bool, &Entry::d_tcp>>>,
                                                          sequenced<tag<SequencedTag>>,
-                                                         ordered_non_unique<tag<NameTag>, member<Entry, DNSName, &Entry::d_name>, CanonDNSNameCompare>>>;
+                                                         ordered_non_unique<tag<NameTag>, member<Entry, DNSName, &Entry::d_name>, CanonDNSNameCompare>,
+                                                         ordered_non_unique<tag<ExpiryTag>, member<Entry, time_t, &Entry::d_expiry>>>>;
 
   struct MapCombo
   {
@@ -239,8 +251,11 @@ private:
     return d_maps.at(combine(tag, hash, tcp) % d_maps.size());
   }
 
-  static bool qrMatch(const packetCache_t::index<HashTag>::type::iterator& iter, const std::string& queryPacket, const DNSName& qname, uint16_t qtype, uint16_t qclass);
-  static bool checkResponseMatches(MapCombo::LockedContent& shard, std::pair<packetCache_t::index<HashTag>::type::iterator, packetCache_t::index<HashTag>::type::iterator> range, const std::string& queryPacket, const DNSName& qname, uint16_t qtype, uint16_t qclass, time_t now, std::string* responsePacket, uint32_t* age, vState* valState, OptPBData* pbdata);
+  // Name is either a DNSName or a DNSPacketView::NameView into the query packet
+  template <typename Name>
+  static bool qrMatch(const packetCache_t::index<HashTag>::type::iterator& iter, const std::string& queryPacket, const Name& qname, uint16_t qtype, uint16_t qclass);
+  template <typename Name>
+  static bool checkResponseMatches(MapCombo::LockedContent& shard, std::pair<packetCache_t::index<HashTag>::type::iterator, packetCache_t::index<HashTag>::type::iterator> range, const std::string& queryPacket, const Name& qname, uint16_t qtype, uint16_t qclass, time_t now, std::string* responsePacket, uint32_t* age, vState* valState, OptPBData* pbdata);
 
   void setShardSizes(size_t shardSize);
 };
@@ -77,6 +77,7 @@ uint16_t MemRecursorCache::s_maxServedStaleExtensions;
 uint16_t MemRecursorCache::s_maxRRSetSize = 256;
 bool MemRecursorCache::s_limitQTypeAny = true;
 uint32_t MemRecursorCache::s_maxEntrySize = 8192;
+uint32_t MemRecursorCache::s_maxECSPrefixesPerName = 0;
 
 const MemRecursorCache::AuthRecs MemRecursorCache::s_emptyAuthRecs = std::make_shared<MemRecursorCache::AuthRecsVec>();
 const MemRecursorCache::SigRecs MemRecursorCache::s_emptySigRecs = std::make_shared<MemRecursorCache::SigRecsVec>();
@@ -91,6 +92,7 @@ void MemRecursorCache::resetStaticsForTests()
   s_maxRRSetSize = 256;
   s_limitQTypeAny = true;
   s_maxEntrySize = 8192;
+  s_maxECSPrefixesPerName = 0;
 }
 
 MemRecursorCache::MemRecursorCache(size_t mapsCount) :
@@ -111,10 +113,9 @@ pair<uint64_t, uint64_t> MemRecursorCache::stats()
 {
   uint64_t contended = 0;
   uint64_t acquired = 0;
-  for (auto& shard : d_maps) {
-    auto lockedShard = shard.lock();
-    contended += lockedShard->d_contended_count;
-    acquired += lockedShard->d_acquired_count;
+  for (const auto& shard : d_maps) {
+    contended += shard.getContendedCount();
+    acquired += shard.getAcquiredCount();
   }
   return {contended, acquired};
 }
@@ -130,6 +131,18 @@ size_t MemRecursorCache::ecsIndexSize()
   return count;
 }
 
+size_t MemRecursorCache::ecsEntriesCount()
+{
+  size_t count = 0;
+  for (auto& shard : d_maps) {
+    auto lockedShard = shard.lock();
+    for (const auto& ecsIndex : lockedShard->d_ecsIndex) {
+      count += ecsIndex.size();
+    }
+  }
+  return count;
+}
+
 size_t MemRecursorCache::CacheEntry::authRecsSizeEstimate() const
 {
   size_t ret = 0;
@@ -165,6 +178,20 @@ size_t MemRecursorCache::CacheEntry::sizeEstimate() const
   return ret;
 }
 
+size_t MemRecursorCache::CacheEntry::amortizedSizeEstimate() const
+{
+  auto ret = sizeof(struct CacheEntry);
+  ret += d_qname.sizeEstimate();
+  ret += d_authZone.sizeEstimate();
+  for (const auto& record : d_records) {
+    // the use count also includes references held outside of the cache, so this is a rough estimate
+    ret += record->sizeEstimate() / std::max(1L, record.use_count());
+  }
+  ret += authRecsSizeEstimate();
+  ret += sigRecsSizeEstimate();
+  return ret;
+}
+
 // this function is too slow to poll!
 size_t MemRecursorCache::bytes()
 {
@@ -172,7 +199,7 @@ size_t MemRecursorCache::bytes()
   for (auto& shard : d_maps) {
     auto lockedShard = shard.lock();
     for (const auto& entry : lockedShard->d_map) {
-      ret += entry.sizeEstimate();
+      ret += entry.amortizedSizeEstimate();
     }
   }
   return ret;
@@ -212,86 +239,97 @@ static void ptrAssign(T* ptr, const T& value)
 
 // If the authorityRecs is non-null, it should refer to a un-set shared_ptr, or a shared_ptr pointing to an empty vector
 // See the assert in the processing of authorityRecs.
-time_t MemRecursorCache::handleHit(time_t now, MapCombo::LockedContent& content, OrderedTagIterator_t& entry, const DNSName& qname, uint32_t& origTTL, vector<DNSRecord>* res, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, std::optional<vState>& state, bool* wasAuth, DNSName* fromAuthZone, Extra* extra)
+// Fills the output parameters from the entry without modifying the cache, so it can be called
+// while holding a shared lock.
+time_t MemRecursorCache::readHit(time_t now, const CacheEntry& entry, const DNSName& qname, uint32_t& origTTL, vector<DNSRecord>* res, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, std::optional<vState>& state, bool* wasAuth, DNSName* fromAuthZone, Extra* extra)
 {
-  // MUTEX SHOULD BE ACQUIRED (as indicated by the reference to the content which is protected by a lock)
-  if (entry->d_tooBig) {
+  // MUTEX SHOULD BE ACQUIRED (shared mode is sufficient)
+  if (entry.d_tooBig) {
     throw ImmediateServFailException("too many records in RRSet");
   }
-  time_t ttd = entry->d_ttd;
+  time_t ttd = entry.d_ttd;
+  entry.d_hits.hit();
   if (ttd <= now) {
     // Expired, don't bother returning contents. Callers *MUST* check return value of get(), and only look at the entry
     // if it returned > 0
     return ttd;
   }
-  origTTL = entry->d_orig_ttl;
+  origTTL = entry.d_orig_ttl;
 
-  if (!entry->d_netmask.empty() || !entry->d_rtag.empty()) {
+  if (!entry.d_netmask.empty() || !entry.d_rtag.empty()) {
     ptrAssign(variable, true);
   }
 
   if (res != nullptr) {
-    if (s_limitQTypeAny && res->size() + entry->d_records.size() > s_maxRRSetSize) {
+    if (s_limitQTypeAny && res->size() + entry.d_records.size() > s_maxRRSetSize) {
       throw ImmediateServFailException("too many records in result");
     }
 
-    res->reserve(res->size() + entry->d_records.size());
+    res->reserve(res->size() + entry.d_records.size());
 
-    for (const auto& record : entry->d_records) {
+    for (const auto& record : entry.d_records) {
       DNSRecord result;
       result.d_name = qname;
-      result.d_type = entry->d_qtype;
+      result.d_type = entry.d_qtype;
       result.d_class = QClass::IN;
       result.setContent(record);
       // coverity[store_truncates_time_t]
-      result.d_ttl = static_cast<uint32_t>(entry->d_ttd);
+      result.d_ttl = static_cast<uint32_t>(entry.d_ttd);
       result.d_place = DNSResourceRecord::ANSWER;
       res->push_back(std::move(result));
     }
   }
 
   if (signatures != nullptr) {
-    if (*signatures && !(*signatures)->empty() && entry->d_signatures && !entry->d_signatures->empty()) {
+    if (*signatures && !(*signatures)->empty() && entry.d_signatures && !entry.d_signatures->empty()) {
       // Return a new vec if we need to append to a non-empty vector
       SigRecsVec vec(**signatures);
-      vec.insert(vec.end(), entry->d_signatures->cbegin(), entry->d_signatures->cend());
+      vec.insert(vec.end(), entry.d_signatures->cbegin(), entry.d_signatures->cend());
       *signatures = std::make_shared<SigRecsVec>(std::move(vec));
     }
     else {
-      *signatures = entry->d_signatures ? entry->d_signatures : s_emptySigRecs;
+      *signatures = entry.d_signatures ? entry.d_signatures : s_emptySigRecs;
     }
   }
 
   if (authorityRecs != nullptr) {
     // XXX Might need to be adapted like sigs to handle a non-empty incoming authorityRecs
     assert(*authorityRecs == nullptr || (*authorityRecs)->empty());
-    *authorityRecs = entry->d_authorityRecs ? entry->d_authorityRecs : s_emptyAuthRecs;
+    *authorityRecs = entry.d_authorityRecs ? entry.d_authorityRecs : s_emptyAuthRecs;
   }
 
-  updateDNSSECValidationStateFromCache(state, entry->d_state);
+  updateDNSSECValidationStateFromCache(state, entry.d_state);
 
   if (wasAuth != nullptr) {
-    *wasAuth = *wasAuth && entry->d_auth;
+    *wasAuth = *wasAuth && entry.d_auth;
   }
-  ptrAssign(fromAuthZone, entry->d_authZone);
+  ptrAssign(fromAuthZone, entry.d_authZone);
   if (extra != nullptr) {
-    extra->d_address = entry->d_from;
-    extra->d_tcp = entry->d_tcp;
+    extra->d_address = entry.d_from;
+    extra->d_tcp = entry.d_tcp;
   }
 
-  moveCacheItemToBack<SequencedTag>(content.d_map, entry);
+  return ttd;
+}
 
+time_t MemRecursorCache::handleHit(time_t now, MapCombo::LockedContent& content, OrderedTagIterator_t& entry, const DNSName& qname, uint32_t& origTTL, vector<DNSRecord>* res, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, std::optional<vState>& state, bool* wasAuth, DNSName* fromAuthZone, Extra* extra)
+{
+  // MUTEX SHOULD BE ACQUIRED (as indicated by the reference to the content which is protected by a lock)
+  time_t ttd = readHit(now, *entry, qname, origTTL, res, signatures, authorityRecs, variable, state, wasAuth, fromAuthZone, extra);
+  if (ttd > now) {
+    moveCacheItemToBack<SequencedTag>(content.d_map, entry);
+  }
   return ttd;
 }
 
-static void pushRefreshTask(const DNSName& qname, QType qtype, time_t deadline, const Netmask& netmask)
+static void pushRefreshTask(const DNSName& qname, QType qtype, time_t deadline, const Netmask& netmask, uint32_t popularity)
 {
   if (qtype == QType::ADDR) {
-    pushAlmostExpiredTask(qname, QType::A, deadline, netmask);
-    pushAlmostExpiredTask(qname, QType::AAAA, deadline, netmask);
+    pushAlmostExpiredTask(qname, QType::A, deadline, netmask, false, popularity);
+    pushAlmostExpiredTask(qname, QType::AAAA, deadline, netmask, false, popularity);
   }
   else {
-    pushAlmostExpiredTask(qname, qtype, deadline, netmask);
+    pushAlmostExpiredTask(qname, qtype, deadline, netmask, false, popularity);
   }
 }
 
@@ -305,7 +343,7 @@ void MemRecursorCache::updateStaleEntry(time_t now, MemRecursorCache::OrderedTag
   entry->d_servedStale = std::min(entry->d_servedStale + 1 + howlong / extension, static_cast<time_t>(s_maxServedStaleExtensions));
   entry->d_ttd = now + extension;
 
-  pushRefreshTask(entry->d_qname, entry->d_qtype, entry->d_ttd, entry->d_netmask);
+  pushRefreshTask(entry->d_qname, entry->d_qtype, entry->d_ttd, entry->d_netmask, entry->d_hits.value());
 }
 
 // If we are serving this record stale (or *should*) and the ttd has
@@ -326,25 +364,16 @@ MemRecursorCache::cache_t::const_iterator MemRecursorCache::getEntryUsingECSInde
   if (ecsIndex != map.d_ecsIndex.end() && !ecsIndex->isEmpty()) {
     /* we have netmask-specific entries, let's see if we match one */
     while (true) {
-      const Netmask best = ecsIndex->lookupBestMatch(who);
-      if (best.empty()) {
+      const auto* best = ecsIndex->lookupBestMatch(who);
+      if (best == nullptr) {
         /* we have nothing more specific for you */
         break;
       }
-      auto key = std::tuple(qname, qtype, NOTAG, best);
-      auto entry = map.d_map.find(key);
-      if (entry == map.d_map.end()) {
-        /* ecsIndex is not up-to-date */
-        ecsIndex->removeNetmask(best);
-        if (ecsIndex->isEmpty()) {
-          map.d_ecsIndex.erase(ecsIndex);
-          break;
-        }
-        continue;
-      }
+      auto entry = best->d_entry;
       handleServeStaleBookkeeping(now, serveStale, entry);
 
       if (entry->d_ttd > now) {
+        ecsIndex->touch(*best);
         if (!requireAuth || entry->d_auth) {
           return entry;
         }
@@ -354,7 +383,7 @@ MemRecursorCache::cache_t::const_iterator MemRecursorCache::getEntryUsingECSInde
       /* this netmask-specific entry has expired */
       moveCacheItemToFront<SequencedTag>(map.d_map, entry);
       // XXX when serving stale, it should be kept, but we don't want a match wth lookupBestMatch()...
-      ecsIndex->removeNetmask(best);
+      ecsIndex->removeNetmask(entry->d_netmask);
       if (ecsIndex->isEmpty()) {
         map.d_ecsIndex.erase(ecsIndex);
         break;
@@ -394,27 +423,29 @@ MemRecursorCache::Entries MemRecursorCache::getEntries(MapCombo::LockedContent&
   return map.d_cachecache;
 }
 
-bool MemRecursorCache::entryMatches(MemRecursorCache::OrderedTagIterator_t& entry, const QType qtype, bool requireAuth, const ComboAddress& who)
+bool MemRecursorCache::entryMatches(const CacheEntry& entry, const QType qtype, bool requireAuth, const ComboAddress& who)
 {
   // This code assumes that if a routing tag is present, it matches
   // MUTEX SHOULD BE ACQUIRED
-  if (requireAuth && !entry->d_auth) {
+  if (requireAuth && !entry.d_auth) {
     return false;
   }
 
-  bool match = (entry->d_qtype == qtype || qtype == QType::ANY || (qtype == QType::ADDR && (entry->d_qtype == QType::A || entry->d_qtype == QType::AAAA)))
-    && (entry->d_netmask.empty() || entry->d_netmask.match(who));
+  bool match = (entry.d_qtype == qtype || qtype == QType::ANY || (qtype == QType::ADDR && (entry.d_qtype == QType::A || entry.d_qtype == QType::AAAA)))
+    && (entry.d_netmask.empty() || entry.d_netmask.match(who));
   return match;
 }
 
 // Fake a cache miss if more than refreshTTLPerc of the original TTL has passed
-time_t MemRecursorCache::fakeTTD(MemRecursorCache::OrderedTagIterator_t& entry, const DNSName& qname, QType qtype, time_t ret, time_t now, uint32_t origTTL, MemRecursorCache::Flags flags)
+// Sets needsRefreshTask if a refresh task should be pushed for this entry, which is left to the caller
+time_t MemRecursorCache::computeFakeTTD(const CacheEntry& entry, QType qtype, time_t ret, time_t now, uint32_t origTTL, MemRecursorCache::Flags flags, bool& needsRefreshTask)
 {
+  needsRefreshTask = false;
   time_t ttl = ret - now;
   // If we are checking an entry being served stale in refresh mode,
   // we always consider it stale so a real refresh attempt will be
   // kicked by SyncRes
-  if (refresh(flags) && entry->d_servedStale > 0) {
+  if (refresh(flags) && entry.d_servedStale > 0) {
     return -1;
   }
   if (ttl > 0 && (forcedRefresh(flags) || SyncRes::s_refresh_ttlperc > 0)) {
@@ -428,15 +459,88 @@ time_t MemRecursorCache::fakeTTD(MemRecursorCache::OrderedTagIterator_t& entry,
       // We do not want to refresh auth NS entries, as it could lead to ghost domains if an entry
       // expires between submit and response coming in, as the TTL capping then does not work for
       // lack of current TTL info.
-      if (!entry->d_submitted && (qtype != QType::NS || !entry->d_auth)) {
-        pushRefreshTask(qname, qtype, entry->d_ttd, entry->d_netmask);
-        entry->d_submitted = true;
-      }
+      needsRefreshTask = !entry.d_submitted && (qtype != QType::NS || !entry.d_auth);
     }
   }
   return ttl;
 }
 
+time_t MemRecursorCache::fakeTTD(MemRecursorCache::OrderedTagIterator_t& entry, const DNSName& qname, QType qtype, time_t ret, time_t now, uint32_t origTTL, MemRecursorCache::Flags flags)
+{
+  // MUTEX SHOULD BE ACQUIRED (exclusively, d_submitted might be modified)
+  bool needsRefreshTask = false;
+  time_t ttl = computeFakeTTD(*entry, qtype, ret, now, origTTL, flags, needsRefreshTask);
+  if (needsRefreshTask) {
+    pushRefreshTask(qname, qtype, entry->d_ttd, entry->d_netmask, entry->d_hits.value());
+    entry->d_submitted = true;
+  }
+  return ttl;
+}
+
+// Lookup of an untagged entry of a single type (not ANY or ADDR) under a shared lock. Anything that would require modifying
+// the shard (LRU bookkeeping of unusable entries, serve-stale extensions, submitting refresh tasks,
+// ECS index maintenance) makes us return std::nullopt so the caller retries with an exclusive lock.
+// A hit only marks the entry; the LRU order is corrected lazily when pruning.
+std::optional<time_t> MemRecursorCache::getWithSharedLock(MapCombo& shard, time_t now, const DNSName& qname, const QType qtype, Flags flags, vector<DNSRecord>* res, const ComboAddress& who, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, vState* state, bool* wasAuth, DNSName* fromAuthZone, Extra* extra)
+{
+  bool requireAuth = (flags & RequireAuth) != 0;
+  bool serveStale = (flags & ServeStale) != 0;
+
+  auto lockedShard = shard.read_lock();
+  // Netmask-specific entries for this name and type are looked up through the ECS index, which
+  // needs to be maintained. Otherwise only the generic entry can be used, as in getEntryUsingECSIndex()
+  const bool ecsOnlyGeneric = !lockedShard->d_ecsIndex.empty();
+  if (ecsOnlyGeneric) {
+    auto ecsIndex = lockedShard->d_ecsIndex.find(std::tie(qname, qtype));
+    if (ecsIndex != lockedShard->d_ecsIndex.end() && !ecsIndex->isEmpty()) {
+      return std::nullopt;
+    }
+  }
+
+  const auto& idx = lockedShard->d_map.get<NameAndRTagOnlyHashedTag>();
+  auto entries = idx.equal_range(std::tie(qname, NOTAG));
+  const CacheEntry* hit = nullptr;
+  for (auto i = entries.first; i != entries.second; ++i) {
+    // When serving stale, we consider expired records
+    if (!i->isEntryUsable(now, serveStale)) {
+      // the exclusive path moves those to the front of the LRU
+      return std::nullopt;
+    }
+    if (!entryMatches(*i, qtype, requireAuth, who) || (ecsOnlyGeneric && !i->d_netmask.empty())) {
+      continue;
+    }
+    // Normally if we have a hit, we are done, see get()
+    hit = &*i;
+    break;
+  }
+
+  if (hit == nullptr) {
+    return -1;
+  }
+  if (hit->d_ttd <= now) {
+    // serve-stale bookkeeping or expiry needs exclusive access
+    return std::nullopt;
+  }
+
+  bool needsRefreshTask = false;
+  time_t ttl = computeFakeTTD(*hit, qtype, hit->d_ttd, now, hit->d_orig_ttl, flags, needsRefreshTask);
+  if (needsRefreshTask) {
+    return std::nullopt;
+  }
+
+  std::optional<vState> cachedState{std::nullopt};
+  uint32_t origTTL = 0;
+  if (authorityRecs != nullptr) {
+    *authorityRecs = s_emptyAuthRecs;
+  }
+  time_t ttd = readHit(now, *hit, qname, origTTL, res, signatures, authorityRecs, variable, cachedState, wasAuth, fromAuthZone, extra);
+  hit->d_deferredHit.mark();
+  if (cachedState && ttd > now) {
+    ptrAssign(state, *cachedState);
+  }
+  return ttl;
+}
+
 // returns -1 for no hits
 time_t MemRecursorCache::get(time_t now, const DNSName& qname, const QType qtype, Flags flags, vector<DNSRecord>* res, const ComboAddress& who, const OptTag& routingTag, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, vState* state, bool* wasAuth, DNSName* fromAuthZone, Extra* extra) // NOLINT(readability-function-cognitive-complexity)
 {
@@ -455,6 +559,11 @@ time_t MemRecursorCache::get(time_t now, const DNSName& qname, const QType qtype
   ptrAssign(wasAuth, true);
 
   auto& shard = getMap(qname);
+  if (qtype != QType::ANY && qtype != QType::ADDR && routingTag.empty()) {
+    if (auto ret = getWithSharedLock(shard, now, qname, qtype, flags, res, who, signatures, authorityRecs, variable, state, wasAuth, fromAuthZone, extra)) {
+      return *ret;
+    }
+  }
   auto lockedShard = shard.lock();
 
   /* If we don't have any netmask-specific entries at all, let's just skip this
@@ -515,7 +624,7 @@ time_t MemRecursorCache::get(time_t now, const DNSName& qname, const QType qtype
           continue;
         }
 
-        if (!entryMatches(firstIndexIterator, qtype, requireAuth, who)) {
+        if (!entryMatches(*firstIndexIterator, qtype, requireAuth, who)) {
           continue;
         }
         ++found;
@@ -562,7 +671,7 @@ time_t MemRecursorCache::get(time_t now, const DNSName& qname, const QType qtype
         continue;
       }
 
-      if (!entryMatches(firstIndexIterator, qtype, requireAuth, who)) {
+      if (!entryMatches(*firstIndexIterator, qtype, requireAuth, who)) {
         continue;
       }
       ++found;
@@ -655,6 +764,17 @@ bool MemRecursorCache::replace(CacheEntry&& entry)
 
 void MemRecursorCache::replace(time_t now, const DNSName& qname, const QType qtype, const vector<DNSRecord>& content, const SigRecsVec& signatures, const AuthRecsVec& authorityRecs, bool auth, const DNSName& authZone, const std::optional<Netmask>& ednsmaskArg, const OptTag& routingTag, vState state, const std::optional<Extra>& extra, bool refresh, time_t ttl_time)
 {
+  // Done before taking the lock, as this might have to serialize the records
+  const bool tooBig = content.size() > s_maxRRSetSize;
+  CacheEntry::records_t records;
+  records.reserve(tooBig ? 1 : content.size());
+  for (const auto& record : content) {
+    records.push_back(d_interner.intern(record.getContent()));
+    if (tooBig) {
+      break; // record cache does not like empty RRSets
+    }
+  }
+
   auto& shard = getMap(qname);
   auto lockedShard = shard.lock();
 
@@ -681,15 +801,11 @@ void MemRecursorCache::replace(time_t now, const DNSName& qname, const QType qty
      been garbage collected yet) we might need to update the ECS index.
      Otherwise it should already be indexed and we don't need to update it.
   */
+  const bool ecsSpecific = routingTag.empty() && ednsmask && !ednsmask->empty();
   if (isNew || stored->d_ttd <= now) {
     /* don't bother building an ecsIndex if we don't have any netmask-specific entries */
-    if (routingTag.empty() && ednsmask && !ednsmask->empty()) {
-      auto ecsIndexKey = std::tuple(qname, qtype.getCode());
-      auto ecsIndex = lockedShard->d_ecsIndex.find(ecsIndexKey);
-      if (ecsIndex == lockedShard->d_ecsIndex.end()) {
-        ecsIndex = lockedShard->d_ecsIndex.insert(ECSIndexEntry(qname, qtype.getCode())).first;
-      }
-      ecsIndex->addMask(*ednsmask);
+    if (ecsSpecific) {
+      addToECSIndex(shard, *lockedShard, stored);
     }
   }
 
@@ -727,7 +843,6 @@ void MemRecursorCache::replace(time_t now, const DNSName& qname, const QType qty
   else {
     cacheEntry.d_authorityRecs = nullptr;
   }
-  cacheEntry.d_records.clear();
   cacheEntry.d_authZone = authZone;
   if (extra) {
     cacheEntry.d_from = extra->d_address;
@@ -738,15 +853,8 @@ void MemRecursorCache::replace(time_t now, const DNSName& qname, const QType qty
     cacheEntry.d_tcp = false;
   }
 
-  size_t toStore = content.size();
-  if (toStore <= s_maxRRSetSize) {
-    cacheEntry.d_tooBig = false;
-  }
-  else {
-    toStore = 1; // record cache does not like empty RRSets
-    cacheEntry.d_tooBig = true;
-  }
-  cacheEntry.d_records.reserve(toStore);
+  cacheEntry.d_tooBig = tooBig;
+  size_t toStore = records.size();
   for (const auto& record : content) {
     /* Yes, we have altered the d_ttl value by adding time(nullptr) to it
        prior to calling this function, so the TTL actually holds a TTD. */
@@ -760,11 +868,11 @@ void MemRecursorCache::replace(time_t now, const DNSName& qname, const QType qty
     if (cacheEntry.d_orig_ttl < SyncRes::s_minimumTTL || cacheEntry.d_orig_ttl > SyncRes::s_maxcachettl) {
       cacheEntry.d_orig_ttl = SyncRes::s_minimumTTL;
     }
-    cacheEntry.d_records.push_back(record.getContent());
     if (--toStore == 0) {
       break;
     }
   }
+  cacheEntry.d_records = std::move(records);
 
   auto storeSize = cacheEntry.sizeEstimate();
   if (s_maxEntrySize > 0 && storeSize > s_maxEntrySize) {
@@ -775,7 +883,131 @@ void MemRecursorCache::replace(time_t now, const DNSName& qname, const QType qty
   }
   cacheEntry.d_submitted = false;
   cacheEntry.d_servedStale = 0;
+  // the new TTL might be lower than the previous one
+  cacheEntry.d_expiry = 0;
   lockedShard->d_map.replace(stored, cacheEntry);
+  if (ecsSpecific) {
+    coalesceECSEntries(shard, *lockedShard, stored, now);
+  }
+}
+
+void MemRecursorCache::addToECSIndex(MapCombo& shard, MapCombo::LockedContent& content, OrderedTagIterator_t entry)
+{
+  // MUTEX SHOULD BE ACQUIRED
+  auto ecsIndexKey = std::tie(entry->d_qname, entry->d_qtype);
+  auto ecsIndex = content.d_ecsIndex.find(ecsIndexKey);
+  if (ecsIndex == content.d_ecsIndex.end()) {
+    ecsIndex = content.d_ecsIndex.insert(ECSIndexEntry(entry->d_qname, entry->d_qtype)).first;
+  }
+  ecsIndex->addMask(entry->d_netmask, entry);
+
+  // The new prefix is the most recently used one, so it is never the one evicted
+  while (s_maxECSPrefixesPerName > 0 && ecsIndex->size() > s_maxECSPrefixesPerName) {
+    const auto* victim = ecsIndex->lookupExact(ecsIndex->leastRecentlyUsed());
+    if (victim == nullptr) {
+      break;
+    }
+    auto victimEntry = victim->d_entry;
+    ecsIndex->removeNetmask(victimEntry->d_netmask);
+    content.d_map.erase(victimEntry);
+    shard.decEntriesCount();
+    ++d_ecsEvictions;
+  }
+}
+
+bool MemRecursorCache::sameAnswer(const CacheEntry& lhs, const CacheEntry& rhs, time_t now)
+{
+  if (lhs.d_ttd <= now || rhs.d_ttd <= now || lhs.d_servedStale != 0 || rhs.d_servedStale != 0 || lhs.d_tooBig || rhs.d_tooBig) {
+    return false;
+  }
+  if (lhs.d_auth != rhs.d_auth || lhs.d_state != rhs.d_state || lhs.d_authZone != rhs.d_authZone) {
+    return false;
+  }
+
+  auto sameContents = [](const auto& left, const auto& right) {
+    return left.size() == right.size() && std::equal(left.cbegin(), left.cend(), right.cbegin(), [](const auto& lptr, const auto& rptr) {
+             return lptr == rptr || *lptr == *rptr;
+           });
+  };
+  if (!sameContents(lhs.d_records, rhs.d_records)) {
+    return false;
+  }
+
+  const auto& lsigs = lhs.d_signatures ? *lhs.d_signatures : *s_emptySigRecs;
+  const auto& rsigs = rhs.d_signatures ? *rhs.d_signatures : *s_emptySigRecs;
+  if (!sameContents(lsigs, rsigs)) {
+    return false;
+  }
+
+  const auto& lauth = lhs.d_authorityRecs ? *lhs.d_authorityRecs : *s_emptyAuthRecs;
+  const auto& rauth = rhs.d_authorityRecs ? *rhs.d_authorityRecs : *s_emptyAuthRecs;
+  return lauth == rauth;
+}
+
+// The other half of the prefix one bit shorter than netmask, which must have at least one bit
+static Netmask siblingPrefix(const Netmask& netmask)
+{
+  ComboAddress address = netmask.getNetwork();
+  const auto bits = netmask.getBits();
+  if (address.isIPv4()) {
+    address.sin4.sin_addr.s_addr ^= htonl(1U << (32 - bits));
+  }
+  else {
+    auto* bytes = reinterpret_cast<uint8_t*>(&address.sin6.sin6_addr.s6_addr); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    bytes[(bits - 1) / 8] ^= 0x80 >> ((bits - 1) % 8); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+  return {address, bits};
+}
+
+// Authoritative servers often return the same answer for many adjacent source prefixes. When both
+// halves of a prefix are cached with the same answer, they are replaced by a single entry for the
+// whole prefix, which matches exactly the same clients. This is repeated as long as the new entry
+// also has a sibling with the same answer.
+// A cached entry for the whole prefix itself is dropped: as both halves were valid, it could not
+// have been used anymore.
+void MemRecursorCache::coalesceECSEntries(MapCombo& shard, MapCombo::LockedContent& content, OrderedTagIterator_t entry, time_t now)
+{
+  // MUTEX SHOULD BE ACQUIRED
+  auto ecsIndex = content.d_ecsIndex.find(std::tie(entry->d_qname, entry->d_qtype));
+  if (ecsIndex == content.d_ecsIndex.end()) {
+    return;
+  }
+
+  // we never coalesce into a /0, that would look like a non-ECS entry
+  while (entry->d_netmask.getBits() > 1) {
+    const auto* sibling = ecsIndex->lookupExact(siblingPrefix(entry->d_netmask));
+    if (sibling == nullptr) {
+      return;
+    }
+    auto siblingEntry = sibling->d_entry;
+    if (!sameAnswer(*entry, *siblingEntry, now)) {
+      return;
+    }
+
+    CacheEntry merged = entry->d_ttd <= siblingEntry->d_ttd ? *entry : *siblingEntry;
+    merged.d_orig_ttl = std::min(entry->d_orig_ttl, siblingEntry->d_orig_ttl);
+    merged.d_submitted = entry->d_submitted || siblingEntry->d_submitted;
+    merged.d_netmask = entry->d_netmask.getSuper(entry->d_netmask.getBits() - 1).getNormalized();
+
+    ecsIndex->removeNetmask(entry->d_netmask);
+    ecsIndex->removeNetmask(siblingEntry->d_netmask);
+    content.d_map.erase(entry);
+    content.d_map.erase(siblingEntry);
+    shard.decEntriesCount();
+    shard.decEntriesCount();
+
+    auto existing = content.d_map.find(std::tie(merged.d_qname, merged.d_qtype, merged.d_rtag, merged.d_netmask));
+    if (existing != content.d_map.end()) {
+      ecsIndex->removeNetmask(existing->d_netmask);
+      content.d_map.erase(existing);
+      shard.decEntriesCount();
+    }
+
+    entry = content.d_map.insert(std::move(merged)).first;
+    shard.incEntriesCount();
+    ecsIndex->addMask(entry->d_netmask, entry);
+    ++d_ecsCoalesced;
+  }
 }
 
 size_t MemRecursorCache::doWipeCache(const DNSName& name, bool sub, const QType qtype)
@@ -870,6 +1102,7 @@ bool MemRecursorCache::doAgeCache(time_t now, const DNSName& name, const QType q
 
     if (cacheEntry.d_ttd > newTTD) {
       cacheEntry.d_ttd = newTTD;
+      cacheEntry.d_expiry = 0;
       lockedShard->d_map.replace(iter, cacheEntry);
     }
     return true;
@@ -897,8 +1130,9 @@ bool MemRecursorCache::updateValidationStatus(time_t now, const DNSName& qname,
     }
 
     entry->d_state = newState;
-    if (capTTD) {
-      entry->d_ttd = std::min(entry->d_ttd, *capTTD);
+    if (capTTD && *capTTD < entry->d_ttd) {
+      entry->d_ttd = *capTTD;
+      resetCacheItemExpiry<ExpiryTag>(map->d_map, entry);
     }
     return true;
   }
@@ -908,13 +1142,14 @@ bool MemRecursorCache::updateValidationStatus(time_t now, const DNSName& qname,
   for (auto i = entries.first; i != entries.second; ++i) {
     auto firstIndexIterator = map->d_map.project<OrderedTag>(i);
 
-    if (!entryMatches(firstIndexIterator, qtype, requireAuth, who)) {
+    if (!entryMatches(*firstIndexIterator, qtype, requireAuth, who)) {
       continue;
     }
 
     i->d_state = newState;
-    if (capTTD) {
-      i->d_ttd = std::min(i->d_ttd, *capTTD);
+    if (capTTD && *capTTD < i->d_ttd) {
+      i->d_ttd = *capTTD;
+      resetCacheItemExpiry<ExpiryTag>(map->d_map, i);
     }
     updated = true;
 
@@ -981,10 +1216,13 @@ uint64_t MemRecursorCache::doDump(int fileDesc, size_t maxCacheEntries)
   return count;
 }
 
-void MemRecursorCache::doPrune(time_t now, size_t keep)
+void MemRecursorCache::doPrune(time_t now, size_t keep, const PruneControl& control)
 {
-  size_t cacheSize = size();
-  pruneMutexCollectionsVector<SequencedTag>(now, d_maps, keep, cacheSize);
+  pruneMutexCollectionsVector<SequencedTag, ExpiryTag>(now, d_maps, keep, control);
+  if (control.d_part == 0) {
+    // Look at about 10% of the shared contents table each time
+    d_interner.prune((d_interner.shardCount() + 9) / 10);
+  }
 }
 
 enum class PBCacheDump : protozero::pbf_tag_type
@@ -1167,7 +1405,7 @@ bool MemRecursorCache::putRecordSet(T& message)
     switch (message.tag()) {
     case PBCacheEntry::repeated_bytes_record: {
       auto ptr = DNSRecordContent::deserialize(cacheEntry.d_qname, cacheEntry.d_qtype, message.get_bytes());
-      cacheEntry.d_records.emplace_back(ptr);
+      cacheEntry.d_records.emplace_back(d_interner.intern(ptr));
       break;
     }
     case PBCacheEntry::repeated_bytes_sig: {
@@ -20,6 +20,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 #pragma once
+#include <list>
 #include <string>
 #include "dns.hh"
 #include "qtype.hh"
@@ -33,8 +34,10 @@
 #include <boost/multi_index/key_extractors.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/version.hpp>
+#include "cachecleaner.hh"
 #include "iputils.hh"
 #include "lock.hh"
+#include "rec-contentinterner.hh"
 #include "stat_t.hh"
 #include "validate.hh"
 #undef max
@@ -57,11 +60,27 @@ public:
   static uint16_t s_maxRRSetSize;
   static bool s_limitQTypeAny;
   static uint32_t s_maxEntrySize;
+  // Maximum number of ECS-specific entries per (qname, qtype), the least recently used prefix is
+  // evicted when it is exceeded. 0 means no limit.
+  static uint32_t s_maxECSPrefixesPerName;
 
   [[nodiscard]] size_t size() const;
   [[nodiscard]] size_t bytes();
   [[nodiscard]] pair<uint64_t, uint64_t> stats();
   [[nodiscard]] size_t ecsIndexSize();
+  [[nodiscard]] size_t ecsEntriesCount();
+  [[nodiscard]] uint64_t getECSCoalesced() const
+  {
+    return d_ecsCoalesced.load();
+  }
+  [[nodiscard]] uint64_t getECSEvictions() const
+  {
+    return d_ecsEvictions.load();
+  }
+  [[nodiscard]] size_t sharedContentsCount() const
+  {
+    return d_interner.size();
+  }
 
   size_t getRecordSets(size_t perShard, size_t maxSize, std::string& ret);
   size_t putRecordSets(const std::string& pbuf);
@@ -118,7 +137,7 @@ public:
 
   void replace(time_t, const DNSName& qname, QType qtype, const vector<DNSRecord>& content, const SigRecsVec& signatures, const AuthRecsVec& authorityRecs, bool auth, const DNSName& authZone, const std::optional<Netmask>& ednsmask = std::nullopt, const OptTag& routingTag = NOTAG, vState state = vState::Indeterminate, const std::optional<Extra>& extra = std::nullopt, bool refresh = false, time_t ttl_time = time(nullptr));
 
-  void doPrune(time_t now, size_t keep);
+  void doPrune(time_t now, size_t keep, const PruneControl& control = PruneControl());
   uint64_t doDump(int fileDesc, size_t maxCacheEntries);
 
   size_t doWipeCache(const DNSName& name, bool sub, QType qtype = 0xffff);
@@ -147,6 +166,8 @@ public:
 
 private:
   pdns::stat_t cacheHits{0}, cacheMisses{0};
+  pdns::stat_t d_ecsCoalesced{0};
+  pdns::stat_t d_ecsEvictions{0};
 
   struct CacheEntry
   {
@@ -161,13 +182,18 @@ private:
 
     using records_t = vector<std::shared_ptr<const DNSRecordContent>>;
 
-    bool isStale(time_t now) const
+    [[nodiscard]] time_t getStaleTime() const
     {
       // We like to keep things in cache when we (potentially) should serve stale
       if (s_maxServedStaleExtensions > 0) {
-        return d_ttd + static_cast<time_t>(s_maxServedStaleExtensions) * std::min(s_serveStaleExtensionPeriod, d_orig_ttl) < now;
+        return d_ttd + static_cast<time_t>(s_maxServedStaleExtensions) * std::min(s_serveStaleExtensionPeriod, d_orig_ttl);
       }
-      return d_ttd < now;
+      return d_ttd;
+    }
+
+    bool isStale(time_t now) const
+    {
+      return getStaleTime() < now;
     }
 
     bool isEntryUsable(time_t now, bool serveStale) const
@@ -179,6 +205,8 @@ private:
     bool shouldReplace(time_t now, bool auth, vState state, bool refresh);
 
     [[nodiscard]] size_t sizeEstimate() const;
+    // Like sizeEstimate(), but content shared with other entries only counts for its share
+    [[nodiscard]] size_t amortizedSizeEstimate() const;
     [[nodiscard]] size_t authRecsSizeEstimate() const;
     [[nodiscard]] size_t sigRecsSizeEstimate() const;
 
@@ -191,6 +219,7 @@ private:
     SigRecs d_signatures; // 16
     AuthRecs d_authorityRecs; // 16
     mutable time_t d_ttd{0}; // 8
+    time_t d_expiry{0}; // 8 key of the expiry index, only updated by pruning, see pruneMutexCollectionsVector()
     uint32_t d_orig_ttl{0}; // 4
     mutable uint16_t d_servedStale{0}; // 2
     QType d_qtype; // 2
@@ -199,6 +228,8 @@ private:
     mutable bool d_submitted{false}; // 1, whether this entry has been queued for refetch
     bool d_tooBig{false}; // 1
     bool d_tcp{false}; // 1 was entry received over TCP?
+    DeferredHit d_deferredHit; // 1 hit served under a shared lock, not yet reflected in the LRU order
+    HitCounter d_hits; // 1 popularity of this entry, used to prioritize refresh tasks
   };
 
   bool replace(CacheEntry&& entry);
@@ -208,12 +239,56 @@ private:
   template <typename T, typename U>
   void getRecordSet(T&, U);
 
+  struct HashedTag
+  {
+  };
+  struct SequencedTag
+  {
+  };
+  struct NameAndRTagOnlyHashedTag
+  {
+  };
+  struct OrderedTag
+  {
+  };
+  struct ExpiryTag
+  {
+  };
+
+  using cache_t = multi_index_container<
+    CacheEntry,
+    indexed_by<
+      ordered_unique<tag<OrderedTag>,
+                     composite_key<
+                       CacheEntry,
+                       member<CacheEntry, DNSName, &CacheEntry::d_qname>,
+                       member<CacheEntry, QType, &CacheEntry::d_qtype>,
+                       member<CacheEntry, OptTag, &CacheEntry::d_rtag>,
+                       member<CacheEntry, Netmask, &CacheEntry::d_netmask>>,
+                     composite_key_compare<CanonDNSNameCompare, std::less<>, std::less<>, std::less<>>>,
+      sequenced<tag<SequencedTag>>,
+      hashed_non_unique<tag<NameAndRTagOnlyHashedTag>,
+                        composite_key<
+                          CacheEntry,
+                          member<CacheEntry, DNSName, &CacheEntry::d_qname>,
+                          member<CacheEntry, OptTag, &CacheEntry::d_rtag>>>,
+      ordered_non_unique<tag<ExpiryTag>,
+                         member<CacheEntry, time_t, &CacheEntry::d_expiry>>>>;
+
+  using OrderedTagIterator_t = MemRecursorCache::cache_t::index<MemRecursorCache::OrderedTag>::type::iterator;
+  using NameAndRTagOnlyHashedTagIterator_t = MemRecursorCache::cache_t::index<MemRecursorCache::NameAndRTagOnlyHashedTag>::type::iterator;
+
   /* The ECS Index (d_ecsIndex) keeps track of whether there is any ECS-specific
      entry for a given (qname,qtype) entry in the cache (d_map), and if so
      provides a NetmaskTree of those ECS entries.
      This allows figuring out quickly if we should look for an entry
      specific to the requestor IP, and if so which entry is the most
-     specific one.
+     specific one. The tree stores an iterator to that entry, so a lookup
+     does not need a second search in the cache. Every removal of an ECS
+     entry from the cache must therefore remove its netmask from the index
+     first, see preRemoval().
+     The netmasks are also kept in least recently used order, so the number
+     of prefixes per (qname,qtype) can be capped, see s_maxECSPrefixesPerName.
      Keeping the entries in the regular cache is currently necessary
      because of the way we manage expired entries (moving them to the
      front of the expunge queue to be deleted at a regular interval).
@@ -221,75 +296,86 @@ private:
   class ECSIndexEntry
   {
   public:
+    struct Prefix
+    {
+      OrderedTagIterator_t d_entry;
+      std::list<Netmask>::iterator d_lru;
+      bool d_assigned{false};
+    };
+
     ECSIndexEntry(DNSName qname, QType qtype) :
       d_qname(std::move(qname)), d_qtype(qtype)
     {
     }
 
-    [[nodiscard]] Netmask lookupBestMatch(const ComboAddress& addr) const
+    [[nodiscard]] const Prefix* lookupBestMatch(const ComboAddress& addr) const
     {
       const auto* best = d_nmt.lookup(addr);
       if (best != nullptr) {
-        return best->first;
+        return &best->second;
       }
 
-      return {};
+      return nullptr;
     }
 
-    void addMask(const Netmask& netmask) const
+    [[nodiscard]] const Prefix* lookupExact(const Netmask& netmask) const
     {
-      d_nmt.insert(netmask).second = true;
+      const auto* node = d_nmt.lookup(netmask);
+      if (node != nullptr && node->first == netmask) {
+        return &node->second;
+      }
+      return nullptr;
+    }
+
+    void addMask(const Netmask& netmask, OrderedTagIterator_t entry) const
+    {
+      auto& node = d_nmt.insert(netmask);
+      if (!node.second.d_assigned) {
+        node.second.d_lru = d_lru.insert(d_lru.end(), node.first);
+        node.second.d_assigned = true;
+      }
+      else {
+        d_lru.splice(d_lru.end(), d_lru, node.second.d_lru);
+      }
+      node.second.d_entry = entry;
+    }
+
+    void touch(const Prefix& prefix) const
+    {
+      d_lru.splice(d_lru.end(), d_lru, prefix.d_lru);
     }
 
     void removeNetmask(const Netmask& netmask) const
     {
+      const auto* node = d_nmt.lookup(netmask);
+      if (node == nullptr || node->first != netmask) {
+        return;
+      }
+      d_lru.erase(node->second.d_lru);
       d_nmt.erase(netmask);
     }
 
+    [[nodiscard]] const Netmask& leastRecentlyUsed() const
+    {
+      return d_lru.front();
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+      return d_lru.size();
+    }
+
     [[nodiscard]] bool isEmpty() const
     {
-      return d_nmt.empty();
+      return d_lru.empty();
     }
 
-    mutable NetmaskTree<bool> d_nmt;
+    mutable NetmaskTree<Prefix> d_nmt;
+    mutable std::list<Netmask> d_lru;
     DNSName d_qname;
     QType d_qtype;
   };
 
-  struct HashedTag
-  {
-  };
-  struct SequencedTag
-  {
-  };
-  struct NameAndRTagOnlyHashedTag
-  {
-  };
-  struct OrderedTag
-  {
-  };
-
-  using cache_t = multi_index_container<
-    CacheEntry,
-    indexed_by<
-      ordered_unique<tag<OrderedTag>,
-                     composite_key<
-                       CacheEntry,
-                       member<CacheEntry, DNSName, &CacheEntry::d_qname>,
-                       member<CacheEntry, QType, &CacheEntry::d_qtype>,
-                       member<CacheEntry, OptTag, &CacheEntry::d_rtag>,
-                       member<CacheEntry, Netmask, &CacheEntry::d_netmask>>,
-                     composite_key_compare<CanonDNSNameCompare, std::less<>, std::less<>, std::less<>>>,
-      sequenced<tag<SequencedTag>>,
-      hashed_non_unique<tag<NameAndRTagOnlyHashedTag>,
-                        composite_key<
-                          CacheEntry,
-                          member<CacheEntry, DNSName, &CacheEntry::d_qname>,
-                          member<CacheEntry, OptTag, &CacheEntry::d_rtag>>>>>;
-
-  using OrderedTagIterator_t = MemRecursorCache::cache_t::index<MemRecursorCache::OrderedTag>::type::iterator;
-  using NameAndRTagOnlyHashedTagIterator_t = MemRecursorCache::cache_t::index<MemRecursorCache::NameAndRTagOnlyHashedTag>::type::iterator;
-
   using ecsIndex_t = multi_index_container<
     ECSIndexEntry,
     indexed_by<
@@ -323,8 +409,6 @@ private:
       DNSName d_cachedqname;
       OptTag d_cachedrtag;
       Entries d_cachecache;
-      uint64_t d_contended_count{0};
-      uint64_t d_acquired_count{0};
       bool d_cachecachevalid{false};
 
       void invalidate()
@@ -349,17 +433,39 @@ private:
       }
     };
 
-    LockGuardedTryHolder<LockedContent> lock()
+    SharedLockGuardedTryHolder<LockedContent> lock()
     {
-      auto locked = d_content.try_lock();
+      auto locked = d_content.try_write_lock();
       if (!locked.owns_lock()) {
         locked.lock();
-        ++locked->d_contended_count;
+        ++d_contended_count;
       }
-      ++locked->d_acquired_count;
+      ++d_acquired_count;
       return locked;
     }
 
+    // Only for lookups that do not modify the shard: no LRU moves, no d_cachecache update
+    SharedLockGuardedNonExclusiveTryHolder<LockedContent> read_lock()
+    {
+      auto locked = d_content.try_read_lock();
+      if (!locked.owns_lock()) {
+        locked.lock();
+        ++d_contended_count;
+      }
+      ++d_acquired_count;
+      return locked;
+    }
+
+    [[nodiscard]] uint64_t getContendedCount() const
+    {
+      return d_contended_count.load();
+    }
+
+    [[nodiscard]] uint64_t getAcquiredCount() const
+    {
+      return d_acquired_count.load();
+    }
+
     [[nodiscard]] auto getEntriesCount() const
     {
       return d_entriesCount.load();
@@ -381,23 +487,32 @@ private:
     }
 
   private:
-    LockGuarded<LockedContent> d_content;
+    SharedLockGuarded<LockedContent> d_content;
     pdns::stat_t d_entriesCount{0};
+    pdns::stat_t d_contended_count{0};
+    pdns::stat_t d_acquired_count{0};
   };
 
   vector<MapCombo> d_maps;
+  RecordContentInterner d_interner;
   MapCombo& getMap(const DNSName& qname)
   {
     return d_maps.at(qname.hash() % d_maps.size());
   }
 
   static time_t fakeTTD(OrderedTagIterator_t& entry, const DNSName& qname, QType qtype, time_t ret, time_t now, uint32_t origTTL, Flags flags);
+  static time_t computeFakeTTD(const CacheEntry& entry, QType qtype, time_t ret, time_t now, uint32_t origTTL, Flags flags, bool& needsRefreshTask);
 
-  static bool entryMatches(OrderedTagIterator_t& entry, QType qtype, bool requireAuth, const ComboAddress& who);
+  static bool entryMatches(const CacheEntry& entry, QType qtype, bool requireAuth, const ComboAddress& who);
   static Entries getEntries(MapCombo::LockedContent& map, const DNSName& qname, QType qtype, const OptTag& rtag);
+  static bool sameAnswer(const CacheEntry& lhs, const CacheEntry& rhs, time_t now);
+  void addToECSIndex(MapCombo& shard, MapCombo::LockedContent& content, OrderedTagIterator_t entry);
+  void coalesceECSEntries(MapCombo& shard, MapCombo::LockedContent& content, OrderedTagIterator_t entry, time_t now);
   static cache_t::const_iterator getEntryUsingECSIndex(MapCombo::LockedContent& map, time_t now, const DNSName& qname, QType qtype, bool requireAuth, const ComboAddress& who, bool serveStale);
 
+  static time_t readHit(time_t now, const CacheEntry& entry, const DNSName& qname, uint32_t& origTTL, vector<DNSRecord>* res, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, std::optional<vState>& state, bool* wasAuth, DNSName* authZone, Extra* extra);
   static time_t handleHit(time_t now, MapCombo::LockedContent& content, OrderedTagIterator_t& entry, const DNSName& qname, uint32_t& origTTL, vector<DNSRecord>* res, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, std::optional<vState>& state, bool* wasAuth, DNSName* authZone, Extra* extra);
+  static std::optional<time_t> getWithSharedLock(MapCombo& shard, time_t now, const DNSName& qname, QType qtype, Flags flags, vector<DNSRecord>* res, const ComboAddress& who, SigRecs* signatures, AuthRecs* authorityRecs, bool* variable, vState* state, bool* wasAuth, DNSName* fromAuthZone, Extra* extra);
   static void updateStaleEntry(time_t now, OrderedTagIterator_t& entry);
   static void handleServeStaleBookkeeping(time_t, bool, OrderedTagIterator_t&);
 };
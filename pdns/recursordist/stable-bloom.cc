@@ -0,0 +1,154 @@
+/*
+ * This file is part of PowerDNS or dnsdist.
+ * Copyright -- PowerDNS.COM B.V. and its contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * In addition, for the avoidance of any doubt, permission is granted to
+ * link this program with OpenSSL and to (re)distribute the binaries
+ * produced as the result of such linking.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stable-bloom.hh"
+
+namespace bf
+{
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free, "the cells are accessed in place in the mapping");
+
+static constexpr std::array<char, 8> s_magic{'P', 'D', 'N', 'S', 'S', 'B', 'F', '1'};
+static constexpr uint32_t s_byteOrder{0x01020304};
+
+ConcurrentStableBF::ConcurrentStableBF(float fp_rate, uint32_t num_cells, uint8_t pArg) :
+  d_num_cells(num_cells),
+  d_k(optimalK(fp_rate)),
+  d_p(pArg)
+{
+  if (num_cells == 0) {
+    throw std::runtime_error("SBF: the number of cells cannot be 0");
+  }
+  const auto size = wordsCount() * sizeof(uint64_t);
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast): MAP_FAILED
+  void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("SBF: cannot allocate " + std::to_string(size) + " bytes: " + stringerror());
+  }
+  d_mapping = mapping;
+  d_mappingSize = size;
+  d_words = static_cast<std::atomic<uint64_t>*>(mapping);
+}
+
+ConcurrentStableBF::~ConcurrentStableBF()
+{
+  unmap();
+}
+
+void ConcurrentStableBF::unmap()
+{
+  if (d_mapping != nullptr) {
+    munmap(d_mapping, d_mappingSize);
+    d_mapping = nullptr;
+    d_words = nullptr;
+  }
+}
+
+ConcurrentStableBF::FileHeader ConcurrentStableBF::makeHeader() const
+{
+  FileHeader header{};
+  header.d_magic = s_magic;
+  header.d_byteOrder = s_byteOrder;
+  header.d_numCells = d_num_cells;
+  header.d_k = d_k;
+  header.d_p = d_p;
+  return header;
+}
+
+void ConcurrentStableBF::dump(int fileDesc) const
+{
+  const auto header = makeHeader();
+  writen2(fileDesc, &header, sizeof(header));
+
+  // copy the cells in chunks, so that we never see a word half-updated
+  std::vector<uint64_t> buffer(8192);
+  const auto words = wordsCount();
+  for (size_t word = 0; word < words; word += buffer.size()) {
+    const auto count = std::min(buffer.size(), words - word);
+    for (size_t idx = 0; idx < count; idx++) {
+      buffer[idx] = d_words[word + idx].load(std::memory_order_relaxed); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+    writen2(fileDesc, buffer.data(), count * sizeof(uint64_t));
+  }
+}
+
+void ConcurrentStableBF::restore(const std::string& fname)
+{
+  auto fileDesc = FDWrapper(open(fname.c_str(), O_RDONLY | O_CLOEXEC)); // NOLINT(cppcoreguidelines-pro-type-vararg)
+  if (fileDesc == -1) {
+    throw std::runtime_error("SBF: cannot open " + fname + ": " + stringerror());
+  }
+
+  struct stat fileStat{};
+  if (fstat(fileDesc, &fileStat) != 0) {
+    throw std::runtime_error("SBF: cannot stat " + fname + ": " + stringerror());
+  }
+  const auto size = sizeof(FileHeader) + wordsCount() * sizeof(uint64_t);
+  if (fileStat.st_size < 0 || static_cast<size_t>(fileStat.st_size) != size) {
+    throw std::runtime_error("SBF: size of " + fname + " does not match the size of the filter");
+  }
+
+  FileHeader header{};
+  if (pread(fileDesc, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+    throw std::runtime_error("SBF: read failed (file too short?)");
+  }
+  const auto expected = makeHeader();
+  if (header.d_magic != expected.d_magic || header.d_byteOrder != expected.d_byteOrder) {
+    throw std::runtime_error("SBF: " + fname + " is not a snapshot written on this architecture");
+  }
+  if (header.d_numCells != expected.d_numCells || header.d_k != expected.d_k || header.d_p != expected.d_p) {
+    throw std::runtime_error("SBF: " + fname + " was written for a filter with different parameters");
+  }
+
+  // the mapping stays valid after the file has been closed, renamed or removed
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast): MAP_FAILED
+  void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDesc, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("SBF: cannot map " + fname + ": " + stringerror());
+  }
+  unmap();
+  d_mapping = mapping;
+  d_mappingSize = size;
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  d_words = reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(mapping) + sizeof(FileHeader));
+}
+
+void ConcurrentStableBF::restoreLegacy(std::istream& istr)
+{
+  stableBF legacy(d_k, d_num_cells, d_p, std::string());
+  legacy.restore(istr);
+  if (legacy.d_num_cells != d_num_cells || legacy.d_k != d_k || legacy.d_cells.size() != d_num_cells) {
+    throw std::runtime_error("SBF: file was written for a filter with different parameters");
+  }
+
+  for (size_t word = 0; word < wordsCount(); word++) {
+    d_words[word].store(0, std::memory_order_relaxed); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+  for (auto cell = legacy.d_cells.find_first(); cell != boost::dynamic_bitset<>::npos; cell = legacy.d_cells.find_next(cell)) {
+    setCell(static_cast<uint32_t>(cell));
+  }
+}
+}
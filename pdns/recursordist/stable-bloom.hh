@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <vector>
 #include <cmath>
 #include <random>
@@ -33,6 +36,30 @@
 
 namespace bf
 {
+inline unsigned int optimalK(float fp_rate)
+{
+  return std::ceil(std::log2(1.0 / fp_rate));
+}
+
+// This is a double hash implementation, the k cell positions are hash1 + i * hash2
+inline void doubleHash(const std::string& data, uint32_t& hash1, uint32_t& hash2)
+{
+  // MurmurHash3 assumes the data is uint32_t aligned, so fixup if needed
+  // It does handle string lengths that are not a multiple of sizeof(uint32_t) correctly
+  if (reinterpret_cast<uintptr_t>(data.data()) % sizeof(uint32_t) != 0) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    NoInitVector<uint32_t> vec((data.length() / sizeof(uint32_t)) + 1);
+    memcpy(vec.data(), data.data(), data.length());
+    MurmurHash3_x86_32(vec.data(), static_cast<int>(data.length()), 1, &hash1);
+    MurmurHash3_x86_32(vec.data(), static_cast<int>(data.length()), 2, &hash2);
+  }
+  else {
+    MurmurHash3_x86_32(data.data(), static_cast<int>(data.length()), 1, &hash1);
+    MurmurHash3_x86_32(data.data(), static_cast<int>(data.length()), 2, &hash2);
+  }
+}
+
+class ConcurrentStableBF;
+
 // Based on http://webdocs.cs.ualberta.ca/~drafiei/papers/DupDetExt.pdf
 // Max is always 1 in this implementation, which is best for streaming data
 // This also means we can use a bitset for storing values which is very
@@ -156,11 +183,6 @@ private:
     return static_cast<char*>(ptr);
   }
 
-  static unsigned int optimalK(float fp_rate)
-  {
-    return std::ceil(std::log2(1.0 / fp_rate));
-  }
-
   void decrement()
   {
     // Choose a random cell then decrement the next p-1
@@ -181,24 +203,12 @@ private:
     d_cells.swap(rhs.d_cells);
   }
 
-  // This is a double hash implementation returning an array of
-  // k hashes
+  // Returns an array of k hashes
   [[nodiscard]] std::vector<uint32_t> hash(const std::string& data) const
   {
     uint32_t hash1{};
     uint32_t hash2{};
-    // MurmurHash3 assumes the data is uint32_t aligned, so fixup if needed
-    // It does handle string lengths that are not a multiple of sizeof(uint32_t) correctly
-    if (reinterpret_cast<uintptr_t>(data.data()) % sizeof(uint32_t) != 0) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
-      NoInitVector<uint32_t> vec((data.length() / sizeof(uint32_t)) + 1);
-      memcpy(vec.data(), data.data(), data.length());
-      MurmurHash3_x86_32(vec.data(), static_cast<int>(data.length()), 1, &hash1);
-      MurmurHash3_x86_32(vec.data(), static_cast<int>(data.length()), 2, &hash2);
-    }
-    else {
-      MurmurHash3_x86_32(data.data(), static_cast<int>(data.length()), 1, &hash1);
-      MurmurHash3_x86_32(data.data(), static_cast<int>(data.length()), 2, &hash2);
-    }
+    doubleHash(data, hash1, hash2);
     std::vector<uint32_t> ret_hashes(d_k);
     for (size_t i = 0; i < d_k; ++i) {
       ret_hashes[i] = hash1 + i * hash2;
@@ -212,5 +222,130 @@ private:
   boost::dynamic_bitset<> d_cells;
   std::mt19937 d_gen;
   std::uniform_int_distribution<> d_dis;
+
+  friend class ConcurrentStableBF;
+};
+
+// A stable Bloom filter that several threads can use at the same time without locking: cells are
+// set and cleared with atomic operations on the 64-bit words holding them. Cell positions are the
+// same as the ones of stableBF, so the content of a stableBF dump can be imported as it is.
+//
+// The cells live in a private memory mapping: of the snapshot file the filter was restored from,
+// copy-on-write, so that restoring does not need to read or parse anything, or of anonymous memory.
+class ConcurrentStableBF
+{
+public:
+  ConcurrentStableBF(float fp_rate, uint32_t num_cells, uint8_t pArg);
+  ~ConcurrentStableBF();
+  ConcurrentStableBF(const ConcurrentStableBF&) = delete;
+  ConcurrentStableBF(ConcurrentStableBF&&) = delete;
+  ConcurrentStableBF& operator=(const ConcurrentStableBF&) = delete;
+  ConcurrentStableBF& operator=(ConcurrentStableBF&&) = delete;
+
+  void add(const std::string& data)
+  {
+    uint32_t hash1{};
+    uint32_t hash2{};
+    doubleHash(data, hash1, hash2);
+    decrement();
+    for (uint32_t idx = 0; idx < d_k; ++idx) {
+      setCell((hash1 + idx * hash2) % d_num_cells);
+    }
+  }
+
+  [[nodiscard]] bool test(const std::string& data) const
+  {
+    uint32_t hash1{};
+    uint32_t hash2{};
+    doubleHash(data, hash1, hash2);
+    for (uint32_t idx = 0; idx < d_k; ++idx) {
+      if (!testCell((hash1 + idx * hash2) % d_num_cells)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool testAndAdd(const std::string& data)
+  {
+    uint32_t hash1{};
+    uint32_t hash2{};
+    doubleHash(data, hash1, hash2);
+    bool retval = true;
+    for (uint32_t idx = 0; idx < d_k; ++idx) {
+      if (!testCell((hash1 + idx * hash2) % d_num_cells)) {
+        retval = false;
+        break;
+      }
+    }
+    decrement();
+    for (uint32_t idx = 0; idx < d_k; ++idx) {
+      setCell((hash1 + idx * hash2) % d_num_cells);
+    }
+    return retval;
+  }
+
+  // Write a snapshot to fileDesc. Writers are not blocked while this runs, so cells set or cleared
+  // in the meantime might or might not be part of the snapshot.
+  void dump(int fileDesc) const;
+  // Replace the content of the filter by the one of a snapshot written by dump(). This is not
+  // thread-safe, it has to be done before the filter is used.
+  void restore(const std::string& fname);
+  // Same as restore(), from the stream written by stableBF::dump()
+  void restoreLegacy(std::istream& istr);
+
+private:
+  // The snapshot file is this header, in host byte order, followed by the words holding the cells
+  struct FileHeader
+  {
+    std::array<char, 8> d_magic;
+    uint32_t d_byteOrder;
+    uint32_t d_numCells;
+    uint8_t d_k;
+    uint8_t d_p;
+    std::array<uint8_t, 46> d_reserved;
+  };
+  static_assert(sizeof(FileHeader) == 64, "the words need to stay aligned in the mapping");
+
+  [[nodiscard]] FileHeader makeHeader() const;
+  [[nodiscard]] size_t wordsCount() const
+  {
+    return (static_cast<size_t>(d_num_cells) + 63) / 64;
+  }
+  void unmap();
+
+  void setCell(uint32_t cell)
+  {
+    d_words[cell / 64].fetch_or(uint64_t(1) << (cell % 64), std::memory_order_relaxed); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+
+  [[nodiscard]] bool testCell(uint32_t cell) const
+  {
+    return (d_words[cell / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (cell % 64))) != 0; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+
+  // Same as stableBF::decrement(), clearing each word once instead of each cell
+  void decrement()
+  {
+    thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<uint32_t> dis(0, d_num_cells - 1);
+    uint32_t cell = dis(gen);
+    uint32_t remaining = d_p;
+    while (remaining > 0) {
+      const uint32_t bit = cell % 64;
+      const uint32_t count = std::min({remaining, 64 - bit, d_num_cells - cell});
+      const uint64_t mask = (count == 64 ? ~uint64_t(0) : ((uint64_t(1) << count) - 1)) << bit;
+      d_words[cell / 64].fetch_and(~mask, std::memory_order_relaxed); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      remaining -= count;
+      cell = (cell + count) % d_num_cells;
+    }
+  }
+
+  std::atomic<uint64_t>* d_words{nullptr};
+  void* d_mapping{nullptr};
+  size_t d_mappingSize{0};
+  uint32_t d_num_cells;
+  uint8_t d_k;
+  uint8_t d_p;
 };
 }
@@ -6323,6 +6323,7 @@ void SyncRes::parseEDNSSubnetAllowlist(const std::string& alist)
       s_ednsdomains.add(DNSName(allow));
     }
   }
+  s_ednsdomains.compact();
 }
 
 void SyncRes::parseEDNSSubnetAddFor(const std::string& subnetlist)
@@ -45,6 +45,61 @@ ResolveTask TaskQueue::pop()
   return ret;
 }
 
+bool RefreshTaskQueue::push(ResolveTask&& task)
+{
+  if (d_running.count(task) != 0) {
+    // Another thread is refreshing this record right now
+    d_deduplicated++;
+    return false;
+  }
+  auto& index = d_queue.get<HashTag>();
+  auto iter = index.find(index.key_extractor()(task));
+  if (iter != index.end()) {
+    d_deduplicated++;
+    if (task.d_popularity > iter->d_popularity) {
+      index.modify(iter, [popularity = task.d_popularity](ResolveTask& existing) { existing.d_popularity = popularity; });
+    }
+    return false;
+  }
+  if (d_queue.size() >= d_maxSize) {
+    auto& prio = d_queue.get<PriorityTag>();
+    auto least = std::prev(prio.end());
+    d_evicted++;
+    if (task.d_popularity <= least->d_popularity) {
+      return false;
+    }
+    prio.erase(least);
+  }
+  d_queue.insert(std::move(task));
+  d_pushes++;
+  return true;
+}
+
+const ResolveTask& RefreshTaskQueue::top() const
+{
+  return *d_queue.get<PriorityTag>().begin();
+}
+
+ResolveTask RefreshTaskQueue::pop()
+{
+  auto& prio = d_queue.get<PriorityTag>();
+  ResolveTask ret = *prio.begin();
+  prio.erase(prio.begin());
+  d_running.insert(ret);
+  return ret;
+}
+
+void RefreshTaskQueue::done(const ResolveTask& task)
+{
+  d_running.erase(task);
+}
+
+void RefreshTaskQueue::dropTop()
+{
+  auto& prio = d_queue.get<PriorityTag>();
+  prio.erase(prio.begin());
+}
+
 bool ResolveTask::run(bool logErrors) const
 {
   if (d_func == nullptr) {
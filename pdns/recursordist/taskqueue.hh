@@ -21,6 +21,7 @@
  */
 #pragma once
 
+#include <set>
 #include <sys/time.h>
 #include <thread>
 
@@ -32,6 +33,7 @@ size_t hash_value(const ComboAddress&);
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/key_extractors.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
@@ -69,6 +71,8 @@ struct ResolveTask
   // NS name used by DoT probe task, not part of index and not used by operator<()
   DNSName d_nsname;
   Netmask d_netmask;
+  // Popularity of the refreshed record, higher runs first. Not part of index and not used by operator<()
+  uint32_t d_popularity{0};
 
   bool operator<(const ResolveTask& task) const
   {
@@ -78,6 +82,14 @@ struct ResolveTask
   [[nodiscard]] bool run(bool logErrors) const;
 };
 
+using ResolveTaskKey = composite_key<ResolveTask,
+                                     member<ResolveTask, DNSName, &ResolveTask::d_qname>,
+                                     member<ResolveTask, uint16_t, &ResolveTask::d_qtype>,
+                                     member<ResolveTask, ResolveTask::RefreshMode, &ResolveTask::d_refreshMode>,
+                                     member<ResolveTask, ResolveTask::TaskFunction, &ResolveTask::d_func>,
+                                     member<ResolveTask, ComboAddress, &ResolveTask::d_ip>,
+                                     member<ResolveTask, Netmask, &ResolveTask::d_netmask>>;
+
 class TaskQueue
 {
 public:
@@ -125,14 +137,7 @@ private:
 
   using queue_t = multi_index_container<
     ResolveTask,
-    indexed_by<ordered_unique<tag<HashTag>,
-                              composite_key<ResolveTask,
-                                            member<ResolveTask, DNSName, &ResolveTask::d_qname>,
-                                            member<ResolveTask, uint16_t, &ResolveTask::d_qtype>,
-                                            member<ResolveTask, ResolveTask::RefreshMode, &ResolveTask::d_refreshMode>,
-                                            member<ResolveTask, ResolveTask::TaskFunction, &ResolveTask::d_func>,
-                                            member<ResolveTask, ComboAddress, &ResolveTask::d_ip>,
-                                            member<ResolveTask, Netmask, &ResolveTask::d_netmask>>>,
+    indexed_by<ordered_unique<tag<HashTag>, ResolveTaskKey>,
                sequenced<tag<SequencedTag>>>>;
 
   queue_t d_queue;
@@ -140,4 +145,90 @@ private:
   uint64_t d_expired{0};
 };
 
+// Queue of tasks refreshing almost expired records. Instead of first come first served, the most
+// popular task runs first, and of equally popular tasks the one with the earliest deadline. When
+// full, the least popular task is dropped. Tasks handed out by pop() are remembered until done()
+// is called, so a record being refreshed by one thread is not queued again by another.
+class RefreshTaskQueue
+{
+public:
+  explicit RefreshTaskQueue(size_t maxSize = 100000) :
+    d_maxSize(maxSize)
+  {
+  }
+
+  [[nodiscard]] bool empty() const
+  {
+    return d_queue.empty();
+  }
+
+  [[nodiscard]] size_t size() const
+  {
+    return d_queue.size();
+  }
+
+  bool push(ResolveTask&& task);
+  [[nodiscard]] const ResolveTask& top() const;
+  ResolveTask pop();
+  void done(const ResolveTask& task);
+  void dropTop();
+
+  [[nodiscard]] uint64_t getPushes() const
+  {
+    return d_pushes;
+  }
+
+  [[nodiscard]] uint64_t getExpired() const
+  {
+    return d_expired;
+  }
+
+  void incExpired()
+  {
+    d_expired++;
+  }
+
+  [[nodiscard]] uint64_t getEvicted() const
+  {
+    return d_evicted;
+  }
+
+  [[nodiscard]] uint64_t getDeduplicated() const
+  {
+    return d_deduplicated;
+  }
+
+  void clear()
+  {
+    d_queue.clear();
+    d_running.clear();
+  }
+
+private:
+  struct HashTag
+  {
+  };
+
+  struct PriorityTag
+  {
+  };
+
+  using queue_t = multi_index_container<
+    ResolveTask,
+    indexed_by<ordered_unique<tag<HashTag>, ResolveTaskKey>,
+               ordered_non_unique<tag<PriorityTag>,
+                                  composite_key<ResolveTask,
+                                                member<ResolveTask, uint32_t, &ResolveTask::d_popularity>,
+                                                member<ResolveTask, time_t, &ResolveTask::d_deadline>>,
+                                  composite_key_compare<std::greater<>, std::less<>>>>>;
+
+  queue_t d_queue;
+  std::set<ResolveTask> d_running;
+  size_t d_maxSize;
+  uint64_t d_pushes{0};
+  uint64_t d_expired{0};
+  uint64_t d_evicted{0};
+  uint64_t d_deduplicated{0};
+};
+
 }
@@ -354,6 +354,29 @@ BOOST_AUTO_TEST_CASE(test_prune_many_shards)
   BOOST_CHECK_EQUAL(cache.size(), 100U);
 }
 
+BOOST_AUTO_TEST_CASE(test_prune_capped_entry)
+{
+  DNSName qname("www.powerdns.com");
+  DNSName auth("powerdns.com");
+
+  struct timeval now;
+  Utility::gettimeofday(&now, 0);
+
+  NegCache cache(1);
+  cache.add(genNegCacheEntry(qname, auth, now));
+
+  /* the entry gets its place in the expiry index, 600s from now */
+  cache.prune(now.tv_sec, 100);
+  BOOST_CHECK_EQUAL(cache.size(), 1U);
+
+  /* its TTL is then capped to 10s */
+  cache.updateValidationStatus(qname, QType(0), vState::Insecure, now.tv_sec + 10);
+  cache.prune(now.tv_sec + 5, 100);
+  BOOST_CHECK_EQUAL(cache.size(), 1U);
+  cache.prune(now.tv_sec + 11, 100);
+  BOOST_CHECK_EQUAL(cache.size(), 0U);
+}
+
 BOOST_AUTO_TEST_CASE(test_prune_valid_entries)
 {
   DNSName power1("powerdns.com.");
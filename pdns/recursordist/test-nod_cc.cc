@@ -4,6 +4,8 @@
 
 #define BOOST_TEST_NO_MAIN
 #include <boost/test/unit_test.hpp>
+#include <fcntl.h>
+#include <fstream>
 #include "nod.hh"
 #include "pdnsexception.hh"
 using namespace boost;
@@ -63,4 +65,116 @@ BOOST_AUTO_TEST_CASE(test_basic)
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_concurrent)
+{
+  PersistentSBF sbf;
+  BOOST_CHECK_EQUAL(sbf.init(), true);
+
+  const size_t threadsCount = 4;
+  const size_t perThread = 10000;
+  std::vector<std::thread> threads;
+  for (size_t thread = 0; thread < threadsCount; thread++) {
+    threads.emplace_back([&sbf, thread]() {
+      for (size_t idx = 0; idx < perThread; idx++) {
+        sbf.testAndAdd("domain" + std::to_string(idx) + ".thread" + std::to_string(thread));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  /* a few entries might have been decayed since, but not many */
+  size_t found = 0;
+  for (size_t thread = 0; thread < threadsCount; thread++) {
+    for (size_t idx = 0; idx < perThread; idx++) {
+      if (sbf.test("domain" + std::to_string(idx) + ".thread" + std::to_string(thread))) {
+        found++;
+      }
+    }
+  }
+  BOOST_CHECK_GE(found, threadsCount * perThread * 95 / 100);
+  BOOST_CHECK_EQUAL(sbf.test("never-seen"), false);
+}
+
+BOOST_AUTO_TEST_CASE(test_snapshot_restore)
+{
+  std::string dir = "/tmp/pdns-nod-test.XXXXXX";
+  BOOST_REQUIRE(mkdtemp(dir.data()) != nullptr);
+  auto fname = dir + "/snapshot";
+
+  {
+    bf::ConcurrentStableBF filter(c_fp_rate, 65536, c_num_dec);
+    filter.add("abc.com");
+    filter.add("xyz.com");
+    auto fileDesc = FDWrapper(open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600));
+    BOOST_REQUIRE(fileDesc != -1);
+    filter.dump(fileDesc);
+  }
+  {
+    bf::ConcurrentStableBF filter(c_fp_rate, 65536, c_num_dec);
+    BOOST_CHECK_EQUAL(filter.test("abc.com"), false);
+    filter.restore(fname);
+    BOOST_CHECK_EQUAL(filter.test("abc.com"), true);
+    BOOST_CHECK_EQUAL(filter.test("xyz.com"), true);
+    BOOST_CHECK_EQUAL(filter.test("powerdns.com"), false);
+    /* the mapping is copy-on-write, the file is not altered */
+    filter.add("powerdns.com");
+    bf::ConcurrentStableBF other(c_fp_rate, 65536, c_num_dec);
+    other.restore(fname);
+    BOOST_CHECK_EQUAL(other.test("powerdns.com"), false);
+  }
+  {
+    /* different size */
+    bf::ConcurrentStableBF filter(c_fp_rate, 131072, c_num_dec);
+    BOOST_CHECK_THROW(filter.restore(fname), std::runtime_error);
+  }
+
+  std::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(test_legacy_snapshot)
+{
+  std::string dir = "/tmp/pdns-nod-test.XXXXXX";
+  BOOST_REQUIRE(mkdtemp(dir.data()) != nullptr);
+
+  {
+    /* a dump written by an older version */
+    bf::stableBF legacy(c_fp_rate, 65536, c_num_dec);
+    legacy.add(DNSName("abc.com.").toDNSStringLC());
+    std::ofstream ostr(dir + "/nod_1_1.bf", std::ios::binary);
+    legacy.dump(ostr);
+  }
+  {
+    NODDB noddb(65536);
+    noddb.setCacheDir(dir);
+    BOOST_CHECK_EQUAL(noddb.init(), true);
+    BOOST_CHECK_EQUAL(noddb.isNewDomain(DNSName("abc.com.")), false);
+    BOOST_CHECK_EQUAL(noddb.isNewDomain(DNSName("xyz.com.")), true);
+  }
+
+  /* it has been converted */
+  size_t legacyFiles = 0;
+  size_t files = 0;
+  for (const auto& file : std::filesystem::directory_iterator(dir)) {
+    if (file.path().extension() == "." + bf_suffix) {
+      legacyFiles++;
+    }
+    else if (file.path().extension() == "." + bf_mmap_suffix) {
+      files++;
+    }
+  }
+  BOOST_CHECK_EQUAL(legacyFiles, 0U);
+  BOOST_CHECK_EQUAL(files, 1U);
+
+  {
+    NODDB noddb(65536);
+    noddb.setCacheDir(dir);
+    BOOST_CHECK_EQUAL(noddb.init(true), true);
+    BOOST_CHECK_EQUAL(noddb.isNewDomain(DNSName("abc.com.")), false);
+  }
+
+  std::filesystem::remove_all(dir);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
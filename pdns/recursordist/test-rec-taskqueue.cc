@@ -30,6 +30,55 @@ BOOST_AUTO_TEST_CASE(test_almostexpired_queue_no_dups)
   BOOST_CHECK_EQUAL(getTaskSize(), 1U);
 }
 
+BOOST_AUTO_TEST_CASE(test_almostexpired_queue_popularity)
+{
+  taskQueueClear();
+  pushAlmostExpiredTask(DNSName("cold"), QType::A, 10, Netmask(), false, 1);
+  pushAlmostExpiredTask(DNSName("warm"), QType::A, 20, Netmask(), false, 5);
+  pushAlmostExpiredTask(DNSName("hot"), QType::A, 30, Netmask(), false, 5);
+  pushAlmostExpiredTask(DNSName("warm"), QType::A, 20, Netmask(), false, 1);
+  // Pushing a duplicate raises the popularity of the queued task
+  pushAlmostExpiredTask(DNSName("hot"), QType::A, 30, Netmask(), false, 9);
+  pushAlmostExpiredTask(DNSName("forced"), QType::A, 40, Netmask(), true, 0);
+
+  BOOST_CHECK_EQUAL(getTaskSize(), 4U);
+  BOOST_CHECK(taskQueuePop().d_qname == DNSName("forced"));
+  BOOST_CHECK(taskQueuePop().d_qname == DNSName("hot"));
+  BOOST_CHECK(taskQueuePop().d_qname == DNSName("warm"));
+  BOOST_CHECK(taskQueuePop().d_qname == DNSName("cold"));
+  BOOST_CHECK_EQUAL(getTaskSize(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(test_refresh_queue_running)
+{
+  pdns::RefreshTaskQueue queue(2);
+  pdns::ResolveTask task{DNSName("foo"), QType::A, 0, pdns::ResolveTask::RefreshMode::Refresh, nullptr, {}, {}, {}, 1};
+
+  BOOST_CHECK(queue.push(pdns::ResolveTask(task)));
+  auto running = queue.pop();
+  BOOST_CHECK(queue.empty());
+  // Not queued again while it is being run
+  BOOST_CHECK(!queue.push(pdns::ResolveTask(task)));
+  BOOST_CHECK_EQUAL(queue.getDeduplicated(), 1U);
+  queue.done(running);
+  BOOST_CHECK(queue.push(pdns::ResolveTask(task)));
+
+  // When full, the least popular task is evicted
+  pdns::ResolveTask other{DNSName("bar"), QType::A, 0, pdns::ResolveTask::RefreshMode::Refresh, nullptr, {}, {}, {}, 3};
+  BOOST_CHECK(queue.push(pdns::ResolveTask(other)));
+  other.d_qname = DNSName("baz");
+  other.d_popularity = 2;
+  BOOST_CHECK(queue.push(pdns::ResolveTask(other)));
+  BOOST_CHECK_EQUAL(queue.size(), 2U);
+  BOOST_CHECK_EQUAL(queue.getEvicted(), 1U);
+  other.d_qname = DNSName("qux");
+  other.d_popularity = 1;
+  BOOST_CHECK(!queue.push(pdns::ResolveTask(other)));
+  BOOST_CHECK_EQUAL(queue.getEvicted(), 2U);
+  BOOST_CHECK(queue.pop().d_qname == DNSName("bar"));
+  BOOST_CHECK(queue.pop().d_qname == DNSName("baz"));
+}
+
 BOOST_AUTO_TEST_CASE(test_resolve_queue_rate_limit)
 {
   taskQueueClear();
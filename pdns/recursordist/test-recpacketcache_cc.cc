@@ -86,6 +86,43 @@ BOOST_AUTO_TEST_CASE(test_recPacketCacheSimple)
   BOOST_CHECK_EQUAL(rpc.size(), 0U);
 }
 
+BOOST_AUTO_TEST_CASE(test_recPacketCachePruneLoweredTTL)
+{
+  RecursorPacketCache rpc(1000);
+  string fpacket;
+  unsigned int tag = 0;
+  uint32_t age = 0;
+  uint32_t qhash = 0;
+
+  DNSName qname("www.powerdns.com");
+  vector<uint8_t> packet;
+  DNSPacketWriter pw(packet, qname, QType::A);
+  pw.getHeader()->rd = true;
+  pw.getHeader()->qr = false;
+  pw.getHeader()->id = dns_random_uint16();
+  string qpacket((const char*)&packet[0], packet.size());
+  pw.startRecord(qname, QType::A, 3600);
+  ARecordContent ar("127.0.0.1");
+  ar.toPacket(pw);
+  pw.commit();
+  string rpacket((const char*)&packet[0], packet.size());
+
+  time_t now = time(nullptr);
+  BOOST_CHECK_EQUAL(rpc.getResponsePacket(tag, qpacket, now, &fpacket, &age, &qhash), false);
+  rpc.insertResponsePacket(tag, qhash, string(qpacket), qname, QType::A, QClass::IN, string(rpacket), now, 3600, vState::Indeterminate, std::nullopt, false);
+  /* the entry gets its place in the expiry index, an hour from now */
+  rpc.doPruneTo(now, 10);
+  BOOST_CHECK_EQUAL(rpc.size(), 1U);
+
+  /* the same response comes back with a much lower TTL */
+  rpc.insertResponsePacket(tag, qhash, string(qpacket), qname, QType::A, QClass::IN, string(rpacket), now, 10, vState::Indeterminate, std::nullopt, false);
+  BOOST_CHECK_EQUAL(rpc.size(), 1U);
+  rpc.doPruneTo(now + 5, 10);
+  BOOST_CHECK_EQUAL(rpc.size(), 1U);
+  rpc.doPruneTo(now + 11, 10);
+  BOOST_CHECK_EQUAL(rpc.size(), 0U);
+}
+
 BOOST_AUTO_TEST_CASE(test_recPacketCacheSimpleWithRefresh)
 {
   RecursorPacketCache::s_refresh_ttlperc = 30;
@@ -9,6 +9,7 @@
 #endif
 #include <boost/test/unit_test.hpp>
 #include <boost/format.hpp>
+#include <thread>
 
 #include "iputils.hh"
 #include "recursor_cache.hh"
@@ -576,25 +577,13 @@ BOOST_AUTO_TEST_CASE(test_RecursorCache_ExpungingExpiredEntries)
   records.clear();
   BOOST_CHECK_EQUAL(MRC.size(), 2U);
 
-  /* the one for power2 having been inserted more recently should be removed last */
-  /* we ask that 10 entries remain in the cache, this is larger than
-     the cache size (2), so 1 entry will be looked at as the code
-     rounds up the 10% of entries per shard to look at */
+  /* expired entries are found through the expiry index, wherever they are
+     in the LRU order, so both are removed even though we ask that 10
+     entries remain in the cache */
   MRC.doPrune(now, 10);
-  BOOST_CHECK_EQUAL(MRC.size(), 1U);
-
-  /* the remaining entry should be power2, but to get it
-     we need to go back in the past a bit */
-  BOOST_CHECK_EQUAL(MRC.get(ttd - 1, power2, QType(dr2.d_type), MemRecursorCache::None, &retrieved, who, MemRecursorCache::NOTAG, nullptr), 1);
-  BOOST_REQUIRE_EQUAL(retrieved.size(), 1U);
-  BOOST_CHECK_EQUAL(getRR<AAAARecordContent>(retrieved.at(0))->getCA().toString(), dr2Content.toString());
-  /* check that power1 is gone */
-  BOOST_CHECK_EQUAL(MRC.get(ttd - 1, power1, QType(dr1.d_type), MemRecursorCache::None, &retrieved, who, MemRecursorCache::NOTAG, nullptr), -1);
-
-  /* clear everything up */
-  MRC.doWipeCache(DNSName("."), true);
   BOOST_CHECK_EQUAL(MRC.size(), 0U);
-  records.clear();
+  BOOST_CHECK_EQUAL(MRC.get(ttd - 1, power1, QType(dr1.d_type), MemRecursorCache::None, &retrieved, who, MemRecursorCache::NOTAG, nullptr), -1);
+  BOOST_CHECK_EQUAL(MRC.get(ttd - 1, power2, QType(dr2.d_type), MemRecursorCache::None, &retrieved, who, MemRecursorCache::NOTAG, nullptr), -1);
 
   /* insert both entries back */
   records.push_back(dr1);
@@ -605,24 +594,122 @@ BOOST_AUTO_TEST_CASE(test_RecursorCache_ExpungingExpiredEntries)
   records.clear();
   BOOST_CHECK_EQUAL(MRC.size(), 2U);
 
-  /* trigger a miss (expired) for power2 */
-  BOOST_CHECK_EQUAL(MRC.get(now, power2, QType(dr2.d_type), MemRecursorCache::None, &retrieved, who, MemRecursorCache::NOTAG, nullptr), -1);
+  /* pruning at a time the entries are not stale yet keeps them */
+  MRC.doPrune(ttd - 1, 10);
+  BOOST_CHECK_EQUAL(MRC.size(), 2U);
+  MRC.doPrune(ttd, 10);
+  BOOST_CHECK_EQUAL(MRC.size(), 2U);
+
+  /* and once they are, they are removed */
+  MRC.doPrune(ttd + 1, 10);
+  BOOST_CHECK_EQUAL(MRC.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(test_RecursorCache_PruneBatches)
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache MRC(1);
+
+  std::vector<DNSRecord> records;
+  std::vector<std::shared_ptr<const RRSIGRecordContent>> signatures;
+  MemRecursorCache::AuthRecsVec authRecs;
+  const DNSName authZone(".");
+  time_t now = time(nullptr);
+
+  DNSRecord dr;
+  dr.d_type = QType::A;
+  dr.d_class = QClass::IN;
+  dr.d_place = DNSResourceRecord::ANSWER;
+  dr.setContent(std::make_shared<ARecordContent>(ComboAddress("192.0.2.1")));
+
+  /* 100 expired entries and 100 valid ones */
+  for (size_t idx = 0; idx < 200; idx++) {
+    dr.d_name = DNSName("host" + std::to_string(idx) + ".powerdns.com.");
+    dr.d_ttl = static_cast<uint32_t>(idx % 2 == 0 ? now - 10 : now + 3600);
+    records.clear();
+    records.push_back(dr);
+    MRC.replace(now, dr.d_name, QType(dr.d_type), records, signatures, authRecs, true, authZone, std::nullopt);
+  }
+  BOOST_CHECK_EQUAL(MRC.size(), 200U);
+
+  std::vector<uint64_t> pauses;
+  PruneControl control{7, 0, 1, [&pauses](uint64_t usec) { pauses.push_back(usec); }};
+  /* remove the expired entries, then trim the valid ones down to 50 */
+  MRC.doPrune(now, 50, control);
+  BOOST_CHECK_EQUAL(MRC.size(), 50U);
+  /* the shard lock was released every 7 entries: 200 entries looked at in the
+     expiry index (of which 100 were valid and get their expiry time set), then
+     50 removed from the LRU index */
+  BOOST_CHECK_EQUAL(pauses.size(), (200 + 6) / 7 + (50 + 6) / 7);
+
+  /* with two parts, each part only takes care of its own shards, and keeps
+     its share of the maximum size */
+  MemRecursorCache MRC2(2);
+  for (size_t idx = 0; idx < 200; idx++) {
+    dr.d_name = DNSName("host" + std::to_string(idx) + ".powerdns.com.");
+    dr.d_ttl = static_cast<uint32_t>(now + 3600);
+    records.clear();
+    records.push_back(dr);
+    MRC2.replace(now, dr.d_name, QType(dr.d_type), records, signatures, authRecs, true, authZone, std::nullopt);
+  }
+  BOOST_CHECK_EQUAL(MRC2.size(), 200U);
+  MRC2.doPrune(now, 100, PruneControl{1000, 0, 2, nullptr});
+  const auto afterFirst = MRC2.size();
+  BOOST_CHECK_LT(afterFirst, 200U);
+  BOOST_CHECK_GT(afterFirst, 100U);
+  MRC2.doPrune(now, 100, PruneControl{1000, 1, 2, nullptr});
+  BOOST_CHECK_EQUAL(MRC2.size(), 100U);
+}
+
+BOOST_AUTO_TEST_CASE(test_RecursorCache_PruneLoweredTTL)
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache MRC(1);
+
+  std::vector<DNSRecord> records;
+  std::vector<std::shared_ptr<const RRSIGRecordContent>> signatures;
+  MemRecursorCache::AuthRecsVec authRecs;
+  const DNSName authZone(".");
+  const ComboAddress who("192.0.2.1");
+  time_t now = time(nullptr);
 
-  /* power2 should have been moved to the front of the expunge
-     queue, and should this time be removed first */
-  /* we ask that 10 entries remain in the cache, this is larger than
-     the cache size (2), so 1 entry will be looked at as the code
-     rounds up the 10% of entries per shard to look at */
+  DNSRecord dr;
+  dr.d_type = QType::A;
+  dr.d_class = QClass::IN;
+  dr.d_place = DNSResourceRecord::ANSWER;
+  dr.setContent(std::make_shared<ARecordContent>(ComboAddress("192.0.2.1")));
+
+  const DNSName replaced("replaced.powerdns.com.");
+  const DNSName aged("aged.powerdns.com.");
+  const DNSName capped("capped.powerdns.com.");
+  for (const auto& name : {replaced, aged, capped}) {
+    dr.d_name = name;
+    dr.d_ttl = static_cast<uint32_t>(now + 3600);
+    records.clear();
+    records.push_back(dr);
+    MRC.replace(now, name, QType(dr.d_type), records, signatures, authRecs, true, authZone, std::nullopt);
+  }
+  BOOST_CHECK_EQUAL(MRC.size(), 3U);
+
+  /* the entries get their place in the expiry index, an hour from now */
   MRC.doPrune(now, 10);
-  BOOST_CHECK_EQUAL(MRC.size(), 1U);
+  BOOST_CHECK_EQUAL(MRC.size(), 3U);
 
-  /* the remaining entry should be power1, but to get it
-     we need to go back in the past a bit */
-  BOOST_CHECK_EQUAL(MRC.get(ttd - 1, power1, QType(dr1.d_type), MemRecursorCache::None, &retrieved, who, MemRecursorCache::NOTAG, nullptr), 1);
-  BOOST_REQUIRE_EQUAL(retrieved.size(), 1U);
-  BOOST_CHECK_EQUAL(getRR<AAAARecordContent>(retrieved.at(0))->getCA().toString(), dr1Content.toString());
-  /* check that power2 is gone */
-  BOOST_CHECK_EQUAL(MRC.get(ttd - 1, power2, QType(dr2.d_type), MemRecursorCache::None, &retrieved, who, MemRecursorCache::NOTAG, nullptr), -1);
+  /* then their TTL goes down to 10s, in three different ways */
+  dr.d_name = replaced;
+  dr.d_ttl = static_cast<uint32_t>(now + 10);
+  records.clear();
+  records.push_back(dr);
+  MRC.replace(now, replaced, QType(dr.d_type), records, signatures, authRecs, true, authZone, std::nullopt);
+  BOOST_CHECK(MRC.doAgeCache(now, aged, QType::A, 10));
+  BOOST_CHECK(MRC.updateValidationStatus(now, capped, QType::A, who, MemRecursorCache::NOTAG, false, vState::Insecure, now + 10));
+  BOOST_CHECK_EQUAL(MRC.size(), 3U);
+
+  /* and they have to be removed once that has passed, not an hour from now */
+  MRC.doPrune(now + 5, 10);
+  BOOST_CHECK_EQUAL(MRC.size(), 3U);
+  MRC.doPrune(now + 11, 10);
+  BOOST_CHECK_EQUAL(MRC.size(), 0U);
 }
 
 BOOST_AUTO_TEST_CASE(test_RecursorCache_ExpungingValidEntries)
@@ -964,6 +1051,196 @@ BOOST_AUTO_TEST_CASE(test_RecursorCacheECSIndex)
   BOOST_CHECK_EQUAL(MRC.ecsIndexSize(), 0U);
 }
 
+BOOST_AUTO_TEST_CASE(test_RecursorCacheECSIndexSharedLock)
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache MRC(1);
+
+  const DNSName power("powerdns.com.");
+  const DNSName other("other.powerdns.com.");
+  const DNSName authZone(".");
+  const MemRecursorCache::AuthRecsVec authRecords;
+  const MemRecursorCache::SigRecsVec signatures;
+  const time_t now = time(nullptr);
+  const time_t ttd = now + 10;
+  const ComboAddress who("192.0.2.1");
+  std::vector<DNSRecord> retrieved;
+
+  auto insert = [&](const DNSName& name, QType qtype, const std::string& content, const std::optional<Netmask>& netmask) {
+    DNSRecord record;
+    record.d_name = name;
+    record.d_type = qtype;
+    record.d_class = QClass::IN;
+    record.d_ttl = static_cast<uint32_t>(ttd);
+    record.d_place = DNSResourceRecord::ANSWER;
+    record.setContent(DNSRecordContent::make(qtype, QClass::IN, content));
+    MRC.replace(now, name, qtype, {record}, signatures, authRecords, true, authZone, netmask);
+  };
+  /* the number of times the shard lock was taken to answer a query: once when the hit is served
+     under the shared lock, twice when we had to fall back to the exclusive path */
+  auto locksTaken = [&](const DNSName& name, QType qtype, const std::string& expected, const ComboAddress& client) {
+    auto before = MRC.stats().second;
+    BOOST_CHECK_EQUAL(MRC.get(now, name, qtype, MemRecursorCache::None, &retrieved, client), ttd - now);
+    BOOST_REQUIRE_EQUAL(retrieved.size(), 1U);
+    BOOST_CHECK_EQUAL(retrieved.at(0).getContent()->getZoneRepresentation(), expected);
+    return MRC.stats().second - before;
+  };
+
+  insert(power, QType::A, "192.0.2.255", std::nullopt);
+  insert(power, QType::A, "192.0.2.127", Netmask("192.0.2.0/24"));
+  insert(power, QType::AAAA, "2001:db8::1", std::nullopt);
+  insert(other, QType::A, "192.0.2.42", std::nullopt);
+  BOOST_CHECK_EQUAL(MRC.ecsIndexSize(), 1U);
+
+  /* the ECS index is not empty, but it has nothing for these names and types */
+  BOOST_CHECK_EQUAL(locksTaken(other, QType::A, "192.0.2.42", who), 1U);
+  BOOST_CHECK_EQUAL(locksTaken(power, QType::AAAA, "2001:db8::1", who), 1U);
+
+  /* netmask-specific entries exist, they are looked up through the ECS index */
+  BOOST_CHECK_EQUAL(locksTaken(power, QType::A, "192.0.2.127", who), 2U);
+  BOOST_CHECK_EQUAL(locksTaken(power, QType::A, "192.0.2.255", ComboAddress("198.51.100.1")), 2U);
+
+  /* a netmask-specific entry that is not in the ECS index anymore is not served */
+  insert(other, QType::AAAA, "2001:db8::2", Netmask("192.0.2.0/24"));
+  BOOST_CHECK_EQUAL(MRC.ecsIndexSize(), 2U);
+  BOOST_CHECK_EQUAL(MRC.get(now + 20, other, QType(QType::AAAA), MemRecursorCache::None, &retrieved, who), -1);
+  BOOST_CHECK_EQUAL(MRC.ecsIndexSize(), 1U);
+  insert(other, QType::AAAA, "2001:db8::3", std::nullopt);
+  BOOST_CHECK_EQUAL(locksTaken(other, QType::AAAA, "2001:db8::3", who), 1U);
+
+  /* both the A and AAAA entries are returned for ADDR */
+  BOOST_CHECK_EQUAL(MRC.get(now, other, QType(QType::ADDR), MemRecursorCache::None, &retrieved, who), ttd - now);
+  BOOST_CHECK_EQUAL(retrieved.size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(test_RecursorCacheECSCoalescing)
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache MRC(1);
+
+  const DNSName power("powerdns.com.");
+  const DNSName authZone(".");
+  MemRecursorCache::AuthRecsVec authRecords;
+  std::vector<std::shared_ptr<const RRSIGRecordContent>> signatures;
+  time_t now = time(nullptr);
+  std::vector<DNSRecord> retrieved;
+
+  auto makeRecords = [&](const std::string& address) {
+    DNSRecord record;
+    record.d_name = power;
+    record.d_type = QType::A;
+    record.d_class = QClass::IN;
+    record.setContent(std::make_shared<ARecordContent>(ComboAddress(address)));
+    record.d_ttl = static_cast<uint32_t>(now + 10);
+    record.d_place = DNSResourceRecord::ANSWER;
+    return std::vector<DNSRecord>{record};
+  };
+  const auto answer1 = makeRecords("192.0.2.1");
+  const auto answer2 = makeRecords("192.0.2.2");
+
+  /* two halves of 198.51.100.0/23 with different answers are kept apart */
+  MRC.replace(now, power, QType(QType::A), answer1, signatures, authRecords, true, authZone, Netmask("198.51.100.0/24"));
+  MRC.replace(now, power, QType(QType::A), answer2, signatures, authRecords, true, authZone, Netmask("198.51.101.0/24"));
+  BOOST_CHECK_EQUAL(MRC.size(), 2U);
+  BOOST_CHECK_EQUAL(MRC.ecsEntriesCount(), 2U);
+  BOOST_CHECK_EQUAL(MRC.getECSCoalesced(), 0U);
+
+  /* the same answer for both halves gives a single /23 entry */
+  MRC.replace(now, power, QType(QType::A), answer1, signatures, authRecords, true, authZone, Netmask("198.51.101.0/24"));
+  BOOST_CHECK_EQUAL(MRC.size(), 1U);
+  BOOST_CHECK_EQUAL(MRC.ecsEntriesCount(), 1U);
+  BOOST_CHECK_EQUAL(MRC.getECSCoalesced(), 1U);
+
+  for (const auto* client : {"198.51.100.1", "198.51.101.254"}) {
+    BOOST_CHECK_GT(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress(client)), 0);
+    BOOST_REQUIRE_EQUAL(retrieved.size(), 1U);
+    BOOST_CHECK_EQUAL(getRR<ARecordContent>(retrieved.at(0))->getCA().toString(), "192.0.2.1");
+  }
+  /* but the /23 does not cover the neighbouring /23 */
+  BOOST_CHECK_EQUAL(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress("198.51.102.1")), -1);
+
+  /* filling the neighbouring /23 coalesces again, into a /22 */
+  MRC.replace(now, power, QType(QType::A), answer1, signatures, authRecords, true, authZone, Netmask("198.51.102.0/24"));
+  BOOST_CHECK_EQUAL(MRC.size(), 2U);
+  MRC.replace(now, power, QType(QType::A), answer1, signatures, authRecords, true, authZone, Netmask("198.51.103.0/24"));
+  BOOST_CHECK_EQUAL(MRC.size(), 1U);
+  BOOST_CHECK_EQUAL(MRC.getECSCoalesced(), 3U);
+  BOOST_CHECK_GT(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress("198.51.102.1")), 0);
+  BOOST_CHECK_EQUAL(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress("198.51.104.1")), -1);
+
+  /* a more specific answer still wins over the coalesced entry */
+  MRC.replace(now, power, QType(QType::A), answer2, signatures, authRecords, true, authZone, Netmask("198.51.100.128/25"));
+  BOOST_CHECK_EQUAL(MRC.size(), 2U);
+  BOOST_CHECK_GT(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress("198.51.100.129")), 0);
+  BOOST_REQUIRE_EQUAL(retrieved.size(), 1U);
+  BOOST_CHECK_EQUAL(getRR<ARecordContent>(retrieved.at(0))->getCA().toString(), "192.0.2.2");
+
+  /* IPv6 */
+  MRC.replace(now, power, QType(QType::A), answer1, signatures, authRecords, true, authZone, Netmask("2001:db8::/56"));
+  MRC.replace(now, power, QType(QType::A), answer1, signatures, authRecords, true, authZone, Netmask("2001:db8:0:100::/56"));
+  BOOST_CHECK_EQUAL(MRC.size(), 3U);
+  BOOST_CHECK_GT(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress("2001:db8:0:1ff::1")), 0);
+
+  /* a wipe removes the coalesced entries and their index */
+  BOOST_CHECK_EQUAL(MRC.doWipeCache(power, false), 3U);
+  BOOST_CHECK_EQUAL(MRC.size(), 0U);
+  BOOST_CHECK_EQUAL(MRC.ecsIndexSize(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(test_RecursorCacheECSPrefixLimit)
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache::s_maxECSPrefixesPerName = 3;
+  MemRecursorCache MRC(1);
+
+  const DNSName power("powerdns.com.");
+  const DNSName authZone(".");
+  MemRecursorCache::AuthRecsVec authRecords;
+  std::vector<std::shared_ptr<const RRSIGRecordContent>> signatures;
+  time_t now = time(nullptr);
+  std::vector<DNSRecord> retrieved;
+
+  /* a different answer per prefix, so nothing gets coalesced */
+  for (int idx = 0; idx < 4; idx++) {
+    DNSRecord record;
+    record.d_name = power;
+    record.d_type = QType::A;
+    record.d_class = QClass::IN;
+    record.setContent(std::make_shared<ARecordContent>(ComboAddress("192.0.2." + std::to_string(idx))));
+    record.d_ttl = static_cast<uint32_t>(now + 10);
+    record.d_place = DNSResourceRecord::ANSWER;
+    MRC.replace(now, power, QType(QType::A), {record}, signatures, authRecords, true, authZone, Netmask("198.51." + std::to_string(idx * 2) + ".0/24"));
+    if (idx == 2) {
+      /* make the first prefix the most recently used one */
+      BOOST_CHECK_GT(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress("198.51.0.1")), 0);
+    }
+  }
+
+  BOOST_CHECK_EQUAL(MRC.size(), 3U);
+  BOOST_CHECK_EQUAL(MRC.ecsEntriesCount(), 3U);
+  BOOST_CHECK_EQUAL(MRC.getECSEvictions(), 1U);
+
+  /* the least recently used prefix, 198.51.2.0/24, is gone */
+  BOOST_CHECK_EQUAL(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress("198.51.2.1")), -1);
+  for (const auto* client : {"198.51.0.1", "198.51.4.1", "198.51.6.1"}) {
+    BOOST_CHECK_GT(MRC.get(now, power, QType(QType::A), MemRecursorCache::None, &retrieved, ComboAddress(client)), 0);
+  }
+
+  /* other types of the same name have their own limit */
+  DNSRecord record;
+  record.d_name = power;
+  record.d_type = QType::AAAA;
+  record.d_class = QClass::IN;
+  record.setContent(std::make_shared<AAAARecordContent>(ComboAddress("2001:db8::1")));
+  record.d_ttl = static_cast<uint32_t>(now + 10);
+  record.d_place = DNSResourceRecord::ANSWER;
+  MRC.replace(now, power, QType(QType::AAAA), {record}, signatures, authRecords, true, authZone, Netmask("198.51.2.0/24"));
+  BOOST_CHECK_EQUAL(MRC.size(), 4U);
+  BOOST_CHECK_EQUAL(MRC.getECSEvictions(), 1U);
+
+  MemRecursorCache::resetStaticsForTests();
+}
+
 BOOST_AUTO_TEST_CASE(test_RecursorCache_Wipe)
 {
   MemRecursorCache::resetStaticsForTests();
@@ -1442,6 +1719,132 @@ BOOST_AUTO_TEST_CASE(test_RecursorAuthRecords)
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_RecursorCacheSharedContents)
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache MRC;
+
+  const DNSName authZone(".");
+  const MemRecursorCache::SigRecsVec signatures;
+  const MemRecursorCache::AuthRecsVec authRecords;
+  const ComboAddress who("192.0.2.128");
+  const time_t now = time(nullptr);
+
+  auto makeRecord = [&](const DNSName& name, const std::shared_ptr<DNSRecordContent>& content) {
+    DNSRecord record;
+    record.d_name = name;
+    record.d_type = content->getType();
+    record.d_class = QClass::IN;
+    record.d_ttl = static_cast<uint32_t>(now + 3600);
+    record.d_place = DNSResourceRecord::ANSWER;
+    record.setContent(content);
+    return record;
+  };
+
+  /* two delegations using the same name server, each parsed separately */
+  const DNSName first("first.powerdns.com.");
+  const DNSName second("second.powerdns.com.");
+  MRC.replace(now, first, QType(QType::NS), {makeRecord(first, std::make_shared<NSRecordContent>(DNSName("ns1.Hoster.net.")))}, signatures, authRecords, true, authZone);
+  MRC.replace(now, second, QType(QType::NS), {makeRecord(second, std::make_shared<NSRecordContent>(DNSName("ns1.Hoster.net.")))}, signatures, authRecords, true, authZone);
+  /* same name, different case */
+  const DNSName third("third.powerdns.com.");
+  MRC.replace(now, third, QType(QType::NS), {makeRecord(third, std::make_shared<NSRecordContent>(DNSName("ns1.hoster.net.")))}, signatures, authRecords, true, authZone);
+  BOOST_CHECK_EQUAL(MRC.sharedContentsCount(), 2U);
+
+  std::vector<DNSRecord> firstRecords;
+  std::vector<DNSRecord> secondRecords;
+  std::vector<DNSRecord> thirdRecords;
+  BOOST_REQUIRE_GT(MRC.get(now, first, QType(QType::NS), MemRecursorCache::None, &firstRecords, who), 0);
+  BOOST_REQUIRE_GT(MRC.get(now, second, QType(QType::NS), MemRecursorCache::None, &secondRecords, who), 0);
+  BOOST_REQUIRE_GT(MRC.get(now, third, QType(QType::NS), MemRecursorCache::None, &thirdRecords, who), 0);
+  BOOST_REQUIRE_EQUAL(firstRecords.size(), 1U);
+  BOOST_REQUIRE_EQUAL(secondRecords.size(), 1U);
+  BOOST_REQUIRE_EQUAL(thirdRecords.size(), 1U);
+  BOOST_CHECK(firstRecords.at(0).getContent() == secondRecords.at(0).getContent());
+  BOOST_CHECK(firstRecords.at(0).getContent() != thirdRecords.at(0).getContent());
+  BOOST_CHECK_EQUAL(thirdRecords.at(0).getContent()->getZoneRepresentation(), "ns1.hoster.net.");
+
+  /* A records are not shared */
+  MRC.replace(now, first, QType(QType::A), {makeRecord(first, std::make_shared<ARecordContent>(ComboAddress("192.0.2.1")))}, signatures, authRecords, true, authZone);
+  MRC.replace(now, second, QType(QType::A), {makeRecord(second, std::make_shared<ARecordContent>(ComboAddress("192.0.2.1")))}, signatures, authRecords, true, authZone);
+  BOOST_CHECK_EQUAL(MRC.sharedContentsCount(), 2U);
+
+  /* once no entry refers to the content anymore, pruning removes it from the index */
+  firstRecords.clear();
+  secondRecords.clear();
+  thirdRecords.clear();
+  MRC.doPrune(now, 0);
+  BOOST_CHECK_EQUAL(MRC.size(), 0U);
+  for (size_t count = 0; count < 10; count++) {
+    MRC.doPrune(now, 0);
+  }
+  BOOST_CHECK_EQUAL(MRC.sharedContentsCount(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(test_RecursorCacheConcurrentHits)
+{
+  MemRecursorCache::resetStaticsForTests();
+  MemRecursorCache MRC(4);
+
+  const DNSName authZone(".");
+  const MemRecursorCache::SigRecsVec signatures;
+  const MemRecursorCache::AuthRecsVec authRecords;
+  const ComboAddress who("192.0.2.128");
+  const time_t now = time(nullptr);
+  const size_t hotCount = 8;
+
+  auto insert = [&](const DNSName& name, uint32_t address) {
+    DNSRecord record;
+    record.d_name = name;
+    record.d_type = QType::A;
+    record.d_class = QClass::IN;
+    record.d_ttl = static_cast<uint32_t>(now + 3600);
+    record.d_place = DNSResourceRecord::ANSWER;
+    record.setContent(std::make_shared<ARecordContent>(htonl(address)));
+    MRC.replace(now, name, QType(QType::A), {record}, signatures, authRecords, true, authZone, std::nullopt);
+  };
+
+  for (size_t idx = 0; idx < hotCount; idx++) {
+    insert(DNSName("hot" + std::to_string(idx) + ".powerdns.com."), 0xc0000200U + idx);
+  }
+
+  /* the readers take shared locks for these hits, while the main thread keeps adding cold entries
+     and trimming the cache, moving the entries that were hit to the back of the LRU */
+  std::atomic<bool> done{false};
+  std::atomic<size_t> wrong{0};
+  std::vector<std::thread> readers;
+  for (size_t thread = 0; thread < 4; thread++) {
+    readers.emplace_back([&]() {
+      std::vector<DNSRecord> retrieved;
+      size_t idx = 0;
+      while (!done) {
+        const DNSName name("hot" + std::to_string(idx % hotCount) + ".powerdns.com.");
+        if (MRC.get(now, name, QType(QType::A), MemRecursorCache::None, &retrieved, who) > 0 && (retrieved.size() != 1 || getRR<ARecordContent>(retrieved.at(0))->getCA().toString() != "192.0.2." + std::to_string(idx % hotCount))) {
+          ++wrong;
+        }
+        ++idx;
+      }
+    });
+  }
+
+  for (size_t idx = 0; idx < 20000; idx++) {
+    insert(DNSName("cold" + std::to_string(idx) + ".powerdns.com."), 0xc6336400U + (idx % 256));
+    if (idx % 100 == 0) {
+      MRC.doPrune(now, 200);
+    }
+  }
+
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  BOOST_CHECK_EQUAL(wrong.load(), 0U);
+  BOOST_CHECK_LE(MRC.size(), 20000U);
+  auto [contended, acquired] = MRC.stats();
+  BOOST_CHECK_GE(acquired, contended);
+}
+
 #if 0
 volatile bool g_ret; // make sure the optimizer does not get too smart
 uint64_t g_totalRuns;
@@ -467,6 +467,68 @@ BOOST_AUTO_TEST_CASE(test_dnssec_rrsig)
   BOOST_CHECK_EQUAL(validationContext.d_validationsCounter, 1U);
 }
 
+BOOST_AUTO_TEST_CASE(test_dnssec_rrsig_verification_caches)
+{
+  initSR();
+
+  auto log = g_slog->withName("testrunner");
+  auto dcke = DNSCryptoKeyEngine::make(log, DNSSEC::ECDSA256);
+  dcke->create(dcke->getBits());
+  DNSSECPrivateKey dpk;
+  dpk.setKey(std::move(dcke), 256);
+
+  sortedRecords_t recordcontents;
+  recordcontents.insert(getRecordContent(QType::A, "192.0.2.1"));
+
+  DNSName qname("powerdns.com.");
+
+  time_t now = time(nullptr);
+  RRSIGRecordContent rrc;
+  computeRRSIG(dpk, qname, qname, QType::A, 600, 3600, rrc, recordcontents, std::nullopt, now);
+
+  skeyset_t keyset;
+  keyset.insert(std::make_shared<DNSKEYRecordContent>(dpk.getDNSKEY()));
+
+  std::vector<std::shared_ptr<const RRSIGRecordContent>> sigs;
+  sigs.push_back(std::make_shared<RRSIGRecordContent>(rrc));
+
+  pdns::validation::setVerificationCacheSizes(100, 100);
+  auto before = pdns::validation::getVerificationCacheStats();
+
+  pdns::validation::ValidationContext validationContext;
+  BOOST_CHECK(validateWithKeySet(now, qname, recordcontents, sigs, keyset, std::nullopt, validationContext) == vState::Secure);
+  auto stats = pdns::validation::getVerificationCacheStats();
+  BOOST_CHECK_EQUAL(stats.d_signatureMisses - before.d_signatureMisses, 1U);
+  BOOST_CHECK_EQUAL(stats.d_keyMisses - before.d_keyMisses, 1U);
+  BOOST_CHECK_EQUAL(stats.d_signatureEntries, 1U);
+  BOOST_CHECK_EQUAL(stats.d_keyEntries, 1U);
+
+  /* same data, same signature: no crypto this time, but still counted as a validation */
+  BOOST_CHECK(validateWithKeySet(now, qname, recordcontents, sigs, keyset, std::nullopt, validationContext) == vState::Secure);
+  BOOST_CHECK_EQUAL(validationContext.d_validationsCounter, 2U);
+  stats = pdns::validation::getVerificationCacheStats();
+  BOOST_CHECK_EQUAL(stats.d_signatureHits - before.d_signatureHits, 1U);
+  BOOST_CHECK_EQUAL(stats.d_keyHits - before.d_keyHits, 0U);
+
+  /* different data under the same signature: the parsed key is reused, and the result is not */
+  sortedRecords_t otherContents;
+  otherContents.insert(getRecordContent(QType::A, "192.0.2.2"));
+  BOOST_CHECK(validateWithKeySet(now, qname, otherContents, sigs, keyset, std::nullopt, validationContext) == vState::BogusNoValidRRSIG);
+  BOOST_CHECK(validateWithKeySet(now, qname, otherContents, sigs, keyset, std::nullopt, validationContext) == vState::BogusNoValidRRSIG);
+  stats = pdns::validation::getVerificationCacheStats();
+  BOOST_CHECK_EQUAL(stats.d_keyHits - before.d_keyHits, 1U);
+  BOOST_CHECK_EQUAL(stats.d_signatureHits - before.d_signatureHits, 2U);
+  BOOST_CHECK_EQUAL(stats.d_signatureEntries, 2U);
+
+  /* the validity period is still checked for cached results */
+  BOOST_CHECK(validateWithKeySet(now + 7200, qname, recordcontents, sigs, keyset, std::nullopt, validationContext) == vState::BogusSignatureExpired);
+
+  pdns::validation::setVerificationCacheSizes(0, 0);
+  stats = pdns::validation::getVerificationCacheStats();
+  BOOST_CHECK_EQUAL(stats.d_signatureEntries, 0U);
+  BOOST_CHECK_EQUAL(stats.d_keyEntries, 0U);
+}
+
 BOOST_AUTO_TEST_CASE(test_dnssec_rrsig_future)
 {
   initSR();
@@ -42,8 +42,10 @@
 #include "query-local-address.hh"
 #include "gss_context.hh"
 #include "auth-main.hh"
+#include "lock.hh"
 
-std::mutex PacketHandler::s_rfc2136lock;
+#include <deque>
+#include <future>
 
 // Context data for RFC2136 operation
 struct updateContext {
@@ -1014,6 +1016,371 @@ static uint8_t updateRecords(const MOADNSParser::answers_t& answers, DNSSECKeepe
   return RCode::NoError;
 }
 
+// An update message waiting for its zone while another thread updates it.
+// The thread owning the zone either applies the message on its behalf and
+// fulfils the promise with the resulting RCODE, or hands the zone over to it
+// by fulfilling the promise with c_updatePromoted.
+struct PendingUpdate
+{
+  const MOADNSParser::answers_t& answers;
+  DNSPacket& packet;
+  const std::unique_ptr<AuthLua4>& updatePolicyLua;
+  std::string msgPrefix;
+  std::shared_ptr<Logr::Logger> slog;
+  std::promise<int> result;
+};
+
+static constexpr int c_updatePromoted = -1;
+
+// Zones with an update in progress, along with the updates queued behind it.
+// A zone is present for as long as a thread owns it.
+static LockGuarded<std::map<ZoneName, std::deque<PendingUpdate*>>> s_rfc2136zones;
+
+// Checks the prerequisites of an update message and prescans its update
+// section, within an already started transaction. Nothing is changed yet.
+static int checkUpdateMessage(const MOADNSParser::answers_t& answers, updateContext& ctx)
+{
+  // 3.2.1 and 3.2.2 - Prerequisite check
+  for (const auto& rec : answers) {
+    if (rec.d_place == DNSResourceRecord::ANSWER) {
+      int res = checkUpdatePrerequisites(rec, &ctx.di);
+      if (res > 0) {
+        SLOG(g_log << Logger::Error << ctx.msgPrefix << "Failed PreRequisites check for " << rec.d_name << ", returning " << RCode::to_s(res) << endl,
+             ctx.slog->info(Logr::Error, "Update: failed PreRequisites check for record", "record", Logging::Loggable(rec.d_name), "returned value", Logging::Loggable(RCode::to_s(res))));
+        return res;
+      }
+    }
+  }
+
+  // 3.2.3 - Prerequisite check - this is outside of updatePrerequisitesCheck because we check an RRSet and not the RR.
+  if (auto rcode = updatePrereqCheck323(answers, ctx); rcode != RCode::NoError) {
+    return rcode;
+  }
+
+  // 3.4.1 - Prescan section
+  for (const auto& rec : answers) {
+    if (rec.d_place == DNSResourceRecord::AUTHORITY) {
+      int res = checkUpdatePrescan(rec);
+      if (res > 0) {
+        SLOG(g_log << Logger::Error << ctx.msgPrefix << "Failed prescan check, returning " << RCode::to_s(res) << endl,
+             ctx.slog->info(Logr::Error, "Update: failed prescan check", "returned value", Logging::Loggable(RCode::to_s(res))));
+        return res;
+      }
+    }
+  }
+
+  return RCode::NoError;
+}
+
+// Performs the updates of a message that passed checkUpdateMessage(), once
+// prepareUpdateContext() has been called. On failure, `dirty' tells whether
+// some of the changes of the message had already been made.
+static int performUpdateMessage(const PendingUpdate& update, DNSSECKeeper& dsk, updateContext& ctx, uint& changedRecords, bool& dirty)
+{
+  const auto& answers = update.answers;
+  dirty = false;
+
+  // 3.4.2 - Perform the updates.
+  // There's a special condition where deleting the last NS record at zone apex is never deleted (3.4.2.4)
+  // This means we must do it outside the normal performUpdate() because that focusses only on a separate RR.
+
+  // Another special case is the addition of both a CNAME and a non-CNAME for the same name (#6270)
+  // TODO: convert to use Check::checkRRSet() for consistency
+  set<DNSName> cn; // NOLINT(readability-identifier-length)
+  set<DNSName> nocn;
+  for (const auto& rec : answers) {
+    if (rec.d_place == DNSResourceRecord::AUTHORITY && rec.d_class == QClass::IN && rec.d_ttl > 0) {
+      // Addition
+      if (rec.d_type == QType::CNAME) {
+        cn.insert(rec.d_name);
+      }
+      else if (rec.d_type != QType::RRSIG) {
+        nocn.insert(rec.d_name);
+      }
+    }
+  }
+  for (auto const& name : cn) {
+    if (nocn.count(name) > 0) {
+      SLOG(g_log << Logger::Error << ctx.msgPrefix << "Refusing update, found CNAME and non-CNAME addition" << endl,
+           ctx.slog->info(Logr::Error, "Update: found CNAME and non-CNAME addition, refusing update"));
+      return RCode::FormErr;
+    }
+  }
+
+  auto rcode = updateRecords(answers, dsk, changedRecords, update.updatePolicyLua, update.packet, ctx);
+  dirty = rcode != RCode::NoError;
+  return rcode;
+}
+
+// Sets up the DNSSEC-related fields of ctx, once the transaction has been started
+// and the prerequisites of the (first) message to apply have been checked.
+static void prepareUpdateContext(DNSSECKeeper& dsk, updateContext& ctx, string& soaEditSetting)
+{
+  ctx.isPresigned = dsk.isPresigned(ctx.di.zone);
+  ctx.narrow = false;
+  ctx.haveNSEC3 = dsk.getNSEC3PARAM(ctx.di.zone, &ctx.ns3pr, &ctx.narrow);
+  ctx.updatedSerial = false;
+  // all ctx fields valid from now on
+
+  dsk.getSoaEdit(ctx.di.zone, soaEditSetting);
+}
+
+// Logs the exception currently being handled; only to be called from a catch block.
+static void logUpdateException(const updateContext& ctx)
+{
+  try {
+    throw;
+  }
+  catch (SSqlException& e) {
+    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught SSqlException: " << e.txtReason() << "; Sending ServFail!" << endl,
+         ctx.slog->error(Logr::Error, e.txtReason(), "Update: caught SSqlException, sending ServFail"));
+  }
+  catch (DBException& e) {
+    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught DBException: " << e.reason << "; Sending ServFail!" << endl,
+         ctx.slog->error(Logr::Error, e.reason, "Update: caught DBException, sending ServFail"));
+  }
+  catch (PDNSException& e) {
+    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught PDNSException: " << e.reason << "; Sending ServFail!" << endl,
+         ctx.slog->error(Logr::Error, e.reason, "Update: caught PDNSException, sending ServFail"));
+  }
+  catch (std::exception& e) {
+    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught std:exception: " << e.what() << "; Sending ServFail!" << endl,
+         ctx.slog->error(Logr::Error, e.what(), "Update: caught std::exception, sending ServFail"));
+  }
+  catch (...) {
+    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught unknown exception when performing update. Sending ServFail!" << endl,
+         ctx.slog->info(Logr::Error, "Update: caught unknown exception, sending ServFail"));
+  }
+}
+
+// Statistics, cache purges and secondaries notification, once changes have been committed.
+static void updateCommitted(UeberBackend& UBackend, const updateContext& ctx, uint changedRecords)
+{
+  S.deposit("dnsupdate-changes", static_cast<int>(changedRecords));
+
+  DNSSECKeeper::clearMetaCache(ctx.di.zone);
+  // Purge the records!
+  purgeAuthCaches(ctx.di.zone.operator const DNSName&().toString() + "$");
+
+  // Notify secondaries
+  if (ctx.di.kind == DomainInfo::Primary) {
+    vector<string> notify;
+    UBackend.getDomainMetadata(ctx.di.zone, "NOTIFY-DNSUPDATE", notify);
+    if (!notify.empty() && notify.front() == "1") {
+      Communicator.notifyDomain(ctx.di.zone, &UBackend);
+    }
+  }
+}
+
+// Applies a single update message in its own transaction.
+static int processSingleUpdate(UeberBackend& UBackend, DNSSECKeeper& dsk, const PendingUpdate& update, updateContext& ctx)
+{
+  ctx.msgPrefix = update.msgPrefix;
+  ctx.slog = update.slog;
+
+  SLOG(g_log << Logger::Info << ctx.msgPrefix << "starting transaction." << endl,
+       ctx.slog->info(Logr::Info, "Update: starting transaction"));
+  if (!ctx.di.backend->startTransaction(update.packet.qdomainzone, UnknownDomainID)) { // Not giving the domain_id means that we do not delete the existing records.
+    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Backend does not support transaction. Can't do Update packet." << endl,
+         ctx.slog->info(Logr::Error, "Update: backend does not support transaction. Can't process Update packet."));
+    return RCode::NotImp;
+  }
+
+  try {
+    if (auto rcode = checkUpdateMessage(update.answers, ctx); rcode != RCode::NoError) {
+      ctx.di.backend->abortTransaction();
+      return rcode;
+    }
+
+    string soaEditSetting;
+    prepareUpdateContext(dsk, ctx, soaEditSetting);
+
+    uint changedRecords = 0;
+    bool dirty{false};
+    if (auto rcode = performUpdateMessage(update, dsk, ctx, changedRecords, dirty); rcode != RCode::NoError) {
+      ctx.di.backend->abortTransaction();
+      return rcode;
+    }
+
+    // Section 3.6 - Update the SOA serial - outside of performUpdate because we do a SOA update for the complete update message
+    if (changedRecords != 0 && !ctx.updatedSerial) {
+      increaseSerial(soaEditSetting, ctx);
+      changedRecords++;
+    }
+
+    if (changedRecords != 0) {
+      if (!ctx.di.backend->commitTransaction()) {
+        SLOG(g_log << Logger::Error << ctx.msgPrefix << "Failed to commit updates!" << endl,
+             ctx.slog->info(Logr::Error, "Update: failed to commit updates!"));
+        return RCode::ServFail;
+      }
+
+      updateCommitted(UBackend, ctx, changedRecords);
+
+      SLOG(g_log << Logger::Info << ctx.msgPrefix << "Update completed, " << changedRecords << " changed records committed." << endl,
+           ctx.slog->info(Logr::Info, "Update: completed", "number of changed records", Logging::Loggable(changedRecords)));
+    }
+    else {
+      //No change, no commit, we perform abort() because some backends might like this more.
+      SLOG (g_log << Logger::Info << ctx.msgPrefix << "Update completed, 0 changes, rolling back." << endl,
+            ctx.slog->info(Logr::Info, "Update: completed, no changes, rolling back"));
+      ctx.di.backend->abortTransaction();
+    }
+    return RCode::NoError; //rfc 2136 3.4.2.5
+  }
+  catch (...) {
+    logUpdateException(ctx);
+    ctx.di.backend->abortTransaction();
+    return RCode::ServFail;
+  }
+}
+
+// Applies several update messages for the same zone in a single transaction,
+// with one SOA serial increase and one cache purge for the whole group. The
+// prerequisites of each message are checked against the zone as left by the
+// messages preceding it, and a message failing them does not affect the
+// others. Should a message fail after some of its changes have been made,
+// the transaction is rolled back and the messages are applied one by one.
+static void processUpdateGroup(UeberBackend& UBackend, DNSSECKeeper& dsk, const std::vector<PendingUpdate*>& group, updateContext& ctx, std::vector<int>& rcodes)
+{
+  rcodes.assign(group.size(), RCode::NoError);
+  ctx.msgPrefix = group.front()->msgPrefix;
+  ctx.slog = group.front()->slog;
+
+  SLOG(g_log << Logger::Info << ctx.msgPrefix << "starting transaction for " << group.size() << " update messages." << endl,
+       ctx.slog->info(Logr::Info, "Update: starting group transaction", "messages", Logging::Loggable(group.size())));
+  if (!ctx.di.backend->startTransaction(group.front()->packet.qdomainzone, UnknownDomainID)) {
+    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Backend does not support transaction. Can't do Update packet." << endl,
+         ctx.slog->info(Logr::Error, "Update: backend does not support transaction. Can't process Update packet."));
+    rcodes.assign(group.size(), RCode::NotImp);
+    return;
+  }
+
+  try {
+    string soaEditSetting;
+    bool contextPrepared{false};
+    uint changedRecords = 0;
+    bool needSerialIncrease{false};
+    bool dirty{false};
+    for (size_t idx = 0; idx < group.size() && !dirty; ++idx) {
+      ctx.msgPrefix = group[idx]->msgPrefix;
+      ctx.slog = group[idx]->slog;
+      rcodes[idx] = checkUpdateMessage(group[idx]->answers, ctx);
+      if (rcodes[idx] != RCode::NoError) {
+        continue;
+      }
+      if (!contextPrepared) {
+        prepareUpdateContext(dsk, ctx, soaEditSetting);
+        contextPrepared = true;
+      }
+      ctx.updatedSerial = false;
+      uint messageChanges = 0;
+      rcodes[idx] = performUpdateMessage(*group[idx], dsk, ctx, messageChanges, dirty);
+      if (rcodes[idx] == RCode::NoError && messageChanges != 0) {
+        changedRecords += messageChanges;
+        // Section 3.6 - the serial ends up as the last message with changes left it
+        needSerialIncrease = !ctx.updatedSerial;
+      }
+    }
+    ctx.msgPrefix = group.front()->msgPrefix;
+    ctx.slog = group.front()->slog;
+
+    if (!dirty) {
+      if (needSerialIncrease) {
+        increaseSerial(soaEditSetting, ctx);
+        changedRecords++;
+      }
+
+      if (changedRecords != 0) {
+        if (!ctx.di.backend->commitTransaction()) {
+          SLOG(g_log << Logger::Error << ctx.msgPrefix << "Failed to commit updates!" << endl,
+               ctx.slog->info(Logr::Error, "Update: failed to commit updates!"));
+          for (auto& rcode : rcodes) {
+            if (rcode == RCode::NoError) {
+              rcode = RCode::ServFail;
+            }
+          }
+          return;
+        }
+
+        updateCommitted(UBackend, ctx, changedRecords);
+
+        SLOG(g_log << Logger::Info << ctx.msgPrefix << "Update of " << group.size() << " messages completed, " << changedRecords << " changed records committed." << endl,
+             ctx.slog->info(Logr::Info, "Update: group completed", "messages", Logging::Loggable(group.size()), "number of changed records", Logging::Loggable(changedRecords)));
+      }
+      else {
+        SLOG(g_log << Logger::Info << ctx.msgPrefix << "Update of " << group.size() << " messages completed, 0 changes, rolling back." << endl,
+             ctx.slog->info(Logr::Info, "Update: group completed, no changes, rolling back", "messages", Logging::Loggable(group.size())));
+        ctx.di.backend->abortTransaction();
+      }
+      return;
+    }
+
+    SLOG(g_log << Logger::Warning << ctx.msgPrefix << "A message failed after partially applying its changes, rolling back and applying messages one by one." << endl,
+         ctx.slog->info(Logr::Warning, "Update: a message failed after partially applying its changes, rolling back and applying messages one by one"));
+    ctx.di.backend->abortTransaction();
+  }
+  catch (...) {
+    logUpdateException(ctx);
+    ctx.di.backend->abortTransaction();
+  }
+
+  for (size_t idx = 0; idx < group.size(); ++idx) {
+    rcodes[idx] = processSingleUpdate(UBackend, dsk, *group[idx], ctx);
+  }
+}
+
+// Called by the thread owning ctx.di.zone: applies its own update message,
+// along with up to dnsupdate-group-commit - 1 of the messages queued behind
+// it, then hands the zone over to the next queued message, if any.
+static int processUpdateQueue(PendingUpdate& self, updateContext& ctx, UeberBackend& UBackend, DNSSECKeeper& dsk)
+{
+  static const size_t maxGroupSize = std::max(::arg().asNum("dnsupdate-group-commit"), 1);
+
+  std::vector<PendingUpdate*> group{&self};
+  if (maxGroupSize > 1) {
+    auto zones = s_rfc2136zones.lock();
+    auto& queue = zones->at(ctx.di.zone);
+    while (group.size() < maxGroupSize && !queue.empty()) {
+      group.push_back(queue.front());
+      queue.pop_front();
+    }
+  }
+
+  std::vector<int> rcodes;
+  try {
+    if (group.size() == 1) {
+      rcodes.push_back(processSingleUpdate(UBackend, dsk, self, ctx));
+    }
+    else {
+      processUpdateGroup(UBackend, dsk, group, ctx, rcodes);
+    }
+  }
+  catch (...) {
+    logUpdateException(ctx);
+    rcodes.assign(group.size(), RCode::ServFail);
+  }
+
+  for (size_t idx = 1; idx < group.size(); ++idx) {
+    group[idx]->result.set_value(rcodes[idx]);
+  }
+
+  {
+    auto zones = s_rfc2136zones.lock();
+    auto iter = zones->find(ctx.di.zone);
+    if (iter->second.empty()) {
+      zones->erase(iter);
+    }
+    else {
+      auto* next = iter->second.front();
+      iter->second.pop_front();
+      next->result.set_value(c_updatePromoted);
+    }
+  }
+
+  return rcodes.front();
+}
+
 int PacketHandler::processUpdate(DNSPacket& packet)
 {
   if (!::arg().mustDo("dnsupdate")) {
@@ -1104,161 +1471,30 @@ int PacketHandler::processUpdate(DNSPacket& packet)
     }
   }
 
-  auto lock = std::scoped_lock(s_rfc2136lock); //TODO: i think this lock can be per zone, not for everything
-  SLOG(g_log << Logger::Info << ctx.msgPrefix << "starting transaction." << endl,
-       ctx.slog->info(Logr::Info, "Update: starting transaction"));
-  if (!ctx.di.backend->startTransaction(packet.qdomainzone, UnknownDomainID)) { // Not giving the domain_id means that we do not delete the existing records.
-    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Backend does not support transaction. Can't do Update packet." << endl,
-         ctx.slog->info(Logr::Error, "Update: backend does not support transaction. Can't process Update packet."));
-    return RCode::NotImp;
-  }
-
-  // 3.2.1 and 3.2.2 - Prerequisite check
-  for (const auto& rec : answers) {
-    if (rec.d_place == DNSResourceRecord::ANSWER) {
-      int res = checkUpdatePrerequisites(rec, &ctx.di);
-      if (res > 0) {
-        SLOG(g_log << Logger::Error << ctx.msgPrefix << "Failed PreRequisites check for " << rec.d_name << ", returning " << RCode::to_s(res) << endl,
-             ctx.slog->info(Logr::Error, "Update: failed PreRequisites check for record", "record", Logging::Loggable(rec.d_name), "returned value", Logging::Loggable(RCode::to_s(res))));
-        ctx.di.backend->abortTransaction();
-        return res;
-      }
-    }
-  }
-
-  // 3.2.3 - Prerequisite check - this is outside of updatePrerequisitesCheck because we check an RRSet and not the RR.
-  if (auto rcode = updatePrereqCheck323(answers, ctx); rcode != RCode::NoError) {
-    ctx.di.backend->abortTransaction();
-    return rcode;
-  }
-
-  // 3.4 - Prescan & Add/Update/Delete records - is all done within a try block.
-  try {
-    // 3.4.1 - Prescan section
-    for (const auto& rec : answers) {
-      if (rec.d_place == DNSResourceRecord::AUTHORITY) {
-        int res = checkUpdatePrescan(rec);
-        if (res > 0) {
-          SLOG(g_log << Logger::Error << ctx.msgPrefix << "Failed prescan check, returning " << RCode::to_s(res) << endl,
-               ctx.slog->info(Logr::Error, "Update: failed prescan check", "returned value", Logging::Loggable(RCode::to_s(res))));
-          ctx.di.backend->abortTransaction();
-          return res;
-        }
-      }
-    }
-
-    ctx.isPresigned = d_dk.isPresigned(ctx.di.zone);
-    ctx.narrow = false;
-    ctx.haveNSEC3 = d_dk.getNSEC3PARAM(ctx.di.zone, &ctx.ns3pr, &ctx.narrow);
-    ctx.updatedSerial = false;
-    // all ctx fields valid from now on
-
-    string soaEditSetting;
-    d_dk.getSoaEdit(ctx.di.zone, soaEditSetting);
-
-    // 3.4.2 - Perform the updates.
-    // There's a special condition where deleting the last NS record at zone apex is never deleted (3.4.2.4)
-    // This means we must do it outside the normal performUpdate() because that focusses only on a separate RR.
-
-    // Another special case is the addition of both a CNAME and a non-CNAME for the same name (#6270)
-    // TODO: convert to use Check::checkRRSet() for consistency
-    set<DNSName> cn; // NOLINT(readability-identifier-length)
-    set<DNSName> nocn;
-    for (const auto& rec : answers) {
-      if (rec.d_place == DNSResourceRecord::AUTHORITY && rec.d_class == QClass::IN && rec.d_ttl > 0) {
-        // Addition
-        if (rec.d_type == QType::CNAME) {
-          cn.insert(rec.d_name);
-        }
-        else if (rec.d_type != QType::RRSIG) {
-          nocn.insert(rec.d_name);
-        }
-      }
-    }
-    for (auto const& name : cn) {
-      if (nocn.count(name) > 0) {
-        SLOG(g_log << Logger::Error << ctx.msgPrefix << "Refusing update, found CNAME and non-CNAME addition" << endl,
-             ctx.slog->info(Logr::Error, "Update: found CNAME and non-CNAME addition, refusing update"));
-        ctx.di.backend->abortTransaction();
-        return RCode::FormErr;
-      }
-    }
-
-    uint changedRecords = 0;
-    if (auto rcode = updateRecords(answers, d_dk, changedRecords, update_policy_lua, packet, ctx); rcode != RCode::NoError) {
-      ctx.di.backend->abortTransaction();
-      return rcode;
-    }
-
-    // Section 3.6 - Update the SOA serial - outside of performUpdate because we do a SOA update for the complete update message
-    if (changedRecords != 0 && !ctx.updatedSerial) {
-      increaseSerial(soaEditSetting, ctx);
-      changedRecords++;
-    }
-
-    if (changedRecords != 0) {
-      if (!ctx.di.backend->commitTransaction()) {
-        SLOG(g_log << Logger::Error << ctx.msgPrefix << "Failed to commit updates!" << endl,
-             ctx.slog->info(Logr::Error, "Update: failed to commit updates!"));
-        return RCode::ServFail;
-      }
-
-      S.deposit("dnsupdate-changes", static_cast<int>(changedRecords));
-
-      DNSSECKeeper::clearMetaCache(ctx.di.zone);
-      // Purge the records!
-      purgeAuthCaches(ctx.di.zone.operator const DNSName&().toString() + "$");
-
-      // Notify secondaries
-      if (ctx.di.kind == DomainInfo::Primary) {
-        vector<string> notify;
-        B.getDomainMetadata(packet.qdomainzone, "NOTIFY-DNSUPDATE", notify);
-        if (!notify.empty() && notify.front() == "1") {
-          Communicator.notifyDomain(ctx.di.zone, &B);
-        }
-      }
-
-      SLOG(g_log << Logger::Info << ctx.msgPrefix << "Update completed, " << changedRecords << " changed records committed." << endl,
-           ctx.slog->info(Logr::Info, "Update: completed", "number of changed records", Logging::Loggable(changedRecords)));
+  // Updates to different zones proceed in parallel, updates to the same zone
+  // queue up behind the one in progress, which may apply them along with its own.
+  PendingUpdate self{answers, packet, update_policy_lua, ctx.msgPrefix, ctx.slog, {}};
+  auto result = self.result.get_future();
+  bool leader = false;
+  {
+    auto zones = s_rfc2136zones.lock();
+    auto [iter, inserted] = zones->try_emplace(ctx.di.zone);
+    if (inserted) {
+      leader = true;
     }
     else {
-      //No change, no commit, we perform abort() because some backends might like this more.
-      SLOG (g_log << Logger::Info << ctx.msgPrefix << "Update completed, 0 changes, rolling back." << endl,
-            ctx.slog->info(Logr::Info, "Update: completed, no changes, rolling back"));
-      ctx.di.backend->abortTransaction();
+      iter->second.push_back(&self);
     }
-    return RCode::NoError; //rfc 2136 3.4.2.5
-  }
-  catch (SSqlException& e) {
-    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught SSqlException: " << e.txtReason() << "; Sending ServFail!" << endl,
-         ctx.slog->error(Logr::Error, e.txtReason(), "Update: caught SSqlException, sending ServFail"));
-    ctx.di.backend->abortTransaction();
-    return RCode::ServFail;
-  }
-  catch (DBException& e) {
-    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught DBException: " << e.reason << "; Sending ServFail!" << endl,
-         ctx.slog->error(Logr::Error, e.reason, "Update: caught DBException, sending ServFail"));
-    ctx.di.backend->abortTransaction();
-    return RCode::ServFail;
   }
-  catch (PDNSException& e) {
-    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught PDNSException: " << e.reason << "; Sending ServFail!" << endl,
-         ctx.slog->error(Logr::Error, e.reason, "Update: caught PDNSException, sending ServFail"));
-    ctx.di.backend->abortTransaction();
-    return RCode::ServFail;
-  }
-  catch (std::exception& e) {
-    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught std:exception: " << e.what() << "; Sending ServFail!" << endl,
-         ctx.slog->error(Logr::Error, e.what(), "Update: caught std::exception, sending ServFail"));
-    ctx.di.backend->abortTransaction();
-    return RCode::ServFail;
-  }
-  catch (...) {
-    SLOG(g_log << Logger::Error << ctx.msgPrefix << "Caught unknown exception when performing update. Sending ServFail!" << endl,
-         ctx.slog->info(Logr::Error, "Update: caught unknown exception, sending ServFail"));
-    ctx.di.backend->abortTransaction();
-    return RCode::ServFail;
+  if (!leader) {
+    SLOG(g_log << Logger::Info << ctx.msgPrefix << "zone busy, waiting for the update in progress." << endl,
+         ctx.slog->info(Logr::Info, "Update: zone busy, waiting for the update in progress"));
+    int rcode = result.get();
+    if (rcode != c_updatePromoted) {
+      return rcode;
+    }
   }
+  return processUpdateQueue(self, ctx, B, d_dk);
 }
 
 static void increaseSerial(const string& soaEditSetting, const updateContext& ctx)
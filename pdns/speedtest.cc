@@ -1,6 +1,7 @@
 #include "config.h"
 #include <boost/format.hpp>
 #include <boost/container/string.hpp>
+#include <boost/functional/hash.hpp>
 #include "credentials.hh"
 #include "dnsparser.hh"
 #include "sstuff.hh"
@@ -15,6 +16,8 @@
 #include "dns_random.hh"
 #include "arguments.hh"
 #include "shuffle.hh"
+#include "zoneparser-tng.hh"
+#include <thread>
 
 #if defined(HAVE_LIBSODIUM)
 #include <sodium.h>
@@ -517,6 +520,74 @@ struct SOARecordTest
   int d_records;
 };
 
+/* An answer as PacketHandler assembles it from the query cache: the record contents
+   already exist, and are either serialized again or written from their rendering */
+struct TypicalAnswerTest
+{
+  explicit TypicalAnswerTest(bool prerendered) : d_prerendered(prerendered)
+  {
+    auto add = [this](const std::string& owner, uint16_t type, const std::string& content, DNSResourceRecord::Place place) {
+      d_records.push_back({DNSName(owner), DNSRecordContent::make(type, QClass::IN, content), type, place});
+    };
+    add("example.org", QType::MX, "10 mx1.example.org.", DNSResourceRecord::ANSWER);
+    add("example.org", QType::MX, "20 mx2.example.org.", DNSResourceRecord::ANSWER);
+    add("example.org", QType::RRSIG, "MX 13 2 3600 20250101000000 20240101000000 12345 example.org. aGVsbG8gd29ybGQgaGVsbG8gd29ybGQgaGVsbG8gd29ybGQgaGVsbG8gd29ybGQgaGVsbG8gd29ybGQgaGVsbG8gd29ybGQ=", DNSResourceRecord::ANSWER);
+    for (const auto& nameserver : {"ns1.example.org.", "ns2.example.org.", "ns3.example.net."}) {
+      add("example.org", QType::NS, nameserver, DNSResourceRecord::AUTHORITY);
+    }
+    add("mx1.example.org", QType::A, "192.0.2.1", DNSResourceRecord::ADDITIONAL);
+    add("mx1.example.org", QType::AAAA, "2001:db8::1", DNSResourceRecord::ADDITIONAL);
+    add("mx2.example.org", QType::A, "192.0.2.2", DNSResourceRecord::ADDITIONAL);
+    add("mx2.example.org", QType::AAAA, "2001:db8::2", DNSResourceRecord::ADDITIONAL);
+  }
+
+  string getName() const
+  {
+    return d_prerendered ? "typical answer, prerendered" : "typical answer, toPacket";
+  }
+
+  void operator()() const
+  {
+    // DNSPacket::addRecord() hashes every record's wire format to spot duplicates
+    for (const auto& record : d_records) {
+      size_t hash = 0;
+      boost::hash_combine(hash, record.d_name);
+      if (d_prerendered) {
+        boost::hash_combine(hash, record.d_content->getPrerendered().wire);
+      }
+      else {
+        boost::hash_combine(hash, record.d_content->serialize(record.d_name));
+      }
+      d_hashes += hash;
+    }
+
+    // DNSPacket::wrapup()
+    vector<uint8_t> packet;
+    DNSPacketWriter pw(packet, DNSName("example.org"), QType::MX);
+    for (const auto& record : d_records) {
+      pw.startRecord(record.d_name, record.d_type, 3600, QClass::IN, record.d_place);
+      if (d_prerendered) {
+        pw.xfrPrerendered(record.d_content->getPrerendered());
+      }
+      else {
+        record.d_content->toPacket(pw);
+      }
+    }
+    pw.commit();
+  }
+
+  struct Record
+  {
+    DNSName d_name;
+    std::shared_ptr<const DNSRecordContent> d_content;
+    uint16_t d_type;
+    DNSResourceRecord::Place d_place;
+  };
+  vector<Record> d_records;
+  mutable size_t d_hashes{0};
+  bool d_prerendered;
+};
+
 static vector<uint8_t> makeEmptyQuery()
 {
   vector<uint8_t> packet;
@@ -800,6 +871,41 @@ private:
   SuffixMatchNode d_smn;
 };
 
+struct SuffixMatchNodeLargeTest
+{
+  explicit SuffixMatchNodeLargeTest(bool compact) :
+    d_compact(compact)
+  {
+    for (unsigned int idx = 0; idx < 100000; idx++) {
+      d_smn.add(DNSName("host" + std::to_string(idx) + ".domain" + std::to_string(idx % 1000) + ".com."));
+    }
+    if (d_compact) {
+      d_smn.compact();
+    }
+  }
+
+  string getName() const
+  {
+    return string("SuffixMatchNode 100k entries") + (d_compact ? " compact" : "");
+  }
+
+  void operator()() const
+  {
+    if (!d_smn.check(d_exist)) {
+      throw std::runtime_error("Entry not found in SuffixMatchNodeLargeTest");
+    }
+    if (d_smn.check(d_does_not_exist)) {
+      throw std::runtime_error("Non-existent entry found in SuffixMatchNodeLargeTest");
+    }
+  }
+
+private:
+  const DNSName d_exist{"www.host12345.domain345.com."};
+  const DNSName d_does_not_exist{"www.host12345.domain346.com."};
+  SuffixMatchNode d_smn;
+  bool d_compact;
+};
+
 struct IEqualsTest
 {
   string getName() const
@@ -1219,6 +1325,43 @@ private:
   bool d_withdup;
 };
 
+static vector<string> makeZoneLines(size_t howmany)
+{
+  vector<string> lines;
+  lines.reserve(howmany + 8);
+  lines.emplace_back("$TTL 3600");
+  lines.emplace_back("@ IN SOA ns1 hostmaster ( 1 3600 1800 604800 300 )");
+  lines.emplace_back("  IN NS ns1");
+  for (size_t idx = 0; idx < howmany; idx += 5) {
+    auto name = "host-" + std::to_string(idx);
+    lines.emplace_back(name + " IN A 192.0.2." + std::to_string(idx % 256));
+    lines.emplace_back("  IN AAAA 2001:db8::" + std::to_string(idx % 65536));
+    lines.emplace_back("  300 IN MX 10 mail-" + std::to_string(idx));
+    lines.emplace_back("  IN TXT \"v=spf1 a mx -all\" ; a comment");
+    lines.emplace_back("alias-" + std::to_string(idx) + " IN CNAME " + name);
+  }
+  lines.emplace_back("$GENERATE 1-" + std::to_string(howmany) + " gen-$ IN A 198.51.100.${0,0,d}");
+  return lines;
+}
+
+// Wall-clock, as opposed to doRun(), since the work is spread over threads
+static void zoneParseRun(const vector<string>& lines, size_t threads)
+{
+  DTime dt;
+  dt.set();
+  ZoneParserTNG zpt(lines, ZoneName("example.com"));
+  zpt.setParallel(threads);
+  DNSResourceRecord rr;
+  size_t records = 0;
+  while (zpt.get(rr)) {
+    ++records;
+  }
+  double delta = dt.udiff() / 1000000.0;
+  boost::format fmt("'%d records zone parse, %d thread(s)' %.02f seconds: %.1f records/s");
+
+  cerr << (fmt % records % threads % delta % (records / delta)) << endl;
+}
+
 int main()
 {
   try {
@@ -1313,6 +1456,9 @@ int main()
     doRun(SOARecordTest(4));
     doRun(SOARecordTest(64));
 
+    doRun(TypicalAnswerTest(false));
+    doRun(TypicalAnswerTest(true));
+
     doRun(StringtokTest());
     doRun(VStringtokTest());
     doRun(StringAppendTest());
@@ -1322,6 +1468,8 @@ int main()
     doRun(DNSNameRootTest());
 
     doRun(SuffixMatchNodeTest());
+    doRun(SuffixMatchNodeLargeTest(false));
+    doRun(SuffixMatchNodeLargeTest(true));
 
     doRun(NetmaskTreeTest());
 
@@ -1371,6 +1519,12 @@ int main()
     doRun(DedupRecordsTest(4096, true));
     doRun(DedupRecordsTest(4096, true, true));
 
+    {
+      auto lines = makeZoneLines(200000);
+      zoneParseRun(lines, 1);
+      zoneParseRun(lines, std::max(2U, std::thread::hardware_concurrency()));
+    }
+
     cerr<<"Total runs: " << g_totalRuns<<endl;
   }
   catch (std::exception &e) {
@@ -361,6 +361,11 @@ std::unique_ptr<SSqlStatement> SSQLite3::prepare(const string& query, int nparam
   return std::make_unique<SSQLite3Statement>(d_slog, this, m_dolog, query);
 }
 
+std::unique_ptr<SSqlBulkInserter> SSQLite3::bulkInserter(const string& table, const vector<string>& columns, size_t batchSize)
+{
+  return std::make_unique<SSqlMultiRowInserter>(this, table, columns, batchSize, true);
+}
+
 void SSQLite3::executeImpl(const string& query)
 {
   char* errmsg = nullptr;
@@ -45,6 +45,7 @@ public:
 
   std::unique_ptr<SSqlStatement> prepare(const string& query, int nparams) override;
   void execute(const string& query) override;
+  std::unique_ptr<SSqlBulkInserter> bulkInserter(const string& table, const vector<string>& columns, size_t batchSize) override;
   void setLog(bool state) override;
 
   void startTransaction() override;
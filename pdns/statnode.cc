@@ -48,6 +48,18 @@ void StatNode::visit(const visitor_t& visitor, Stat& newstat, unsigned int depth
   newstat += childstat;
 }
 
+void StatNode::merge(StatNode&& rhs)
+{
+  s += rhs.s;
+  for (auto& [childName, child] : rhs.children) {
+    auto [iter, inserted] = children.try_emplace(childName, std::move(child));
+    if (!inserted) {
+      iter->second.merge(std::move(child));
+    }
+  }
+  rhs.children.clear();
+}
+
 void StatNode::submit(const DNSName& domain, int rcode, unsigned int bytes, bool hit, const std::optional<ComboAddress>& remote, size_t samplingRate)
 {
   //  cerr<<"FIRST submit called on '"<<domain<<"'"<<endl;
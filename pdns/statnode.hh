@@ -67,6 +67,8 @@ public:
   void submit(const DNSName& domain, int rcode, uint32_t bytes, bool hit, const std::optional<ComboAddress>& remote, size_t samplingRate);
   Stat print(unsigned int depth=0, Stat newstat=Stat(), bool silent=false) const;
   void visit(const visitor_t& visitor, Stat& newstat, unsigned int depth = 0) const;
+  // adds the statistics of rhs, whose subtrees are moved over where we do not have them yet
+  void merge(StatNode&& rhs);
   [[nodiscard]] bool empty() const
   {
     return children.empty() && s.remotes.empty();
@@ -119,6 +119,43 @@ BOOST_AUTO_TEST_CASE(test_add_while_pending_replace_duplicate)
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_replace_incremental)
+{
+  AuthZoneCache cache(16);
+  cache.setRefreshInterval(3600);
+
+  vector<std::tuple<ZoneName, domainid_t>> zone_indices;
+  for (domainid_t idx = 1; idx <= 100; idx++) {
+    zone_indices.emplace_back(ZoneName("zone" + std::to_string(idx) + ".example."), idx);
+  }
+  cache.setReplacePending();
+  cache.replace(zone_indices);
+  BOOST_CHECK_EQUAL(cache.size(), 100U);
+  BOOST_CHECK_GT(cache.lastChangedShards(), 0U);
+
+  // identical data does not touch any shard
+  cache.setReplacePending();
+  cache.replace(zone_indices);
+  BOOST_CHECK_EQUAL(cache.size(), 100U);
+  BOOST_CHECK_EQUAL(cache.lastChangedShards(), 0U);
+
+  // one changed id, one removal: at most two shards are rewritten
+  std::get<1>(zone_indices.at(0)) = 1000;
+  zone_indices.pop_back();
+  cache.setReplacePending();
+  cache.replace(zone_indices);
+  BOOST_CHECK_EQUAL(cache.size(), 99U);
+  BOOST_CHECK_GE(cache.lastChangedShards(), 1U);
+  BOOST_CHECK_LE(cache.lastChangedShards(), 2U);
+
+  domainid_t zoneId = 0;
+  BOOST_CHECK(cache.getEntry(ZoneName("zone1.example."), zoneId));
+  BOOST_CHECK_EQUAL(zoneId, 1000);
+  BOOST_CHECK(!cache.getEntry(ZoneName("zone100.example."), zoneId));
+  BOOST_CHECK(cache.getEntry(ZoneName("zone50.example."), zoneId));
+  BOOST_CHECK_EQUAL(zoneId, 50);
+}
+
 BOOST_AUTO_TEST_CASE(test_netmask)
 {
   AuthZoneCache cache;
@@ -0,0 +1,143 @@
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_NO_MAIN
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <cstdlib>
+#include <optional>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+#include "axfr-spool.hh"
+
+BOOST_AUTO_TEST_SUITE(test_axfr_spool_cc)
+
+static DNSResourceRecord makeRecord(size_t idx)
+{
+  DNSResourceRecord record;
+  record.qname = DNSName("host" + std::to_string(idx) + ".example.com.");
+  record.qtype = idx % 3 == 0 ? QType::TXT : QType::A;
+  record.qclass = QClass::IN;
+  /* large enough that the spilled records do not fit in a single stdio buffer, and sometimes empty */
+  record.content = idx % 3 == 0 ? "\"" + std::string(idx * 10, 'x') + "\"" : (idx % 7 == 0 ? "" : "192.0.2." + std::to_string(idx % 256));
+  record.ttl = 3600 + idx;
+  record.signttl = idx;
+  record.domain_id = 42;
+  record.last_modified = static_cast<time_t>(1700000000 + idx);
+  record.scopeMask = idx % 32;
+  record.auth = idx % 2 == 0;
+  record.disabled = idx % 5 == 0;
+  record.ordername = DNSName("ordername");
+  record.wildcardname = DNSName("wildcard.example.com.");
+  return record;
+}
+
+static void checkRecords(AXFRSpool& spool, size_t count)
+{
+  size_t idx = 0;
+  spool.forEach([&idx](DNSResourceRecord& record) {
+    const auto expected = makeRecord(idx);
+    BOOST_CHECK_EQUAL(record.qname, expected.qname);
+    BOOST_CHECK_EQUAL(record.qtype, expected.qtype);
+    BOOST_CHECK_EQUAL(record.qclass, expected.qclass);
+    BOOST_CHECK_EQUAL(record.content, expected.content);
+    BOOST_CHECK_EQUAL(record.ttl, expected.ttl);
+    BOOST_CHECK_EQUAL(record.signttl, expected.signttl);
+    BOOST_CHECK_EQUAL(record.domain_id, expected.domain_id);
+    BOOST_CHECK_EQUAL(record.last_modified, expected.last_modified);
+    BOOST_CHECK_EQUAL(record.scopeMask, expected.scopeMask);
+    BOOST_CHECK_EQUAL(record.auth, expected.auth);
+    BOOST_CHECK_EQUAL(record.disabled, expected.disabled);
+    ++idx;
+  });
+  BOOST_CHECK_EQUAL(idx, count);
+}
+
+BOOST_AUTO_TEST_CASE(test_in_memory)
+{
+  AXFRSpool spool(0);
+  BOOST_CHECK(spool.empty());
+
+  for (size_t idx = 0; idx < 1000; idx++) {
+    spool.add(makeRecord(idx));
+  }
+
+  BOOST_CHECK_EQUAL(spool.size(), 1000U);
+  BOOST_CHECK_EQUAL(spool.spilledBytes(), 0U);
+  BOOST_CHECK(spool.spillError().empty());
+  BOOST_CHECK(spool.containsType(QType::A));
+  BOOST_CHECK(spool.containsType(QType::TXT));
+  BOOST_CHECK(!spool.containsType(QType::SOA));
+  checkRecords(spool, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(test_spill)
+{
+  AXFRSpool spool(10);
+
+  for (size_t idx = 0; idx < 995; idx++) {
+    spool.add(makeRecord(idx));
+  }
+
+  BOOST_CHECK_EQUAL(spool.size(), 995U);
+  BOOST_CHECK(spool.spillError().empty());
+  BOOST_CHECK_GT(spool.spilledBytes(), 0U);
+  BOOST_CHECK(spool.containsType(QType::TXT));
+
+  /* the records that were spilled come back from the file, followed by the ones still in memory */
+  checkRecords(spool, 995);
+
+  /* ordername and wildcardname are not preserved once spilled, see axfr-spool.hh */
+  size_t idx = 0;
+  spool.forEach([&idx](DNSResourceRecord& record) {
+    if (idx++ < 990) {
+      BOOST_CHECK(record.ordername.empty());
+      BOOST_CHECK(record.wildcardname.empty());
+    }
+  });
+
+  /* the spool can be read more than once, and records can still be added after reading it */
+  const auto spilled = spool.spilledBytes();
+  for (size_t idx = 995; idx < 1200; idx++) {
+    spool.add(makeRecord(idx));
+  }
+  BOOST_CHECK_GT(spool.spilledBytes(), spilled);
+  checkRecords(spool, 1200);
+}
+
+BOOST_AUTO_TEST_CASE(test_spill_error)
+{
+  char path[] = "/tmp/pdns-test-axfr-spool.XXXXXX";
+  BOOST_REQUIRE(mkdtemp(path) != nullptr);
+  /* a directory that does not exist anymore, which we cannot create a file in, not even as root */
+  BOOST_REQUIRE_EQUAL(rmdir(path), 0);
+
+  const char* previous = getenv("TMPDIR"); // NOLINT(concurrency-mt-unsafe)
+  const std::optional<std::string> savedTmpDir = previous != nullptr ? std::optional<std::string>(previous) : std::nullopt;
+  setenv("TMPDIR", path, 1); // NOLINT(concurrency-mt-unsafe)
+
+  AXFRSpool spool(10);
+  for (size_t idx = 0; idx < 100; idx++) {
+    spool.add(makeRecord(idx));
+  }
+
+  if (savedTmpDir) {
+    setenv("TMPDIR", savedTmpDir->c_str(), 1); // NOLINT(concurrency-mt-unsafe)
+  }
+  else {
+    unsetenv("TMPDIR"); // NOLINT(concurrency-mt-unsafe)
+  }
+
+  /* everything is kept in memory instead */
+  BOOST_CHECK(!spool.spillError().empty());
+  BOOST_CHECK(spool.spillError().find(path) != std::string::npos);
+  BOOST_CHECK_EQUAL(spool.spilledBytes(), 0U);
+  BOOST_CHECK_EQUAL(spool.size(), 100U);
+  checkRecords(spool, 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -565,6 +565,90 @@ BOOST_AUTO_TEST_CASE(test_suffixmatch) {
   BOOST_CHECK(smn.check(DNSName("sub.domain.fr.")));
 }
 
+BOOST_AUTO_TEST_CASE(test_suffixmatch_compact) {
+  SuffixMatchNode smn;
+  smn.add(DNSName("ezdns.it."));
+  smn.add(DNSName("org."));
+  smn.add(DNSName("news.bbc.co.uk."));
+  smn.add(DNSName("Example.NET."));
+  smn.compact();
+
+  BOOST_CHECK(smn.check(DNSName("www.ezdns.it.")));
+  BOOST_CHECK(!smn.check(DNSName("www.powerdns.com.")));
+  BOOST_CHECK(smn.check(DNSName("www.powerdns.oRG.")));
+  BOOST_CHECK(smn.check(DNSName("news.bbc.co.uk.")));
+  BOOST_CHECK(smn.check(DNSName("www.www.news.BBC.co.uk.")));
+  BOOST_CHECK(!smn.check(DNSName("images.bbc.co.uk.")));
+  BOOST_CHECK(!smn.check(DNSName("co.uk.")));
+  BOOST_CHECK(!smn.check(g_rootdnsname));
+  BOOST_CHECK(smn.getBestMatch(DNSName("www.news.bbc.co.uk")) == DNSName("news.bbc.co.uk."));
+  BOOST_CHECK(smn.getBestMatch(DNSName("images.bbc.co.uk")) == std::nullopt);
+  // the case of the names that were added is preserved
+  BOOST_CHECK_EQUAL(smn.getBestMatch(DNSName("www.example.net."))->toString(), "Example.NET.");
+  BOOST_CHECK_EQUAL(smn.toString(), "org., news.bbc.co.uk., Example.NET., ezdns.it.");
+
+  // copies share the compact tree, and are not affected by updates to the original
+  const auto copy = smn;
+
+  // names added after compacting are still found, and the longest match wins
+  smn.add(DNSName("bbc.co.uk."));
+  smn.add(DNSName("www.news.bbc.co.uk."));
+  BOOST_CHECK(smn.check(DNSName("images.bbc.co.uk.")));
+  BOOST_CHECK(smn.getBestMatch(DNSName("a.www.news.bbc.co.uk")) == DNSName("www.news.bbc.co.uk."));
+  BOOST_CHECK(smn.getBestMatch(DNSName("a.news.bbc.co.uk")) == DNSName("news.bbc.co.uk."));
+  BOOST_CHECK(!copy.check(DNSName("images.bbc.co.uk.")));
+
+  // removing a compacted name
+  smn.remove(DNSName("org."));
+  BOOST_CHECK(!smn.check(DNSName("www.powerdns.org.")));
+  BOOST_CHECK(copy.check(DNSName("www.powerdns.org.")));
+  smn.remove(DNSName("example.net."));
+  BOOST_CHECK(!smn.check(DNSName("example.net.")));
+  BOOST_CHECK_EQUAL(smn.toVector().size(), 4U);
+
+  smn.compact();
+  BOOST_CHECK(smn.check(DNSName("images.bbc.co.uk.")));
+  BOOST_CHECK(smn.check(DNSName("www.ezdns.it.")));
+  BOOST_CHECK(!smn.check(DNSName("www.powerdns.org.")));
+  BOOST_CHECK_EQUAL(smn.toString(), "bbc.co.uk., news.bbc.co.uk., www.news.bbc.co.uk., ezdns.it.");
+
+  smn.add(g_rootdnsname);
+  smn.compact();
+  BOOST_CHECK(smn.check(DNSName("a.root-servers.net.")));
+  BOOST_CHECK(smn.getBestMatch(DNSName("a.root-servers.net.")) == g_rootdnsname);
+  BOOST_CHECK(smn.getBestMatch(DNSName("www.ezdns.it.")) == DNSName("ezdns.it."));
+}
+
+BOOST_AUTO_TEST_CASE(test_suffixmatch_compact_vs_tree) {
+  // the compact tree has to answer exactly like the regular one
+  std::vector<DNSName> names;
+  SuffixMatchNode regular;
+  for (unsigned int idx = 0; idx < 5000; idx++) {
+    DNSName name("d" + std::to_string(idx % 7) + ".example" + std::to_string(idx % 97) + ".tld" + std::to_string(idx % 3) + ".");
+    if (idx % 11 == 0) {
+      name = DNSName("host" + std::to_string(idx)) + name;
+    }
+    names.push_back(name);
+    regular.add(name);
+  }
+  const CompactSuffixMatchTree compact(names);
+  BOOST_CHECK_EQUAL(compact.getNames().size(), compact.size());
+
+  for (unsigned int idx = 0; idx < 10000; idx += 3) {
+    const DNSName name("host" + std::to_string(idx) + ".d" + std::to_string(idx % 9) + ".EXAMPLE" + std::to_string(idx % 101) + ".tld" + std::to_string(idx % 4) + ".");
+    BOOST_CHECK_EQUAL(compact.check(name), regular.check(name));
+    BOOST_CHECK(compact.getBestMatch(name) == regular.getBestMatch(name));
+  }
+  for (const auto& name : names) {
+    BOOST_CHECK(compact.contains(name));
+    BOOST_CHECK(compact.check(DNSName("sub") + name));
+  }
+  BOOST_CHECK(!compact.contains(DNSName("example1.tld1.")));
+  BOOST_CHECK(compact.check(DNSName("d1.example1.tld1.")));
+  BOOST_CHECK(!compact.check(DNSName("example1.tld1.")));
+  BOOST_CHECK(!CompactSuffixMatchTree().check(g_rootdnsname));
+}
+
 BOOST_AUTO_TEST_CASE(test_suffixmatch_tree) {
   SuffixMatchTree<DNSName> smt;
   DNSName ezdns("ezdns.it.");
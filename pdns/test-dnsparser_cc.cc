@@ -11,7 +11,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include "dnsparser.hh"
+#include "dnsrecords.hh"
 #include "dnswriter.hh"
+#include "ednsoptions.hh"
 #include "svc-records.hh"
 
 BOOST_AUTO_TEST_SUITE(test_dnsparser_cc)
@@ -730,4 +732,113 @@ BOOST_AUTO_TEST_CASE(test_xfrSvcParamKeyVals_bad_ordering) {
   BOOST_CHECK_THROW(pr.xfrSvcParamKeyVals(svcParams), std::out_of_range);
 }
 
+BOOST_AUTO_TEST_CASE(test_DNSPacketView) {
+  const DNSName name("powerdns.com.");
+  const DNSName target("www.powerdns.com.");
+
+  vector<uint8_t> packet;
+  DNSPacketWriter pwR(packet, name, QType::A, QClass::IN, 0);
+  pwR.getHeader()->qr = 1;
+  pwR.startRecord(name, QType::CNAME, 3600, QClass::IN, DNSResourceRecord::ANSWER);
+  CNAMERecordContent(target).toPacket(pwR);
+  pwR.startRecord(target, QType::A, 42, QClass::IN, DNSResourceRecord::ANSWER);
+  ARecordContent(ComboAddress("192.0.2.1")).toPacket(pwR);
+  pwR.startRecord(name, QType::NS, 86400, QClass::IN, DNSResourceRecord::AUTHORITY);
+  NSRecordContent(DNSName("ns1.powerdns.com.")).toPacket(pwR);
+  pwR.startRecord(DNSName("ns1.powerdns.com."), QType::AAAA, 86400, QClass::IN, DNSResourceRecord::ADDITIONAL);
+  AAAARecordContent(ComboAddress("2001:db8::1")).toPacket(pwR);
+  pwR.addOpt(1232, 0, EDNSOpts::DNSSECOK, GenericDNSPacketWriter<vector<uint8_t>>::optvect_t{{EDNSOptionCode::NSID, "nsid"}});
+  pwR.commit();
+
+  const std::string_view wire(reinterpret_cast<const char*>(packet.data()), packet.size());
+  MOADNSParser mdp(false, wire.data(), wire.size());
+  DNSPacketView view(wire);
+
+  BOOST_CHECK(view.d_qname == name);
+  BOOST_CHECK(view.d_qname == DNSName("PowerDNS.COM."));
+  BOOST_CHECK(view.d_qname != target);
+  BOOST_CHECK(view.d_qname != DNSName("com."));
+  BOOST_CHECK(view.d_qname != DNSName());
+  BOOST_CHECK_EQUAL(view.d_qname.toDNSName(), mdp.d_qname);
+  BOOST_CHECK_EQUAL(view.d_qtype, mdp.d_qtype);
+  BOOST_CHECK_EQUAL(view.d_qclass, mdp.d_qclass);
+  BOOST_CHECK_EQUAL(view.d_header.ancount, mdp.d_header.ancount);
+  BOOST_CHECK_EQUAL(view.d_header.arcount, mdp.d_header.arcount);
+
+  BOOST_REQUIRE_EQUAL(view.size(), mdp.d_answers.size());
+  size_t idx = 0;
+  for (const auto& record : view) {
+    const auto& expected = mdp.d_answers.at(idx++);
+    BOOST_CHECK(record.d_name == expected.d_name);
+    /* names are compressed in the packet */
+    BOOST_CHECK_EQUAL(record.d_name.wirelength(), expected.d_name.wirelength());
+    BOOST_CHECK_EQUAL(record.d_place, expected.d_place);
+    BOOST_CHECK_EQUAL(record.d_type, expected.d_type);
+    BOOST_CHECK_EQUAL(record.d_class, expected.d_class);
+    BOOST_CHECK_EQUAL(record.d_ttl, expected.d_ttl);
+    BOOST_CHECK_EQUAL(record.d_clen, expected.d_clen);
+    BOOST_CHECK_EQUAL(record.getRData().size(), record.d_clen);
+  }
+  BOOST_CHECK_EQUAL(idx, mdp.d_answers.size());
+
+  const auto records = view.getRecords();
+  BOOST_REQUIRE_EQUAL(records.size(), mdp.d_answers.size());
+  for (idx = 0; idx < records.size(); idx++) {
+    BOOST_CHECK(records.at(idx) == mdp.d_answers.at(idx));
+  }
+
+  EDNSOpts fromView;
+  EDNSOpts fromParser;
+  BOOST_REQUIRE(getEDNSOpts(view, &fromView));
+  BOOST_REQUIRE(getEDNSOpts(mdp, &fromParser));
+  BOOST_CHECK_EQUAL(fromView.d_packetsize, fromParser.d_packetsize);
+  BOOST_CHECK_EQUAL(fromView.d_extFlags, fromParser.d_extFlags);
+  BOOST_CHECK(fromView.d_options == fromParser.d_options);
+}
+
+BOOST_AUTO_TEST_CASE(test_DNSPacketView_truncated) {
+  const DNSName name("powerdns.com.");
+
+  vector<uint8_t> packet;
+  DNSPacketWriter pwR(packet, name, QType::A, QClass::IN, 0);
+  pwR.getHeader()->qr = 1;
+  for (unsigned int idx = 1; idx <= 3; idx++) {
+    pwR.startRecord(name, QType::A, 42, QClass::IN, DNSResourceRecord::ANSWER);
+    ARecordContent(ComboAddress("192.0.2." + std::to_string(idx))).toPacket(pwR);
+  }
+  pwR.commit();
+
+  /* cut the last record in half */
+  packet.resize(packet.size() - 2);
+  const std::string_view wire(reinterpret_cast<const char*>(packet.data()), packet.size());
+  BOOST_CHECK_THROW(DNSPacketView view(wire), MOADNSException);
+
+  dnsheader header{};
+  memcpy(&header, packet.data(), sizeof(header));
+  header.tc = 1;
+  memcpy(packet.data(), &header, sizeof(header));
+  DNSPacketView view(wire);
+  MOADNSParser mdp(false, wire.data(), wire.size());
+  BOOST_CHECK_EQUAL(view.d_header.ancount, 2U);
+  BOOST_CHECK_EQUAL(view.d_header.ancount, mdp.d_header.ancount);
+  BOOST_CHECK_EQUAL(view.getRecords().size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(test_DNSPacketView_invalid_names) {
+  /* a question name that is a pointer to itself */
+  dnsheader header{};
+  header.qr = 1;
+  header.qdcount = htons(1);
+  std::string packet(reinterpret_cast<const char*>(&header), sizeof(header));
+  packet.append("\xc0\x0c\x00\x01\x00\x01", 6);
+
+  BOOST_CHECK_THROW(DNSPacketView view(packet), MOADNSException);
+  BOOST_CHECK_THROW(MOADNSParser mdp(false, packet), MOADNSException);
+
+  const DNSPacketView::NameView nameView(packet, sizeof(dnsheader));
+  BOOST_CHECK(nameView != DNSName("powerdns.com."));
+  BOOST_CHECK_THROW(nameView.toDNSName(), std::range_error);
+  BOOST_CHECK_THROW(nameView.getOnWireLength(), std::range_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,278 @@
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_NO_MAIN
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+#include "dnspcap.hh"
+#include "dnswriter.hh"
+
+BOOST_AUTO_TEST_SUITE(test_dnspcap_cc)
+
+template <typename T>
+static void append(std::string& out, T value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+/* an IPv4 header, an UDP header and the payload */
+static std::string makeIPv4UDP(const ComboAddress& source, const ComboAddress& dest, const std::string& payload, uint8_t protocol = 17)
+{
+  struct ip iphdr{};
+  iphdr.ip_v = 4;
+  iphdr.ip_hl = sizeof(iphdr) / 4;
+  iphdr.ip_len = htons(sizeof(iphdr) + sizeof(struct udphdr) + payload.size());
+  iphdr.ip_ttl = 64;
+  iphdr.ip_p = protocol;
+  iphdr.ip_src = source.sin4.sin_addr;
+  iphdr.ip_dst = dest.sin4.sin_addr;
+
+  struct udphdr udp{};
+  udp.uh_sport = source.sin4.sin_port;
+  udp.uh_dport = dest.sin4.sin_port;
+  udp.uh_ulen = htons(sizeof(udp) + payload.size());
+
+  std::string ret;
+  append(ret, iphdr);
+  append(ret, udp);
+  ret += payload;
+  return ret;
+}
+
+/* the block type, its total length, the body padded to 32 bits and the total length again */
+static void appendPcapngBlock(std::string& out, uint32_t type, std::string body)
+{
+  body.resize((body.size() + 3) & ~3);
+  const uint32_t length = body.size() + 3 * sizeof(uint32_t);
+  append(out, type);
+  append(out, length);
+  out += body;
+  append(out, length);
+}
+
+static void appendEnhancedPacketBlock(std::string& out, uint32_t interfaceID, uint64_t timestamp, const std::string& packet)
+{
+  std::string body;
+  append(body, interfaceID);
+  append(body, static_cast<uint32_t>(timestamp >> 32));
+  append(body, static_cast<uint32_t>(timestamp & 0xffffffff));
+  append(body, static_cast<uint32_t>(packet.size()));
+  append(body, static_cast<uint32_t>(packet.size()));
+  body += packet;
+  appendPcapngBlock(out, 6, std::move(body));
+}
+
+static std::string writeTemporaryFile(const std::string& content)
+{
+  char path[] = "/tmp/pdns-test-pcap.XXXXXX";
+  int fileDesc = mkstemp(path);
+  if (fileDesc < 0) {
+    BOOST_FAIL("Unable to generate a temporary file");
+  }
+  BOOST_REQUIRE_EQUAL(write(fileDesc, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+  close(fileDesc);
+  return path;
+}
+
+static std::string makeQuery(const DNSName& qname)
+{
+  vector<uint8_t> packet;
+  DNSPacketWriter writer(packet, qname, QType::A);
+  writer.getHeader()->id = htons(4242);
+  writer.getHeader()->rd = 1;
+  return std::string(packet.begin(), packet.end());
+}
+
+BOOST_AUTO_TEST_CASE(test_pcapng)
+{
+  const ComboAddress client("192.0.2.1:4242");
+  const ComboAddress server("192.0.2.53:53");
+  const auto query1 = makeQuery(DNSName("raw.powerdns.com."));
+  const auto query2 = makeQuery(DNSName("ethernet.powerdns.com."));
+  const auto query3 = makeQuery(DNSName("simple.powerdns.com."));
+
+  std::string capture;
+  {
+    std::string body;
+    append(body, PcapPacketReader::s_pcapngByteOrderMagic);
+    append(body, static_cast<uint16_t>(1));
+    append(body, static_cast<uint16_t>(0));
+    append(body, static_cast<int64_t>(-1));
+    appendPcapngBlock(capture, PcapPacketReader::s_pcapngSectionHeaderBlock, std::move(body));
+  }
+  {
+    /* interface 0: raw IP, timestamps in nanoseconds (if_tsresol = 9) */
+    std::string body;
+    append(body, static_cast<uint16_t>(101));
+    append(body, static_cast<uint16_t>(0));
+    append(body, static_cast<uint32_t>(65535));
+    append(body, static_cast<uint16_t>(9));
+    append(body, static_cast<uint16_t>(1));
+    append(body, static_cast<uint32_t>(9));
+    append(body, static_cast<uint32_t>(0));
+    appendPcapngBlock(capture, 1, std::move(body));
+  }
+  /* an interface statistics block, which has to be skipped */
+  appendPcapngBlock(capture, 5, std::string(20, '\0'));
+  appendEnhancedPacketBlock(capture, 0, 1700000000ULL * 1000000000ULL + 123456789ULL, makeIPv4UDP(client, server, query1));
+  /* not UDP */
+  appendEnhancedPacketBlock(capture, 0, 1700000001ULL * 1000000000ULL, makeIPv4UDP(client, server, query1, 6));
+  {
+    /* interface 1: ethernet, default resolution of microseconds */
+    std::string body;
+    append(body, static_cast<uint16_t>(1));
+    append(body, static_cast<uint16_t>(0));
+    append(body, static_cast<uint32_t>(65535));
+    appendPcapngBlock(capture, 1, std::move(body));
+  }
+  {
+    struct ether_header ether{};
+    ether.ether_type = htons(0x0800);
+    std::string frame;
+    append(frame, ether);
+    frame += makeIPv4UDP(server, client, query2);
+    appendEnhancedPacketBlock(capture, 1, 1700000002ULL * 1000000ULL + 42ULL, frame);
+  }
+  {
+    /* simple packet blocks have no timestamp and always refer to the first interface */
+    const auto packet = makeIPv4UDP(client, server, query3);
+    std::string body;
+    append(body, static_cast<uint32_t>(packet.size()));
+    body += packet;
+    appendPcapngBlock(capture, 3, std::move(body));
+  }
+
+  const auto path = writeTemporaryFile(capture);
+  const auto output = path + ".out";
+  {
+    PcapPacketReader reader(path);
+    BOOST_CHECK(reader.isPcapng());
+
+    BOOST_REQUIRE(reader.getUDPPacket());
+    BOOST_CHECK_EQUAL(reader.d_pheader.ts.tv_sec, 1700000000U);
+    BOOST_CHECK_EQUAL(reader.d_pheader.ts.tv_usec, 123456U);
+    BOOST_CHECK_EQUAL(reader.getSource().toStringWithPort(), client.toStringWithPort());
+    BOOST_CHECK_EQUAL(reader.getDest().toStringWithPort(), server.toStringWithPort());
+    BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(reader.d_payload), reader.d_len), query1); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    const PcapUDPPacket first(reader, true);
+
+    BOOST_REQUIRE(reader.getUDPPacket());
+    BOOST_CHECK_EQUAL(reader.d_pheader.ts.tv_sec, 1700000002U);
+    BOOST_CHECK_EQUAL(reader.d_pheader.ts.tv_usec, 42U);
+    BOOST_CHECK_EQUAL(reader.getSource().toStringWithPort(), server.toStringWithPort());
+    BOOST_CHECK_EQUAL(reader.getDest().toStringWithPort(), client.toStringWithPort());
+    BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(reader.d_payload), reader.d_len), query2); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+    BOOST_REQUIRE(reader.getUDPPacket());
+    BOOST_CHECK_EQUAL(reader.d_pheader.ts.tv_sec, 0U);
+    BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(reader.d_payload), reader.d_len), query3); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+
+    BOOST_CHECK(!reader.getUDPPacket());
+    BOOST_CHECK_EQUAL(reader.d_correctpackets, 3U);
+    BOOST_CHECK_EQUAL(reader.d_nonetheripudp, 1U);
+
+    /* a copied packet can be written out as classic PCAP, even once the reader is gone */
+    PcapPacketWriter writer(output);
+    {
+      PcapPacketReader again(path);
+      BOOST_REQUIRE(again.getUDPPacket());
+      writer.setPPR(again);
+    }
+    writer.write(first);
+  }
+
+  {
+    PcapPacketReader reader(output);
+    BOOST_CHECK(!reader.isPcapng());
+    BOOST_REQUIRE(reader.getUDPPacket());
+    BOOST_CHECK_EQUAL(reader.d_pheader.ts.tv_sec, 1700000000U);
+    BOOST_CHECK_EQUAL(reader.d_pheader.ts.tv_usec, 123456U);
+    BOOST_CHECK_EQUAL(reader.getSource().toStringWithPort(), client.toStringWithPort());
+    BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(reader.d_payload), reader.d_len), query1); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    BOOST_CHECK(!reader.getUDPPacket());
+  }
+
+  unlink(path.c_str());
+  unlink(output.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_pcapng_writer_linktype)
+{
+  const ComboAddress client("192.0.2.1:4242");
+  const ComboAddress server("192.0.2.53:53");
+  const auto query = makeQuery(DNSName("raw.powerdns.com."));
+
+  std::string capture;
+  {
+    std::string body;
+    append(body, PcapPacketReader::s_pcapngByteOrderMagic);
+    append(body, static_cast<uint16_t>(1));
+    append(body, static_cast<uint16_t>(0));
+    append(body, static_cast<int64_t>(-1));
+    appendPcapngBlock(capture, PcapPacketReader::s_pcapngSectionHeaderBlock, std::move(body));
+  }
+  {
+    /* raw IP */
+    std::string body;
+    append(body, static_cast<uint16_t>(101));
+    append(body, static_cast<uint16_t>(0));
+    append(body, static_cast<uint32_t>(65535));
+    appendPcapngBlock(capture, 1, std::move(body));
+  }
+  appendEnhancedPacketBlock(capture, 0, 1700000000ULL * 1000000ULL, makeIPv4UDP(client, server, query));
+
+  const auto path = writeTemporaryFile(capture);
+  const auto output = path + ".out";
+  {
+    /* the writer is set up before the reader has seen the interface description block,
+       as dnsscope does when the packets are handed to several threads */
+    PcapPacketReader reader(path);
+    PcapPacketWriter writer(output, reader);
+    BOOST_REQUIRE(reader.getUDPPacket());
+    writer.write(PcapUDPPacket(reader, true));
+  }
+
+  {
+    auto filePtr = pdns::UniqueFilePtr(fopen(output.c_str(), "r"));
+    BOOST_REQUIRE(filePtr);
+    pdns_pcap_file_header header{};
+    BOOST_REQUIRE_EQUAL(fread(&header, sizeof(header), 1, filePtr.get()), 1U);
+    BOOST_CHECK_EQUAL(header.magic, PcapPacketReader::s_pcapMagic);
+    BOOST_CHECK_EQUAL(header.linktype, 101U);
+  }
+
+  {
+    PcapPacketReader reader(output);
+    BOOST_REQUIRE(reader.getUDPPacket());
+    BOOST_CHECK_EQUAL(reader.getSource().toStringWithPort(), client.toStringWithPort());
+    BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(reader.d_payload), reader.d_len), query); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    BOOST_CHECK(!reader.getUDPPacket());
+  }
+
+  unlink(path.c_str());
+  unlink(output.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_pcapng_bad_block)
+{
+  std::string capture;
+  std::string body;
+  append(body, PcapPacketReader::s_pcapngByteOrderMagic);
+  append(body, static_cast<uint16_t>(1));
+  append(body, static_cast<uint16_t>(0));
+  append(body, static_cast<int64_t>(-1));
+  appendPcapngBlock(capture, PcapPacketReader::s_pcapngSectionHeaderBlock, std::move(body));
+  /* a packet referring to an interface that has not been described */
+  appendEnhancedPacketBlock(capture, 0, 0, std::string(40, '\0'));
+
+  const auto path = writeTemporaryFile(capture);
+  PcapPacketReader reader(path);
+  BOOST_CHECK_THROW(reader.getUDPPacket(), std::runtime_error);
+  unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
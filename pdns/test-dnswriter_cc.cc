@@ -13,6 +13,7 @@
 
 #include "dnswriter.hh"
 #include "dnsparser.hh"
+#include "dnsrecords.hh"
 
 BOOST_AUTO_TEST_SUITE(test_dnswriter_cc)
 
@@ -407,4 +408,112 @@ BOOST_AUTO_TEST_CASE(test_NodeOrLocatorID) {
     0, 0, 0, 1}));
 }
 
+BOOST_AUTO_TEST_CASE(test_xfrPrerendered) {
+  const std::vector<std::pair<uint16_t, std::string>> records = {
+    {QType::A, "192.0.2.1"},
+    {QType::NS, "ns1.example.org."},
+    {QType::MX, "10 mail.example.org."},
+    {QType::SOA, "ns1.example.org. hostmaster.example.org. 2025010101 7200 3600 1209600 3600"},
+    {QType::SRV, "0 5 5060 sip.example.org."},
+    {QType::RRSIG, "A 8 3 3600 20250101000000 20240101000000 12345 example.org. AAAA"},
+    {QType::NSEC, "b.example.org. A NS SOA RRSIG NSEC"},
+    {QType::DNAME, "example.net."},
+  };
+
+  for (const bool lowerCase : {false, true}) {
+    vector<uint8_t> expected;
+    vector<uint8_t> replayed;
+    DNSPacketWriter expectedWriter(expected, DNSName("www.example.org."), QType::A);
+    DNSPacketWriter replayWriter(replayed, DNSName("www.example.org."), QType::A);
+    expectedWriter.setLowercase(lowerCase);
+    replayWriter.setLowercase(lowerCase);
+
+    for (const auto& [type, content] : records) {
+      auto drc = DNSRecordContent::make(type, QClass::IN, content);
+      // the same rendering is written twice, its names have to compress against different packet contents
+      for (const auto& owner : {DNSName("Example.org."), DNSName("sub.example.org.")}) {
+        expectedWriter.startRecord(owner, type);
+        drc->toPacket(expectedWriter);
+        replayWriter.startRecord(owner, type);
+        replayWriter.xfrPrerendered(drc->getPrerendered());
+      }
+    }
+    expectedWriter.commit();
+    replayWriter.commit();
+
+    BOOST_CHECK(expected == replayed);
+  }
+
+  // a copy of a content may be modified, it must not inherit the rendering
+  auto soa = std::dynamic_pointer_cast<SOARecordContent>(DNSRecordContent::make(QType::SOA, QClass::IN, "a.example. b.example. 1 2 3 4 5"));
+  BOOST_REQUIRE(soa);
+  const auto* first = &soa->getPrerendered();
+  auto copy = std::make_shared<SOARecordContent>(*soa);
+  copy->d_st.serial = 2;
+  BOOST_CHECK(&soa->getPrerendered() == first);
+  BOOST_CHECK(copy->getPrerendered().wire != first->wire);
+}
+
+BOOST_AUTO_TEST_CASE(test_compressionTable) {
+  auto generatePacket = [](DNSNameCompressionTable* table) {
+    vector<uint8_t> packet;
+    DNSPacketWriter writer(packet, DNSName("www.Example.org."), QType::ANY);
+    writer.setCompressionTable(table);
+    for (unsigned int idx = 0; idx < 300; idx++) {
+      const DNSName owner("host" + std::to_string(idx) + ".sub" + std::to_string(idx % 7) + (idx % 2 == 0 ? ".example.org." : ".EXAMPLE.org."));
+      writer.startRecord(owner, QType::A, 3600, QClass::IN, idx < 100 ? DNSResourceRecord::ANSWER : DNSResourceRecord::ADDITIONAL);
+      writer.xfrIP(htonl(0xc0000200 + (idx % 256)));
+      writer.startRecord(owner, QType::MX);
+      writer.xfr16BitInt(10);
+      writer.xfrName(DNSName("mail" + std::to_string(idx % 5) + ".sub" + std::to_string(idx % 3) + ".example.org."), true);
+      writer.startRecord(owner, QType::NS, 3600, QClass::IN, DNSResourceRecord::ADDITIONAL, false);
+      writer.xfrName(DNSName("ns" + std::to_string(idx % 4) + ".example.net."), true);
+    }
+    writer.commit();
+    return packet;
+  };
+
+  const auto linear = generatePacket(nullptr);
+  DNSNameCompressionTable table(16);
+  // the table is reused, and has to grow
+  for (unsigned int run = 0; run < 2; run++) {
+    const auto hashed = generatePacket(&table);
+    /* an equally long match may be found at a different offset, but the result has to be as small */
+    BOOST_CHECK_EQUAL(hashed.size(), linear.size());
+
+    MOADNSParser linearParser(false, reinterpret_cast<const char*>(linear.data()), linear.size());
+    MOADNSParser hashedParser(false, reinterpret_cast<const char*>(hashed.data()), hashed.size());
+    BOOST_REQUIRE_EQUAL(hashedParser.d_answers.size(), linearParser.d_answers.size());
+    for (size_t idx = 0; idx < linearParser.d_answers.size(); idx++) {
+      BOOST_CHECK(hashedParser.d_answers.at(idx) == linearParser.d_answers.at(idx));
+      BOOST_CHECK_EQUAL(hashedParser.d_answers.at(idx).d_name.toString(), linearParser.d_answers.at(idx).d_name.toString());
+    }
+  }
+
+  /* names written before the table is set, and rollbacks */
+  vector<uint8_t> packet;
+  DNSPacketWriter writer(packet, DNSName("powerdns.com."), QType::A);
+  writer.startRecord(DNSName("www.powerdns.com."), QType::A);
+  writer.xfrIP(htonl(0xc0000201));
+  writer.commit();
+  const auto size = writer.size();
+  writer.setCompressionTable(&table);
+  writer.startRecord(DNSName("rolledback.example.net."), QType::A);
+  writer.xfrIP(htonl(0xc0000202));
+  writer.rollback();
+  writer.startRecord(DNSName("WWW.powerdns.com."), QType::AAAA);
+  writer.xfrIP6(std::string(16, '\x01'));
+  writer.commit();
+  /* fully compressed against the first record */
+  BOOST_CHECK_EQUAL(writer.size(), size + 2 + 10 + 16);
+  writer.startRecord(DNSName("mail.example.net."), QType::A);
+  writer.xfrIP(htonl(0xc0000203));
+  writer.commit();
+
+  MOADNSParser parser(false, reinterpret_cast<const char*>(packet.data()), packet.size());
+  BOOST_REQUIRE_EQUAL(parser.d_answers.size(), 3U);
+  BOOST_CHECK_EQUAL(parser.d_answers.at(1).d_name, DNSName("www.powerdns.com."));
+  BOOST_CHECK_EQUAL(parser.d_answers.at(2).d_name, DNSName("mail.example.net."));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #endif
 #include <boost/test/unit_test.hpp>
 #include <bitset>
+#include <random>
 #include "iputils.hh"
 
 using namespace boost;
@@ -645,6 +646,120 @@ BOOST_AUTO_TEST_CASE(test_removal) {
   BOOST_CHECK(nmt.empty());
 }
 
+static ComboAddress randomAddress(std::mt19937& gen, bool ipv6)
+{
+  if (!ipv6) {
+    return ComboAddress(std::to_string(gen() % 256) + "." + std::to_string(gen() % 256) + "." + std::to_string(gen() % 256) + "." + std::to_string(gen() % 256));
+  }
+  // keep the first 16 bits in a small range so that prefixes overlap
+  std::ostringstream str;
+  str << std::hex << (0x2000 + gen() % 4);
+  for (int idx = 0; idx < 7; idx++) {
+    str << ":" << (gen() % 0x10000);
+  }
+  return ComboAddress(str.str());
+}
+
+static void checkSameLookups(const NetmaskTree<int>& tree, const CompressedNetmaskTree<int>& compressed, std::mt19937& gen, const std::vector<ComboAddress>& known)
+{
+  BOOST_CHECK_EQUAL(compressed.size(), tree.size());
+  auto check = [&](const ComboAddress& address) {
+    const auto* expected = tree.lookup(address);
+    const auto* got = compressed.lookup(address);
+    BOOST_REQUIRE_EQUAL(got == nullptr, expected == nullptr);
+    if (expected != nullptr) {
+      BOOST_CHECK_EQUAL(got->first.toString(), expected->first.toString());
+      BOOST_CHECK_EQUAL(got->second, expected->second);
+    }
+  };
+  for (const auto& address : known) {
+    check(address);
+  }
+  for (int idx = 0; idx < 20000; idx++) {
+    check(randomAddress(gen, idx % 2 == 1));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_CompressedNetmaskTree) {
+  std::mt19937 gen(42);
+  NetmaskTree<int> tree;
+  std::vector<Netmask> masks;
+  std::vector<ComboAddress> known;
+  for (int idx = 0; idx < 20000; idx++) {
+    const bool ipv6 = idx % 3 == 0;
+    const auto address = randomAddress(gen, ipv6);
+    // mostly specific prefixes, with a few short ones that cover them
+    const unsigned int bits = ipv6 ? (idx % 50 == 0 ? gen() % 17 : 16 + gen() % 113) : (idx % 50 == 0 ? gen() % 9 : 8 + gen() % 25);
+    masks.emplace_back(address, bits);
+    tree.insert(masks.back()).second = idx;
+    known.push_back(address);
+  }
+  tree.insert(Netmask("0.0.0.0/0")).second = -1;
+
+  CompressedNetmaskTree<int> compressed(tree);
+  checkSameLookups(tree, compressed, gen, known);
+  BOOST_CHECK(compressed.match(ComboAddress("192.0.2.1")));
+  BOOST_CHECK(!CompressedNetmaskTree<int>().match(ComboAddress("192.0.2.1")));
+
+  // incremental updates, a copy taken before keeps answering as the original tree did
+  const auto copy = compressed;
+  const auto original = tree;
+  for (size_t idx = 0; idx < masks.size(); idx += 7) {
+    // NetmaskTree::erase() is only safe for keys that are present
+    if (tree.has_key(masks[idx].getNormalized())) {
+      tree.erase(masks[idx]);
+    }
+    compressed.erase(masks[idx]);
+  }
+  for (int idx = 0; idx < 2000; idx++) {
+    const bool ipv6 = idx % 2 == 0;
+    const Netmask mask(randomAddress(gen, ipv6), ipv6 ? gen() % 129 : gen() % 33);
+    tree.insert(mask).second = 100000 + idx;
+    compressed.insert_or_assign(mask, 100000 + idx);
+  }
+  tree.erase(Netmask("0.0.0.0/0"));
+  compressed.erase(Netmask("0.0.0.0/0"));
+  checkSameLookups(tree, compressed, gen, known);
+  checkSameLookups(original, copy, gen, known);
+
+  // empty it completely
+  for (const auto& entry : NetmaskTree<int>(tree)) {
+    tree.erase(entry.first);
+    compressed.erase(entry.first);
+  }
+  BOOST_CHECK(compressed.empty());
+  checkSameLookups(tree, compressed, gen, known);
+}
+
+BOOST_AUTO_TEST_CASE(test_NetmaskGroup_compress) {
+  NetmaskGroup group;
+  group.addMask("10.0.0.0/8");
+  group.addMask("!10.1.0.0/16");
+  group.addMask("192.0.2.0/24");
+  group.addMask("2001:db8::/32");
+  group.compress();
+
+  Netmask matched;
+  BOOST_CHECK(group.match(ComboAddress("10.2.3.4")));
+  BOOST_CHECK(!group.match(ComboAddress("10.1.3.4")));
+  BOOST_CHECK(!group.lookup(ComboAddress("10.1.3.4"), &matched));
+  BOOST_CHECK_EQUAL(matched.toString(), "10.1.0.0/16");
+  BOOST_CHECK(group.lookup(ComboAddress("2001:db8::1"), &matched));
+  BOOST_CHECK_EQUAL(matched.toString(), "2001:db8::/32");
+  BOOST_CHECK(!group.match(ComboAddress("192.0.3.1")));
+
+  group.addMask("192.0.3.0/24");
+  group.deleteMask(Netmask("10.1.0.0/16"));
+  BOOST_CHECK(group.match(ComboAddress("192.0.3.1")));
+  BOOST_CHECK(group.match(ComboAddress("10.1.3.4")));
+  BOOST_CHECK_EQUAL(group.size(), 4U);
+
+  group.clear();
+  BOOST_CHECK(!group.match(ComboAddress("10.2.3.4")));
+  group.addMask("10.0.0.0/8");
+  BOOST_CHECK(group.match(ComboAddress("10.2.3.4")));
+}
+
 BOOST_AUTO_TEST_CASE(test_iterator) {
   NetmaskTree<int> masks_set1;
   std::set<Netmask> masks_set2;
@@ -0,0 +1,154 @@
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_NO_MAIN
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+#include "ixfrutils.hh"
+#include "zoneparser-tng.hh"
+
+BOOST_AUTO_TEST_SUITE(test_ixfrutils_cc)
+
+static DNSRecord makeRecord(const std::string& name, uint16_t qtype, const std::string& content, uint32_t ttl = 3600)
+{
+  DNSRecord record;
+  record.d_name = DNSName(name);
+  record.d_type = qtype;
+  record.d_class = QClass::IN;
+  record.d_ttl = ttl;
+  record.setContent(DNSRecordContent::make(qtype, QClass::IN, content));
+  return record;
+}
+
+static std::string makeTemporaryDirectory()
+{
+  char path[] = "/tmp/pdns-test-ixfrutils.XXXXXX";
+  BOOST_REQUIRE(mkdtemp(path) != nullptr);
+  return path;
+}
+
+static bool fileExists(const std::string& path)
+{
+  return access(path.c_str(), F_OK) == 0;
+}
+
+BOOST_AUTO_TEST_CASE(test_zonefilewriter_roundtrip)
+{
+  const ZoneName zone("example.com.");
+  const auto directory = makeTemporaryDirectory();
+
+  /* relative to the zone, as received by ixfrdist */
+  records_t records;
+  records.insert(makeRecord(".", QType::SOA, "ns1.example.com. hostmaster.example.com. 2024010101 3600 600 604800 300"));
+  records.insert(makeRecord(".", QType::NS, "ns1.example.com."));
+  records.insert(makeRecord(".", QType::NS, "ns2.example.net."));
+  records.insert(makeRecord(".", QType::MX, "10 mail.example.com."));
+  records.insert(makeRecord(".", QType::TXT, "\"v=spf1 -all\" \"a second string; with a semicolon\"", 60));
+  records.insert(makeRecord("ns1.", QType::A, "192.0.2.1"));
+  records.insert(makeRecord("ns1.", QType::AAAA, "2001:db8::1"));
+  records.insert(makeRecord("www.", QType::CNAME, "ns1.example.com."));
+  records.insert(makeRecord("*.wild.", QType::A, "192.0.2.2", 0));
+  records.insert(makeRecord("sub.", QType::NS, "ns.sub.example.com."));
+  records.insert(makeRecord("ns.sub.", QType::A, "192.0.2.3"));
+  records.insert(makeRecord("_sip._tcp.", QType::SRV, "0 5 5060 sip.example.com."));
+  records.insert(makeRecord("svc.", QType::HTTPS, "1 . alpn=h2,h3 port=8443"));
+  records.insert(makeRecord("escaped\\.dot.", QType::TXT, "\"\\\"quoted\\\" and \\\\ backslash\""));
+  records.insert(makeRecord("spaced\\032label.", QType::A, "192.0.2.4"));
+
+  writeZoneToDisk(records, zone, directory);
+
+  const auto fname = directory + "/2024010101";
+  BOOST_CHECK(fileExists(fname));
+  BOOST_CHECK(!fileExists(fname + ".partial"));
+  BOOST_CHECK_EQUAL(getSerialFromDir(directory), 2024010101U);
+
+  records_t loaded;
+  loadZoneFromDisk(loaded, fname, zone);
+  BOOST_REQUIRE_EQUAL(loaded.size(), records.size());
+  auto expected = records.begin();
+  for (const auto& record : loaded) {
+    BOOST_CHECK_EQUAL(record.d_name, expected->d_name);
+    BOOST_CHECK_EQUAL(record.d_type, expected->d_type);
+    BOOST_CHECK_EQUAL(record.d_ttl, expected->d_ttl);
+    BOOST_CHECK_EQUAL(record.getContent()->getZoneRepresentation(), expected->getContent()->getZoneRepresentation());
+    ++expected;
+  }
+
+  /* the parser sees the zone with the SOA at both ends, as in an AXFR */
+  ZoneParserTNG zpt(fname, zone);
+  DNSResourceRecord resourceRecord;
+  size_t count = 0;
+  QType last;
+  while (zpt.get(resourceRecord)) {
+    if (count == 0) {
+      BOOST_CHECK_EQUAL(resourceRecord.qtype, QType::SOA);
+      BOOST_CHECK_EQUAL(resourceRecord.qname, DNSName("example.com."));
+    }
+    last = resourceRecord.qtype;
+    ++count;
+  }
+  BOOST_CHECK_EQUAL(count, records.size() + 2);
+  BOOST_CHECK_EQUAL(last, QType::SOA);
+
+  unlink(fname.c_str());
+  rmdir(directory.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_zonefilewriter_incomplete)
+{
+  const ZoneName zone("example.com.");
+  const auto directory = makeTemporaryDirectory();
+  const auto soa = makeRecord(".", QType::SOA, "ns1.example.com. hostmaster.example.com. 42 3600 600 604800 300");
+  const auto fname = directory + "/42";
+
+  {
+    ZoneFileWriter writer(zone, directory);
+    /* the first record has to be the SOA */
+    BOOST_CHECK_THROW(writer.write(makeRecord("www.", QType::A, "192.0.2.1")), std::runtime_error);
+    BOOST_CHECK_THROW(writer.commit(), std::runtime_error);
+  }
+
+  {
+    ZoneFileWriter writer(zone, directory);
+    writer.write(soa);
+    writer.write(makeRecord("www.", QType::A, "192.0.2.1"));
+    BOOST_CHECK_EQUAL(writer.getSerial(), 42U);
+    BOOST_CHECK(fileExists(fname + ".partial"));
+    /* the last record has to be the SOA as well */
+    BOOST_CHECK_THROW(writer.commit(), std::runtime_error);
+    BOOST_CHECK(!fileExists(fname + ".partial"));
+    BOOST_CHECK(!fileExists(fname));
+  }
+
+  {
+    /* a transfer that is aborted leaves nothing behind */
+    ZoneFileWriter writer(zone, directory);
+    writer.write(soa);
+    writer.write(makeRecord("www.", QType::A, "192.0.2.1"));
+    BOOST_CHECK(fileExists(fname + ".partial"));
+  }
+  BOOST_CHECK(!fileExists(fname + ".partial"));
+  BOOST_CHECK(!fileExists(fname));
+  BOOST_CHECK_EQUAL(getSerialFromDir(directory), 0U);
+
+  {
+    ZoneFileWriter writer(zone, directory);
+    writer.write(soa);
+    writer.write(soa);
+    writer.commit();
+    BOOST_CHECK_THROW(writer.write(soa), std::runtime_error);
+  }
+  BOOST_CHECK(fileExists(fname));
+  BOOST_CHECK_EQUAL(getSerialFromDir(directory), 42U);
+
+  unlink(fname.c_str());
+  rmdir(directory.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
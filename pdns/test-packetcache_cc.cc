@@ -14,6 +14,7 @@
 #include "auth-packetcache.hh"
 #include "auth-querycache.hh"
 #ifdef PDNS_AUTH
+#include "auth-denialcache.hh"
 #include "auth-zonecache.hh"
 #endif
 #include "arguments.hh"
@@ -726,6 +727,76 @@ BOOST_AUTO_TEST_CASE(test_AuthViews)
   BOOST_CHECK_EQUAL(PC.purgeView(view2), 1U);
   BOOST_CHECK_EQUAL(PC.size(), 0U);
 }
+
+BOOST_AUTO_TEST_CASE(test_AuthDenialCache)
+{
+  AuthDenialCache DC; // NOLINT(readability-identifier-length)
+  DC.setTTL(3600);
+
+  ZoneName zone("example.org");
+  DNSName apex("example.org");
+  vector<DNSZoneRecord> nsecs;
+
+  auto makeNSEC = [](const DNSName& name, const DNSName& next) {
+    DNSZoneRecord rec;
+    rec.dr.d_name = name;
+    rec.dr.d_type = QType::NSEC;
+    rec.dr.d_place = DNSResourceRecord::AUTHORITY;
+    auto nrc = std::make_shared<NSECRecordContent>();
+    nrc->d_next = next;
+    rec.dr.setContent(nrc);
+    return rec;
+  };
+
+  // nothing exists between a. and d., learned from b.example.org
+  DNSName before("a.example.org");
+  DNSName after("d.example.org");
+  BOOST_CHECK_EQUAL(AuthDenialCache::getClosestEncloser(DNSName("b.example.org"), before, after), apex);
+  DC.insert(zone, 1, 2025010101, before, after, apex, {makeNSEC(before, after), makeNSEC(apex, before)});
+  BOOST_CHECK_EQUAL(DC.size(), 1U);
+
+  // any other name inside the gap gets the same proof
+  BOOST_CHECK(DC.get(zone, 1, 2025010101, DNSName("c.example.org"), true, nsecs));
+  BOOST_REQUIRE_EQUAL(nsecs.size(), 2U);
+  BOOST_CHECK_EQUAL(nsecs.at(0).dr.d_name, before);
+  BOOST_CHECK_EQUAL(nsecs.at(1).dr.d_name, apex);
+  nsecs.clear();
+  BOOST_CHECK(DC.get(zone, 1, 2025010101, DNSName("x.b.example.org"), false, nsecs));
+  BOOST_CHECK(nsecs.empty());
+
+  // the borders themselves exist, and names below 'a' have another closest encloser
+  BOOST_CHECK(!DC.get(zone, 1, 2025010101, before, false, nsecs));
+  BOOST_CHECK(!DC.get(zone, 1, 2025010101, after, false, nsecs));
+  BOOST_CHECK(!DC.get(zone, 1, 2025010101, DNSName("x.a.example.org"), false, nsecs));
+  BOOST_CHECK(!DC.get(zone, 1, 2025010101, DNSName("e.example.org"), false, nsecs));
+
+  // another zone version or zone id does not match
+  BOOST_CHECK(!DC.get(zone, 1, 2025010102, DNSName("c.example.org"), false, nsecs));
+  BOOST_CHECK(!DC.get(zone, 2, 2025010101, DNSName("c.example.org"), false, nsecs));
+
+  // the last link wraps around to the apex, and without NSEC records it only serves non-DO queries
+  DC.insert(zone, 1, 2025010101, DNSName("z.example.org"), apex, apex, {});
+  BOOST_CHECK_EQUAL(DC.size(), 2U);
+  BOOST_CHECK(DC.get(zone, 1, 2025010101, DNSName("zz.example.org"), false, nsecs));
+  BOOST_CHECK(!DC.get(zone, 1, 2025010101, DNSName("zz.example.org"), true, nsecs));
+  BOOST_CHECK(nsecs.empty());
+
+  // a DO-less answer does not replace the proof, a new serial drops everything
+  DC.insert(zone, 1, 2025010101, before, after, apex, {});
+  BOOST_CHECK(DC.get(zone, 1, 2025010101, DNSName("c.example.org"), true, nsecs));
+  nsecs.clear();
+  DC.insert(zone, 1, 2025010102, before, after, apex, {});
+  BOOST_CHECK_EQUAL(DC.size(), 1U);
+  BOOST_CHECK(!DC.get(zone, 1, 2025010102, DNSName("zz.example.org"), false, nsecs));
+
+  // any change inside the zone purges it as a whole
+  DC.insert(ZoneName("example.net"), 3, 1, DNSName("a.example.net"), DNSName("example.net"), DNSName("example.net"), {});
+  BOOST_CHECK_EQUAL(DC.size(), 2U);
+  BOOST_CHECK_EQUAL(DC.purgeExact(DNSName("www.example.org")), 1U);
+  BOOST_CHECK_EQUAL(DC.size(), 1U);
+  BOOST_CHECK_EQUAL(DC.purge("net$"), 1U);
+  BOOST_CHECK_EQUAL(DC.size(), 0U);
+}
 #endif // ] PDNS_AUTH
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+#ifndef BOOST_TEST_DYN_LINK
+#define BOOST_TEST_DYN_LINK
+#endif
+
+#define BOOST_TEST_NO_MAIN
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_SQLITE3
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+#include "ssqlite3.hh"
+
+BOOST_AUTO_TEST_SUITE(test_ssqlite3_cc)
+
+/* A fresh database in its own directory, with a table shaped like the records one */
+struct BulkInsertFixture
+{
+  BulkInsertFixture()
+  {
+    char path[] = "/tmp/pdns-test-ssqlite3.XXXXXX";
+    BOOST_REQUIRE(mkdtemp(path) != nullptr);
+    d_directory = path;
+    d_db = std::make_unique<SSQLite3>(nullptr, d_directory + "/test.sqlite3", "", true);
+    d_db->execute("create table records (content varchar(64000), ttl integer, name varchar(255) not null)");
+  }
+
+  BulkInsertFixture(const BulkInsertFixture&) = delete;
+  BulkInsertFixture(BulkInsertFixture&&) = delete;
+  BulkInsertFixture& operator=(const BulkInsertFixture&) = delete;
+  BulkInsertFixture& operator=(BulkInsertFixture&&) = delete;
+
+  ~BulkInsertFixture()
+  {
+    d_db.reset();
+    unlink((d_directory + "/test.sqlite3").c_str());
+    rmdir(d_directory.c_str());
+  }
+
+  [[nodiscard]] std::unique_ptr<SSqlBulkInserter> inserter(size_t batchSize) const
+  {
+    return d_db->bulkInserter("records", {"content", "ttl", "name"}, batchSize);
+  }
+
+  size_t count(const string& where = "") const
+  {
+    SSqlStatement::result_t result;
+    d_db->prepare("select count(*) from records" + (where.empty() ? "" : " where " + where), 0)->execute()->getResult(result);
+    BOOST_REQUIRE_EQUAL(result.size(), 1U);
+    return std::stoul(result.at(0).at(0));
+  }
+
+  static SSqlBulkInserter::row_t row(size_t idx)
+  {
+    return {"192.0.2." + std::to_string(idx), std::to_string(3600 + idx), "host" + std::to_string(idx) + ".example.com"};
+  }
+
+  string d_directory;
+  std::unique_ptr<SSQLite3> d_db;
+};
+
+BOOST_FIXTURE_TEST_CASE(test_bulk_insert, BulkInsertFixture)
+{
+  auto bulk = inserter(3);
+  BOOST_REQUIRE(bulk != nullptr);
+
+  d_db->startTransaction();
+  bulk->addRow(row(0));
+  bulk->addRow(row(1));
+  /* buffered, not in the table yet */
+  BOOST_CHECK_EQUAL(count(), 0U);
+
+  /* a full batch is sent right away */
+  bulk->addRow(row(2));
+  BOOST_CHECK_EQUAL(count(), 3U);
+
+  for (size_t idx = 3; idx < 10; idx++) {
+    bulk->addRow(row(idx));
+  }
+  BOOST_CHECK_EQUAL(count(), 9U);
+
+  /* the last, partial batch */
+  bulk->flush();
+  BOOST_CHECK_EQUAL(count(), 10U);
+  bulk->flush();
+  BOOST_CHECK_EQUAL(count(), 10U);
+
+  /* NULL fields, as for empty non-terminals */
+  bulk->addRow({std::nullopt, std::nullopt, "ent.example.com"});
+  bulk->flush();
+  d_db->commit();
+
+  BOOST_CHECK_EQUAL(count(), 11U);
+  BOOST_CHECK_EQUAL(count("content is null and ttl is null and name = 'ent.example.com'"), 1U);
+  for (size_t idx = 0; idx < 10; idx++) {
+    const auto expected = row(idx);
+    BOOST_CHECK_EQUAL(count("content = '" + *expected.at(0) + "' and ttl = " + *expected.at(1) + " and name = '" + *expected.at(2) + "'"), 1U);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(test_bulk_insert_discard, BulkInsertFixture)
+{
+  auto bulk = inserter(3);
+  BOOST_REQUIRE(bulk != nullptr);
+
+  d_db->startTransaction();
+  for (size_t idx = 0; idx < 4; idx++) {
+    bulk->addRow(row(idx));
+  }
+  BOOST_CHECK_EQUAL(count(), 3U);
+
+  /* the buffered row is dropped, the batch already sent goes away with the transaction */
+  bulk->discard();
+  bulk->flush();
+  BOOST_CHECK_EQUAL(count(), 3U);
+  d_db->rollback();
+  BOOST_CHECK_EQUAL(count(), 0U);
+
+  /* and the inserter can be used for the next transaction */
+  d_db->startTransaction();
+  bulk->addRow(row(42));
+  bulk->flush();
+  d_db->commit();
+  BOOST_CHECK_EQUAL(count(), 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(test_bulk_insert_errors, BulkInsertFixture)
+{
+  auto bulk = inserter(3);
+  BOOST_REQUIRE(bulk != nullptr);
+
+  d_db->startTransaction();
+  /* a row that does not match the columns is refused, and not buffered */
+  BOOST_CHECK_THROW(bulk->addRow({"192.0.2.1", "3600"}), SSqlException);
+  bulk->flush();
+  BOOST_CHECK_EQUAL(count(), 0U);
+
+  /* a batch the database refuses: the error is reported by the call sending it */
+  bulk->addRow(row(0));
+  bulk->addRow({"192.0.2.1", "3600", std::nullopt});
+  BOOST_CHECK_THROW(bulk->addRow(row(2)), SSqlException);
+  BOOST_CHECK_EQUAL(count(), 0U);
+
+  /* the refused rows are not sent again */
+  bulk->flush();
+  BOOST_CHECK_EQUAL(count(), 0U);
+
+  /* a partial batch refused on flush */
+  bulk->addRow({"192.0.2.1", "3600", std::nullopt});
+  BOOST_CHECK_THROW(bulk->flush(), SSqlException);
+  bulk->flush();
+  BOOST_CHECK_EQUAL(count(), 0U);
+
+  /* the full batch statement is prepared again after its failure */
+  for (size_t idx = 0; idx < 3; idx++) {
+    bulk->addRow(row(idx));
+  }
+  d_db->commit();
+  BOOST_CHECK_EQUAL(count(), 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif /* HAVE_SQLITE3 */
@@ -223,4 +223,63 @@ BOOST_AUTO_TEST_CASE(test_tng_upgrade) {
   BOOST_CHECK_EQUAL(rr.content, std::string("192.0.3.4"));
 }
 
+BOOST_AUTO_TEST_CASE(test_tng_parallel) {
+  const std::vector<std::string> zonedata({
+    "$TTL 3600",
+    "@ IN SOA ns1.test. hostmaster.test. (",
+    "  1 ; serial",
+    "  3600 1800 604800 300 )",
+    "  IN NS ns1",
+    "ns1 IN A 192.0.2.1",
+    "   IN AAAA 2001:db8::1 ; comment",
+    "; nothing but a comment",
+    "",
+    "www 300 IN CNAME ns1",
+    "$GENERATE 1-25/2 host-$ IN A 192.0.2.$",
+    "  IN TXT \"follows the last generated record\"",
+    "$ORIGIN sub.test.",
+    "mail IN MX 10 @",
+    "$TTL 60",
+    "txt IN TXT \"a ( b\" ( \"c\"",
+    "  \"d\" )",
+    "$GENERATE 0-3 other-$ CNAME host-$",
+    "last IN A 192.0.2.2",
+  });
+
+  auto parse = [&zonedata](size_t threads) {
+    std::vector<std::string> result;
+    ZoneParserTNG zoneparser(zonedata, ZoneName("test"));
+    zoneparser.setParallel(threads, 2);
+    DNSResourceRecord rr;
+    std::string comment;
+    while (zoneparser.get(rr, &comment)) {
+      /* the origin reported is the one of the record just returned, not that of the lines read ahead */
+      result.push_back(zoneparser.getZoneName().toString() + " " + rr.qname.toString() + " " + std::to_string(rr.ttl) + " " + rr.qtype.toString() + " " + rr.content + " " + comment);
+    }
+    return result;
+  };
+
+  auto sequential = parse(1);
+  BOOST_CHECK_EQUAL(sequential.size(), 26U);
+  BOOST_CHECK_EQUAL(sequential.front().substr(0, 6), "test. ");
+  BOOST_CHECK_EQUAL(sequential.back().substr(0, 10), "sub.test. ");
+  for (size_t threads : {2, 3, 8}) {
+    auto parallel = parse(threads);
+    BOOST_CHECK_EQUAL_COLLECTIONS(parallel.begin(), parallel.end(), sequential.begin(), sequential.end());
+  }
+
+  {
+    /* the records preceding an error are returned first */
+    ZoneParserTNG zoneparser(std::vector<std::string>({"$TTL 60", "a IN A 192.0.2.1", "b IN A 192.0.2.2", "c IN A 192.0.2.3", "d IN BOGUS foo", "e IN A 192.0.2.4"}), ZoneName("test"));
+    zoneparser.setParallel(2, 1);
+    DNSResourceRecord rr;
+    BOOST_CHECK(zoneparser.get(rr));
+    BOOST_CHECK(zoneparser.get(rr));
+    BOOST_CHECK(zoneparser.get(rr));
+    BOOST_CHECK_EQUAL(rr.qname.toString(), "c.test.");
+    BOOST_CHECK_THROW(zoneparser.get(rr), std::exception);
+    BOOST_CHECK_EQUAL(zoneparser.getLineOfFile(), "on line 5 of given string");
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -10,13 +10,16 @@
 #include "arguments.hh"
 #include "auth-packetcache.hh"
 #include "auth-querycache.hh"
+#include "auth-denialcache.hh"
 #include "auth-zonecache.hh"
 #include "statbag.hh"
 
 StatBag S;
 AuthPacketCache PC;
 AuthQueryCache QC;
+AuthDenialCache DC;
 AuthZoneCache g_zoneCache;
+std::string g_memberCatalogGroup;
 uint16_t g_maxNSEC3Iterations{0};
 bool g_slogStructured{false};
 bool g_logDNSQueries{false};
@@ -20,9 +20,17 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
 #include "validate.hh"
 #include "dnssec.hh"
 #include "base32.hh"
+#include "lock.hh"
+#include "sha.hh"
+#include "stat_t.hh"
 
 uint32_t g_signatureInceptionSkew{0};
 uint16_t g_maxNSEC3Iterations{0};
@@ -1060,13 +1068,172 @@ namespace
   return false;
 }
 
+// A bounded map from a binary key to a value, evicting the least recently used entries. It is
+// split in shards so that the validating threads do not all contend on a single lock.
+template <typename T>
+class VerificationCache
+{
+public:
+  [[nodiscard]] bool enabled() const
+  {
+    return d_maxEntriesPerShard.load() > 0;
+  }
+
+  std::optional<T> get(const std::string& key)
+  {
+    auto lock = getShard(key).lock();
+    auto& idx = lock->template get<KeyTag>();
+    auto entry = idx.find(key);
+    if (entry == idx.end()) {
+      ++d_misses;
+      return std::nullopt;
+    }
+    auto& lru = lock->template get<LRUTag>();
+    lru.relocate(lru.end(), lock->template project<LRUTag>(entry));
+    ++d_hits;
+    return entry->d_value;
+  }
+
+  void insert(std::string&& key, T value)
+  {
+    const auto maxEntries = d_maxEntriesPerShard.load();
+    if (maxEntries == 0) {
+      return;
+    }
+    auto lock = getShard(key).lock();
+    if (!lock->insert(Entry{std::move(key), std::move(value)}).second) {
+      return;
+    }
+    ++d_entries;
+    auto& lru = lock->template get<LRUTag>();
+    while (lru.size() > maxEntries) {
+      lru.pop_front();
+      --d_entries;
+    }
+  }
+
+  void setMaxEntries(size_t maxEntries)
+  {
+    d_maxEntriesPerShard = maxEntries == 0 ? 0 : std::max(maxEntries / s_shardCount, static_cast<size_t>(1));
+    clear();
+  }
+
+  void clear()
+  {
+    for (auto& shard : d_shards) {
+      auto lock = shard.lock();
+      d_entries -= lock->size();
+      lock->clear();
+    }
+  }
+
+  [[nodiscard]] uint64_t hits() const
+  {
+    return d_hits;
+  }
+
+  [[nodiscard]] uint64_t misses() const
+  {
+    return d_misses;
+  }
+
+  [[nodiscard]] uint64_t size() const
+  {
+    return d_entries;
+  }
+
+private:
+  struct Entry
+  {
+    std::string d_key;
+    T d_value;
+  };
+  struct KeyTag
+  {
+  };
+  struct LRUTag
+  {
+  };
+  using container_t = boost::multi_index_container<
+    Entry,
+    boost::multi_index::indexed_by<
+      boost::multi_index::hashed_unique<boost::multi_index::tag<KeyTag>, boost::multi_index::member<Entry, std::string, &Entry::d_key>>,
+      boost::multi_index::sequenced<boost::multi_index::tag<LRUTag>>>>;
+
+  static constexpr size_t s_shardCount = 16;
+
+  LockGuarded<container_t>& getShard(const std::string& key)
+  {
+    return d_shards.at(std::hash<std::string>{}(key) % s_shardCount);
+  }
+
+  std::array<LockGuarded<container_t>, s_shardCount> d_shards;
+  std::atomic<size_t> d_maxEntriesPerShard{0};
+  pdns::stat_t d_hits{0};
+  pdns::stat_t d_misses{0};
+  pdns::stat_t d_entries{0};
+};
+
+VerificationCache<std::shared_ptr<const DNSCryptoKeyEngine>> s_keyEngines;
+VerificationCache<bool> s_signatureResults;
+
+std::shared_ptr<const DNSCryptoKeyEngine> getKeyEngine(const DNSKEYRecordContent& key)
+{
+  if (!s_keyEngines.enabled()) {
+    return DNSCryptoKeyEngine::makeFromPublicKeyString(g_slog->withName("validate"), key.d_algorithm, key.d_key);
+  }
+
+  std::string cacheKey;
+  cacheKey.reserve(key.d_key.size() + 1);
+  cacheKey.push_back(static_cast<char>(key.d_algorithm));
+  cacheKey.append(key.d_key);
+  if (auto engine = s_keyEngines.get(cacheKey)) {
+    return *engine;
+  }
+
+  std::shared_ptr<const DNSCryptoKeyEngine> engine = DNSCryptoKeyEngine::makeFromPublicKeyString(g_slog->withName("validate"), key.d_algorithm, key.d_key);
+  s_keyEngines.insert(std::move(cacheKey), engine);
+  return engine;
+}
+
+std::string getSignatureCacheKey(const DNSKEYRecordContent& key, const std::string& msg, const std::string& signature)
+{
+  /* the lengths make sure that moving bytes from one field to the next yields a different digest */
+  std::string lengths;
+  for (auto length : {key.d_key.size(), msg.size(), signature.size()}) {
+    lengths.append(std::to_string(length));
+    lengths.push_back(' ');
+  }
+  lengths.push_back(static_cast<char>(key.d_algorithm));
+
+  pdns::SHADigest digest(256);
+  digest.process(lengths);
+  digest.process(key.d_key);
+  digest.process(msg);
+  digest.process(signature);
+  return digest.digest();
+}
+
 [[nodiscard]] bool checkSignatureWithKey(const DNSName& qname, const RRSIGRecordContent& sig, const DNSKEYRecordContent& key, const std::string& msg, vState& ede, const OptLog& log)
 {
   bool result = false;
   try {
-    auto dke = DNSCryptoKeyEngine::makeFromPublicKeyString(g_slog->withName("validate"), key.d_algorithm, key.d_key);
-    result = dke->verify(msg, sig.d_signature);
-    VLOG(log, qname << ": Signature by key with tag " << sig.d_tag << " and algorithm " << DNSSEC::algorithm2name(sig.d_algorithm) << " was " << (result ? "" : "NOT ") << "valid" << endl);
+    std::string cacheKey;
+    std::optional<bool> cached;
+    if (s_signatureResults.enabled()) {
+      cacheKey = getSignatureCacheKey(key, msg, sig.d_signature);
+      cached = s_signatureResults.get(cacheKey);
+    }
+    if (cached) {
+      result = *cached;
+    }
+    else {
+      result = getKeyEngine(key)->verify(msg, sig.d_signature);
+      if (!cacheKey.empty()) {
+        s_signatureResults.insert(std::move(cacheKey), result);
+      }
+    }
+    VLOG(log, qname << ": Signature by key with tag " << sig.d_tag << " and algorithm " << DNSSEC::algorithm2name(sig.d_algorithm) << " was " << (result ? "" : "NOT ") << "valid" << (cached ? " (cached)" : "") << endl);
     if (!result) {
       ede = vState::BogusNoValidRRSIG;
     }
@@ -1080,6 +1247,30 @@ namespace
 
 }
 
+void pdns::validation::setVerificationCacheSizes(size_t keyEntries, size_t signatureEntries)
+{
+  s_keyEngines.setMaxEntries(keyEntries);
+  s_signatureResults.setMaxEntries(signatureEntries);
+}
+
+void pdns::validation::clearVerificationCaches()
+{
+  s_keyEngines.clear();
+  s_signatureResults.clear();
+}
+
+pdns::validation::VerificationCacheStats pdns::validation::getVerificationCacheStats()
+{
+  VerificationCacheStats stats;
+  stats.d_keyHits = s_keyEngines.hits();
+  stats.d_keyMisses = s_keyEngines.misses();
+  stats.d_keyEntries = s_keyEngines.size();
+  stats.d_signatureHits = s_signatureResults.hits();
+  stats.d_signatureMisses = s_signatureResults.misses();
+  stats.d_signatureEntries = s_signatureResults.size();
+  return stats;
+}
+
 vState validateWithKeySet(time_t now, const DNSName& name, const sortedRecords_t& toSign, const vector<shared_ptr<const RRSIGRecordContent>>& signatures, const skeyset_t& keys, const OptLog& log, pdns::validation::ValidationContext& context, bool validateAllSigs)
 {
   // whether we could not find the corresponding key in keys for at least one signature
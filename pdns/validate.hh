@@ -121,6 +121,24 @@ public:
   }
 };
 
+
+/* Process-wide caches shared by all validating threads: the key engines built from the DNSKEYs
+   signatures were verified with, so that popular keys (root, TLDs) are only parsed once, and the
+   outcome of recent signature verifications, keyed by a SHA-256 digest of the key, the signed
+   data and the signature. A size of 0 disables the corresponding cache. */
+struct VerificationCacheStats
+{
+  uint64_t d_keyHits{0};
+  uint64_t d_keyMisses{0};
+  uint64_t d_signatureHits{0};
+  uint64_t d_signatureMisses{0};
+  uint64_t d_keyEntries{0};
+  uint64_t d_signatureEntries{0};
+};
+
+void setVerificationCacheSizes(size_t keyEntries, size_t signatureEntries);
+void clearVerificationCaches();
+VerificationCacheStats getVerificationCacheStats();
 }
 
 vState validateWithKeySet(time_t now, const DNSName& name, const sortedRecords_t& toSign, const vector<shared_ptr<const RRSIGRecordContent>>& signatures, const skeyset_t& keys, const OptLog& log, pdns::validation::ValidationContext& context, bool validateAllSigs = true);
@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <string>
 #include <map>
+#include <thread>
 
 #include <iostream>
 #include <stdio.h>
@@ -207,6 +208,7 @@ try
     else {
       ZoneParserTNG zpt(zonefile, ZoneName(::arg()["zone-name"]));
       zpt.setMaxGenerateSteps(::arg().asNum("max-generate-steps"));
+      zpt.setParallel(std::thread::hardware_concurrency());
       DNSResourceRecord rr;
       string zname;
       Json::object obj;
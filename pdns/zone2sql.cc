@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <string>
 #include <map>
+#include <thread>
 
 #include <iostream>
 #include <stdio.h>
@@ -341,6 +342,7 @@ try
 
       ZoneParserTNG zpt(zonefile, zonename);
       zpt.setMaxGenerateSteps(::arg().asNum("max-generate-steps"));
+      zpt.setParallel(std::thread::hardware_concurrency());
       DNSResourceRecord rr;
       startNewTransaction();
       string comment;
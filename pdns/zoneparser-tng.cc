@@ -35,9 +35,134 @@
 #include <system_error>
 #include <cinttypes>
 #include <sys/stat.h>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 const static string g_INstr("IN");
 
+// A run of zone lines handed to a worker thread, together with the parser
+// context ($ORIGIN, $TTL) in effect at its first line.
+struct ZoneParserTNG::Chunk
+{
+  struct Record
+  {
+    DNSName qname;
+    QType qtype;
+    uint32_t ttl;
+    string content;
+    string comment;
+    uint32_t origin; // index into origins
+  };
+
+  vector<string> lines;
+  vector<pair<size_t, int>> sources; // index into files, line number
+  vector<string> files;
+  ZoneName origin;
+  int defaultTTL{3600};
+  bool haveSpecificTTL{false};
+  bool upgradeContent{false};
+  bool generateEnabled{true};
+  size_t maxGenerateSteps{0};
+
+  vector<Record> records;
+  vector<ZoneName> origins; // the $ORIGIN values in effect for the records, in order
+  std::exception_ptr error;
+  pair<string, int> errorSource;
+  std::promise<void> parsed;
+  std::future<void> ready{parsed.get_future()};
+};
+
+struct ZoneParserTNG::ParallelState
+{
+  ParallelState(size_t threads, size_t lines) :
+    chunkLines(std::max(lines, static_cast<size_t>(1))), maxInFlight(threads * 4)
+  {
+    workers.reserve(threads);
+    for (size_t idx = 0; idx < threads; ++idx) {
+      workers.emplace_back([this]() { work(); });
+    }
+  }
+
+  ~ParallelState()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cond.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  ParallelState(const ParallelState&) = delete;
+  ParallelState& operator=(const ParallelState&) = delete;
+
+  void work()
+  {
+    for (;;) {
+      Chunk* chunk{nullptr};
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]() { return stop || !queue.empty(); });
+        if (stop) {
+          return;
+        }
+        chunk = queue.front();
+        queue.pop_front();
+      }
+      parseChunk(*chunk);
+      chunk->parsed.set_value();
+    }
+  }
+
+  void submit(std::unique_ptr<Chunk>&& chunk)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push_back(chunk.get());
+    }
+    inFlight.push_back(std::move(chunk));
+    cond.notify_one();
+  }
+
+  // $GENERATE whose range is handed out to the workers in slices
+  struct PendingGenerate
+  {
+    string rest;
+    string file;
+    int lineno;
+    uint64_t next;
+    uint64_t stop;
+    uint64_t step;
+  };
+
+  const size_t chunkLines;
+  const size_t maxInFlight;
+  // chunks in zone order, the front one being consumed
+  std::deque<std::unique_ptr<Chunk>> inFlight;
+  size_t position{0};
+  bool consuming{false};
+  std::unique_ptr<Chunk> building;
+  std::optional<PendingGenerate> generate;
+  bool inParens{false};
+  bool inputDone{false};
+  std::optional<pair<string, int>> errorSource;
+  // $ORIGIN in effect for the record last returned, as the calling thread reads ahead,
+  // and its index in the origins of the chunk being consumed
+  ZoneName origin;
+  std::optional<uint32_t> originIndex;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<Chunk*> queue;
+  bool stop{false};
+  vector<std::thread> workers;
+};
+
 ZoneParserTNG::ZoneParserTNG(const string& fname, ZoneName zname, string reldir, bool upgradeContent):
   d_reldir(std::move(reldir)), d_zonename(std::move(zname)), d_defaultttl(3600),
   d_templatecounter(0), d_templatestop(0), d_templatestep(0),
@@ -93,6 +218,18 @@ void ZoneParserTNG::stackFile(const std::string& fname)
   d_fileset.emplace_back(std::make_pair(fname, st.st_ctime));
 }
 
+void ZoneParserTNG::includeFile(string fname)
+{
+  // Find the first semicolon and remove everything after it, including the semicolon
+  if (auto semicolon_pos = fname.find(';'); semicolon_pos != string::npos) {
+    fname.resize(semicolon_pos);
+  }
+  if (!fname.empty() && fname[0] != '/' && !d_reldir.empty()) {
+    fname = d_reldir + "/" + fname;
+  }
+  stackFile(fname);
+}
+
 ZoneParserTNG::~ZoneParserTNG()
 {
   while(!d_filestates.empty()) {
@@ -318,11 +455,25 @@ static bool findAndElide(string& line, char c)
 
 ZoneName ZoneParserTNG::getZoneName()
 {
+  if (d_parallel) {
+    return d_parallel->origin;
+  }
   return d_zonename;
 }
 
 string ZoneParserTNG::getLineOfFile()
 {
+  if (d_chunk != nullptr || (d_parallel && d_parallel->errorSource)) {
+    auto [file, lineno] = getLineNumAndFile();
+    if (lineno == 0) {
+      return "";
+    }
+    if (file.empty()) {
+      return "on line "+std::to_string(lineno)+" of given string";
+    }
+    return "on line "+std::to_string(lineno)+" of file '"+file+"'";
+  }
+
   if (!d_zonedata.empty())
     return "on line "+std::to_string(std::distance(d_zonedata.begin(), d_zonedataline))+" of given string";
 
@@ -334,15 +485,113 @@ string ZoneParserTNG::getLineOfFile()
 
 pair<string,int> ZoneParserTNG::getLineNumAndFile()
 {
+  if (d_chunk != nullptr) {
+    auto index = static_cast<size_t>(std::distance(d_zonedata.begin(), d_zonedataline));
+    if (index == 0 || index > d_chunk->sources.size()) {
+      return {"", 0};
+    }
+    const auto& source = d_chunk->sources.at(index - 1);
+    return {d_chunk->files.at(source.first), source.second};
+  }
+  if (d_parallel && d_parallel->errorSource) {
+    return *d_parallel->errorSource;
+  }
+
   if (d_filestates.empty())
     return {"", 0};
   else
     return {d_filestates.top().d_filename, d_filestates.top().d_lineno};
 }
 
+// $GENERATE 1-127 $ CNAME $.0
+// The range part can be one of two forms: start-stop or start-stop/step. If the first
+// form is used, then step is set to 1. start, stop and step must be positive
+// integers between 0 and (2^31)-1. start must not be larger than stop.
+// http://www.zytrax.com/books/dns/ch8/generate.html
+static void parseGenerateRange(string range, uint32_t& start, uint32_t& stop, uint32_t& step)
+{
+  auto splitOnOnlyOneSeparator = [range](const std::string& input, std::vector<std::string>& output, char separator) {
+    output.clear();
+
+    auto pos = input.find(separator);
+    if (pos == string::npos) {
+      output.emplace_back(input);
+      return;
+    }
+    if (pos == (input.size()-1)) {
+      /* ends on a separator!? */
+      throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
+    }
+    auto next = input.find(separator, pos + 1);
+    if (next != string::npos) {
+      /* more than one separator */
+      throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
+    }
+    output.emplace_back(input.substr(0, pos));
+    output.emplace_back(input.substr(pos + 1));
+  };
+
+  std::vector<std::string> fields;
+  splitOnOnlyOneSeparator(range, fields, '-');
+  if (fields.size() != 2) {
+    throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
+  }
+
+  auto parseValue = [](const std::string& parameters, const std::string& name, const std::string& str, uint32_t& value) {
+    try {
+      auto got = std::stoul(str);
+      if (got > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Invalid " + name + " value in $GENERATE parameters '" + parameters + "'");
+      }
+      value = static_cast<uint32_t>(got);
+    }
+    catch (const std::exception& e) {
+      throw std::runtime_error("Invalid " + name + " value in $GENERATE parameters '" + parameters + "': " + e.what());
+    }
+  };
+
+  parseValue(range, "start", fields.at(0), start);
+
+  /* now the remaining part(s) */
+  range = std::move(fields.at(1));
+  splitOnOnlyOneSeparator(range, fields, '/');
+
+  if (fields.size() > 2) {
+    throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
+  }
+
+  parseValue(range, "stop", fields.at(0), stop);
+
+  if (fields.size() == 2) {
+    parseValue(range, "step", fields.at(1), step);
+  }
+  else {
+    step = 1;
+  }
+
+  if (step < 1 ||
+      stop < start) {
+    throw std::runtime_error("Invalid $GENERATE parameters");
+  }
+}
+
+void ZoneParserTNG::checkGenerateSteps(uint32_t start, uint32_t stop, uint32_t step) const
+{
+  if (d_maxGenerateSteps != 0) {
+    size_t numberOfSteps = (stop - start) / step;
+    if (numberOfSteps > d_maxGenerateSteps) {
+      throw std::runtime_error("The number of $GENERATE steps (" + std::to_string(numberOfSteps) + ") is too high, the maximum is set to " + std::to_string(d_maxGenerateSteps));
+    }
+  }
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 bool ZoneParserTNG::get(DNSResourceRecord& rr, std::string* comment)
 {
+  if (d_parallel) {
+    return getParallel(rr, comment);
+  }
+
  retry:;
   if(!getTemplateLine() && !getLine())
     return false;
@@ -369,15 +618,7 @@ bool ZoneParserTNG::get(DNSResourceRecord& rr, std::string* comment)
       d_havespecificttl=true;
     }
     else if(pdns_iequals(command,"$INCLUDE") && d_parts.size() > 1 && d_fromfile) {
-      string fname=unquotify(makeString(d_line, d_parts[1]));
-      // Find the first semicolon and remove everything after it, including the semicolon
-      if (auto semicolon_pos = fname.find(';'); semicolon_pos != string::npos) {
-        fname.resize(semicolon_pos);
-      }
-      if (!fname.empty() && fname[0] != '/' && !d_reldir.empty()) {
-        fname = d_reldir + "/" + fname;
-      }
-      stackFile(fname);
+      includeFile(unquotify(makeString(d_line, d_parts[1])));
     }
     else if(pdns_iequals(command, "$ORIGIN") && d_parts.size() > 1) {
       d_zonename = ZoneName(makeString(d_line, d_parts[1]));
@@ -386,82 +627,8 @@ bool ZoneParserTNG::get(DNSResourceRecord& rr, std::string* comment)
       if (!d_generateEnabled) {
         throw exception("$GENERATE is not allowed in this zone");
       }
-      // $GENERATE 1-127 $ CNAME $.0
-      // The range part can be one of two forms: start-stop or start-stop/step. If the first
-      // form is used, then step is set to 1. start, stop and step must be positive
-      // integers between 0 and (2^31)-1. start must not be larger than stop.
-      // http://www.zytrax.com/books/dns/ch8/generate.html
-      string range = makeString(d_line, d_parts.at(1));
-
-      auto splitOnOnlyOneSeparator = [range](const std::string& input, std::vector<std::string>& output, char separator) {
-        output.clear();
-
-        auto pos = input.find(separator);
-        if (pos == string::npos) {
-          output.emplace_back(input);
-          return;
-        }
-        if (pos == (input.size()-1)) {
-          /* ends on a separator!? */
-          throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
-        }
-        auto next = input.find(separator, pos + 1);
-        if (next != string::npos) {
-          /* more than one separator */
-          throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
-        }
-        output.emplace_back(input.substr(0, pos));
-        output.emplace_back(input.substr(pos + 1));
-      };
-
-      std::vector<std::string> fields;
-      splitOnOnlyOneSeparator(range, fields, '-');
-      if (fields.size() != 2) {
-        throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
-      }
-
-      auto parseValue = [](const std::string& parameters, const std::string& name, const std::string& str, uint32_t& value) {
-        try {
-          auto got = std::stoul(str);
-          if (got > std::numeric_limits<uint32_t>::max()) {
-            throw std::runtime_error("Invalid " + name + " value in $GENERATE parameters '" + parameters + "'");
-          }
-          value = static_cast<uint32_t>(got);
-        }
-        catch (const std::exception& e) {
-          throw std::runtime_error("Invalid " + name + " value in $GENERATE parameters '" + parameters + "': " + e.what());
-        }
-      };
-
-      parseValue(range, "start", fields.at(0), d_templatecounter);
-
-      /* now the remaining part(s) */
-      range = std::move(fields.at(1));
-      splitOnOnlyOneSeparator(range, fields, '/');
-
-      if (fields.size() > 2) {
-        throw std::runtime_error("Invalid range from $GENERATE parameters '" + range + "'");
-      }
-
-      parseValue(range, "stop", fields.at(0), d_templatestop);
-
-      if (fields.size() == 2) {
-        parseValue(range, "step", fields.at(1), d_templatestep);
-      }
-      else {
-        d_templatestep = 1;
-      }
-
-      if (d_templatestep < 1 ||
-          d_templatestop < d_templatecounter) {
-        throw std::runtime_error("Invalid $GENERATE parameters");
-      }
-      if (d_maxGenerateSteps != 0) {
-        size_t numberOfSteps = (d_templatestop - d_templatecounter) / d_templatestep;
-        if (numberOfSteps > d_maxGenerateSteps) {
-          throw std::runtime_error("The number of $GENERATE steps (" + std::to_string(numberOfSteps) + ") is too high, the maximum is set to " + std::to_string(d_maxGenerateSteps));
-        }
-      }
+      parseGenerateRange(makeString(d_line, d_parts.at(1)), d_templatecounter, d_templatestop, d_templatestep);
+      checkGenerateSteps(d_templatecounter, d_templatestop, d_templatestep);
 
       d_templateline = d_line;
       d_parts.pop_front();
@@ -706,3 +873,258 @@ bool ZoneParserTNG::getLine()
   }
   return false;
 }
+
+void ZoneParserTNG::setParallel(size_t threads, size_t chunkLines)
+{
+  if (threads < 2) {
+    d_parallel.reset();
+    return;
+  }
+  d_parallel = std::make_unique<ParallelState>(threads, chunkLines);
+  d_parallel->origin = d_zonename;
+}
+
+// Runs on a worker thread: parses the lines of a chunk with a sequential
+// parser primed with the context in effect at the start of the chunk
+void ZoneParserTNG::parseChunk(Chunk& chunk)
+{
+  try {
+    ZoneParserTNG zpt(vector<string>(), chunk.origin, chunk.upgradeContent);
+    zpt.d_zonedata = std::move(chunk.lines);
+    zpt.d_zonedataline = zpt.d_zonedata.begin();
+    zpt.d_defaultttl = chunk.defaultTTL;
+    zpt.d_havespecificttl = chunk.haveSpecificTTL;
+    zpt.d_generateEnabled = chunk.generateEnabled;
+    zpt.d_maxGenerateSteps = chunk.maxGenerateSteps;
+    zpt.d_chunk = &chunk;
+
+    DNSResourceRecord rr;
+    string comment;
+    try {
+      while (zpt.get(rr, &comment)) {
+        if (chunk.origins.empty() || chunk.origins.back() != zpt.d_zonename) {
+          chunk.origins.push_back(zpt.d_zonename);
+        }
+        chunk.records.push_back({rr.qname, rr.qtype, rr.ttl, std::move(rr.content), std::move(comment), static_cast<uint32_t>(chunk.origins.size() - 1)});
+      }
+    }
+    catch (...) {
+      chunk.errorSource = zpt.getLineNumAndFile();
+      throw;
+    }
+  }
+  catch (...) {
+    chunk.error = std::current_exception();
+  }
+}
+
+bool ZoneParserTNG::getParallel(DNSResourceRecord& rr, std::string* comment)
+{
+  auto& state = *d_parallel;
+  for (;;) {
+    if (state.consuming) {
+      auto& chunk = *state.inFlight.front();
+      if (state.position < chunk.records.size()) {
+        auto& record = chunk.records[state.position++];
+        rr.qname = std::move(record.qname);
+        rr.qtype = record.qtype;
+        rr.ttl = record.ttl;
+        rr.content = std::move(record.content);
+        if (state.originIndex != record.origin) {
+          state.origin = chunk.origins.at(record.origin);
+          state.originIndex = record.origin;
+        }
+        if (comment != nullptr) {
+          *comment = std::move(record.comment);
+        }
+        return true;
+      }
+      auto error = chunk.error;
+      if (error) {
+        state.errorSource = chunk.errorSource;
+      }
+      state.inFlight.pop_front();
+      state.consuming = false;
+      if (error) {
+        // only now, so that the records preceding the error have been returned
+        std::rethrow_exception(error);
+      }
+    }
+
+    splitInput();
+    if (state.inFlight.empty()) {
+      return false;
+    }
+    state.inFlight.front()->ready.wait();
+    state.consuming = true;
+    state.position = 0;
+    state.originIndex.reset();
+  }
+}
+
+// Reads input on the calling thread until enough chunks are in flight
+void ZoneParserTNG::splitInput()
+{
+  static const string s_nofile;
+  auto& state = *d_parallel;
+
+  try {
+    while (state.inFlight.size() < state.maxInFlight) {
+      if (state.generate) {
+        splitGenerate();
+        continue;
+      }
+      if (state.inputDone) {
+        dispatchChunk();
+        break;
+      }
+      if (!getLine()) {
+        state.inputDone = true;
+        continue;
+      }
+      string line = std::move(d_line);
+      if (!d_zonedata.empty()) {
+        splitLine(std::move(line), s_nofile, static_cast<int>(std::distance(d_zonedata.begin(), d_zonedataline)));
+      }
+      else {
+        const auto& current = d_filestates.top();
+        splitLine(std::move(line), current.d_filename, current.d_lineno);
+      }
+    }
+  }
+  catch (...) {
+    // hand out what was read before the error, then the error itself
+    dispatchChunk();
+    state.generate.reset();
+    state.inputDone = true;
+
+    auto chunk = std::make_unique<Chunk>();
+    chunk->error = std::current_exception();
+    if (!d_zonedata.empty()) {
+      chunk->errorSource = {"", static_cast<int>(std::distance(d_zonedata.begin(), d_zonedataline))};
+    }
+    else {
+      chunk->errorSource = getLineNumAndFile();
+    }
+    chunk->parsed.set_value();
+    state.inFlight.push_back(std::move(chunk));
+  }
+}
+
+void ZoneParserTNG::addSplitLine(string&& line, const string& file, int lineno)
+{
+  auto& state = *d_parallel;
+  if (!state.building) {
+    state.building = std::make_unique<Chunk>();
+    state.building->lines.reserve(state.chunkLines);
+    state.building->origin = d_zonename;
+    state.building->defaultTTL = d_defaultttl;
+    state.building->haveSpecificTTL = d_havespecificttl;
+    state.building->upgradeContent = d_upgradeContent;
+    state.building->generateEnabled = d_generateEnabled;
+    state.building->maxGenerateSteps = d_maxGenerateSteps;
+  }
+
+  auto& chunk = *state.building;
+  if (chunk.files.empty() || chunk.files.back() != file) {
+    chunk.files.push_back(file);
+  }
+  chunk.sources.emplace_back(chunk.files.size() - 1, lineno);
+  chunk.lines.push_back(std::move(line));
+}
+
+// Decides where a chunk may end. Chunks only ever start on a line carrying
+// its own owner name, outside of parentheses, and once $TTL has been seen,
+// as otherwise the default TTL depends on the records preceding it.
+// $INCLUDE is followed here; $TTL and $ORIGIN are tracked and passed on.
+void ZoneParserTNG::splitLine(string&& line, const string& file, int lineno)
+{
+  auto& state = *d_parallel;
+
+  if (state.inParens) {
+    if (line.find(')') != string::npos) {
+      string copy(line);
+      chopComment(copy);
+      state.inParens = !findAndElide(copy, ')');
+    }
+    addSplitLine(std::move(line), file, lineno);
+    return;
+  }
+
+  if (line.empty()) {
+    return;
+  }
+
+  if (line[0] == '$') {
+    d_line = line;
+    boost::trim_right_if(d_line, boost::is_any_of(" \t\r\n\x1a"));
+    d_parts.clear();
+    vstringtok(d_parts, d_line);
+    string command = makeString(d_line, d_parts[0]);
+
+    if (pdns_iequals(command, "$TTL") && d_parts.size() > 1) {
+      d_defaultttl = makeTTLFromZone(trim_right_copy_if(makeString(d_line, d_parts[1]), boost::is_any_of(";")));
+      d_havespecificttl = true;
+    }
+    else if (pdns_iequals(command, "$INCLUDE") && d_parts.size() > 1 && d_fromfile) {
+      includeFile(unquotify(makeString(d_line, d_parts[1])));
+      return;
+    }
+    else if (pdns_iequals(command, "$ORIGIN") && d_parts.size() > 1) {
+      d_zonename = ZoneName(makeString(d_line, d_parts[1]));
+    }
+    else if (pdns_iequals(command, "$GENERATE") && d_parts.size() > 2 && d_generateEnabled && d_havespecificttl) {
+      uint32_t start{0};
+      uint32_t stop{0};
+      uint32_t step{0};
+      parseGenerateRange(makeString(d_line, d_parts.at(1)), start, stop, step);
+      checkGenerateSteps(start, stop, step);
+      if ((stop - start) / step >= state.chunkLines) {
+        dispatchChunk();
+        state.generate = ParallelState::PendingGenerate{d_line.substr(d_parts.at(2).first), file, lineno, start, stop, step};
+        return;
+      }
+    }
+    addSplitLine(std::move(line), file, lineno);
+    return;
+  }
+
+  if (!dns_isspace(line[0]) && line[0] != ';' && d_havespecificttl && state.building && state.building->lines.size() >= state.chunkLines) {
+    dispatchChunk();
+  }
+  if (line.find('(') != string::npos) {
+    string copy(line);
+    chopComment(copy);
+    state.inParens = findAndElide(copy, '(') && !findAndElide(copy, ')');
+  }
+  addSplitLine(std::move(line), file, lineno);
+}
+
+// Hands out the next slice of a large $GENERATE range. The last slice stays
+// in the chunk being built, as the lines following it may refer to its owner.
+void ZoneParserTNG::splitGenerate()
+{
+  auto& state = *d_parallel;
+  auto& generate = *state.generate;
+
+  uint64_t remaining = (generate.stop - generate.next) / generate.step + 1;
+  uint64_t count = std::min(remaining, static_cast<uint64_t>(state.chunkLines));
+  uint64_t last = generate.next + (count - 1) * generate.step;
+  addSplitLine("$GENERATE " + std::to_string(generate.next) + "-" + std::to_string(last) + "/" + std::to_string(generate.step) + " " + generate.rest, generate.file, generate.lineno);
+
+  if (count == remaining) {
+    state.generate.reset();
+  }
+  else {
+    generate.next = last + generate.step;
+    dispatchChunk();
+  }
+}
+
+void ZoneParserTNG::dispatchChunk()
+{
+  auto& state = *d_parallel;
+  if (state.building) {
+    state.submit(std::move(state.building));
+  }
+}
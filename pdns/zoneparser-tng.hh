@@ -25,6 +25,7 @@
 #include <stdexcept>
 #include <stack>
 #include <deque>
+#include <memory>
 
 #include "namespaces.hh"
 
@@ -58,12 +59,29 @@ public:
     d_defaultttl = ttl;
     d_havespecificttl = true;
   }
+  // Parses the zone on `threads' worker threads, in chunks of about
+  // `chunkLines' lines split off by the calling thread, records still being
+  // returned in zone order. Fewer than 2 threads keeps parsing sequential.
+  // Must be called before the first get().
+  void setParallel(size_t threads, size_t chunkLines = 4096);
   std::vector<std::pair<std::string, time_t>> getFileset() const { return d_fileset; }
 private:
+  struct Chunk;
+  struct ParallelState;
+
   bool getLine();
   bool getTemplateLine();
   void stackFile(const std::string& fname);
+  void includeFile(std::string fname);
   unsigned makeTTLFromZone(const std::string& str);
+  void checkGenerateSteps(uint32_t start, uint32_t stop, uint32_t step) const;
+  bool getParallel(DNSResourceRecord& rr, std::string* comment);
+  void addSplitLine(std::string&& line, const std::string& file, int lineno);
+  void splitInput();
+  void splitLine(std::string&& line, const std::string& file, int lineno);
+  void splitGenerate();
+  void dispatchChunk();
+  static void parseChunk(Chunk& chunk);
 
   struct filestate {
     filestate(FILE* fp, string filename) :
@@ -93,4 +111,6 @@ private:
   bool d_upgradeContent;
   bool d_templateCounterWrapped{false};
   std::vector<std::pair<std::string, time_t>> d_fileset;
+  std::unique_ptr<ParallelState> d_parallel;
+  const Chunk* d_chunk{nullptr}; // set when parsing a chunk, for error reporting
 };
@@ -51,6 +51,7 @@ socket-dir={confdir}
 cache-ttl=0
 negquery-cache-ttl=0
 query-cache-ttl=0
+denial-cache-ttl=0
 log-dns-queries=yes
 log-dns-details=yes
 loglevel=9
@@ -0,0 +1,165 @@
+#!/usr/bin/env python
+import dns
+import dns.update
+import os
+import socket
+import subprocess
+import time
+
+from authtests import AuthTest
+
+
+class TestDNSUpdateGroupCommit(AuthTest):
+    """
+    With dnsupdate-group-commit, the updates queued for a zone while another
+    update to it is in progress are applied together, in one transaction.
+    The Lua update policy holds the update of slow.update.example. for a
+    while, so that the updates sent right after it end up in the same group.
+    """
+
+    _backend = "gsqlite3"
+    _zone = "update.example."
+
+    _config_template = """
+launch=gsqlite3
+gsqlite3-database=configs/auth/powerdns.sqlite
+gsqlite3-pragma-foreign-keys=yes
+allow-dnsupdate-from=0.0.0.0/0
+dnsupdate=yes
+dnsupdate-group-commit=10
+distributor-threads=8
+lua-dnsupdate-policy-script=configs/auth/update-policy.lua
+"""
+
+    _updatePolicy = """
+function updatepolicy(query)
+  if query:getQName():toString() == "slow.update.example." then
+    local start = os.time()
+    while os.time() - start < 2 do
+    end
+  end
+  return true
+end
+"""
+
+    @classmethod
+    def pdnsutil(cls, *args):
+        pdnsutilCmd = [os.environ["PDNSUTIL"], "--config-dir=configs/auth"] + list(args)
+        print(" ".join(pdnsutilCmd))
+        try:
+            subprocess.check_output(pdnsutilCmd, stderr=subprocess.STDOUT)
+        except subprocess.CalledProcessError as e:
+            raise AssertionError("%s failed (%d): %s" % (pdnsutilCmd, e.returncode, e.output))
+
+    @classmethod
+    def generateAuthConfig(cls, confdir):
+        super(TestDNSUpdateGroupCommit, cls).generateAuthConfig(confdir)
+        with open(os.path.join(confdir, "update-policy.lua"), "w") as policy:
+            policy.write(cls._updatePolicy)
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestDNSUpdateGroupCommit, cls).setUpClass()
+        cls.pdnsutil("create-zone", cls._zone)
+        cls.pdnsutil("replace-rrset", cls._zone, cls._zone, "SOA", "3600", cls._SOA)
+        cls.pdnsutil("replace-rrset", cls._zone, cls._zone, "NS", "3600", "ns1.example.net.")
+        cls.pdnsutil("replace-rrset", cls._zone, "keep." + cls._zone, "A", "3600", "192.0.2.1")
+        cls.pdnsutil("replace-rrset", cls._zone, "conflict." + cls._zone, "A", "3600", "192.0.2.2")
+        cls.pdnsutil("set-meta", cls._zone, "SOA-EDIT-DNSUPDATE", "INCREASE")
+
+    def getSerial(self):
+        res = self.sendUDPQuery(dns.message.make_query(self._zone, "SOA"))
+        self.assertRcodeEqual(res, dns.rcode.NOERROR)
+        return res.answer[0][0].serial
+
+    def assertRRsetPresent(self, name, present=True):
+        res = self.sendUDPQuery(dns.message.make_query(name + "." + self._zone, "A"))
+        self.assertEqual(len(res.answer) != 0, present, res)
+
+    def sendUpdates(self, updates):
+        """
+        Sends the update for slow.update.example. followed, while it is being
+        held, by updates, each from its own socket. Returns the RCODEs of updates.
+        """
+        slow = dns.update.UpdateMessage(self._zone)
+        slow.add("slow", 60, "A", "192.0.2.100")
+
+        sockets = []
+        for update in [slow] + updates:
+            sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            sock.settimeout(10.0)
+            sock.connect((self._PREFIX + ".1", self._authPort))
+            sock.send(update.to_wire())
+            sockets.append(sock)
+            if update is slow:
+                time.sleep(0.5)
+
+        rcodes = []
+        for sock in sockets:
+            res = dns.message.from_wire(sock.recv(4096))
+            sock.close()
+            rcodes.append(res.rcode())
+
+        self.assertEqual(rcodes[0], dns.rcode.NOERROR)
+        self.pdnsutil("delete-rrset", self._zone, "slow." + self._zone, "A")
+        return rcodes[1:]
+
+    def testOneSerialIncreasePerGroup(self):
+        serial = self.getSerial()
+        updates = []
+        for name in ["group1", "group2", "group3"]:
+            update = dns.update.UpdateMessage(self._zone)
+            update.add(name, 60, "A", "192.0.2.10")
+            updates.append(update)
+
+        self.assertEqual(self.sendUpdates(updates), [dns.rcode.NOERROR] * 3)
+
+        # once for the slow update, once for the group
+        self.assertEqual(self.getSerial(), serial + 2)
+        for name in ["group1", "group2", "group3"]:
+            self.assertRRsetPresent(name)
+
+    def testPrerequisiteFailingLaterInGroup(self):
+        serial = self.getSerial()
+
+        first = dns.update.UpdateMessage(self._zone)
+        first.add("prereq1", 60, "A", "192.0.2.20")
+        # checked against the zone as left by the first update
+        failing = dns.update.UpdateMessage(self._zone)
+        failing.absent("prereq1")
+        failing.add("prereq2", 60, "A", "192.0.2.21")
+        last = dns.update.UpdateMessage(self._zone)
+        last.present("prereq1", "A")
+        last.add("prereq3", 60, "A", "192.0.2.22")
+
+        self.assertEqual(
+            self.sendUpdates([first, failing, last]), [dns.rcode.NOERROR, dns.rcode.YXDOMAIN, dns.rcode.NOERROR]
+        )
+
+        self.assertEqual(self.getSerial(), serial + 2)
+        self.assertRRsetPresent("prereq1")
+        self.assertRRsetPresent("prereq2", False)
+        self.assertRRsetPresent("prereq3")
+
+    def testGroupRollback(self):
+        serial = self.getSerial()
+
+        first = dns.update.UpdateMessage(self._zone)
+        first.add("rollback1", 60, "A", "192.0.2.30")
+        # the deletion is performed before the CNAME is refused
+        failing = dns.update.UpdateMessage(self._zone)
+        failing.delete("keep", "A")
+        failing.add("conflict", 60, "CNAME", "keep.update.example.")
+        last = dns.update.UpdateMessage(self._zone)
+        last.add("rollback3", 60, "A", "192.0.2.31")
+
+        self.assertEqual(
+            self.sendUpdates([first, failing, last]), [dns.rcode.NOERROR, dns.rcode.REFUSED, dns.rcode.NOERROR]
+        )
+
+        # the group was rolled back and the updates applied one by one,
+        # leaving nothing of the failing one behind
+        self.assertEqual(self.getSerial(), serial + 3)
+        self.assertRRsetPresent("rollback1")
+        self.assertRRsetPresent("keep")
+        self.assertRRsetPresent("rollback3")
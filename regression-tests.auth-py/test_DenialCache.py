@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+import base64
+import os
+import subprocess
+
+import dns
+import dns.dnssec
+
+from authtests import AuthTest
+
+
+class TestDenialCache(AuthTest):
+    """
+    NXDOMAIN and NODATA answers from NSEC and NSEC3 zones with the denial
+    cache enabled. Names falling in an NSEC range that is already known are
+    answered from the cache, and have to get a denial that is as valid as
+    the one built from the backend.
+    """
+
+    _backend = "gsqlite3"
+
+    _config_template = """
+launch=gsqlite3
+gsqlite3-database=configs/auth/powerdns.sqlite
+gsqlite3-pragma-foreign-keys=yes
+gsqlite3-dnssec=yes
+denial-cache-ttl=60
+"""
+
+    # zone name => whether it uses NSEC3
+    _denialZones = {"nsec.example.": False, "nsec3.example.": True}
+
+    _denialZone = """
+{zone} 3600 IN SOA {soa}
+{zone} 3600 IN NS ns1.{zone}
+ns1.{zone} 3600 IN A 192.0.2.1
+mail.{zone} 3600 IN A 192.0.2.2
+www.{zone} 3600 IN A 192.0.2.3
+deep.sub.{zone} 3600 IN A 192.0.2.4
+"""
+
+    @classmethod
+    def pdnsutil(cls, *args):
+        pdnsutilCmd = [os.environ["PDNSUTIL"], "--config-dir=configs/auth"] + list(args)
+        print(" ".join(pdnsutilCmd))
+        try:
+            subprocess.check_output(pdnsutilCmd, stderr=subprocess.STDOUT)
+        except subprocess.CalledProcessError as e:
+            raise AssertionError("%s failed (%d): %s" % (pdnsutilCmd, e.returncode, e.output))
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestDenialCache, cls).setUpClass()
+        for zone, nsec3 in cls._denialZones.items():
+            zonefile = os.path.join("configs", cls._confdir, zone + "zone")
+            with open(zonefile, "w") as fdZone:
+                fdZone.write(cls._denialZone.format(zone=zone, soa=cls._SOA))
+            cls.pdnsutil("load-zone", zone, zonefile)
+            cls.pdnsutil("secure-zone", zone)
+            if nsec3:
+                cls.pdnsutil("set-nsec3", zone, "1 0 0 -")
+            cls.pdnsutil("rectify-zone", zone)
+
+    def getStat(self, name):
+        output = subprocess.check_output([os.environ["PDNSCONTROL"], "--socket-dir=configs/auth", "show", name])
+        return int(output.strip())
+
+    def query(self, qname, qtype, dnssec=True):
+        query = dns.message.make_query(qname, qtype, use_edns=True, want_dnssec=dnssec)
+        res = self.sendUDPQuery(query)
+        self.assertMessageHasFlags(res, ["AA", "QR", "RD"], ["DO"] if dnssec else [])
+        self.assertTrue(any(rrset.rdtype == dns.rdatatype.SOA for rrset in res.authority), res)
+        return res
+
+    @staticmethod
+    def covers(owner, nextName, name):
+        if owner < nextName:
+            return owner < name < nextName
+        # the last link of the chain points back to the start
+        return name > owner or name < nextName
+
+    @staticmethod
+    def nsec3Records(res):
+        ret = []
+        for rrset in res.authority:
+            if rrset.rdtype == dns.rdatatype.NSEC3:
+                ret.append(
+                    (rrset.name.labels[0].decode().lower(), base64.b32hexencode(rrset[0].next).decode().lower())
+                )
+        return ret
+
+    @staticmethod
+    def nsec3Hash(name):
+        return dns.dnssec.nsec3_hash(name, salt=None, iterations=0, algorithm=1).lower()
+
+    def assertCovered(self, res, name, nsec3):
+        if nsec3:
+            links = self.nsec3Records(res)
+            name = self.nsec3Hash(name)
+        else:
+            links = [(rrset.name, rrset[0].next) for rrset in res.authority if rrset.rdtype == dns.rdatatype.NSEC]
+        self.assertTrue(any(self.covers(owner, nextName, name) for owner, nextName in links), f"{name} in {res}")
+
+    def assertDenialEqual(self, res, expected):
+        # the signatures are left out, they are not necessarily the same
+        def denial(msg):
+            return sorted(rrset.to_text() for rrset in msg.authority if rrset.rdtype != dns.rdatatype.RRSIG)
+
+        self.assertEqual(denial(res), denial(expected))
+
+    def checkNXDomain(self, zone, name, closestEncloser):
+        """
+        Checks the NXDOMAIN answer for name, relative to zone, whose closest
+        encloser (relative to zone as well, empty for the apex) is given
+        """
+        nsec3 = self._denialZones[zone]
+        origin = dns.name.from_text(zone)
+        qname = dns.name.from_text(name, origin)
+        encloser = dns.name.from_text(closestEncloser, origin) if closestEncloser else origin
+
+        res = self.query(qname, "A")
+        self.assertRcodeEqual(res, dns.rcode.NXDOMAIN)
+        self.assertEqual(res.answer, [])
+        if nsec3:
+            self.assertIn(self.nsec3Hash(encloser), [owner for owner, _ in self.nsec3Records(res)])
+            nextCloser = dns.name.Name(qname.labels[-(len(encloser.labels) + 1) :])
+            self.assertCovered(res, nextCloser, nsec3)
+        else:
+            self.assertCovered(res, qname, nsec3)
+        self.assertCovered(res, dns.name.from_text("*", encloser), nsec3)
+        return res
+
+    def checkNoData(self, zone, name, qtype):
+        res = self.query(dns.name.from_text(name, dns.name.from_text(zone)), qtype)
+        self.assertRcodeEqual(res, dns.rcode.NOERROR)
+        self.assertEqual(res.answer, [])
+        denialType = dns.rdatatype.NSEC3 if self._denialZones[zone] else dns.rdatatype.NSEC
+        self.assertTrue(any(rrset.rdtype == denialType for rrset in res.authority), res)
+        return res
+
+    def checkDenials(self, zone):
+        # the first name fills the cache, the following ones fall in the same range
+        # with the same closest encloser
+        first = self.checkNXDomain(zone, "a", "")
+        for name in ["b", "foo", "deeper.than.a"]:
+            self.assertDenialEqual(self.checkNXDomain(zone, name, ""), first)
+
+        # without DO, there is only the SOA
+        res = self.query(dns.name.from_text("c", dns.name.from_text(zone)), "A", dnssec=False)
+        self.assertRcodeEqual(res, dns.rcode.NXDOMAIN)
+        self.assertEqual([rrset.rdtype for rrset in res.authority], [dns.rdatatype.SOA])
+
+        # same range in an NSEC zone, but the closest encloser differs
+        self.checkNXDomain(zone, "x.www", "www")
+        self.checkNXDomain(zone, "zz", "")
+        self.checkNXDomain(zone, "y.www", "www")
+        self.checkNXDomain(zone, "x.deep.sub", "deep.sub")
+
+        for name, qtype in [("www", "TXT"), ("sub", "A"), ("", "AAAA")]:
+            first = self.checkNoData(zone, name, qtype)
+            self.assertDenialEqual(self.checkNoData(zone, name, qtype), first)
+
+    def testNSEC(self):
+        hits = self.getStat("denial-cache-hit")
+        self.checkDenials("nsec.example.")
+        self.assertGreaterEqual(self.getStat("denial-cache-hit"), hits + 3)
+
+    def testNSEC3(self):
+        # NSEC3 zones are not cached
+        hits = self.getStat("denial-cache-hit")
+        self.checkDenials("nsec3.example.")
+        self.assertEqual(self.getStat("denial-cache-hit"), hits)
+
+    def testNoDataTypes(self):
+        res = self.checkNoData("nsec.example.", "www", "TXT")
+        nsec = res.find_rrset(
+            dns.message.AUTHORITY, dns.name.from_text("www.nsec.example."), dns.rdataclass.IN, dns.rdatatype.NSEC
+        )
+        types = nsec[0].to_text().split()[1:]
+        self.assertIn("A", types)
+        self.assertNotIn("TXT", types)
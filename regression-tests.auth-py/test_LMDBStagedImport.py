@@ -0,0 +1,143 @@
+#!/usr/bin/env python
+import dns
+import errno
+import fcntl
+import os
+import subprocess
+import time
+
+from authtests import AuthTest
+
+
+class TestLMDBStagedImport(AuthTest):
+    """
+    With lmdb-staged-import, the records of a zone being replaced as a whole
+    are kept in memory until the replacement is committed. pdnsutil load-zone
+    reads the new contents from a FIFO, so that the import can be held half
+    way, while the server is queried.
+    """
+
+    _backend = "lmdb"
+    _zone = "staged.example."
+
+    _config_template = """
+launch=lmdb
+lmdb-staged-import=yes
+"""
+
+    _zones = {
+        "staged.example": """
+staged.example.              3600 IN SOA  {soa}
+staged.example.              3600 IN NS   ns1.staged.example.
+ns1.staged.example.          3600 IN A    192.0.2.1
+www.staged.example.          3600 IN A    192.0.2.1
+old.staged.example.          3600 IN A    192.0.2.2
+"""
+    }
+
+    def getAnswer(self, name, qtype="A"):
+        res = self.sendUDPQuery(dns.message.make_query(name + "." + self._zone, qtype))
+        return (res.rcode(), res.answer)
+
+    def getContents(self):
+        return [self.getAnswer(name) for name in ["www", "old", "new", "filler1", "last"]]
+
+    def getSerial(self):
+        res = self.sendUDPQuery(dns.message.make_query(self._zone, "SOA"))
+        self.assertRcodeEqual(res, dns.rcode.NOERROR)
+        return res.answer[0][0].serial
+
+    def startLoad(self):
+        """
+        Starts pdnsutil load-zone on a FIFO, returns the process and the
+        writing end of the FIFO
+        """
+        fifo = os.path.join("configs", self._confdir, "staged.fifo")
+        if os.path.exists(fifo):
+            os.unlink(fifo)
+        os.mkfifo(fifo)
+
+        pdnsutilCmd = [
+            os.environ["PDNSUTIL"],
+            "--config-dir=configs/auth",
+            "load-zone",
+            self.maybeAddVariant(self._zone),
+            fifo,
+        ]
+        print(" ".join(pdnsutilCmd))
+        proc = subprocess.Popen(pdnsutilCmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+
+        # opening the writing end fails until pdnsutil has opened the FIFO
+        while True:
+            try:
+                fd = os.open(fifo, os.O_WRONLY | os.O_NONBLOCK)
+                break
+            except OSError as e:
+                if e.errno != errno.ENXIO:
+                    raise
+                if proc.poll() is not None:
+                    raise AssertionError("pdnsutil exited early: %s" % proc.stdout.read())
+                time.sleep(0.1)
+        fcntl.fcntl(fd, fcntl.F_SETFL, fcntl.fcntl(fd, fcntl.F_GETFL) & ~os.O_NONBLOCK)
+        return (proc, os.fdopen(fd, "w"))
+
+    def writeFirstPart(self, writer, serial):
+        soa = "ns1.example.net. hostmaster.example.net. %d 3600 1800 1209600 300" % serial
+        writer.write("%s 3600 IN SOA %s\n" % (self._zone, soa))
+        writer.write("%s 3600 IN NS ns1.%s\n" % (self._zone, self._zone))
+        writer.write("ns1.%s 3600 IN A 192.0.2.1\n" % self._zone)
+        writer.write("www.%s 3600 IN A 192.0.2.10\n" % self._zone)
+        writer.write("new.%s 3600 IN A 192.0.2.3\n" % self._zone)
+        for idx in range(1000):
+            writer.write("filler%d.%s 3600 IN A 192.0.2.4\n" % (idx, self._zone))
+        writer.flush()
+
+    def assertImportHeld(self, proc, serial, contents):
+        # whether the records fed so far have reached the backend or are still
+        # being parsed, none of them may be visible yet
+        for _ in range(5):
+            time.sleep(0.2)
+            self.assertIsNone(proc.poll(), proc.stdout.read() if proc.poll() is not None else "")
+            self.assertEqual(self.getSerial(), serial)
+            self.assertEqual(self.getContents(), contents)
+
+    def testCommit(self):
+        serial = self.getSerial()
+        contents = self.getContents()
+        self.assertEqual(contents[1][0], dns.rcode.NOERROR)
+        self.assertEqual(contents[2][0], dns.rcode.NXDOMAIN)
+
+        proc, writer = self.startLoad()
+        self.writeFirstPart(writer, serial + 1)
+        self.assertImportHeld(proc, serial, contents)
+
+        writer.write("last.%s 3600 IN A 192.0.2.5\n" % self._zone)
+        writer.close()
+        output, _ = proc.communicate(timeout=60)
+        self.assertEqual(proc.returncode, 0, output)
+
+        # all at once
+        self.assertEqual(self.getSerial(), serial + 1)
+        www, old, new, filler, last = self.getContents()
+        self.assertEqual(www[1], [dns.rrset.from_text("www." + self._zone, 3600, "IN", "A", "192.0.2.10")])
+        self.assertEqual(old[0], dns.rcode.NXDOMAIN)
+        self.assertEqual(new[1], [dns.rrset.from_text("new." + self._zone, 3600, "IN", "A", "192.0.2.3")])
+        self.assertEqual(filler[1], [dns.rrset.from_text("filler1." + self._zone, 3600, "IN", "A", "192.0.2.4")])
+        self.assertEqual(last[1], [dns.rrset.from_text("last." + self._zone, 3600, "IN", "A", "192.0.2.5")])
+
+    def testAbort(self):
+        serial = self.getSerial()
+        contents = self.getContents()
+
+        proc, writer = self.startLoad()
+        self.writeFirstPart(writer, serial + 1)
+        self.assertImportHeld(proc, serial, contents)
+
+        # pdnsutil gives up on the whole import
+        writer.write("last.%s 3600 IN A not-an-address\n" % self._zone)
+        writer.close()
+        output, _ = proc.communicate(timeout=60)
+        self.assertNotEqual(proc.returncode, 0, output)
+
+        self.assertEqual(self.getSerial(), serial)
+        self.assertEqual(self.getContents(), contents)
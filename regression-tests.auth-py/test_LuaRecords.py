@@ -6,6 +6,7 @@ import dns.rcode
 import dns.rdataclass
 import dns.message
 import os
+import socket
 import time
 import clientsubnetoption
 
@@ -14,6 +15,7 @@ from authtests import AuthTest
 from http.server import BaseHTTPRequestHandler, HTTPServer
 
 webserver = None
+blackhole = None
 
 
 class FakeHTTPServer(BaseHTTPRequestHandler):
@@ -141,6 +143,7 @@ usa-404      IN    LUA    A   ( ";include('config')                         "
                                 "USAips, {{ httpcode='404' }})              ")
 
 ifurlextup   IN    LUA    A   "ifurlextup({{{{['192.168.0.1']='http://{prefix}.101:8080/404',['192.168.0.2']='http://{prefix}.102:8080/404'}}, {{['192.168.0.3']='http://{prefix}.101:8080/'}}}})"
+blackhole.ifurlextup IN LUA  A   "ifurlextup({{{{['192.168.0.1']='http://{prefix}.101:8082/'}}, {{['192.168.0.2']='http://{prefix}.101:8080/'}}}})"
 
 goodheaders.ifurlup IN  LUA   A   ("ifurlup('http://example.com:8080/check-headers', "
                                    "        {{'{prefix}.102', '192.168.42.105'}},    "
@@ -218,6 +221,7 @@ geoipqueryattribute IN LUA    TXT ("string.format('%d %d %d %d %d %d %d',"
     @classmethod
     def startResponders(cls):
         global webserver
+        global blackhole
         if webserver:
             return  # it is already running
 
@@ -225,6 +229,22 @@ geoipqueryattribute IN LUA    TXT ("string.format('%d %d %d %d %d %d %d',"
         webserver.setDaemon(True)
         webserver.start()
 
+        blackhole = threading.Thread(name="Blackhole Listener", target=cls.BlackholeResponder, args=[8082])
+        blackhole.setDaemon(True)
+        blackhole.start()
+
+    @classmethod
+    def BlackholeResponder(cls, port):
+        # accepts connections, then never sends anything back
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        sock.bind(("", port))
+        sock.listen(100)
+        connections = []
+        while True:
+            conn, _ = sock.accept()
+            connections.append(conn)
+
     @classmethod
     def HTTPResponder(cls, port):
         server_address = ("", port)
@@ -599,6 +619,26 @@ class TestLuaRecords(BaseLuaTest):
         self.assertRcodeEqual(res, dns.rcode.NOERROR)
         self.assertEqual(res.answer, expected)
 
+    def testIfurlextupBlackhole(self):
+        """
+        ifurlextup() where the first target accepts the connection but never answers,
+        which has to be marked down once the check times out
+        """
+        expected = [
+            dns.rrset.from_text("blackhole.ifurlextup.example.org.", 0, dns.rdataclass.IN, dns.rdatatype.A, "192.168.0.2")
+        ]
+
+        query = dns.message.make_query("blackhole.ifurlextup.example.org", "A")
+        self.sendUDPQuery(query)
+
+        # the check times out after 2 seconds, wait for it and for the next scheduling round
+        time.sleep(6)
+
+        res = self.sendUDPQuery(query)
+
+        self.assertRcodeEqual(res, dns.rcode.NOERROR)
+        self.assertEqual(res.answer, expected)
+
     def testIfurlupSimplified(self):
         """
         Basic ifurlup() test with the simplified list of ips
@@ -49,6 +49,7 @@ webserver-address: %s
         "ixfrdist_axfr_failures_total",
         "ixfrdist_ixfr_inqueries_total",
         "ixfrdist_ixfr_failures_total",
+        "ixfrdist_wire_cache_bytes",
     ]
 
     @classmethod
@@ -0,0 +1,128 @@
+import dns
+import os
+
+from twisted.internet.protocol import DatagramProtocol
+from twisted.internet import reactor
+
+from recursortests import RecursorTest
+
+udpSocketReuseReactorRunning = False
+# source ports the queries for each qname were received from
+queryPorts = {}
+
+
+class UDPSocketReuseTest(RecursorTest):
+    """
+    With outgoing.udp_socket_max_uses larger than 1, a socket that received the
+    answer it was waiting for is used again for the next query to the same server.
+    A socket that received anything unexpected must not be, whatever the reason
+    the packet was rejected for.
+    """
+
+    _confdir = "UDPSocketReuse"
+    _config_template = """
+recursor:
+  threads: 1
+  forward_zones:
+  - zone: reuse.example
+    forwarders: [%s.28]
+  devonly_regression_test_mode: true
+packetcache:
+  disable: true
+outgoing:
+  udp_socket_max_uses: 100
+  dont_throttle_netmasks: ['127.0.0.28']
+""" % (os.environ["PREFIX"])
+
+    @classmethod
+    def generateRecursorConfig(cls, confdir):
+        super(UDPSocketReuseTest, cls).generateRecursorYamlConfig(confdir)
+
+    @classmethod
+    def startResponders(cls):
+        global udpSocketReuseReactorRunning
+        print("Launching responders..")
+
+        address = cls._PREFIX + ".28"
+        port = 53
+
+        if not udpSocketReuseReactorRunning:
+            reactor.listenUDP(port, UDPResponder(), interface=address)
+            udpSocketReuseReactorRunning = True
+
+        cls.startReactor()
+
+    def query(self, name):
+        query = dns.message.make_query(name, "A")
+        return self.sendUDPQuery(query)
+
+    def checkReused(self, first, second):
+        self.assertRcodeEqual(self.query(first), dns.rcode.NOERROR)
+        self.assertRcodeEqual(self.query(second), dns.rcode.NOERROR)
+        self.assertEqual(queryPorts[first], queryPorts[second])
+
+    def checkNotReused(self, bad, after):
+        # the bad packet is followed by the proper answer, except for the header-only
+        # case where the packet is passed on to the waiting query, which fails
+        self.query(bad)
+        self.assertRcodeEqual(self.query(after), dns.rcode.NOERROR)
+        self.assertIn(bad, queryPorts)
+        self.assertNotIn(queryPorts[after][0], queryPorts[bad])
+
+    def testReuse(self):
+        self.checkReused("proper1.reuse.example.", "proper2.reuse.example.")
+
+    def testQR0(self):
+        self.checkNotReused("qr0.reuse.example.", "after-qr0.reuse.example.")
+
+    def testInvalidQDCount(self):
+        self.checkNotReused("qdcount.reuse.example.", "after-qdcount.reuse.example.")
+
+    def testBadName(self):
+        self.checkNotReused("badname.reuse.example.", "after-badname.reuse.example.")
+
+    def testTooShort(self):
+        self.checkNotReused("tooshort.reuse.example.", "after-tooshort.reuse.example.")
+
+    def testHeaderOnly(self):
+        self.checkNotReused("headeronly.reuse.example.", "after-headeronly.reuse.example.")
+
+
+class UDPResponder(DatagramProtocol):
+    def badPacket(self, kind, request, proper):
+        if kind == "qr0":
+            response = dns.message.make_response(request)
+            response.flags &= ~dns.flags.QR
+            return response.to_wire()
+        if kind == "qdcount":
+            # two questions and an answer
+            return proper[:4] + b"\x00\x02" + proper[6:]
+        if kind == "badname":
+            # a label running past the end of the packet
+            return proper[:12] + b"\x3fbad"
+        if kind == "tooshort":
+            return proper[:6]
+        if kind == "headeronly":
+            response = dns.message.make_response(request)
+            response.question = []
+            response.use_edns(False)
+            return response.to_wire()
+        return None
+
+    def datagramReceived(self, datagram, address):
+        request = dns.message.from_wire(datagram)
+        question = request.question[0]
+        name = question.name.to_text()
+        queryPorts.setdefault(name, []).append(address[1])
+
+        response = dns.message.make_response(request)
+        response.flags |= dns.flags.AA
+        response.answer.append(dns.rrset.from_text(question.name, 15, dns.rdataclass.IN, "A", "192.0.2.1"))
+        proper = response.to_wire()
+
+        bad = self.badPacket(name.split(".")[0], request, proper)
+        if bad is not None:
+            self.transport.write(bad, address)
+            if name.startswith("headeronly."):
+                return
+        self.transport.write(proper, address)